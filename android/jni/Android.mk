@@ -258,6 +258,11 @@ MY_FILES += $(wildcard $(ARTOOLKIT_ROOT)/lib/SRC/VideoImage/*.c)
 MY_FILES := $(MY_FILES:$(LOCAL_PATH)/%=%)
 # ARToolKit libs use lots of floating point, so don't compile in thumb mode.
 LOCAL_ARM_MODE := arm
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+  # Rather than using LOCAL_ARM_NEON := true, just compile the one file in NEON mode.
+  MY_FILES := $(subst videoPixelConvert.c,videoPixelConvert.c.neon,$(MY_FILES))
+  LOCAL_CFLAGS += -DHAVE_ARM_NEON=1
+endif
 LOCAL_SRC_FILES := $(MY_FILES)
 LOCAL_CFLAGS += $(MY_CFLAGS)
 LOCAL_C_INCLUDES := $(ARTOOLKIT_ROOT)/include/android $(ARTOOLKIT_ROOT)/include
@@ -0,0 +1,104 @@
+/*
+ *      videoRawSeq.h
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *  Copyright 2015 Daqri, LLC.
+ *
+ */
+
+/*!
+    @header videoRawSeq
+    @abstract libARvideo module which plays back a memory-mapped sequence of raw frames.
+    @discussion
+        The RawSeq module (-device=RawSeq) maps a file holding uncompressed frames and
+        returns frames as pointers directly into the mapping, so no decoding or copying
+        is done on playback. Because the mapping is private (copy-on-write), the caller
+        may write into a returned frame without altering the file.
+
+        The file consists of a 64-byte header followed by the frames, stored back to back.
+        All header fields are little-endian 32-bit integers, except the magic.
+
+        Offset  Field
+        0       magic, the 8 characters "ARRAWSEQ".
+        8       version, currently 1.
+        12      headerSize, offset of the first frame from the start of the file. At least 64.
+        16      width, in pixels.
+        20      height, in pixels.
+        24      pixelFormat, an AR_PIXEL_FORMAT value.
+        28      frameCount, or 0 to take as many whole frames as the file holds.
+        32      frameStride, bytes from the start of one frame to the next, or 0 if frames
+                are tightly packed.
+        36      fpsNum, numerator of the frame rate, or 0 if unspecified.
+        40      fpsDen, denominator of the frame rate, or 0 for 1.
+        44      reserved, must be 0.
+
+        Frames in single-plane formats are width*height*arVideoUtilGetPixelSize(pixelFormat)
+        bytes. Frames in the bi-planar formats AR_PIXEL_FORMAT_420v, AR_PIXEL_FORMAT_420f and
+        AR_PIXEL_FORMAT_NV21 hold the luma plane (width*height bytes) immediately followed by
+        the interleaved chroma plane (width*height/2 bytes), and are returned via bufPlanes.
+ */
+
+#ifndef AR_VIDEO_RAWSEQ_H
+#define AR_VIDEO_RAWSEQ_H
+
+
+#include <AR/ar.h>
+#include <AR/video.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+typedef struct _AR2VideoParamRawSeqT AR2VideoParamRawSeqT;
+
+
+int                    ar2VideoDispOptionRawSeq(void);
+AR2VideoParamRawSeqT* ar2VideoOpenRawSeq(const char *config);
+int                    ar2VideoCloseRawSeq(AR2VideoParamRawSeqT *vid);
+int                    ar2VideoGetIdRawSeq(AR2VideoParamRawSeqT *vid, ARUint32 *id0, ARUint32 *id1);
+int                    ar2VideoGetSizeRawSeq(AR2VideoParamRawSeqT *vid, int *x, int *y);
+AR_PIXEL_FORMAT        ar2VideoGetPixelFormatRawSeq(AR2VideoParamRawSeqT *vid);
+AR2VideoBufferT* ar2VideoGetImageRawSeq(AR2VideoParamRawSeqT *vid);
+int                    ar2VideoCapStartRawSeq(AR2VideoParamRawSeqT *vid);
+int                    ar2VideoCapStopRawSeq(AR2VideoParamRawSeqT *vid);
+
+int                    ar2VideoGetParamiRawSeq(AR2VideoParamRawSeqT *vid, int paramName, int *value);
+int                    ar2VideoSetParamiRawSeq(AR2VideoParamRawSeqT *vid, int paramName, int value);
+int                    ar2VideoGetParamdRawSeq(AR2VideoParamRawSeqT *vid, int paramName, double *value);
+int                    ar2VideoSetParamdRawSeq(AR2VideoParamRawSeqT *vid, int paramName, double value);
+int                    ar2VideoGetParamsRawSeq(AR2VideoParamRawSeqT *vid, const int paramName, char **value);
+int                    ar2VideoSetParamsRawSeq(AR2VideoParamRawSeqT *vid, const int paramName, const char  *value);
+
+int ar2VideoSetBufferSizeRawSeq(AR2VideoParamRawSeqT *vid, const int width, const int height);
+int ar2VideoGetBufferSizeRawSeq(AR2VideoParamRawSeqT *vid, int *width, int *height);
+
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
@@ -76,7 +76,8 @@ extern "C" {
 #define  AR_VIDEO_DEVICE_WINDOWS_MEDIA_FOUNDATION 16
 #define  AR_VIDEO_DEVICE_WINDOWS_MEDIA_CAPTURE    17
 #define  AR_VIDEO_DEVICE_V4L2                     18
-#define  AR_VIDEO_DEVICE_MAX                      18
+#define  AR_VIDEO_DEVICE_RAWSEQ                   19
+#define  AR_VIDEO_DEVICE_MAX                      19
 
 
 #define  AR_VIDEO_1394_BRIGHTNESS               65
@@ -119,6 +120,17 @@ extern "C" {
 
 #define  AR_VIDEO_WINDS_SHOW_PROPERTIES 129
 
+#define  AR_VIDEO_GSTREAMER_ZERO_COPY   140   // i. If non-zero, frames are not copied, but their GstBuffers are held until the next arVideoGetImage(). Needs a source which can spare 3 buffers.
+
+#define  AR_VIDEO_RAWSEQ_FRAME_COUNT    150   // i. Number of frames in the sequence (read-only).
+#define  AR_VIDEO_RAWSEQ_FRAME_INDEX    151   // i. Index of the frame which will be returned next. Set to seek.
+#define  AR_VIDEO_RAWSEQ_FPS            152   // d. Playback rate in frames per second.
+
+// Raw frame sequence files, as played by -device=RawSeq and written by arVideoRecorder. See videoRawSeq.h for the layout.
+#define  AR_VIDEO_RAWSEQ_MAGIC          "ARRAWSEQ"
+#define  AR_VIDEO_RAWSEQ_VERSION        1
+#define  AR_VIDEO_RAWSEQ_HEADER_SIZE    64
+
 #define  AR_VIDEO_FOCUS_MODE                301           // i
 #define  AR_VIDEO_FOCUS_MANUAL_DISTANCE     302           // d
 #define  AR_VIDEO_FOCUS_POINT_OF_INTEREST_X 303           // d
@@ -260,6 +272,9 @@ typedef void (*AR_VIDEO_FRAME_READY_CALLBACK)(void*);
 #ifdef AR_INPUT_IMAGE
 #include <AR/sys/videoImage.h>
 #endif
+#ifdef AR_INPUT_RAWSEQ
+#include <AR/sys/videoRawSeq.h>
+#endif
 #ifdef AR_INPUT_ANDROID
 #include <AR/sys/videoAndroid.h>
 #endif
@@ -315,6 +330,9 @@ typedef union
 #ifdef AR_INPUT_IMAGE
     AR2VideoParamImageT *image;
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    AR2VideoParamRawSeqT *rawSeq;
+#endif
 #ifdef AR_INPUT_ANDROID
     AR2VideoParamAndroidT *android;
 #endif
@@ -361,8 +379,193 @@ AR_DLL_API int               arVideoGetCParamAsync(void (*callback)(const ARPara
 
 AR_DLL_API int               arVideoUtilGetPixelSize(const AR_PIXEL_FORMAT arPixelFormat);
 AR_DLL_API const char*       arVideoUtilGetPixelFormatName(const AR_PIXEL_FORMAT arPixelFormat);
+
+/*!
+    @function
+    @abstract   Convert an image from one pixel format to another.
+    @discussion
+        Any AR_PIXEL_FORMAT may be converted to any other. Conversions to the RGB formats
+        take one pass over the image, and for the commonly-used formats use SSE2 or AVX2
+        (chosen at runtime) on x86 and NEON on ARM. Other destination formats go via RGBA
+        one row at a time.
+
+        Y'CbCr is taken as BT.601, full range for AR_PIXEL_FORMAT_420f and AR_PIXEL_FORMAT_NV21
+        and video range for AR_PIXEL_FORMAT_420v, AR_PIXEL_FORMAT_2vuy and AR_PIXEL_FORMAT_yuvs.
+        The 16-bit packed formats are taken to be big-endian. Alpha in the output is always
+        opaque, as video sources seldom fill it in.
+
+        Images must be tightly packed, i.e. rows are width * arVideoUtilGetPixelSize() bytes,
+        and for the bi-planar formats the chroma plane has rows of width bytes. Source and
+        destination may not overlap.
+    @param      src Pointer to the source pixels. For the bi-planar formats, the luma plane.
+    @param      srcCbCr For bi-planar source formats, the chroma plane, or NULL if it
+        directly follows the luma plane. Ignored for other formats.
+    @param      srcFormat Pixel format of the source.
+    @param      dst Pointer to the buffer to receive the converted pixels. For the bi-planar
+        formats, the luma plane.
+    @param      dstCbCr For bi-planar destination formats, the chroma plane, or NULL if it
+        directly follows the luma plane. Ignored for other formats.
+    @param      dstFormat Pixel format to convert to.
+    @param      width Width of the image, in pixels. Must be even if either format is Y'CbCr.
+    @param      height Height of the image, in pixels. Must be even if either format is bi-planar.
+    @result     0 if the image was converted, or -1 in case of error.
+ */
+AR_DLL_API int               arVideoUtilConvertPixels(const ARUint8 *src, const ARUint8 *srcCbCr, const AR_PIXEL_FORMAT srcFormat,
+                                                      ARUint8 *dst, ARUint8 *dstCbCr, const AR_PIXEL_FORMAT dstFormat,
+                                                      const int width, const int height);
+
+/*!
+    @typedef ARVideoFrameRef
+    @abstract Opaque handle to a reference-counted frame buffer.
+    @discussion
+        Lets one frame be shared by several threads, e.g. a capture thread, a tracking thread and
+        a KPM recognition thread, without copying it. Each holder takes a reference with
+        arVideoFrameRefRetain() and gives it up with arVideoFrameRefRelease(), and the buffer is
+        freed with the last reference. The pixels must not be changed while other holders may be
+        reading them, i.e. while arVideoFrameRefIsShared() returns true.
+ */
+typedef struct _ARVideoFrameRef ARVideoFrameRef;
+
+/*!
+    @function
+    @abstract Allocate a reference-counted frame buffer.
+    @param xsize Width of the frame, in pixels.
+    @param ysize Height of the frame, in pixels.
+    @param pixFormat Pixel format of the frame. For the bi-planar formats, both planes are held.
+    @result The frame, holding one reference, or NULL in case of error.
+    @seealso arVideoFrameRefRelease arVideoFrameRefRelease
+ */
+AR_DLL_API ARVideoFrameRef*  arVideoFrameRefCreate(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat);
+
+/*!
+    @function
+    @abstract Take a reference to a frame. May be called from any thread.
+    @result The frame.
+ */
+AR_DLL_API ARVideoFrameRef*  arVideoFrameRefRetain(ARVideoFrameRef *frame);
+
+/*!
+    @function
+    @abstract Give up a reference to a frame, freeing it if this was the last. May be called from any thread.
+    @param frame_p Pointer to the frame, which will be set to NULL.
+ */
+AR_DLL_API void              arVideoFrameRefRelease(ARVideoFrameRef **frame_p);
+
+/*!
+    @function
+    @abstract Find out whether anyone other than the caller holds a reference to a frame.
+    @discussion A frame which is not shared may be refilled by its holder.
+    @result 1 if more than one reference is held, or 0 otherwise.
+ */
+AR_DLL_API int               arVideoFrameRefIsShared(ARVideoFrameRef *frame);
+
+/*!
+    @function
+    @abstract Get the pixels of a frame. For the bi-planar formats, the chroma plane directly
+        follows the luma plane.
+ */
+AR_DLL_API ARUint8*          arVideoFrameRefGetBuffer(ARVideoFrameRef *frame);
+
+AR_DLL_API size_t            arVideoFrameRefGetBufferSize(ARVideoFrameRef *frame);
+
+/*!
+    @function
+    @abstract Copy a frame into a frame buffer.
+    @param frame The frame buffer. It must not be shared.
+    @param buff Pointer to the source pixels. For the bi-planar formats, the luma plane.
+    @param buffCbCr For the bi-planar formats, the chroma plane, or NULL if it directly follows
+        the luma plane. Ignored for other formats.
+    @result 0 if successful, or -1 in case of error.
+ */
+AR_DLL_API int               arVideoFrameRefFill(ARVideoFrameRef *frame, const ARUint8 *buff, const ARUint8 *buffCbCr);
+
 #if !AR_ENABLE_MINIMIZE_MEMORY_FOOTPRINT
 AR_DLL_API int               arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixels, const char *filename, const int quality /* 0 to 100 */, const int flipV);
+
+/*!
+    @typedef ARVideoRecorder
+    @abstract Opaque handle to an asynchronous frame recorder.
+    @discussion
+        A recorder saves frames on worker threads, so that recording does not slow the
+        thread which captures and tracks. See arVideoRecorderOpen().
+ */
+typedef struct _ARVideoRecorder ARVideoRecorder;
+
+typedef enum
+{
+    AR_VIDEO_RECORDER_FORMAT_JPEG = 0,   // One JPEG file per frame.
+    AR_VIDEO_RECORDER_FORMAT_RAWSEQ      // All frames, uncompressed, in one raw frame sequence file, as played by -device=RawSeq. No encoding cost.
+} AR_VIDEO_RECORDER_FORMAT;
+
+typedef enum
+{
+    AR_VIDEO_RECORDER_POLICY_DROP = 0,   // If the queue is full, discard the new frame and count it as dropped.
+    AR_VIDEO_RECORDER_POLICY_BLOCK       // If the queue is full, wait until a frame has been written.
+} AR_VIDEO_RECORDER_POLICY;
+
+/*!
+    @function
+    @abstract Start an asynchronous frame recorder.
+    @discussion
+        Frames passed to arVideoRecorderEnqueue() are copied into a bounded queue and
+        saved by worker threads. Each worker keeps its own JPEG compressor for the life
+        of the recorder.
+    @param path For AR_VIDEO_RECORDER_FORMAT_JPEG, a prefix to which the frame number and ".jpg"
+        are appended, e.g. "rec/frame-" gives "rec/frame-000000.jpg" etc. The frame timestamps
+        are written to the prefix followed by "timestamps.txt", in the form read by the Image
+        video module's -timestamps option.
+        For AR_VIDEO_RECORDER_FORMAT_RAWSEQ, the pathname of the file to write.
+    @param format Format of the recording.
+    @param w Width of the frames, in pixels.
+    @param h Height of the frames, in pixels.
+    @param pixFormat Pixel format of the frames. Bi-planar frames are recorded in full in
+        AR_VIDEO_RECORDER_FORMAT_RAWSEQ, and as their luma plane only in AR_VIDEO_RECORDER_FORMAT_JPEG.
+    @param quality JPEG quality, 0 to 100. Ignored for AR_VIDEO_RECORDER_FORMAT_RAWSEQ.
+    @param flipV If non-zero, JPEG frames are flipped vertically. Ignored for AR_VIDEO_RECORDER_FORMAT_RAWSEQ.
+    @param queueLength Maximum number of frames waiting to be saved. Each takes one frame of memory.
+    @param threads Number of JPEG encoding threads. AR_VIDEO_RECORDER_FORMAT_RAWSEQ always uses one.
+    @param policy What arVideoRecorderEnqueue() does when the queue is full.
+    @result The recorder, or NULL in case of error.
+    @seealso arVideoRecorderEnqueue arVideoRecorderEnqueue
+    @seealso arVideoRecorderClose arVideoRecorderClose
+ */
+AR_DLL_API ARVideoRecorder*  arVideoRecorderOpen(const char *path, AR_VIDEO_RECORDER_FORMAT format, int w, int h, AR_PIXEL_FORMAT pixFormat, int quality, int flipV,
+                                                 int queueLength, int threads, AR_VIDEO_RECORDER_POLICY policy);
+
+/*!
+    @function
+    @abstract Queue a frame for recording.
+    @discussion
+        The frame is copied, so the buffer may be reused as soon as this returns.
+    @param rec The recorder.
+    @param buffer The frame, e.g. as returned by ar2VideoGetImage(). Its timestamp is recorded.
+    @result 0 if the frame was queued, 1 if it was dropped because the queue was full, or -1 in case of error.
+ */
+AR_DLL_API int               arVideoRecorderEnqueue(ARVideoRecorder *rec, AR2VideoBufferT *buffer);
+
+/*!
+    @function
+    @abstract Get the recorder's frame counters.
+    @discussion Any of the pointers may be NULL.
+    @param rec The recorder.
+    @param enqueued Number of frames accepted by arVideoRecorderEnqueue().
+    @param written Number of frames saved so far.
+    @param dropped Number of frames discarded because the queue was full.
+    @param failed Number of frames which could not be saved.
+    @result 0 if successful, or -1 in case of error.
+ */
+AR_DLL_API int               arVideoRecorderGetStats(ARVideoRecorder *rec, unsigned long *enqueued, unsigned long *written, unsigned long *dropped, unsigned long *failed);
+
+/*!
+    @function
+    @abstract Finish saving queued frames and dispose of a recorder.
+    @discussion
+        Blocks until every queued frame has been saved. A raw frame sequence file's header
+        is then updated with the frame count and the mean frame rate.
+    @param rec_p Pointer to the recorder, which will be set to NULL.
+    @result 0 if every frame was saved, or -1 if any could not be.
+ */
+AR_DLL_API int               arVideoRecorderClose(ARVideoRecorder **rec_p);
 #endif // !AR_ENABLE_MINIMIZE_MEMORY_FOOTPRINT
 
 typedef enum
@@ -91,11 +91,15 @@ extern "C" {
 #endif
 
 
-#define AR2_THREAD_MAX 8
+#define AR2_THREAD_MAX 8                                        // Maximum number of tracking threads chosen by AR2_TRACKING_DEFAULT_THREAD_NUM.
 
 #define AR2_DEFAULT_SEARCH_SIZE 25                              // Default radius of feature search window.
 
-#define AR2_DEFAULT_SEARCH_FEATURE_NUM 10                       // May not be higher than AR2_SEARCH_FEATURE_MAX.
+#define AR2_DEFAULT_SEARCH_MIN_SIZE 8                           // Default smallest radius of a motion-predicted feature search window. See ar2SetSearchMinSize().
+
+#define AR2_DEFAULT_SEARCH_PYRAMID 1                            // Default for searching a half resolution frame before the full resolution frame. See ar2SetSearchPyramid().
+
+#define AR2_DEFAULT_SEARCH_FEATURE_NUM 10                       // May not be higher than the handle's searchFeatureMax.
 
 #define AR2_DEFAULT_TS1 11                                      // Template size 1. Multiplied by AR2_TEMP_SCALE to give number of pixels outside centre pixel in negative x/y axis.
 #define AR2_DEFAULT_TS2 11                                      // Template size 2. Multiplied by AR2_TEMP_SCALE to give number of pixels outside centre pixel in positive x/y axis.
@@ -107,12 +111,17 @@ extern "C" {
 
 
 /* tracking.c */
-#define    AR2_TRACKING_SURFACE_MAX   10                        // Maximum number of surfaces per surface set (i.e. maximum number of discrete surfaces with fixed relationship to each other able to be combined into a surface set.)
-#define    AR2_TRACKING_CANDIDATE_MAX 200                       // Maximum number of candidate feature points.
+#define    AR2_TRACKING_CANDIDATE_MAX 200                       // Default maximum number of candidate feature points. See ar2CreateHandle2().
+#define    AR2_TRACKING_CULL_SCREEN_MARGIN 0.25F                // Fraction of the frame size by which a feature index cell may project outside the frame and still be searched (allows for lens distortion).
+#define    AR2_TRACKING_CULL_DPI_MARGIN    1.25F                // Factor by which the resolution range at a feature index cell's corners is widened before comparing with a level's dpi range.
+
+/* featureSet.c */
+#define    AR2_FEATURE_INDEX_DIV_MAX       16                   // Maximum number of feature index cells along each axis.
+#define    AR2_FEATURE_INDEX_CELL_FEATURES 16                   // Target number of feature points per feature index cell, in the densest level.
 
 /* tracking2d.c */
 #define AR2_DEFAULT_TRACKING_SD_THRESH 5.0F
-#define AR2_SEARCH_FEATURE_MAX         40
+#define AR2_SEARCH_FEATURE_MAX         40                       // Default maximum number of features searched for per frame. See ar2CreateHandle2().
 
 
 /* genFeatureSet.c */
@@ -78,12 +78,31 @@ typedef struct
     int               num;
 } AR2FeatureSetT;
 
+// Spatial index over the feature points of an AR2FeatureSetT, used to cull features that
+// cannot be visible. The marker-space bounding box of the points is divided into a grid of
+// square cells, and for each resolution level the point indices are bucketed by cell.
+typedef struct
+{
+    int   xdiv, ydiv;               // Grid size in cells.
+    float mx, my;                   // Marker coordinates of the grid's minimum corner.
+    float cellSize;                 // Edge length of one cell, in marker coordinates.
+    int   levelNum;                 // Number of resolution levels (same as AR2FeatureSetT.num).
+    int   *cellStart;               // For each level, xdiv*ydiv + 1 offsets into coordIndex.
+    int   *coordIndex;              // For each level and cell, indices into list[level].coord in ascending order.
+} AR2FeatureIndexT;
+
 
 AR2FeatureMapT* ar2GenFeatureMap(AR2ImageT *image,
                                  int ts1, int ts2,
                                  int search_size1, int search_size2,
                                  float max_sim_thresh, float sd_thresh);
 
+// As ar2GenFeatureMap(), but using threadNum threads. If threadNum is 0, one thread per CPU is used.
+AR2FeatureMapT* ar2GenFeatureMap2(AR2ImageT *image,
+                                  int ts1, int ts2,
+                                  int search_size1, int search_size2,
+                                  float max_sim_thresh, float sd_thresh, int threadNum);
+
 AR2FeatureMapT* ar2ReadFeatureMap(char *filename, char *ext);
 
 int ar2SaveFeatureMap(char *filename, char *ext, AR2FeatureMapT *featureMap);
@@ -105,6 +124,9 @@ AR2FeatureSetT* ar2ReadFeatureSet(char *filename, char *ext);
 int             ar2SaveFeatureSet(char *filename, char *ext, AR2FeatureSetT *featureSet);
 int             ar2FreeFeatureSet(AR2FeatureSetT **featureSet);
 
+AR2FeatureIndexT* ar2GenFeatureIndex(const AR2FeatureSetT *featureSet);
+int               ar2FreeFeatureIndex(AR2FeatureIndexT **featureIndex);
+
 #ifdef __cplusplus
 }
 #endif
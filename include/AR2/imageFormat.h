@@ -60,6 +60,8 @@ typedef struct
 
 AR2JpegImageT* ar2ReadJpegImage(const char *filename, const char *ext);
 AR2JpegImageT* ar2ReadJpegImage2(FILE *fp);
+// Reads only the size, number of components and DPI of the JPEG image at the current position in fp.
+int            ar2ReadJpegImageInfo2(FILE *fp, int *xsize, int *ysize, int *nc, float *dpi);
 int            ar2WriteJpegImage(const char *filename, const char *ext, AR2JpegImageT *jpegImage, int quality);
 int            ar2WriteJpegImage2(FILE *fp, AR2JpegImageT *jpegImage, int quality);
 int            ar2FreeJpegImage(AR2JpegImageT **jpegImage);
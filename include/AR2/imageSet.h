@@ -69,7 +69,15 @@ typedef struct
 
 /*   image.c   */
 AR2ImageSetT* ar2GenImageSet(ARUint8 *image, int xsize, int ysize, int nc, float dpi, float dpi_list[], int dpi_num);
+// Image sets read from file are cached by filename and shared between callers, and all
+// scales other than scale 0 are only minified when first requested via ar2GetImageSetScale().
+// Every set returned by ar2ReadImageSet() must be released with ar2FreeImageSet().
 AR2ImageSetT* ar2ReadImageSet(char *filename);
+// May be called from several threads at once. Once a scale exists, returning it takes no lock.
+AR2ImageT*      ar2GetImageSetScale(AR2ImageSetT *imageSet, int scale);
+// Reads the size and DPI of scale 0 of the image set in filename.iset without decoding the image.
+// Returns -1 if the file cannot be read or is in the ARToolKit v4.x format.
+int             ar2ReadImageSetInfo(char *filename, int *xsize, int *ysize, float *dpi);
 int             ar2WriteImageSet(char *filename, AR2ImageSetT *imageSet);
 int             ar2FreeImageSet(AR2ImageSetT **imageSet);
 
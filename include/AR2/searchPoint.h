@@ -52,6 +52,15 @@ void ar2GetSearchPoint(const ARParamLT * cparamLT,
                        AR2FeatureCoordT * feature,
                        int search[3][2]);
 
+// Like ar2GetSearchPoint(), but once three poses are known returns a single window in search[0],
+// covering the constant-velocity and constant-acceleration predictions of the feature's position
+// with a margin of searchMinSize, in a radius of at most searchSize. Otherwise, or if searchMinSize
+// is 0, fills search[] as ar2GetSearchPoint() does and returns a radius of searchSize.
+void ar2GetSearchWindow(const ARParamLT * cparamLT,
+                        const float trans1[3][4], const float trans2[3][4], const float trans3[3][4],
+                        AR2FeatureCoordT * feature, int searchSize, int searchMinSize,
+                        int search[3][2], int *rx, int *ry);
+
 
 #ifdef __cplusplus
 }
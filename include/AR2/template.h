@@ -112,6 +112,10 @@ int ar2GetBestMatching (ARUint8 * img, ARUint8 * mfImage, int xsize, int ysize,
                         AR2TemplateT * mtemp, int rx, int ry,
                         int search[3][2], int *bx, int *by, float *val);
 
+int ar2GetBestMatchingPyramid(ARUint8 *img, ARUint8 *halfImg, ARUint8 *mfImage, int xsize, int ysize,
+                              AR2TemplateT *mtemp, AR2TemplateT *htemp, int rx, int ry,
+                              int search[3][2], int *bx, int *by, float *val);
+
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
 int ar2GetBestMatching2(ARUint8 * img, ARUint8 * mfImage, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
                         AR2Template2T * mtemp, int rx, int ry,
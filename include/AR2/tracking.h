@@ -68,6 +68,7 @@ typedef struct
 {
     AR2ImageSetT   *imageSet;
     AR2FeatureSetT *featureSet;
+    AR2FeatureIndexT *featureIndex;     // Spatial index over featureSet, used for visibility culling. May be NULL.
     AR2MarkerSetT  *markerSet;
     float          trans[3][4];
     float          itrans[3][4];
@@ -82,7 +83,8 @@ typedef struct
     float                 trans2[3][4];
     float                 trans3[3][4];
     int                   contNum;
-    AR2TemplateCandidateT prevFeature[AR2_SEARCH_FEATURE_MAX + 1];
+    AR2TemplateCandidateT *prevFeature;   // Features tracked in the previous frame, terminated by flag == -1.
+    int                   prevFeatureMax; // Capacity of prevFeature, less the terminator. Grown by ar2Tracking() as needed.
 } AR2SurfaceSetT;
 
 typedef struct
@@ -99,20 +101,54 @@ typedef struct
 typedef struct _AR2HandleT AR2HandleT;
 typedef struct _AR2Tracking2DParamT AR2Tracking2DParamT;
 
+// Per-surface-set state of one ar2Tracking() or ar2TrackingMulti() pass. Buffers are allocated on
+// first use and kept by the AR2HandleT for later passes.
+typedef struct
+{
+    AR2SurfaceSetT        *surfaceSet;
+    int                   surfaceMax;     // Size of wtrans1, wtrans2 and wtrans3.
+    float                 (*wtrans1)[3][4];
+    float                 (*wtrans2)[3][4];
+    float                 (*wtrans3)[3][4];
+    float                 (*pos)[2];      // searchFeatureMax + threadNum entries.
+    float                 (*pos2d)[2];    // searchFeatureMax entries.
+    float                 (*pos3d)[3];    // searchFeatureMax entries.
+    AR2TemplateCandidateT *candidate;     // candidateMax + 1 entries.
+    AR2TemplateCandidateT *candidate2;    // candidateMax + 1 entries.
+    AR2TemplateCandidateT *candidatePtr;  // Which of candidate or candidate2 templates are currently selected from.
+    AR2TemplateCandidateT *usedFeature;   // searchFeatureMax entries.
+    int                   searchNum;      // Number of templates searched for so far.
+    int                   num;            // Number of templates found so far.
+    int                   jobFirst;       // Index in AR2HandleT.job of this surface set's first job in the current round.
+    int                   jobNum;         // Number of jobs for this surface set in the current round, or 0 when selection has finished.
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+    float aveBlur;
+#endif
+} AR2TrackingTargetT;
+
 // Structure to pass parameters to threads spawned to run ar2Tracking2d().
+// Each thread is handed a run of jobs (which are themselves of this type) in job[0..jobNum-1].
+// In a job, ar2Handle, target, candidate, dataPtr, pixFormat and halfPtr are read, and result and ret are written.
+// mfImage, templ and templHalf are the thread's own working memory.
 struct _AR2Tracking2DParamT
 {
     struct _AR2HandleT    *ar2Handle;    // Reference to parent AR2HandleT.
     AR2SurfaceSetT        *surfaceSet;
+    AR2TrackingTargetT    *target;       // Per-surface-set state, including the transforms to use.
     AR2TemplateCandidateT *candidate;
     ARUint8               *dataPtr;      // Input image.
+    AR_PIXEL_FORMAT       pixFormat;     // Pixel format of dataPtr.
+    ARUint8               *halfPtr;      // Input image at half resolution, or NULL if the pyramid search is not in use.
     ARUint8               *mfImage;      // (Internally allocated buffer same size as input image).
     AR2TemplateT          *templ;
+    AR2TemplateT          *templHalf;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     AR2Template2T *templ2;
 #endif
     AR2Tracking2DResultT result;
     int                  ret;
+    struct _AR2Tracking2DParamT *job;
+    int                         jobNum;
 };
 
 struct _AR2HandleT
@@ -128,24 +164,24 @@ struct _AR2HandleT
     int blurLevel;
 #endif
     int   searchSize;
+    int   searchMinSize;
+    int   searchPyramid;
     int   templateSize1;
     int   templateSize2;
     int   searchFeatureNum;
     float simThresh;
     float trackingThresh;
     /*--------------------------------*/
-    float                       wtrans1[AR2_TRACKING_SURFACE_MAX][3][4];
-    float                       wtrans2[AR2_TRACKING_SURFACE_MAX][3][4];
-    float                       wtrans3[AR2_TRACKING_SURFACE_MAX][3][4];
-    float                       pos[AR2_SEARCH_FEATURE_MAX + AR2_THREAD_MAX][2];
-    float                       pos2d[AR2_SEARCH_FEATURE_MAX][2];
-    float                       pos3d[AR2_SEARCH_FEATURE_MAX][3];
-    AR2TemplateCandidateT       candidate[AR2_TRACKING_CANDIDATE_MAX + 1];
-    AR2TemplateCandidateT       candidate2[AR2_TRACKING_CANDIDATE_MAX + 1];
-    AR2TemplateCandidateT       usedFeature[AR2_SEARCH_FEATURE_MAX];
+    int                         searchFeatureMax; // Upper limit of searchFeatureNum.
+    int                         candidateMax;     // Size of each target's candidate lists, less the terminator.
+    AR2TrackingTargetT          *target;          // targetMax entries.
+    int                         targetMax;
+    AR2Tracking2DParamT         *job;             // threadNum * targetMax entries.
+    ARUint8                     *lumaImage;       // Frame converted to luma by ar2TrackingMulti(), or NULL.
+    ARUint8                     *halfImage;       // Luma frame at half resolution, when searchPyramid is set, or NULL.
     int                         threadNum;
-    struct _AR2Tracking2DParamT arg[AR2_THREAD_MAX];
-    THREAD_HANDLE_T             *threadHandle[AR2_THREAD_MAX];
+    struct _AR2Tracking2DParamT *arg;             // threadNum entries.
+    THREAD_HANDLE_T             **threadHandle;   // threadNum entries.
 };
 
 
@@ -176,6 +212,32 @@ struct _AR2HandleT
  */
 int ar2Tracking              (AR2HandleT * ar2Handle, AR2SurfaceSetT * surfaceSet,
                               ARUint8 * dataPtr, float trans[3][4], float  *err);
+
+/*!
+    @function
+    @abstract Perform NFT texture tracking of several surface sets on one image frame.
+    @discussion
+        Equivalent to calling ar2Tracking() once for each surface set, but the per-frame work
+        is shared: the frame is converted to luma once (if it is not already in a luma format),
+        and the template matches for all surface sets are spread across the handle's tracking
+        threads together, rather than one surface set at a time.
+
+        As with ar2Tracking(), ar2SetInitTrans() must have been called for a surface set before it
+        can be tracked. Surface sets which are not being tracked (result -2) cost nothing.
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param surfaceSet Array of surfaceSetNum pointers to tracking surface sets, as returned via ar2ReadSurfaceSet.
+    @param surfaceSetNum Number of surface sets.
+    @param dataPtr Pointer to image data on which tracking will be performed.
+    @param trans Array of surfaceSetNum float[3][4] arrays, which will be filled out with the poses.
+    @param err Array of surfaceSetNum floats, which will be filled out with the pose error values.
+    @param result Array of surfaceSetNum ints, which will be filled out with the result of tracking
+        each surface set, using the same values as returned by ar2Tracking().
+    @result 0 if the frame was processed (check result[] for each surface set), or -1 in case of error.
+    @seealso ar2Tracking ar2Tracking
+ */
+int ar2TrackingMulti(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet[], int surfaceSetNum,
+                     ARUint8 *dataPtr, float trans[][3][4], float err[], int result[]);
+
 void* ar2Tracking2d(THREAD_HANDLE_T *threadHandle);
 /*
    int             ar2Tracking2d            ( AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet,
@@ -213,6 +275,37 @@ AR2SurfaceSetT* ar2ReadSurfaceSet(const char *filename, const char *ext, ARPattH
  */
 int             ar2FreeSurfaceSet(AR2SurfaceSetT **surfaceSet);
 
+/*!
+    @function
+    @abstract Create a second tracking context over an already-loaded NFT surface set.
+    @discussion
+        The returned surface set refers to the same image, feature and marker data as
+        surfaceSet, but has its own tracking state (previous transforms and tracked features),
+        so that the same data may be tracked independently in several video streams, e.g.
+        one per camera. ar2Tracking() only reads the shared data, so the original and any
+        number of shared surface sets may be tracked concurrently using separate AR2HandleTs.
+
+        Dispose of the shared surface set with ar2FreeSharedSurfaceSet(), and before the
+        original is disposed of with ar2FreeSurfaceSet().
+    @param surfaceSet Surface set, as returned via ar2ReadSurfaceSet.
+    @result A pointer to the new AR2SurfaceSetT, or NULL in case of error.
+    @seealso ar2FreeSharedSurfaceSet ar2FreeSharedSurfaceSet
+ */
+AR2SurfaceSetT* ar2ShareSurfaceSet(AR2SurfaceSetT *surfaceSet);
+
+/*!
+    @function
+    @abstract Dispose of a surface set created by ar2ShareSurfaceSet().
+    @discussion
+        Frees only the tracking state of the shared surface set. The image, feature and
+        marker data remain owned by the surface set it was shared from.
+    @param surfaceSet Pointer to a location pointing to an AR2SurfaceSetT. On return,
+        this pointer will be set to NULL.
+    @result 0 if successful, -1 otherwise.
+    @seealso ar2ShareSurfaceSet ar2ShareSurfaceSet
+ */
+int             ar2FreeSharedSurfaceSet(AR2SurfaceSetT **surfaceSet);
+
 /*!
     @function
     @abstract Sets initial transform for subsequent NFT texture tracking.
@@ -251,6 +344,33 @@ int ar2SetInitTrans          (AR2SurfaceSetT * surfaceSet, float trans[3][4]);
  */
 AR2HandleT* ar2CreateHandle(ARParamLT *cparamLT, AR_PIXEL_FORMAT pixFormat, int threadNum);
 
+/*!
+    @function
+    @abstract Allocate and initialise essential structures for NFT texture tracking, using full six degree-of-freedom tracking, with buffers of a given size.
+    @discussion
+        As for ar2CreateHandle(), but the number of features which may be searched for per frame,
+        and the number of candidate features considered per frame, are set by the caller rather
+        than by the compile-time defaults. Surface sets with many features per level (e.g. large
+        posters) may need a larger candidateMax, and hosts with many cores may run more tracking
+        threads if searchFeatureMax is raised to match.
+    @param cparamLT See ar2CreateHandle().
+    @param pixFormat See ar2CreateHandle().
+    @param threadNum Number of threads to spawn for the NFT texture tracking task.
+        Use AR2_TRACKING_DEFAULT_THREAD_NUM to have ARToolKit calculate a sensible default
+        (one per CPU, up to AR2_THREAD_MAX). Any other value is limited only by searchFeatureMax.
+    @param searchFeatureMax Maximum value which may later be set with ar2SetSearchFeatureNum(),
+        or 0 to use AR2_SEARCH_FEATURE_MAX.
+    @param candidateMax Maximum number of candidate features per frame, or 0 to use
+        AR2_TRACKING_CANDIDATE_MAX. If a frame yields more candidates than this,
+        ar2Tracking() will fail for that frame.
+    @result Pointer to a newly allocated AR2HandleT structure, or NULL if an error occurred.
+        This structure must be deallocated via a call to ar2DeleteHandle() when no longer needed.
+    @seealso ar2CreateHandle ar2CreateHandle
+    @seealso ar2CreateHandleHomography2 ar2CreateHandleHomography2
+    @seealso ar2DeleteHandle ar2DeleteHandle
+ */
+AR2HandleT* ar2CreateHandle2(ARParamLT *cparamLT, AR_PIXEL_FORMAT pixFormat, int threadNum, int searchFeatureMax, int candidateMax);
+
 /*!
     @function
     @abstract Allocate and initialise essential structures for NFT texture tracking, using homography-only tracking.
@@ -271,6 +391,18 @@ AR2HandleT* ar2CreateHandle(ARParamLT *cparamLT, AR_PIXEL_FORMAT pixFormat, int
  */
 AR2HandleT* ar2CreateHandleHomography(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat, int threadNum);
 
+/*!
+    @function
+    @abstract Allocate and initialise essential structures for NFT texture tracking, using homography-only tracking, with buffers of a given size.
+    @discussion
+        As for ar2CreateHandleHomography(), with threadNum, searchFeatureMax and candidateMax
+        as described under ar2CreateHandle2().
+    @seealso ar2CreateHandleHomography ar2CreateHandleHomography
+    @seealso ar2CreateHandle2 ar2CreateHandle2
+    @seealso ar2DeleteHandle ar2DeleteHandle
+ */
+AR2HandleT* ar2CreateHandleHomography2(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat, int threadNum, int searchFeatureMax, int candidateMax);
+
 /*!
     @function
     @abstract Finalise and dispose of structures for NFT texture tracking.
@@ -328,6 +460,77 @@ int             ar2SetSearchSize(AR2HandleT *ar2Handle, int searchSize);
  */
 int             ar2GetSearchSize(AR2HandleT *ar2Handle, int *searchSize);
 
+/*!
+    @function
+    @abstract Set smallest feature point search window size.
+    @discussion
+        Once a surface set has been tracked for three frames, the position of each feature
+        in the next frame is predicted from the last three poses, and the feature is searched
+        for in a single window around the prediction. The window's radius is searchMinSize
+        pixels plus half the feature's predicted acceleration, but no more than the search
+        size set by ar2SetSearchSize. When the motion is steady, much less of the frame is
+        searched than with the search size alone.
+
+        Until three poses are known, or if searchMinSize is 0, the feature is searched for
+        in a window of radius equal to the search size around each of its extrapolated positions.
+
+        Default value is AR2_DEFAULT_SEARCH_MIN_SIZE, as defined in &lt;AR2/config.h&gt;
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param searchMinSize The new smallest search size to use, or 0 to disable motion prediction.
+    @result -1 in case of error, or 0 otherwise.
+    @seealso ar2GetSearchMinSize ar2GetSearchMinSize
+    @seealso ar2SetSearchSize ar2SetSearchSize
+ */
+int             ar2SetSearchMinSize(AR2HandleT *ar2Handle, int searchMinSize);
+
+/*!
+    @function
+    @abstract Get smallest feature point search window size.
+    @discussion
+        See the discussion under ar2SetSearchMinSize.
+
+        Default value is AR2_DEFAULT_SEARCH_MIN_SIZE, as defined in &lt;AR2/config.h&gt;
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param searchMinSize Pointer to an int, which on return will be filled with the current smallest search size in use.
+    @result -1 in case of error, or 0 otherwise.
+    @seealso ar2SetSearchMinSize ar2SetSearchMinSize
+ */
+int             ar2GetSearchMinSize(AR2HandleT *ar2Handle, int *searchMinSize);
+
+/*!
+    @function
+    @abstract Set whether feature point search windows are searched at half resolution first.
+    @discussion
+        When enabled, each frame is also downsampled by 2, and each feature's search window is
+        first searched in the downsampled frame with a downsampled template. Only the
+        neighbourhoods of the best matches are then searched at full resolution. This makes
+        each feature's search several times cheaper, with little effect on which features are found.
+
+        The pyramid search is used only for frames in a luma pixel format (or those converted
+        to luma by ar2TrackingMulti()), and only with AR2_CONSTANT_BLUR.
+
+        Default value is AR2_DEFAULT_SEARCH_PYRAMID, as defined in &lt;AR2/config.h&gt;
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param searchPyramid 1 to search at half resolution first, or 0 to search only at full resolution.
+    @result -1 in case of error, or 0 otherwise.
+    @seealso ar2GetSearchPyramid ar2GetSearchPyramid
+ */
+int             ar2SetSearchPyramid(AR2HandleT *ar2Handle, int searchPyramid);
+
+/*!
+    @function
+    @abstract Get whether feature point search windows are searched at half resolution first.
+    @discussion
+        See the discussion under ar2SetSearchPyramid.
+
+        Default value is AR2_DEFAULT_SEARCH_PYRAMID, as defined in &lt;AR2/config.h&gt;
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param searchPyramid Pointer to an int, which on return will be filled with 1 if the pyramid search is enabled, or 0 otherwise.
+    @result -1 in case of error, or 0 otherwise.
+    @seealso ar2SetSearchPyramid ar2SetSearchPyramid
+ */
+int             ar2GetSearchPyramid(AR2HandleT *ar2Handle, int *searchPyramid);
+
 /*!
     @function
     @abstract
@@ -388,6 +591,30 @@ int             ar2SetSearchFeatureNum(AR2HandleT *ar2Handle, int searchTemplate
  */
 int             ar2GetSearchFeatureNum(AR2HandleT *ar2Handle, int *searchTemplateMax);
 
+/*!
+    @function
+    @abstract Get the largest number of features which may be searched for per frame.
+    @discussion
+        This is the limit applied by ar2SetSearchFeatureNum(), as set when the handle was created.
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param searchFeatureMax Pointer to an int, which on return will be filled with the limit.
+    @result -1 in case of error, or 0 otherwise.
+    @seealso ar2CreateHandle2 ar2CreateHandle2
+ */
+int             ar2GetSearchFeatureMax(AR2HandleT *ar2Handle, int *searchFeatureMax);
+
+/*!
+    @function
+    @abstract Get the largest number of candidate features considered per frame.
+    @discussion
+        As set when the handle was created.
+    @param ar2Handle Tracking settings structure, as returned via ar2CreateHandle.
+    @param candidateMax Pointer to an int, which on return will be filled with the limit.
+    @result -1 in case of error, or 0 otherwise.
+    @seealso ar2CreateHandle2 ar2CreateHandle2
+ */
+int             ar2GetCandidateMax(AR2HandleT *ar2Handle, int *candidateMax);
+
 /*!
     @function
     @abstract
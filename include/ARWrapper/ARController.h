@@ -52,10 +52,13 @@
 #include <ARWrapper/ARMarker.h>
 #include <ARWrapper/ARMarkerSquare.h>
 #include <ARWrapper/ARMarkerMulti.h>
+#include <ARWrapper/TripleBuffer.h>
+#include <thread_sub.h>
 #if HAVE_NFT
 #  include <AR2/tracking.h>
 #  include <KPM/kpm.h>
 #  include <ARWrapper/ARMarkerNFT.h>
+typedef struct _PageResidencyHandle PageResidencyHandle;
 #endif
 
 
@@ -74,6 +77,7 @@
 #  define pthread_mutex_destroy(pm) DeleteCriticalSection(pm)
 #endif
 #define PAGES_MAX 64
+#define NFT_RECOGNITION_THREADS_MAX 4
 
 /**
  * Wrapper for ARToolKit functionality. This class handles ARToolKit initialisation, updates,
@@ -134,19 +138,61 @@ ARPattHandle     *m_arPattHandle;                       ///< Structure containin
 AR3DHandle       *m_ar3DHandle;                     ///< Structure used to compute 3D poses from tracking data
 ARdouble         m_transL2R[3][4];
 AR3DStereoHandle *m_ar3DStereoHandle;
+THREAD_HANDLE_T  *m_stereoDetectionThreadHandle;        ///< In stereo mode, detects markers in the image from video source 1 while video source 0 is processed.
+ARUint8          *m_stereoDetectionImage;               ///< Input to the stereo detection thread.
+int              m_stereoDetectionResult;               ///< Output of the stereo detection thread: result of arDetectMarker().
 
 #if HAVE_NFT
 bool doNFTMarkerDetection;
 bool m_nftMultiMode;
 bool m_kpmRequired;
-bool m_kpmBusy;
+bool m_kpmBusy[NFT_RECOGNITION_THREADS_MAX];
+int  m_nftMemoryBudget;                         ///< Megabytes of AR2 data to keep resident, or 0 to keep all pages resident.
+int  m_nftRecognitionThreads;                   ///< Number of KPM threads to run recognition queries on.
+int  m_nftRecognitionMaxAge;                    ///< Recognition results for frames more than this many detection passes old are discarded, or 0 for no limit.
+int  m_nftDetectionPass;                        ///< Count of NFT detection passes, used to stamp the frames given to KPM.
+int  m_kpmLastStartPass;                        ///< Detection pass in which the last recognition query was started.
+float m_kpmQueryPasses;                         ///< Running estimate of the number of detection passes a recognition query takes.
 // NFT data.
-THREAD_HANDLE_T *trackingThreadHandle;
-AR2HandleT      *m_ar2Handle;
-KpmHandle       *m_kpmHandle;
-AR2SurfaceSetT  *surfaceSet[PAGES_MAX];         // Weak-reference. Strong reference is now in ARMarkerNFT class.
+THREAD_HANDLE_T     *trackingThreadHandles[NFT_RECOGNITION_THREADS_MAX]; ///< KPM recognition threads. trackingThreadHandles[0] is set while NFT data is loaded.
+AR2HandleT          *m_ar2Handle;
+KpmHandle           *m_kpmHandles[NFT_RECOGNITION_THREADS_MAX];         ///< One per recognition thread. m_kpmHandles[0] is created by initNFT(), the others by loadNFTData().
+AR2SurfaceSetT      *surfaceSet[PAGES_MAX];     // Weak-reference. Strong reference is now in ARMarkerNFT class. NULL while a page is not resident.
+PageResidencyHandle *m_nftPageResidency;        // Loads and frees AR2 data when m_nftMemoryBudget is set.
 #endif
 
+// Pipelined mode. Capture and detection run on their own threads, connected to each other and
+// to the caller of update() by latest-value queues.
+struct PipelineFrame
+{
+    ARVideoFrameRef *image[2];                  ///< Copy of the frame from each video source. Shared with the KPM thread while it recognises in it.
+    int             frameStamp[2];
+};
+
+struct PipelineMarkerState
+{
+    int      UID;
+    bool     visible;
+    ARdouble transformationMatrix[16];
+    ARdouble transformationMatrixR[16];
+};
+
+struct PipelineResult
+{
+    PipelineFrame                    frame;         ///< The frame in which the markers were detected.
+    std::vector<PipelineMarkerState> markers;
+    bool                             success;       ///< Result of the detection pass.
+    int                              texturesDone;  ///< One bit per texture kind and video source, set once this frame has been pushed there.
+};
+
+bool                         m_pipelined;                   ///< Pipelined mode requested.
+THREAD_HANDLE_T              *m_captureThreadHandle;
+THREAD_HANDLE_T              *m_detectionThreadHandle;
+std::atomic<bool>            m_pipelineQuit;
+TripleBuffer<PipelineFrame>  m_pipelineFrames;              ///< From the capture thread to the detection thread.
+TripleBuffer<PipelineResult> m_pipelineResults;             ///< From the detection thread to the caller of update().
+pthread_mutex_t              m_detectionLock;               ///< Held for each detection pass, and while markers or detection settings change.
+
 int m_error;
 void setError(int error);
 
@@ -158,6 +204,22 @@ void setError(int error);
 void lockVideoSource();
 void unlockVideoSource();
 
+/**
+ * Runs marker detection and NFT tracking on a frame and updates all markers.
+ * @param image0        Frame from video source 0
+ * @param image1        Frame from video source 1, or NULL if not stereo
+ * @param image0Ref     If image0 is held in a reference-counted frame buffer, that buffer, so that NFT
+ *      recognition can share it rather than copy it. Otherwise NULL.
+ * @return                      true if detection completed successfully, false if an error occurred
+ */
+bool detect(ARUint8 *image0, ARUint8 *image1, ARVideoFrameRef *image0Ref);
+
+bool startPipeline();
+void stopPipeline();
+static void* pipelineCaptureMain(THREAD_HANDLE_T *threadHandle);
+static void* pipelineDetectionMain(THREAD_HANDLE_T *threadHandle);
+static void* stereoDetectionMain(THREAD_HANDLE_T *threadHandle);
+
 //
 // Internal marker management.
 //
@@ -397,10 +459,65 @@ bool updateTextureGL(const int videoSourceIndex, const int textureID);
  * marker is updated with visibility and transformation information. Any markers not detected are considered
  * not currently visible.
  *
+ * In pipelined mode, update() instead picks up the most recent result of the detection thread,
+ * without waiting. Marker state should then be read with getMarkerState().
+ *
  * @return                              true if update completed successfully, false if an error occurred
  */
 bool update();
 
+/**
+ * Enables or disables pipelined mode. In pipelined mode, frames are captured on one thread and
+ * markers detected and tracked on another, so that a slow detection pass does not hold up the
+ * thread calling update(). Each call to update() then picks up the newest frame for which
+ * detection has completed, together with the marker poses from that frame, and the texture
+ * update methods push that same frame, so that video and poses stay in step.
+ *
+ * While pipelined, update(), capture(), the texture update methods and getMarkerState() must
+ * all be called from the same thread, and none of them wait on the detection thread. Adding
+ * or removing markers and changing detection settings through this class remain safe, but wait
+ * for any detection pass in progress to finish. Markers' own settings (e.g. their filtering) must
+ * only be changed between lockDetection() and unlockDetection(). If the pipeline cannot be
+ * started, update() logs an error and disables pipelined mode, continuing synchronously.
+ * @param       pipelined       true to enable pipelined mode, false to disable it (the default)
+ * @see                                 getPipelined()
+ */
+void setPipelined(bool pipelined);
+
+/**
+ * Returns whether pipelined mode is enabled.
+ * @return                              true when pipelined mode is enabled, false otherwise
+ * @see                                 setPipelined()
+ */
+bool getPipelined() const;
+
+/**
+ * Retrieves the visibility and pose of a marker as of the last call to update().
+ * In pipelined mode, this is the only safe way to read them, since the marker itself
+ * is being updated on the detection thread.
+ * @param marker                The marker to query
+ * @param matrix                Array to fill with the marker's OpenGL transformation, or NULL if not required
+ * @param matrixR               Array to fill with the marker's OpenGL transformation relative to the right
+ *      camera in stereo mode, or NULL if not required
+ * @return                              true if the marker is visible, otherwise false
+ */
+bool getMarkerState(ARMarker *marker, ARdouble matrix[16], ARdouble matrixR[16]);
+
+/**
+ * Waits for any detection pass in progress to finish, and holds off further passes until
+ * unlockDetection() is called. In pipelined mode, a marker's settings must only be changed
+ * while detection is locked, since the detection thread reads them. Not recursive: do not
+ * call other methods of this class which change markers or detection settings while it is held.
+ * @see                                 unlockDetection()
+ */
+void lockDetection();
+
+/**
+ * Allows detection passes to continue after a call to lockDetection().
+ * @see                                 lockDetection()
+ */
+void unlockDetection();
+
 /**
  * Enables or disables debug mode in the tracker. When enabled, a black and white debug
  * image is generated during marker detection. The debug image is useful for visualising
@@ -479,6 +596,46 @@ void setNFTMultiMode(bool on);
 
 bool getNFTMultiMode() const;
 
+/**
+ * Limits the memory used by the AR2 (tracking) data of NFT markers. KPM (recognition) data
+ * remains resident for all markers, but the image and feature sets of a page are read in the
+ * background when it is recognised, and the least recently tracked pages are freed once the
+ * budget is exceeded. Pages being tracked are never freed.
+ * @param megabytes             The budget in megabytes, or 0 to keep all pages resident (the default).
+ * @see                                 getNFTMemoryBudget()
+ */
+void setNFTMemoryBudget(int megabytes);
+
+/**
+ * Returns the memory budget for the AR2 data of NFT markers.
+ * @return                              The budget in megabytes, or 0 if all pages are kept resident.
+ * @see                                 setNFTMemoryBudget()
+ */
+int getNFTMemoryBudget() const;
+
+/**
+ * Sets the number of threads on which KPM recognition queries for NFT markers run. With more
+ * than one, queries overlap, each starting on a newer frame, so that a page is acquired sooner
+ * after it comes into view. Each thread has its own copy of the KPM data, except where the data
+ * is mapped from indexed files. Changing the number reloads the NFT data.
+ * @param threads               Number of threads, 1 (the default) to NFT_RECOGNITION_THREADS_MAX.
+ * @see                                 getNFTRecognitionThreads()
+ */
+void setNFTRecognitionThreads(int threads);
+
+int getNFTRecognitionThreads() const;
+
+/**
+ * Limits how old the frame a recognition result was computed on may be, when the result comes
+ * in, for it to be used to start tracking. A result from an older frame is discarded rather than
+ * passed to the tracker, which would likely fail to find the page so far from where it now is.
+ * @param passes                Maximum age in detection passes (i.e. frames), or 0 for no limit (the default).
+ * @see                                 getNFTRecognitionMaxAge()
+ */
+void setNFTRecognitionMaxAge(int passes);
+
+int getNFTRecognitionMaxAge() const;
+
 /**
  * Populates the provided color buffer with the current contents of the debug image.
  * @param videoSourceIndex Index into an array of video sources, specifying which source should be queried.
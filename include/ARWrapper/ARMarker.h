@@ -87,7 +87,18 @@ MarkerType type;                                                        ///< Typ
 
 // Factory methods.
 static std::vector<ARMarker*> newFromConfigDataFile(const char *markersConfigDataFilePath, ARPattHandle *arPattHandle, int *patternDetectionMode_out);
-static ARMarker* newWithConfig(const char *cfg, ARPattHandle *arPattHandle);
+static ARMarker* newWithConfig(const char *cfg, ARPattHandle *arPattHandle, bool deferNFTData = false); ///< If deferNFTData is true, NFT markers are created without their AR2 data; see ARMarkerNFT::load().
+
+/**
+ * Creates a marker which tracks the same target as an existing marker, e.g. in another video stream.
+ * The new marker refers to the existing marker's read-only data (pattern, multimarker layout or NFT
+ * surface data) rather than loading its own, but has its own pose, visibility and filter state,
+ * so that the two may be updated concurrently. It has no ARPatterns, and takes the existing marker's
+ * UID, filter settings and position scale factor. The existing marker must outlive the new one.
+ * @param marker        The existing marker
+ * @return                      The new marker, or NULL if the existing marker is not loaded or an error occurred
+ */
+static ARMarker* newSharingData(ARMarker *marker);
 
 
 // Inputs from subclasses.
@@ -63,6 +63,13 @@ ARMarkerMulti();
 
 bool load(const char *multiConfig, ARPattHandle *arPattHandle);
 
+/**
+ * Tracks the same multimarker as another marker, using a copy of its configuration and
+ * the patterns it loaded, which remain owned by the other marker.
+ * @see ARMarker::newSharingData()
+ */
+bool initSharingData(ARMarkerMulti *marker);
+
 /**
  * Updates the marker with new tracking info.
  * Then calls ARMarker::update()
@@ -51,6 +51,7 @@ class ARMarkerNFT : public ARMarker
 {
 private:
 bool  m_loaded;
+bool  m_sharedData;                             ///< surfaceSet was created by ar2ShareSurfaceSet().
 float m_nftScale;
 
 protected:
@@ -65,7 +66,18 @@ AR2SurfaceSetT *surfaceSet;
 ARMarkerNFT();
 ~ARMarkerNFT();
 
-bool load(const char *dataSetPathname_in);
+/**
+ * Loads the NFT dataset. If deferAR2Data is true, only the size of the page is read, and surfaceSet
+ * is left NULL until the AR2 data is read by whoever manages it (e.g. the NFT page residency manager).
+ */
+bool load(const char *dataSetPathname_in, bool deferAR2Data = false);
+
+/**
+ * Tracks the same NFT page as another marker, sharing its AR2 image and feature data but with
+ * tracking state of its own. The page number is also taken from the other marker.
+ * @see ARMarker::newSharingData()
+ */
+bool initSharingData(ARMarkerNFT *marker);
 
 bool updateWithNFTResults(int detectedPage, float trackingTrans[3][4], ARdouble transL2R[3][4] = NULL);
 
@@ -76,6 +76,13 @@ bool initWithPatternFile(const char *path, ARdouble width, ARPattHandle *arPattH
 bool initWithPatternFromBuffer(const char *buffer, ARdouble width, ARPattHandle *arPattHandle);
 bool initWithBarcode(int barcodeID, ARdouble width);
 
+/**
+ * Tracks the same pattern or barcode as another marker, without loading the pattern again.
+ * The pattern remains owned by the other marker, which must outlive this one.
+ * @see ARMarker::newSharingData()
+ */
+bool initSharingData(ARMarkerSquare *marker);
+
 /**
  * Updates the marker with new tracking info.
  * Then calls ARMarker::update()
@@ -72,6 +72,7 @@ bool loadTemplate(int patternID, const ARPattHandle *arPattHandle, float width);
 bool loadMatrix(int barcodeID, AR_MATRIX_CODE_TYPE type, float width);
 #if HAVE_NFT
 bool loadISet(const AR2ImageSetT *imageSet, float nftScale);
+bool loadISetSize(int xsize, int ysize, float dpi, float nftScale);
 #endif
 
 ARdouble m_matrix[16];          ///< Transform of the pattern from origin.
@@ -372,6 +372,45 @@ EXPORT_API void arwSetNFTMultiMode(bool on);
 
 EXPORT_API bool arwGetNFTMultiMode();
 
+/**
+ * Limits the memory used by the tracking data of NFT markers. Pages are read when recognised
+ * and the least recently tracked are freed once the budget is exceeded.
+ * @param megabytes     The budget in megabytes, or 0 to keep the data of all pages resident (the default).
+ */
+EXPORT_API void arwSetNFTMemoryBudget(int megabytes);
+
+EXPORT_API int arwGetNFTMemoryBudget();
+
+/**
+ * Sets the number of threads running KPM recognition queries for NFT markers. With more than one,
+ * queries overlap, so that pages are acquired sooner. Each thread holds its own copy of the KPM
+ * data unless the datasets were saved in the indexed format.
+ * @param threads       Number of threads, 1 (the default) to 4.
+ */
+EXPORT_API void arwSetNFTRecognitionThreads(int threads);
+
+EXPORT_API int arwGetNFTRecognitionThreads();
+
+/**
+ * Discards NFT recognition results computed on frames older than the given age when they
+ * come in, rather than starting tracking from them.
+ * @param frames        Maximum age in frames, or 0 for no limit (the default).
+ */
+EXPORT_API void arwSetNFTRecognitionMaxAge(int frames);
+
+EXPORT_API int arwGetNFTRecognitionMaxAge();
+
+/**
+ * Enables or disables pipelined mode, in which video capture and marker detection run on
+ * threads of their own and arwUpdateAR() picks up the most recent completed result without waiting.
+ * Marker visibility and poses returned by the query functions then match the frame pushed by the
+ * video texture update functions.
+ * @param on            true to enable pipelined mode, false to run capture and detection in arwUpdateAR() (the default).
+ */
+EXPORT_API void arwSetPipelined(bool on);
+
+EXPORT_API bool arwGetPipelined();
+
 // ----------------------------------------------------------------------------------------------------
 #pragma mark  Marker management
 // ----------------------------------------------------------------------------------------------------
@@ -0,0 +1,187 @@
+/*
+ *  ARTrackingServer.h
+ *  ARToolKit5
+ *
+ *  Tracks a common set of markers in the video streams of many cameras in one process.
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *
+ */
+
+
+#ifndef ARTRACKINGSERVER_H
+#define ARTRACKINGSERVER_H
+
+#include <ARWrapper/ARController.h>
+
+#include <atomic>
+#include <vector>
+
+/**
+ * Tracks one set of markers in the video from several cameras, e.g. a rig of fixed cameras
+ * watching the same space, sharing the markers' data and one pool of worker threads between them.
+ *
+ * Markers are loaded once. Each camera has its own video source, detection handles and
+ * per-marker tracking state, but the pattern handle, AR2 surface data and KPM database are shared:
+ * every camera's ARHandle is attached to the one ARPattHandle, every camera's NFT markers
+ * track the AR2 data loaded by the server's own markers (see ARMarker::newSharingData()), and,
+ * provided every NFT dataset has been saved in the indexed format, every camera's KpmHandle maps
+ * the same database files. Otherwise, the merged database is loaded once but copied into each KpmHandle.
+ *
+ * The worker threads take cameras in turn, so that each frame is processed by whichever thread is free.
+ * A camera is processed by only one thread at a time, so its frames are processed in order and
+ * frames which arrive while it is busy are skipped. NFT recognition queries run as separate jobs on the
+ * same threads, and may occupy at most half of them, so that tracking continues in the other cameras.
+ *
+ * Typical use is to add the markers and the cameras, then start(), and from then on poll
+ * getMarkerState() and getCameraStats() from any thread.
+ */
+class ARTrackingServer
+{
+public:
+
+/**
+ * Per-camera timing, accumulated since start(). Times are in milliseconds.
+ */
+struct CameraStats
+{
+    int    framesProcessed;                     ///< Frames in which markers were detected and tracked.
+    double latencyMean;                         ///< Mean time from a frame being taken from the video source to its results being available.
+    double latencyMax;                          ///< Maximum of the above.
+    double frameIntervalMean;                   ///< Mean time between processed frames.
+    int    recognitionQueries;                  ///< NFT recognition queries completed.
+    double recognitionLatencyMean;              ///< Mean time from a frame being taken for NFT recognition to the query completing, including time spent waiting for a free thread.
+};
+
+ARTrackingServer();
+~ARTrackingServer();
+
+/**
+ * Adds a marker to be tracked in every camera. Markers can only be added while the server is stopped.
+ * @param cfg           Marker configuration string, as for ARController::addMarker()
+ * @return                      UID of the marker, or -1 in case of error
+ */
+int addMarker(const char *cfg);
+
+/**
+ * Adds a camera. Cameras can only be added while the server is stopped.
+ * @param vconf         Video configuration string
+ * @param cparaName     Camera parameters filename, or NULL to use the video source's own parameters or the default filename
+ * @return                      Index of the camera, or -1 in case of error
+ */
+int addCamera(const char *vconf, const char *cparaName);
+
+int cameraCount();
+
+/**
+ * Sets the pattern detection mode and matrix code type used in every camera.
+ * Takes effect at the next start().
+ */
+void setPatternDetectionMode(int mode);
+void setMatrixCodeType(AR_MATRIX_CODE_TYPE type);
+
+/**
+ * Sets whether NFT recognition continues while a page is being tracked, so that more than one page
+ * can be tracked at once in each camera. Takes effect at the next start().
+ */
+void setNFTMultiMode(bool on);
+
+/**
+ * Opens the cameras and starts processing.
+ * @param workerThreads Number of worker threads, or 0 for one per CPU
+ * @return                      true if every camera was opened and processing started, otherwise false
+ */
+bool start(int workerThreads = 0);
+
+/**
+ * Stops processing and closes the cameras. Markers and cameras remain, so the server may be started again.
+ */
+void stop();
+
+bool isRunning();
+
+/**
+ * Returns the latest pose of a marker in one camera.
+ * @param camera        Index of the camera
+ * @param UID           UID of the marker
+ * @param matrix        If the marker is visible, on return holds its OpenGL-style transformation matrix
+ * @return                      true if the marker is visible in the camera, otherwise false
+ */
+bool getMarkerState(int camera, int UID, ARdouble matrix[16]);
+
+/**
+ * Returns the timing of one camera.
+ * @param camera        Index of the camera
+ * @param stats         On return, holds the timing
+ * @return                      true if successful, false if the camera does not exist
+ */
+bool getCameraStats(int camera, CameraStats *stats);
+
+private:
+struct Camera;                                  ///< Defined in ARTrackingServer.cpp.
+
+std::vector<ARMarker*> m_markers;               ///< Markers as loaded. These own the shared data, and are not themselves tracked.
+std::vector<Camera*>   m_cameras;
+ARPattHandle           *m_arPattHandle;
+int                    m_patternDetectionMode;
+AR_MATRIX_CODE_TYPE    m_matrixCodeType;
+bool                   m_doMarkerDetection;
+
+#if HAVE_NFT
+bool           m_doNFTMarkerDetection;
+bool           m_nftMultiMode;
+int            m_nftPageCount;
+bool           m_nftMapped;                     ///< Every NFT dataset is indexed, so KPM handles map the files rather than copying m_kpmRefDataSet.
+const char     *m_nftFilenames[PAGES_MAX];      ///< Weak references to the NFT markers' dataset pathnames, when mapped.
+int            m_nftPageNos[PAGES_MAX];
+KpmRefDataSet  *m_kpmRefDataSet;                ///< Merged database, when not mapped.
+#endif
+
+bool                          m_running;
+std::vector<THREAD_HANDLE_T*> m_workerThreadHandles;
+std::atomic<bool>             m_workerQuit;
+pthread_mutex_t               m_scheduleLock;   ///< Guards the assignment of cameras and recognition queries to threads.
+int                           m_nextCamera;     ///< Camera to be offered to the next free thread.
+int                           m_recognitionJobs;
+int                           m_recognitionJobsMax;
+
+bool loadNFTData();
+void unloadNFTData();
+bool initCamera(Camera *camera);
+void finalCamera(Camera *camera);
+bool runJob();
+bool processFrame(Camera *camera);
+#if HAVE_NFT
+void trackNFT(Camera *camera, ARUint8 *image, double frameTime);
+void recognise(Camera *camera);
+#endif
+static void* workerMain(THREAD_HANDLE_T *threadHandle);
+};
+
+#endif // !ARTRACKINGSERVER_H
@@ -0,0 +1,144 @@
+/*
+ *  TripleBuffer.h
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *
+ */
+
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+/**
+ * A latest-value queue between one producer thread and one consumer thread.
+ *
+ * Of the three slots, the producer owns the back slot and the consumer owns the front slot, so
+ * each may read and write its own slot freely. publish() swaps the back slot with the spare
+ * ("ready") slot, and update() swaps the ready slot with the front slot if something was published
+ * since the last update(). Values the consumer has not picked up are simply overwritten, so a slow
+ * consumer always gets the most recent value and a slow producer never holds up the consumer.
+ * Neither side ever blocks: the slot indices live in one atomic word changed only by compare-and-exchange.
+ */
+template <typename T>
+class TripleBuffer
+{
+private:
+// Bits 0-1: back slot, bits 2-3: ready slot, bits 4-5: front slot, bit 6: ready slot holds a value not yet picked up.
+enum { BACK_SHIFT = 0, READY_SHIFT = 2, FRONT_SHIFT = 4, FRESH = 0x40 };
+
+T                m_slots[3];
+std::atomic<int> m_state;
+
+static int slot(int state, int shift)
+{
+    return ((state >> shift) & 3);
+}
+
+TripleBuffer(const TripleBuffer&);
+TripleBuffer& operator=(const TripleBuffer&);
+
+public:
+TripleBuffer() : m_state((0 << BACK_SHIFT) | (1 << READY_SHIFT) | (2 << FRONT_SHIFT))
+{}
+
+/**
+ * Returns the slot owned by the producer. Only the producer thread may call this.
+ */
+T& back()
+{
+    return m_slots[slot(m_state.load(std::memory_order_relaxed), BACK_SHIFT)];
+}
+
+/**
+ * Makes the contents of the back slot available to the consumer. Afterwards, back() refers
+ * to a different slot, whose contents are whatever was last left there.
+ * Only the producer thread may call this.
+ */
+void publish()
+{
+    int state = m_state.load(std::memory_order_relaxed);
+    int newState;
+
+    do
+    {
+        newState = (slot(state, READY_SHIFT) << BACK_SHIFT) | (slot(state, BACK_SHIFT) << READY_SHIFT) | (slot(state, FRONT_SHIFT) << FRONT_SHIFT) | FRESH;
+    }
+    while (!m_state.compare_exchange_weak(state, newState, std::memory_order_acq_rel, std::memory_order_relaxed));
+}
+
+/**
+ * Moves the most recently published value, if any, into the front slot.
+ * Only the consumer thread may call this.
+ * @return              true if front() now refers to a newly published value, false if nothing new was published.
+ */
+bool update()
+{
+    int state = m_state.load(std::memory_order_relaxed);
+    int newState;
+
+    do
+    {
+        if (!(state & FRESH))
+            return false;
+
+        newState = (slot(state, BACK_SHIFT) << BACK_SHIFT) | (slot(state, FRONT_SHIFT) << READY_SHIFT) | (slot(state, READY_SHIFT) << FRONT_SHIFT);
+    }
+    while (!m_state.compare_exchange_weak(state, newState, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    return true;
+}
+
+/**
+ * Returns the slot owned by the consumer. Only the consumer thread may call this.
+ */
+T& front()
+{
+    return m_slots[slot(m_state.load(std::memory_order_relaxed), FRONT_SHIFT)];
+}
+
+/**
+ * Returns one of the three slots regardless of ownership, e.g. to allocate or free their contents.
+ * Only safe while neither the producer nor the consumer is running.
+ */
+T& slotAt(int index)
+{
+    return m_slots[index];
+}
+
+/**
+ * Discards any published value not yet picked up. Only safe while neither the producer nor the consumer is running.
+ */
+void reset()
+{
+    m_state.fetch_and(~FRESH);
+}
+};
+#endif // !TRIPLEBUFFER_H
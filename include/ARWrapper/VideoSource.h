@@ -85,9 +85,6 @@ int videoWidth;                                                 ///< Width of th
 int videoHeight;                                                ///< Height of the video frame in pixels
 
 AR_PIXEL_FORMAT pixelFormat;                    ///< Pixel format from ARToolKit enumeration.
-#if defined(HAVE_ARM_NEON) || defined(HAVE_ARM64_NEON)
-int m_fastPath;
-#endif
 #ifndef _WINRT
 GLenum glPixIntFormat;
 GLenum glPixFormat;
@@ -193,6 +190,12 @@ virtual bool captureFrame() = 0;
  */
 ARUint8* getFrame();
 
+/**
+ * Returns plane 2 of the current frame, for bi-planar pixel formats.
+ * @return              Pointer to the buffer containing plane 2 of the current video frame, or NULL if the pixel format has only one plane
+ */
+ARUint8* getFrame2();
+
 /**
  * Returns the current frame stamp. If the returned value has changed since the last
  * time this function was called, then the caller can assume a new frame is available.
@@ -207,15 +210,37 @@ int getFrameStamp();
  */
 bool updateTexture(Color *buffer);
 
-bool fastPath();
 bool updateTexture32(uint32_t *buffer);
 
+/**
+ * Converts a frame of this video source's size and pixel format, which need not be the
+ * current frame (e.g. a copy held by a processing pipeline), into the provided color buffer.
+ * @param frame         The frame, or for bi-planar formats, plane 1 of the frame
+ * @param frame2        For bi-planar formats, plane 2 of the frame, or NULL if it follows plane 1; otherwise ignored
+ * @param buffer        The color buffer to populate with frame data
+ * @return                      true if the buffer was updated successfully, otherwise false
+ */
+bool convertFrame(const ARUint8 *frame, const ARUint8 *frame2, Color *buffer);
+
+/**
+ * As convertFrame(const ARUint8 *, const ARUint8 *, Color *) but for 32-bit RGBA pixels.
+ */
+bool convertFrame32(const ARUint8 *frame, const ARUint8 *frame2, uint32_t *buffer);
+
 #ifndef _WINRT
 /**
  * Updates the specified OpenGL texture with the current video frame
  * @param textureID     The OpenGL texture ID to which the video frame should be uploaded
  */
 void updateTextureGL(int textureID);
+
+/**
+ * Uploads a frame of this video source's size and pixel format, which need not be the
+ * current frame, to the specified OpenGL texture.
+ * @param textureID     The OpenGL texture ID to which the frame should be uploaded
+ * @param frame         The frame
+ */
+void uploadFrameGL(int textureID, const ARUint8 *frame);
 #endif
 };
 #endif // !VIDEOSOURCE_H
\ No newline at end of file
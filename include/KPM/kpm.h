@@ -233,6 +233,43 @@ int         kpmSetDetectedFeatureMax(KpmHandle *kpmHandle, int detectedMaxFeatur
 int         kpmGetDetectedFeatureMax(KpmHandle *kpmHandle, int *detectedMaxFeature);
 int         kpmSetSurfThreadNum(KpmHandle *kpmHandle, int surfThreadNum);
 
+/*!
+    @function
+    @abstract Enable progressive (early-exit) matching in kpmMatching().
+    @discussion
+        When enabled, the features detected in the input image are matched against
+        the reference data in batches, strongest detector response first. After each
+        batch, pages with enough putative matches are geometrically verified, and
+        matching stops as soon as a page has at least inlierThreshold inliers.
+        Only supported with binary (FREAK) features.
+    @param kpmHandle Handle to the KPM instance.
+    @param batchSize Number of features matched per batch, or 0 to match all features at once (the default).
+    @param inlierThreshold Number of verified inliers at which matching stops early.
+        Values below the matcher's minimum number of inliers are raised to that minimum.
+    @result 0 if successful, or -1 in case of error.
+ */
+int         kpmSetProgressiveMatching(KpmHandle *kpmHandle, int batchSize, int inlierThreshold);
+int         kpmGetProgressiveMatching(KpmHandle *kpmHandle, int *batchSize, int *inlierThreshold);
+
+/*!
+    @function
+    @abstract Enable reuse of feature descriptors between consecutive calls to kpmMatching().
+    @discussion
+        When enabled, the (processed) input image is divided into square tiles, and
+        each tile is compared with the image from which the current query features
+        were computed. Descriptors of features lying entirely in unchanged tiles are
+        carried over from the previous call rather than being re-extracted, and if no
+        tile has changed, feature detection and extraction are skipped altogether.
+        This makes repeated matching of a near-static view considerably cheaper.
+        Only supported with binary (FREAK) features.
+    @param kpmHandle Handle to the KPM instance.
+    @param tileSize Tile edge length in pixels of the processed image, or 0 to disable reuse (the default).
+    @param threshold Mean absolute luma difference (0-255) above which a tile is considered changed.
+    @result 0 if successful, or -1 in case of error.
+ */
+int         kpmSetFeatureReuse(KpmHandle *kpmHandle, int tileSize, int threshold);
+int         kpmGetFeatureReuse(KpmHandle *kpmHandle, int *tileSize, int *threshold);
+
 /*!
     @function
     @abstract Load a reference data set into the key point matcher for tracking.
@@ -371,6 +408,53 @@ int         kpmLoadRefDataSet(const char *filename, const char *ext, KpmRefDataS
 
 int         kpmLoadRefDataSetOld(const char *filename, const char *ext, KpmRefDataSet **refDataSetPtr);
 
+/*!
+    @function
+    @abstract Save a reference data set in the indexed .fset3 format.
+    @discussion
+        As well as the reference points, an indexed file holds the descriptors of each
+        page image contiguously together with the feature index built over them, so
+        that it can be loaded with kpmSetRefDataSetFilesMapped() without regrouping the
+        points or rebuilding the index. Indexed files can still be read by kpmLoadRefDataSet().
+    @param filename Path to the dataset. Either full path, or a relative path if supported by
+        the operating system.
+    @param ext If non-NULL, a '.' charater and this string will be appended to 'filename'.
+        Often, this parameter is a pointer to the string "fset3".
+    @param refDataSet The reference data set to save.
+    @result 0 if the save succeeded, or a value &lt; 0 in case of error.
+    @seealso kpmSetRefDataSetFilesMapped kpmSetRefDataSetFilesMapped
+ */
+int         kpmSaveRefDataSetIndexed(const char *filename, const char *ext, KpmRefDataSet *refDataSet);
+
+/*!
+    @function
+    @abstract Check whether a reference data set file is in the indexed .fset3 format.
+    @param filename Path to the dataset.
+    @param ext If non-NULL, a '.' charater and this string will be appended to 'filename'.
+    @result 1 if the file is an indexed dataset, 0 if it is not, or a value &lt; 0 if it cannot be read.
+ */
+int         kpmRefDataSetFileIsIndexed(const char *filename, const char *ext);
+
+/*!
+    @function
+    @abstract Make a set of indexed reference data set files the current dataset for key point matching.
+    @discussion
+        The files are memory-mapped and the descriptors are used in place, so that
+        loading involves no parsing and no index building. The mappings are held by the
+        KPM handle until the dataset is replaced or the handle deleted.
+        This replaces any dataset previously set on the handle.
+    @param kpmHandle Handle to the current KPM tracker instance.
+    @param filenames Array of 'num' paths to datasets written by kpmSaveRefDataSetIndexed().
+    @param ext If non-NULL, a '.' charater and this string will be appended to each filename.
+    @param pageNos If non-NULL, all pages in filenames[i] are given page number pageNos[i],
+        as kpmChangePageNoOfRefDataSet(refDataSet, KpmChangePageNoAllPages, pageNos[i]) would do.
+        If NULL, the page numbers stored in the files are used.
+    @param num Number of files.
+    @result 0 if successful, or value &lt;0 in case of error.
+    @seealso kpmSaveRefDataSetIndexed kpmSaveRefDataSetIndexed
+ */
+int         kpmSetRefDataSetFilesMapped(KpmHandle *kpmHandle, const char *filenames[], const char *ext, const int pageNos[], int num);
+
 /*!
     @function
     @abstract
@@ -396,6 +480,21 @@ int         kpmChangePageNoOfRefDataSet(KpmRefDataSet *refDataSet, int oldPageNo
  */
 ARUint8* kpmUtilGenBWImage(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int procMode, int *newXsize, int *newYsize);
 
+/*!
+    @function
+    @abstract Generate a luma image for KPM processing into a reusable buffer.
+    @discussion
+        As for kpmUtilGenBWImage(), but the result is written into *buffer, which is
+        only (re)allocated when it is NULL or smaller than required. Repeated calls
+        with the same dimensions therefore perform no allocation. The caller owns the
+        buffer and must free() it when done.
+    @param buffer Pointer to the buffer pointer, which should be NULL on the first call.
+    @param bufferSize Pointer to the size in bytes of *buffer, which should be 0 on the first call.
+    @result Pointer to the luma image (i.e. *buffer), or NULL in case of error.
+ */
+ARUint8* kpmUtilGenBWImageBuffer(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int procMode, int *newXsize, int *newYsize,
+                                 ARUint8 **buffer, int *bufferSize);
+
 #if !BINARY_FEATURE
 int kpmUtilGetPose (ARParamLT * cparamLT, KpmMatchResult * matchData, KpmRefDataSet * refDataSet, KpmInputDataSet * inputDataSet, float camPose[3][4], float  *err);
 
@@ -41,6 +41,13 @@
 #include <stdlib.h>
 #include <AR2/config.h>
 #include <AR2/featureSet.h>
+#include <thread_sub.h>
+#if defined(HAVE_ARM_NEON)
+#  include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define AR2_FEATURE_MAP_SSE2 1
+#  include <emmintrin.h>
+#endif
 
 static int make_template(ARUint8 *imageBW, int xsize, int ysize,
                          int cx, int cy, int ts1, int ts2, float sd_thresh,
@@ -50,6 +57,29 @@ static int get_similarity(ARUint8 *imageBW, int xsize, int ysize,
                           float  *template, float vlen, int ts1, int ts2,
                           int cx, int cy, float  *sim);
 
+// Shared state of the threads generating a feature map.
+typedef struct
+{
+    ARUint8  *imageBW;
+    ARUint32 *sumImage;         // Integral image of imageBW, (xsize+1)*(ysize+1).
+    ARUint32 *sqSumImage;       // Integral image of the squares of imageBW, (xsize+1)*(ysize+1).
+    float    *fimage;           // The feature map being generated.
+    float    *fimage2;          // Gradient magnitude of imageBW.
+    int      xsize, ysize;
+    int      ts1, ts2;
+    int      search_size1, search_size2;
+    float    max_sim_thresh;
+    float    sd_thresh;
+    int      thresh;            // Gradient magnitude * 1000 below which pixels are not features.
+    int      threadNum;
+} AR2FeatureMapParamT;
+
+static void  make_integral_image(ARUint8 *imageBW, int xsize, int ysize, ARUint32 *sumImage, ARUint32 *sqSumImage);
+static void* gen_feature_map_thread(THREAD_HANDLE_T *threadHandle);
+static void  gen_feature_map_rows(AR2FeatureMapParamT *param, int ID);
+static int   get_max_similarity(AR2FeatureMapParamT *param, int cx, int cy, float *max);
+static int   dot_product(ARUint8 *p1, ARUint8 *p2, int n);
+
 int ar2FreeFeatureMap(AR2FeatureMapT *featureMap)
 {
     free(featureMap->map);
@@ -133,24 +163,29 @@ AR2FeatureMapT* ar2GenFeatureMap(AR2ImageT *image,
                                  int search_size1, int search_size2,
                                  float max_sim_thresh, float sd_thresh)
 {
-    AR2FeatureMapT *featureMap;
-    float          *fimage, *fp;
-    float          *fimage2, *fp2;
-    float          *template;
-    ARUint8        *p;
-    float          dx, dy;
-    int            xsize, ysize;
-    int            hist[1000], sum;
-    int            i, j, k;
-    float          vlen;
-    float          max, sim;
-    int            ii, jj;
+    return ar2GenFeatureMap2(image, ts1, ts2, search_size1, search_size2, max_sim_thresh, sd_thresh, 0);
+}
+
+AR2FeatureMapT* ar2GenFeatureMap2(AR2ImageT *image,
+                                  int ts1, int ts2,
+                                  int search_size1, int search_size2,
+                                  float max_sim_thresh, float sd_thresh, int threadNum)
+{
+    AR2FeatureMapT      *featureMap;
+    AR2FeatureMapParamT param;
+    THREAD_HANDLE_T     **threadHandle;
+    float               *fimage;
+    float               *fimage2, *fp2;
+    ARUint8             *p;
+    float               dx, dy;
+    int                 xsize, ysize;
+    int                 hist[1000], sum;
+    int                 i, j, k;
 
     xsize = image->xsize;
     ysize = image->ysize;
     arMalloc(fimage,   float,  xsize * ysize);
     arMalloc(fimage2,  float,  xsize * ysize);
-    arMalloc(template, float, (ts1 + ts2 + 1) * (ts1 + ts2 + 1));
 
 
     fp2 = fimage2;
@@ -237,92 +272,63 @@ AR2FeatureMapT* ar2GenFeatureMap(AR2ImageT *image,
     ARLOGi(" Filtered features = %7d[pixel]\n", j);
 
 
-    fp  = fimage;
-    fp2 = fimage2;
-
-    for (i = 0; i < xsize; i++)
-    {
-        *(fp++) = 1.0f;
-        fp2++;
-    }
-
-    for (j = 1; j < ysize - 1; j++)
-    {
-        ARLOGi("\r%4d/%4d.", j + 1, ysize); fflush(stdout);
-        *(fp++) = 1.0f;
-        fp2++;
-
-        for (i = 1; i < xsize - 1; i++)
-        {
-            if (*fp2 <= *(fp2 - 1) || *fp2 <= *(fp2 + 1) || *fp2 <= *(fp2 - xsize) || *fp2 <= *(fp2 + xsize))
-            {
-                *(fp++) = 1.0f;
-                fp2++;
-                continue;
-            }
-
-            if ((int)(*fp2 * 1000) < k)
-            {
-                *(fp++) = 1.0f;
-                fp2++;
-                continue;
-            }
-
+    // Integral images of the pixel values and their squares, with an extra leading row and column of 0s.
+    arMalloc(param.sumImage,   ARUint32, (xsize + 1) * (ysize + 1));
+    arMalloc(param.sqSumImage, ARUint32, (xsize + 1) * (ysize + 1));
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-            if (make_template(image->imgBWBlur[1], xsize, ysize, i, j, ts1, ts2, sd_thresh, template, &vlen) < 0)
-            {
+    make_integral_image(image->imgBWBlur[1], xsize, ysize, param.sumImage, param.sqSumImage);
+    param.imageBW = image->imgBWBlur[1];
 #else
-            if (make_template(image->imgBW, xsize, ysize, i, j, ts1, ts2, sd_thresh, template, &vlen) < 0)
-            {
+    make_integral_image(image->imgBW, xsize, ysize, param.sumImage, param.sqSumImage);
+    param.imageBW = image->imgBW;
 #endif
-                *(fp++) = 1.0f;
-                fp2++;
-                continue;
-            }
-
-            max = -1.0f;
-
-            for (jj = -search_size1; jj <= search_size1; jj++)
-            {
-                for (ii = -search_size1; ii <= search_size1; ii++)
-                {
-                    if (ii * ii + jj * jj <= search_size2 * search_size2)
-                        continue;
-
-                    // if( jj >= -search_size2 && jj <= search_size2 && ii >= -search_size2 && ii <= search_size2 ) continue;
+    param.fimage         = fimage;
+    param.fimage2        = fimage2;
+    param.xsize          = xsize;
+    param.ysize          = ysize;
+    param.ts1            = ts1;
+    param.ts2            = ts2;
+    param.search_size1   = search_size1;
+    param.search_size2   = search_size2;
+    param.max_sim_thresh = max_sim_thresh;
+    param.sd_thresh      = sd_thresh;
+    param.thresh         = k;
 
-#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-                    if (get_similarity(image->imgBWBlur[1], xsize, ysize, template, vlen, ts1, ts2, i + ii, j + jj, &sim) < 0)
-                        continue;
-
-#else
-                    if (get_similarity(image->imgBW, xsize, ysize, template, vlen, ts1, ts2, i + ii, j + jj, &sim) < 0)
-                        continue;
-#endif
+    for (i = 0; i < xsize * ysize; i++)
+        fimage[i] = 1.0f;
 
-                    if (sim > max)
-                    {
-                        max = sim;
-                        if (max > max_sim_thresh)
-                            break;
-                    }
-                }
+    // Rows are shared out between threads in turn, as the cost of a row depends on how many features it holds.
+    param.threadNum = (threadNum > 0 ? threadNum : threadGetCPU());
+    if (param.threadNum > 1)
+    {
+        arMalloc(threadHandle, THREAD_HANDLE_T*, param.threadNum);
 
-                if (max > max_sim_thresh)
-                    break;
-            }
+        for (i = 0; i < param.threadNum; i++)
+        {
+            threadHandle[i] = threadInit(i, &param, gen_feature_map_thread);
+            threadStartSignal(threadHandle[i]);
+        }
 
-            *(fp++) = (float)max;
-            fp2++;
+        for (i = 0; i < param.threadNum; i++)
+        {
+            threadEndWait(threadHandle[i]);
+            threadWaitQuit(threadHandle[i]);
+            threadFree(&threadHandle[i]);
         }
 
-        *(fp++) = 1.0f;
-        fp2++;
+        free(threadHandle);
+    }
+    else
+    {
+        param.threadNum = 1;
+        gen_feature_map_rows(&param, 0);
     }
 
+    free(param.sumImage);
+    free(param.sqSumImage);
+
     ARLOGi("\n");
     free(fimage2);
-    free(template);
 
     arMalloc(featureMap, AR2FeatureMapT, 1);
     featureMap->map   = fimage;
@@ -885,4 +891,253 @@ static int get_similarity(ARUint8 *imageBW, int xsize, int ysize,
 #endif
 
     return 0;
-}
\ No newline at end of file
+}
+// Fill in integral images of the pixel values and their squares. Entry (x, y) of each, at
+// y * (xsize + 1) + x, is the sum over pixels above and to the left of pixel (x, y) of imageBW.
+// The sums of squares may wrap around 32 bits on large images, but as unsigned arithmetic is
+// modulo 2^32, the sum over any template-sized box taken from them is still exact.
+static void make_integral_image(ARUint8 *imageBW, int xsize, int ysize, ARUint32 *sumImage, ARUint32 *sqSumImage)
+{
+    ARUint32 *s1, *s2, *q1, *q2;
+    ARUint32 rowSum, rowSqSum;
+    int      i, j;
+
+    for (i = 0; i <= xsize; i++)
+    {
+        sumImage[i]   = 0;
+        sqSumImage[i] = 0;
+    }
+
+    for (j = 0; j < ysize; j++)
+    {
+        s1       = &sumImage[j * (xsize + 1)];
+        q1       = &sqSumImage[j * (xsize + 1)];
+        s2       = s1 + (xsize + 1);
+        q2       = q1 + (xsize + 1);
+        *(s2++)  = 0;
+        *(q2++)  = 0;
+        rowSum   = 0;
+        rowSqSum = 0;
+
+        for (i = 0; i < xsize; i++)
+        {
+            rowSum   += *imageBW;
+            rowSqSum += *imageBW * *imageBW;
+            imageBW++;
+            *(s2++) = *(++s1) + rowSum;
+            *(q2++) = *(++q1) + rowSqSum;
+        }
+    }
+}
+
+static void* gen_feature_map_thread(THREAD_HANDLE_T *threadHandle)
+{
+    AR2FeatureMapParamT *param;
+    int                 ID;
+
+    param = (AR2FeatureMapParamT*)threadGetArg(threadHandle);
+    ID    = threadGetID(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0)
+    {
+        gen_feature_map_rows(param, ID);
+        threadEndSignal(threadHandle);
+    }
+
+    return NULL;
+}
+
+// Generate rows ID+1, ID+1+threadNum, ... of the feature map.
+static void gen_feature_map_rows(AR2FeatureMapParamT *param, int ID)
+{
+    float *fp, *fp2;
+    float max;
+    int   xsize, ysize;
+    int   i, j;
+
+    xsize = param->xsize;
+    ysize = param->ysize;
+
+    for (j = ID + 1; j < ysize - 1; j += param->threadNum)
+    {
+        if (ID == 0)
+        {
+            ARLOGi("\r%4d/%4d.", j + 1, ysize); fflush(stdout);
+        }
+
+        fp  = &(param->fimage[j * xsize + 1]);
+        fp2 = &(param->fimage2[j * xsize + 1]);
+
+        for (i = 1; i < xsize - 1; i++, fp++, fp2++)
+        {
+            if (*fp2 <= *(fp2 - 1) || *fp2 <= *(fp2 + 1) || *fp2 <= *(fp2 - xsize) || *fp2 <= *(fp2 + xsize))
+                continue;
+
+            if ((int)(*fp2 * 1000) < param->thresh)
+                continue;
+
+            if (get_max_similarity(param, i, j, &max) < 0)
+                continue;
+
+            *fp = max;
+        }
+    }
+}
+
+#define BOX_SUM(integral, stride, x, y, size) \
+    ((integral)[((y) + (size)) * (stride) + (x) + (size)] - (integral)[(y) * (stride) + (x) + (size)] \
+     - (integral)[((y) + (size)) * (stride) + (x)] + (integral)[(y) * (stride) + (x)])
+
+// Equivalent to make_template() at (cx, cy) followed by get_similarity() at each position in the
+// search ring, returning the highest similarity found. The means and variances come from the
+// integral images, and the correlations are taken directly between the two image patches, so
+// that only one sum of products per position remains.
+static int get_max_similarity(AR2FeatureMapParamT *param, int cx, int cy, float *max)
+{
+    ARUint8  *ip1, *ip2;
+    ARUint32 sum1, sqSum1;
+    ARUint32 sum2, sqSum2;
+    double   vlen1, vlen2;
+    float    sim;
+    int      xsize, ysize, stride;
+    int      ts1, ts2, tsize, n;
+    int      search_size1, search_size2;
+    int      sxy;
+    int      x, y;
+    int      i, j, k;
+
+    xsize  = param->xsize;
+    ysize  = param->ysize;
+    stride = xsize + 1;
+    ts1    = param->ts1;
+    ts2    = param->ts2;
+    tsize  = ts1 + ts2 + 1;
+    n      = tsize * tsize;
+
+    if (cy - ts1 < 0 || cy + ts2 >= ysize || cx - ts1 < 0 || cx + ts2 >= xsize)
+        return -1;
+
+    sum1   = BOX_SUM(param->sumImage, stride, cx - ts1, cy - ts1, tsize);
+    sqSum1 = BOX_SUM(param->sqSumImage, stride, cx - ts1, cy - ts1, tsize);
+    vlen1  = (double)sqSum1 - (double)sum1 * (double)sum1 / n;
+    if (vlen1 <= 0.0)
+        return -1;
+
+    if (vlen1 / n < param->sd_thresh * param->sd_thresh)
+        return -1;
+
+    vlen1 = sqrt(vlen1);
+
+    search_size1 = param->search_size1;
+    search_size2 = param->search_size2;
+    *max         = -1.0f;
+
+    for (j = -search_size1; j <= search_size1; j++)
+    {
+        for (i = -search_size1; i <= search_size1; i++)
+        {
+            if (i * i + j * j <= search_size2 * search_size2)
+                continue;
+
+            x = cx + i;
+            y = cy + j;
+            if (y - ts1 < 0 || y + ts2 >= ysize || x - ts1 < 0 || x + ts2 >= xsize)
+                continue;
+
+            sum2   = BOX_SUM(param->sumImage, stride, x - ts1, y - ts1, tsize);
+            sqSum2 = BOX_SUM(param->sqSumImage, stride, x - ts1, y - ts1, tsize);
+            vlen2  = (double)sqSum2 - (double)sum2 * (double)sum2 / n;
+            if (vlen2 <= 0.0)
+                continue;
+
+            ip1 = &(param->imageBW[(cy - ts1) * xsize + (cx - ts1)]);
+            ip2 = &(param->imageBW[(y - ts1) * xsize + (x - ts1)]);
+            sxy = 0;
+
+            for (k = 0; k < tsize; k++)
+            {
+                sxy += dot_product(ip1, ip2, tsize);
+                ip1 += xsize;
+                ip2 += xsize;
+            }
+
+            // The template is zero-mean, so correlating with it is correlating with the patch less sum1/n.
+            sim = (float)(((double)sxy - (double)sum1 * (double)sum2 / n) / (vlen1 * sqrt(vlen2)));
+            if (sim > *max)
+            {
+                *max = sim;
+                if (*max > param->max_sim_thresh)
+                    break;
+            }
+        }
+
+        if (*max > param->max_sim_thresh)
+            break;
+    }
+
+    return 0;
+}
+
+// Sum of products of n pairs of pixels.
+static int dot_product(ARUint8 *p1, ARUint8 *p2, int n)
+{
+    int sum;
+    int i;
+
+    i   = 0;
+    sum = 0;
+#if defined(HAVE_ARM_NEON)
+    if (n >= 16)
+    {
+        uint32x4_t acc = vdupq_n_u32(0);
+        uint32x2_t acc2;
+
+        for (; i + 16 <= n; i += 16)
+        {
+            uint8x16_t v1 = vld1q_u8(p1 + i);
+            uint8x16_t v2 = vld1q_u8(p2 + i);
+            acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(v1), vget_low_u8(v2)));
+            acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(v1), vget_high_u8(v2)));
+        }
+
+        for (; i + 8 <= n; i += 8)
+        {
+            acc = vpadalq_u16(acc, vmull_u8(vld1_u8(p1 + i), vld1_u8(p2 + i)));
+        }
+
+        acc2 = vadd_u32(vget_low_u32(acc), vget_high_u32(acc));
+        sum  = (int)(vget_lane_u32(acc2, 0) + vget_lane_u32(acc2, 1));
+    }
+#elif defined(AR2_FEATURE_MAP_SSE2)
+    if (n >= 8)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i acc  = _mm_setzero_si128();
+        __m128i v1, v2;
+
+        for (; i + 16 <= n; i += 16)
+        {
+            v1  = _mm_loadu_si128((const __m128i*)(p1 + i));
+            v2  = _mm_loadu_si128((const __m128i*)(p2 + i));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(v1, zero), _mm_unpacklo_epi8(v2, zero)));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(v1, zero), _mm_unpackhi_epi8(v2, zero)));
+        }
+
+        for (; i + 8 <= n; i += 8)
+        {
+            v1  = _mm_loadl_epi64((const __m128i*)(p1 + i));
+            v2  = _mm_loadl_epi64((const __m128i*)(p2 + i));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(v1, zero), _mm_unpacklo_epi8(v2, zero)));
+        }
+
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm_cvtsi128_si32(acc);
+    }
+#endif
+
+    for (; i < n; i++)
+        sum += p1[i] * p2[i];
+
+    return sum;
+}
@@ -38,6 +38,7 @@
 #include <AR/ar.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <AR2/featureSet.h>
 
 AR2FeatureSetT* ar2ReadFeatureSet(char *filename, char *ext)
@@ -223,4 +224,116 @@ int ar2FreeFeatureSet(AR2FeatureSetT **featureSet)
     *featureSet = NULL;
 
     return 0;
-}
\ No newline at end of file
+}
+AR2FeatureIndexT* ar2GenFeatureIndex(const AR2FeatureSetT *featureSet)
+{
+    AR2FeatureIndexT *featureIndex;
+    float            minx, miny, maxx, maxy;
+    int              *cellStart, *count;
+    int              cellNum, div, maxNum;
+    int              cx, cy, c;
+    int              i, j;
+
+    if (!featureSet || featureSet->num <= 0)
+        return NULL;
+
+    // Bounding box of all levels, and the size of the densest level.
+    minx   = miny = 1e20F;
+    maxx   = maxy = -1e20F;
+    maxNum = 0;
+    for (i = 0; i < featureSet->num; i++)
+    {
+        for (j = 0; j < featureSet->list[i].num; j++)
+        {
+            if (featureSet->list[i].coord[j].mx < minx) minx = featureSet->list[i].coord[j].mx;
+            if (featureSet->list[i].coord[j].mx > maxx) maxx = featureSet->list[i].coord[j].mx;
+            if (featureSet->list[i].coord[j].my < miny) miny = featureSet->list[i].coord[j].my;
+            if (featureSet->list[i].coord[j].my > maxy) maxy = featureSet->list[i].coord[j].my;
+        }
+
+        if (featureSet->list[i].num > maxNum)
+            maxNum = featureSet->list[i].num;
+    }
+
+    if (maxNum == 0)
+        return NULL;
+
+    div = (int)sqrtf((float)maxNum / AR2_FEATURE_INDEX_CELL_FEATURES);
+    if (div < 1)
+        div = 1;
+    else if (div > AR2_FEATURE_INDEX_DIV_MAX)
+        div = AR2_FEATURE_INDEX_DIV_MAX;
+
+    arMalloc(featureIndex, AR2FeatureIndexT, 1);
+    featureIndex->mx       = minx;
+    featureIndex->my       = miny;
+    featureIndex->cellSize = ((maxx - minx > maxy - miny) ? maxx - minx : maxy - miny) / div;
+    if (featureIndex->cellSize <= 0.0F)
+        featureIndex->cellSize = 1.0F;
+    featureIndex->xdiv     = (int)((maxx - minx) / featureIndex->cellSize) + 1;
+    featureIndex->ydiv     = (int)((maxy - miny) / featureIndex->cellSize) + 1;
+    if (featureIndex->xdiv > AR2_FEATURE_INDEX_DIV_MAX) featureIndex->xdiv = AR2_FEATURE_INDEX_DIV_MAX;
+    if (featureIndex->ydiv > AR2_FEATURE_INDEX_DIV_MAX) featureIndex->ydiv = AR2_FEATURE_INDEX_DIV_MAX;
+    featureIndex->levelNum = featureSet->num;
+
+    cellNum = featureIndex->xdiv * featureIndex->ydiv;
+    arMalloc(featureIndex->cellStart, int, featureSet->num * (cellNum + 1));
+    arMalloc(count, int, cellNum);
+    j = 0;
+    for (i = 0; i < featureSet->num; i++)
+        j += featureSet->list[i].num;
+    arMalloc(featureIndex->coordIndex, int, (j > 0) ? j : 1);
+
+    // Counting sort of each level's points by cell. Points keep their relative order within a cell.
+    c = 0;
+    for (i = 0; i < featureSet->num; i++)
+    {
+        cellStart = featureIndex->cellStart + i * (cellNum + 1);
+        for (j = 0; j < cellNum; j++)
+            count[j] = 0;
+
+        for (j = 0; j < featureSet->list[i].num; j++)
+        {
+            cx = (int)((featureSet->list[i].coord[j].mx - minx) / featureIndex->cellSize);
+            cy = (int)((featureSet->list[i].coord[j].my - miny) / featureIndex->cellSize);
+            if (cx >= featureIndex->xdiv) cx = featureIndex->xdiv - 1;
+            if (cy >= featureIndex->ydiv) cy = featureIndex->ydiv - 1;
+            count[cy * featureIndex->xdiv + cx]++;
+        }
+
+        for (j = 0; j < cellNum; j++)
+        {
+            cellStart[j] = c;
+            c           += count[j];
+            count[j]     = cellStart[j];
+        }
+
+        cellStart[cellNum] = c;
+
+        for (j = 0; j < featureSet->list[i].num; j++)
+        {
+            cx = (int)((featureSet->list[i].coord[j].mx - minx) / featureIndex->cellSize);
+            cy = (int)((featureSet->list[i].coord[j].my - miny) / featureIndex->cellSize);
+            if (cx >= featureIndex->xdiv) cx = featureIndex->xdiv - 1;
+            if (cy >= featureIndex->ydiv) cy = featureIndex->ydiv - 1;
+            featureIndex->coordIndex[count[cy * featureIndex->xdiv + cx]++] = j;
+        }
+    }
+
+    free(count);
+
+    return featureIndex;
+}
+
+int ar2FreeFeatureIndex(AR2FeatureIndexT **featureIndex)
+{
+    if (*featureIndex == NULL)
+        return -1;
+
+    free((*featureIndex)->cellStart);
+    free((*featureIndex)->coordIndex);
+    free(*featureIndex);
+    *featureIndex = NULL;
+
+    return 0;
+}
@@ -43,14 +43,19 @@
 #include <AR2/tracking.h>
 #include <AR2/util.h>
 
-static AR2HandleT* ar2CreateHandleSub(AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int threadNum);
+static AR2HandleT* ar2CreateHandleSub(AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int threadNum, int searchFeatureMax, int candidateMax);
 
 
 AR2HandleT* ar2CreateHandle(ARParamLT *cparamLT, AR_PIXEL_FORMAT pixFormat, int threadNum)
+{
+    return ar2CreateHandle2(cparamLT, pixFormat, threadNum, 0, 0);
+}
+
+AR2HandleT* ar2CreateHandle2(ARParamLT *cparamLT, AR_PIXEL_FORMAT pixFormat, int threadNum, int searchFeatureMax, int candidateMax)
 {
     AR2HandleT *ar2Handle;
 
-    ar2Handle = ar2CreateHandleSub(pixFormat, cparamLT->param.xsize, cparamLT->param.ysize, threadNum);
+    ar2Handle = ar2CreateHandleSub(pixFormat, cparamLT->param.xsize, cparamLT->param.ysize, threadNum, searchFeatureMax, candidateMax);
 
     ar2Handle->trackingMode = AR2_TRACKING_6DOF;
     ar2Handle->cparamLT     = cparamLT;
@@ -61,10 +66,15 @@ AR2HandleT* ar2CreateHandle(ARParamLT *cparamLT, AR_PIXEL_FORMAT pixFormat, int
 }
 
 AR2HandleT* ar2CreateHandleHomography(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat, int threadNum)
+{
+    return ar2CreateHandleHomography2(xsize, ysize, pixFormat, threadNum, 0, 0);
+}
+
+AR2HandleT* ar2CreateHandleHomography2(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat, int threadNum, int searchFeatureMax, int candidateMax)
 {
     AR2HandleT *ar2Handle;
 
-    ar2Handle = ar2CreateHandleSub(pixFormat, xsize, ysize, threadNum);
+    ar2Handle = ar2CreateHandleSub(pixFormat, xsize, ysize, threadNum, searchFeatureMax, candidateMax);
 
     ar2Handle->trackingMode = AR2_TRACKING_HOMOGRAPHY;
     ar2Handle->cparamLT     = NULL;
@@ -73,7 +83,7 @@ AR2HandleT* ar2CreateHandleHomography(int xsize, int ysize, AR_PIXEL_FORMAT pixF
     return ar2Handle;
 }
 
-static AR2HandleT* ar2CreateHandleSub(int pixFormat, int xsize, int ysize, int threadNum)
+static AR2HandleT* ar2CreateHandleSub(int pixFormat, int xsize, int ysize, int threadNum, int searchFeatureMax, int candidateMax)
 {
     AR2HandleT *ar2Handle;
     int        i;
@@ -87,22 +97,34 @@ static AR2HandleT* ar2CreateHandleSub(int pixFormat, int xsize, int ysize, int t
     ar2Handle->blurLevel  = AR2_DEFAULT_BLUR_LEVEL;
 #endif
     ar2Handle->searchSize       = AR2_DEFAULT_SEARCH_SIZE;
+    ar2Handle->searchMinSize    = AR2_DEFAULT_SEARCH_MIN_SIZE;
+    ar2Handle->searchPyramid    = AR2_DEFAULT_SEARCH_PYRAMID;
     ar2Handle->templateSize1    = AR2_DEFAULT_TS1;
     ar2Handle->templateSize2    = AR2_DEFAULT_TS2;
+    ar2Handle->searchFeatureMax = (searchFeatureMax > 0) ? searchFeatureMax : AR2_SEARCH_FEATURE_MAX;
     ar2Handle->searchFeatureNum = AR2_DEFAULT_SEARCH_FEATURE_NUM;
-    if (ar2Handle->searchFeatureNum > AR2_SEARCH_FEATURE_MAX)
+    if (ar2Handle->searchFeatureNum > ar2Handle->searchFeatureMax)
     {
-        ar2Handle->searchFeatureNum = AR2_SEARCH_FEATURE_MAX;
+        ar2Handle->searchFeatureNum = ar2Handle->searchFeatureMax;
     }
 
+    ar2Handle->candidateMax = (candidateMax > 0) ? candidateMax : AR2_TRACKING_CANDIDATE_MAX;
+    ar2Handle->target       = NULL; // Per-surface-set buffers are allocated by ar2Tracking().
+    ar2Handle->targetMax    = 0;
+    ar2Handle->job          = NULL;
+    ar2Handle->lumaImage    = NULL;
+    ar2Handle->halfImage    = NULL;
+
     ar2Handle->simThresh      = AR2_DEFAULT_SIM_THRESH;
     ar2Handle->trackingThresh = AR2_DEFAULT_TRACKING_THRESH;
 
-
-
     if (threadNum == AR2_TRACKING_DEFAULT_THREAD_NUM)
     {
         threadNum = threadGetCPU();
+        if (threadNum > AR2_THREAD_MAX)
+        {
+            threadNum = AR2_THREAD_MAX;
+        }
     }
 
     if (threadNum < 1)
@@ -110,18 +132,25 @@ static AR2HandleT* ar2CreateHandleSub(int pixFormat, int xsize, int ysize, int t
         threadNum = 1;
     }
 
-    if (threadNum > AR2_THREAD_MAX)
+    // No more than one feature is searched for per thread at a time.
+    if (threadNum > ar2Handle->searchFeatureMax)
     {
-        threadNum = AR2_THREAD_MAX;
+        threadNum = ar2Handle->searchFeatureMax;
     }
 
     ar2Handle->threadNum = threadNum;
     ARLOGi("Tracking thread = %d\n", threadNum);
 
+    arMalloc(ar2Handle->arg, AR2Tracking2DParamT, threadNum);
+    arMalloc(ar2Handle->threadHandle, THREAD_HANDLE_T*, threadNum);
+
     for (i = 0; i < ar2Handle->threadNum; i++)
     {
         arMalloc(ar2Handle->arg[i].mfImage, ARUint8, xsize * ysize);
-        ar2Handle->arg[i].templ = NULL;
+        ar2Handle->arg[i].templ     = NULL;
+        ar2Handle->arg[i].templHalf = NULL;
+        ar2Handle->arg[i].job       = NULL;
+        ar2Handle->arg[i].jobNum    = 0;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
         ar2Handle->arg[i].templ2 = NULL;
 #endif
@@ -133,7 +162,8 @@ static AR2HandleT* ar2CreateHandleSub(int pixFormat, int xsize, int ysize, int t
 
 int ar2DeleteHandle(AR2HandleT **ar2Handle)
 {
-    int i;
+    AR2TrackingTargetT *target;
+    int                i;
 
     if (*ar2Handle == NULL)
         return -1;
@@ -148,6 +178,9 @@ int ar2DeleteHandle(AR2HandleT **ar2Handle)
         if ((*ar2Handle)->arg[i].templ != NULL)
             ar2FreeTemplate((*ar2Handle)->arg[i].templ);
 
+        if ((*ar2Handle)->arg[i].templHalf != NULL)
+            ar2FreeTemplate((*ar2Handle)->arg[i].templHalf);
+
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
         if ((*ar2Handle)->arg[i].templ2 != NULL)
             ar2FreeTemplate ((*ar2Handle)->arg[i].templ2);
@@ -157,6 +190,27 @@ int ar2DeleteHandle(AR2HandleT **ar2Handle)
     if ((*ar2Handle)->icpHandle != NULL)
         icpDeleteHandle(&((*ar2Handle)->icpHandle));
 
+    for (i = 0; i < (*ar2Handle)->targetMax; i++)
+    {
+        target = &((*ar2Handle)->target[i]);
+        free(target->wtrans1);
+        free(target->wtrans2);
+        free(target->wtrans3);
+        free(target->pos);
+        free(target->pos2d);
+        free(target->pos3d);
+        free(target->candidate);
+        free(target->candidate2);
+        free(target->usedFeature);
+    }
+
+    free((*ar2Handle)->target);
+    free((*ar2Handle)->job);
+    free((*ar2Handle)->lumaImage);
+    free((*ar2Handle)->halfImage);
+    free((*ar2Handle)->arg);
+    free((*ar2Handle)->threadHandle);
+
     // if( (*ar2Handle)->cparamLT  != NULL ) arParamLTFree( (*ar2Handle)->cparamLT );
     free(*ar2Handle);
     *ar2Handle = NULL;
@@ -277,15 +331,51 @@ int ar2GetSearchSize(AR2HandleT *ar2Handle, int *searchSize)
     return 0;
 }
 
+int ar2SetSearchMinSize(AR2HandleT *ar2Handle, int searchMinSize)
+{
+    if (ar2Handle == NULL)
+        return -1;
+
+    ar2Handle->searchMinSize = searchMinSize;
+    return 0;
+}
+
+int ar2GetSearchMinSize(AR2HandleT *ar2Handle, int *searchMinSize)
+{
+    if (ar2Handle == NULL)
+        return -1;
+
+    *searchMinSize = ar2Handle->searchMinSize;
+    return 0;
+}
+
+int ar2SetSearchPyramid(AR2HandleT *ar2Handle, int searchPyramid)
+{
+    if (ar2Handle == NULL)
+        return -1;
+
+    ar2Handle->searchPyramid = searchPyramid;
+    return 0;
+}
+
+int ar2GetSearchPyramid(AR2HandleT *ar2Handle, int *searchPyramid)
+{
+    if (ar2Handle == NULL)
+        return -1;
+
+    *searchPyramid = ar2Handle->searchPyramid;
+    return 0;
+}
+
 int ar2SetSearchFeatureNum(AR2HandleT *ar2Handle, int searchFeatureNum)
 {
     if (ar2Handle == NULL)
         return -1;
 
     ar2Handle->searchFeatureNum = searchFeatureNum;
-    if (ar2Handle->searchFeatureNum > AR2_SEARCH_FEATURE_MAX)
+    if (ar2Handle->searchFeatureNum > ar2Handle->searchFeatureMax)
     {
-        ar2Handle->searchFeatureNum = AR2_SEARCH_FEATURE_MAX;
+        ar2Handle->searchFeatureNum = ar2Handle->searchFeatureMax;
     }
 
     if (ar2Handle->searchFeatureNum < 3)
@@ -305,6 +395,24 @@ int ar2GetSearchFeatureNum(AR2HandleT *ar2Handle, int *searchFeatureNum)
     return 0;
 }
 
+int ar2GetSearchFeatureMax(AR2HandleT *ar2Handle, int *searchFeatureMax)
+{
+    if (ar2Handle == NULL)
+        return -1;
+
+    *searchFeatureMax = ar2Handle->searchFeatureMax;
+    return 0;
+}
+
+int ar2GetCandidateMax(AR2HandleT *ar2Handle, int *candidateMax)
+{
+    if (ar2Handle == NULL)
+        return -1;
+
+    *candidateMax = ar2Handle->candidateMax;
+    return 0;
+}
+
 int ar2SetTemplateSize1(AR2HandleT *ar2Handle, int templateSize1)
 {
     if (ar2Handle == NULL)
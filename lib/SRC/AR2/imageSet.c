@@ -45,9 +45,48 @@
 #endif
 #include <AR2/imageFormat.h>
 #include <AR2/imageSet.h>
+// #define AR2_DISABLE_PTHREADS // Uncomment to disable pthreads support.
+
+#if !defined(_WINRT) && !defined(AR2_DISABLE_PTHREADS)
+#  include <pthread.h>
+#else
+#  include <windows.h>
+#  define pthread_mutex_t SRWLOCK
+#  define PTHREAD_MUTEX_INITIALIZER SRWLOCK_INIT
+#  define pthread_mutex_lock(pm)   AcquireSRWLockExclusive(pm)
+#  define pthread_mutex_unlock(pm) ReleaseSRWLockExclusive(pm)
+#endif
+
+// A scale's pixels are published with a release store once generated, so that callers can
+// find an existing scale with an acquire load and no lock.
+#ifdef _MSC_VER
+#  include <intrin.h>
+#  define AR2_LOAD_PTR_ACQUIRE(pp)      _InterlockedCompareExchangePointer((void * volatile *)(pp), NULL, NULL)
+#  define AR2_STORE_PTR_RELEASE(pp, v)  _InterlockedExchangePointer((void * volatile *)(pp), (v))
+#else
+#  define AR2_LOAD_PTR_ACQUIRE(pp)      __atomic_load_n((pp), __ATOMIC_ACQUIRE)
+#  define AR2_STORE_PTR_RELEASE(pp, v)  __atomic_store_n((pp), (v), __ATOMIC_RELEASE)
+#endif
+
+// Image sets read from disk are shared between all surface sets in the process that
+// load the same file. Each entry is reference counted and released by ar2FreeImageSet().
+typedef struct _AR2ImageSetCacheEntryT
+{
+    char                           *filename;
+    AR2ImageSetT                   *imageSet;
+    int                            refCount;
+    struct _AR2ImageSetCacheEntryT *next;
+} AR2ImageSetCacheEntryT;
+
+static AR2ImageSetCacheEntryT *imageSetCache = NULL;
+// Guards imageSetCache and the publishing of scales generated by ar2GetImageSetScale().
+static pthread_mutex_t        imageSetLock = PTHREAD_MUTEX_INITIALIZER;
 
 static AR2ImageT* ar2GenImageLayer1(ARUint8 *image, int xsize, int ysize, int nc, float srcdpi, float dstdpi);
 static AR2ImageT* ar2GenImageLayer2(AR2ImageT *src, float dstdpi);
+static AR2ImageT* ar2InitImageLayer2(AR2ImageT *src, float dstdpi);
+static void       ar2FillImageLayer2(AR2ImageT *src, AR2ImageT *dst);
+static AR2ImageSetT* ar2ReadImageSetFile(char *filename);
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
 static void       defocus_image(ARUint8 *img, int xsize, int ysize, int n);
 #endif
@@ -88,6 +127,143 @@ AR2ImageSetT* ar2GenImageSet(ARUint8 *image, int xsize, int ysize, int nc, float
 }
 
 AR2ImageSetT* ar2ReadImageSet(char *filename)
+{
+    AR2ImageSetCacheEntryT *entry;
+    AR2ImageSetT           *imageSet;
+
+    pthread_mutex_lock(&imageSetLock);
+    for (entry = imageSetCache; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->filename, filename) == 0)
+        {
+            entry->refCount++;
+            pthread_mutex_unlock(&imageSetLock);
+            return entry->imageSet;
+        }
+    }
+    pthread_mutex_unlock(&imageSetLock);
+
+    // Decode outside the lock so that other sets can be loaded concurrently.
+    imageSet = ar2ReadImageSetFile(filename);
+    if (imageSet == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&imageSetLock);
+    for (entry = imageSetCache; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->filename, filename) == 0)
+            break;
+    }
+
+    if (entry != NULL)
+    {
+        // Another thread read the same file while we were decoding; use its copy.
+        entry->refCount++;
+        pthread_mutex_unlock(&imageSetLock);
+        ar2FreeImageSet(&imageSet);
+        return entry->imageSet;
+    }
+
+    arMalloc(entry, AR2ImageSetCacheEntryT, 1);
+    arMalloc(entry->filename, char, strlen(filename) + 1);
+    strcpy(entry->filename, filename);
+    entry->imageSet = imageSet;
+    entry->refCount = 1;
+    entry->next     = imageSetCache;
+    imageSetCache   = entry;
+    pthread_mutex_unlock(&imageSetLock);
+
+    return imageSet;
+}
+
+AR2ImageT* ar2GetImageSetScale(AR2ImageSetT *imageSet, int scale)
+{
+    AR2ImageT *image;
+    AR2ImageT tmp;
+
+    if (imageSet == NULL || scale < 0 || scale >= imageSet->num)
+        return NULL;
+
+    image = imageSet->scale[scale];
+
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+    if (AR2_LOAD_PTR_ACQUIRE(&image->imgBWBlur[0]) != NULL)
+        return image;
+#else
+    if (AR2_LOAD_PTR_ACQUIRE(&image->imgBW) != NULL)
+        return image;
+#endif
+
+    // Minify without holding the lock, so that other scales and sets stay available meanwhile.
+    // If another thread publishes this scale first, its copy is kept and ours discarded.
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.xsize = image->xsize;
+    tmp.ysize = image->ysize;
+    tmp.dpi   = image->dpi;
+    ar2FillImageLayer2(imageSet->scale[0], &tmp);
+
+    pthread_mutex_lock(&imageSetLock);
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+    if (image->imgBWBlur[0] == NULL)
+    {
+        for (int i = 1; i < AR2_BLUR_IMAGE_MAX; i++)
+            image->imgBWBlur[i] = tmp.imgBWBlur[i];
+
+        AR2_STORE_PTR_RELEASE(&image->imgBWBlur[0], tmp.imgBWBlur[0]);
+    }
+    else
+    {
+        for (int i = 0; i < AR2_BLUR_IMAGE_MAX; i++)
+            free(tmp.imgBWBlur[i]);
+    }
+#else
+    if (image->imgBW == NULL)
+        AR2_STORE_PTR_RELEASE(&image->imgBW, tmp.imgBW);
+    else
+        free(tmp.imgBW);
+#endif
+    pthread_mutex_unlock(&imageSetLock);
+
+    return image;
+}
+
+int ar2ReadImageSetInfo(char *filename, int *xsize, int *ysize, float *dpi)
+{
+    FILE       *fp;
+    int32_t    num;
+    int        nc;
+    int        ret;
+    size_t     len;
+    const char ext[] = ".iset";
+    char       *buf;
+
+    len = strlen(filename) + strlen(ext) + 1; // +1 for nul terminator.
+    arMalloc(buf, char, len);
+    sprintf(buf, "%s%s", filename, ext);
+    fp = fopen(buf, "rb");
+    free(buf);
+    if (!fp)
+    {
+        ARLOGe("Error: unable to open file '%s%s' for reading.\n", filename, ext);
+        return (-1);
+    }
+
+    if (fread(&num, sizeof(num), 1, fp) != 1 || num <= 0)
+    {
+        ARLOGe("Error reading imageSet.\n");
+        fclose(fp);
+        return (-1);
+    }
+
+    ret = ar2ReadJpegImageInfo2(fp, xsize, ysize, &nc, dpi);
+    fclose(fp);
+    if (ret < 0 || nc != 1)
+        return (-1);
+
+    return (0);
+}
+
+static AR2ImageSetT* ar2ReadImageSetFile(char *filename)
 {
     FILE          *fp       = NULL;
     AR2JpegImageT *jpgImage = NULL;
@@ -169,8 +345,8 @@ AR2ImageSetT* ar2ReadImageSet(char *filename)
 #endif
     free(jpgImage);
 
-    // Minify for the other scales.
-    // First, find the list of scales we wrote into the file.
+    // The other scales are minified from scale 0 on first use by ar2GetImageSetScale().
+    // Here we only read the list of scales we wrote into the file.
     fseek(fp, (long)(-(int)sizeof(dpi) * (imageSet->num - 1)), SEEK_END);
 
     for (i = 1; i < imageSet->num; i++)
@@ -192,7 +368,7 @@ AR2ImageSetT* ar2ReadImageSet(char *filename)
             goto bail1;
         }
 
-        imageSet->scale[i] = ar2GenImageLayer2(imageSet->scale[0], dpi);
+        imageSet->scale[i] = ar2InitImageLayer2(imageSet->scale[0], dpi);
         if (imageSet->scale[i] == NULL)
         {
             for (k1 = 0; k1 < i; k1++)
@@ -278,7 +454,8 @@ bailBadWrite:
 
 int ar2FreeImageSet(AR2ImageSetT **imageSet)
 {
-    int i;
+    AR2ImageSetCacheEntryT *entry, **prev;
+    int                    i;
 
     if (imageSet == NULL)
         return -1;
@@ -286,6 +463,26 @@ int ar2FreeImageSet(AR2ImageSetT **imageSet)
     if (*imageSet == NULL)
         return -1;
 
+    pthread_mutex_lock(&imageSetLock);
+    for (prev = &imageSetCache; (entry = *prev) != NULL; prev = &entry->next)
+    {
+        if (entry->imageSet == *imageSet)
+        {
+            if (--entry->refCount > 0)
+            {
+                pthread_mutex_unlock(&imageSetLock);
+                *imageSet = NULL;
+                return 0;
+            }
+
+            *prev = entry->next;
+            free(entry->filename);
+            free(entry);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&imageSetLock);
+
     for (i = 0; i < (*imageSet)->num; i++)
     {
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
@@ -406,19 +603,38 @@ static AR2ImageT* ar2GenImageLayer1(ARUint8 *image, int xsize, int ysize, int nc
 static AR2ImageT* ar2GenImageLayer2(AR2ImageT *src, float dpi)
 {
     AR2ImageT *dst;
-    ARUint8   *p1, *p2;
-    int       wx, wy;
-    int       sx, sy, ex, ey;
-    int       ii, jj, iii, jjj;
-    int       co, value;
 
-    wx = (int)lroundf(src->xsize * dpi / src->dpi);
-    wy = (int)lroundf(src->ysize * dpi / src->dpi);
+    dst = ar2InitImageLayer2(src, dpi);
+    ar2FillImageLayer2(src, dst);
 
-    arMalloc(dst, AR2ImageT, 1);
-    dst->xsize = wx;
-    dst->ysize = wy;
+    return dst;
+}
+
+// Sets up the size of a minified layer of src without generating its pixels.
+static AR2ImageT* ar2InitImageLayer2(AR2ImageT *src, float dpi)
+{
+    AR2ImageT *dst;
+
+    arMallocClear(dst, AR2ImageT, 1);
+    dst->xsize = (int)lroundf(src->xsize * dpi / src->dpi);
+    dst->ysize = (int)lroundf(src->ysize * dpi / src->dpi);
     dst->dpi   = dpi;
+
+    return dst;
+}
+
+static void ar2FillImageLayer2(AR2ImageT *src, AR2ImageT *dst)
+{
+    ARUint8 *p1, *p2;
+    int     wx, wy;
+    float   dpi;
+    int     sx, sy, ex, ey;
+    int     ii, jj, iii, jjj;
+    int     co, value;
+
+    wx  = dst->xsize;
+    wy  = dst->ysize;
+    dpi = dst->dpi;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     for (int i = 0; i < AR2_BLUR_IMAGE_MAX; i++)
     {
@@ -483,8 +699,6 @@ static AR2ImageT* ar2GenImageLayer2(AR2ImageT *src, float dpi)
 #else
     // defocus_image( dst->imgBW, wx, wy, 3 );
 #endif
-
-    return dst;
 }
 
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
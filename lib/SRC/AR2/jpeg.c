@@ -51,6 +51,8 @@ struct my_error_mgr
 typedef struct my_error_mgr*my_error_ptr;
 
 static unsigned char* jpgread(FILE *fp, int *w, int *h, int *nc, float *dpi);
+static int            jpginfo(FILE *fp, int *w, int *h, int *nc, float *dpi);
+static float          jpgdpi(const struct jpeg_decompress_struct *cinfo);
 static int            jpgwrite(FILE *fp, unsigned char *image, int w, int h, int nc, float dpi, int quality);
 
 int ar2WriteJpegImage(const char *filename, const char *ext, AR2JpegImageT *jpegImage, int quality)
@@ -127,6 +129,11 @@ AR2JpegImageT* ar2ReadJpegImage2(FILE *fp)
     return jpegImage;
 }
 
+int ar2ReadJpegImageInfo2(FILE *fp, int *xsize, int *ysize, int *nc, float *dpi)
+{
+    return jpginfo(fp, xsize, ysize, nc, dpi);
+}
+
 int ar2FreeJpegImage(AR2JpegImageT **jpegImage)
 {
     if (jpegImage == NULL)
@@ -244,26 +251,71 @@ static unsigned char* jpgread(FILE *fp, int *w, int *h, int *nc, float *dpi)
         *nc = cinfo.num_components;
 
     if (dpi)
+        *dpi = jpgdpi(&cinfo);
+
+    return pixels;
+}
+
+// Reads only the header of the JPEG image, leaving fp after it.
+static int jpginfo(FILE *fp, int *w, int *h, int *nc, float *dpi)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct my_error_mgr           jerr;
+
+    memset(&cinfo, 0, sizeof(cinfo));
+    cinfo.err           = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = my_error_exit;
+    if (setjmp(jerr.setjmp_buffer))
     {
-        if (cinfo.density_unit == 1 && cinfo.X_density == cinfo.Y_density)
-        {
-            *dpi = (float)cinfo.X_density;
-        }
-        else if (cinfo.density_unit == 2 && cinfo.X_density == cinfo.Y_density)
-        {
-            *dpi = (float)cinfo.X_density * 2.54f;
-        }
-        else if (cinfo.density_unit > 2 && cinfo.X_density == 0 && cinfo.Y_density == 0)     // Handle the case with some libjpeg versions where density in DPI is returned in the density_unit field.
-        {
-            *dpi = (float)(cinfo.density_unit);
-        }
-        else
-        {
-            *dpi = 0.0f;
-        }
+        jpeg_destroy_decompress(&cinfo);
+        ARLOGe("Error reading JPEG file header.\n");
+        return -1;
     }
 
-    return pixels;
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, fp);
+    if (jpeg_read_header(&cinfo, TRUE) != 1)
+    {
+        ARLOGe("Error reading JPEG file header.\n");
+        jpeg_destroy_decompress(&cinfo);
+        return -1;
+    }
+
+    if (w)
+        *w = cinfo.image_width;
+
+    if (h)
+        *h = cinfo.image_height;
+
+    if (nc)
+        *nc = cinfo.num_components;
+
+    if (dpi)
+        *dpi = jpgdpi(&cinfo);
+
+    jpeg_destroy_decompress(&cinfo);
+
+    return 0;
+}
+
+static float jpgdpi(const struct jpeg_decompress_struct *cinfo)
+{
+    if (cinfo->density_unit == 1 && cinfo->X_density == cinfo->Y_density)
+    {
+        return (float)cinfo->X_density;
+    }
+    else if (cinfo->density_unit == 2 && cinfo->X_density == cinfo->Y_density)
+    {
+        return (float)cinfo->X_density * 2.54f;
+    }
+    else if (cinfo->density_unit > 2 && cinfo->X_density == 0 && cinfo->Y_density == 0)     // Handle the case with some libjpeg versions where density in DPI is returned in the density_unit field.
+    {
+        return (float)(cinfo->density_unit);
+    }
+    else
+    {
+        return 0.0f;
+    }
 }
 
 static int jpgwrite(FILE *fp, unsigned char *image, int w, int h, int nc, float dpi, int quality)
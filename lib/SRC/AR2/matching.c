@@ -50,11 +50,16 @@
 #define  SKIP_INTERVAL 3
 #define  KEEP_NUM      3
 
+#define  PYRAMID_SKIP_INTERVAL 1 // In the half resolution image, i.e. every 4th pixel at full resolution, as SKIP_INTERVAL.
+
 
 static int ar2GetBestMatchingSubFine(ARUint8 *img, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat,
                                      AR2TemplateT *mtemp, int sx, int sy, int *val);
 static void updateCandidate(int x, int y, int wval,
                             int *keep_num, int cx[KEEP_NUM], int cy[KEEP_NUM], int cval[KEEP_NUM]);
+static int ar2GetBestMatchingRefine(ARUint8 *img, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat, AR2TemplateT *mtemp,
+                                    int keep_num, int cx[KEEP_NUM], int cy[KEEP_NUM], int *bx, int *by, float *val);
+static int ar2SetHalfTemplate(AR2TemplateT *mtemp, AR2TemplateT *htemp);
 #if 1
 static int ar2GetBestMatchingSubFineOpt(ARUint8 *img, int xsize, int ysize, int sx1, int sy1, AR2TemplateT *mtemp,
                                         ARUint32 *subImage1, ARUint32 *subImage2, int sx2, int sy2, int *val);
@@ -89,21 +94,12 @@ int ar2GetBestMatching(ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR_
     int     keep_num;
     int     cx[KEEP_NUM], cy[KEEP_NUM];
     int     cval[KEEP_NUM];
-    int     wval, wval2;
-    int     i, j, l;
+    int     wval;
+    int     i, j;
     int     ii;
     int     ret;
     ARUint8 *pmf;
 
-#if 0
-#else
-    ARUint32 *subImage1, *p11, *p12, w1;
-    ARUint32 *subImage2, *p21, *p22, w2;
-    ARUint32 subImage11[AR2_TEMP_SCALE];
-    ARUint32 subImage21[AR2_TEMP_SCALE];
-    ARUint8  *p3, *p4;
-#endif
-
     // First pass: initialise.
     yts1 = mtemp->yts1;
     yts2 = mtemp->yts2;
@@ -200,6 +196,255 @@ int ar2GetBestMatching(ARUint8 *img, ARUint8 *mfImage, int xsize, int ysize, AR_
     }
 
     // Third pass. Determine best candidate.
+    return ar2GetBestMatchingRefine(img, xsize, ysize, pixFormat, mtemp, keep_num, cx, cy, bx, by, val);
+}
+
+/*!
+    @function
+    @abstract Get best match for a candidate feature template, searching a half resolution image first.
+    @discussion
+        The search window is first searched in halfImg with a half resolution copy of mtemp
+        (built in htemp), at a quarter of the cost of each full resolution comparison.
+        The best candidates are then refined at full resolution, as ar2GetBestMatching() does.
+        If mtemp has too little texture to survive downsampling, this falls back to ar2GetBestMatching().
+    @param img Incoming image to match against. Must be a single luma plane.
+    @param halfImg img downsampled to (xsize/2)x(ysize/2), each pixel the mean of a 2x2 block of img.
+    @param mfImage Buffer same size as img, to provide working memory for status of matched features.
+    @param xsize Horizontal size of img and mfImage.
+    @param ysize Vertical size of img and mfImage.
+    @param mtemp Template undergoing matching.
+    @param htemp Working memory for the half resolution template, as returned by ar2GenTemplate() with
+        the same template sizes as mtemp.
+    @param rx search radius in x dimension.
+    @param ry search radius in y dimension.
+    @param search screen coordinates (second dimension is x and y) for up to three previous positions of this feature.
+    @param bx On return, x position of best candidate.
+    @param by On return, y position of best candidate.
+    @param val On return, the quality of the match of the best candidate.
+    @result -1 in case of error or no match, or 0 otherwise.
+ */
+int ar2GetBestMatchingPyramid(ARUint8 *img, ARUint8 *halfImg, ARUint8 *mfImage, int xsize, int ysize,
+                              AR2TemplateT *mtemp, AR2TemplateT *htemp, int rx, int ry,
+                              int search[3][2], int *bx, int *by, float *val)
+{
+    int     search_flag[] = {USE_SEARCH1, USE_SEARCH2, USE_SEARCH3};
+    int     hxsize, hysize, hrx, hry;
+    int     px, py, sx, sy, ex, ey;
+    int     keep_num;
+    int     cx[KEEP_NUM], cy[KEEP_NUM];
+    int     cval[KEEP_NUM];
+    int     wval;
+    int     i, j, l;
+    int     ii;
+    int     ret;
+    ARUint8 *pmf;
+
+    if (ar2SetHalfTemplate(mtemp, htemp) < 0)
+    {
+        return ar2GetBestMatching(img, mfImage, xsize, ysize, AR_PIXEL_FORMAT_MONO, mtemp, rx, ry, search, bx, by, val);
+    }
+
+    hxsize = xsize / 2;
+    hysize = ysize / 2;
+    hrx    = rx / 2;
+    hry    = ry / 2;
+
+    // First pass: initialise mfImage, which here holds the status of each pixel of halfImg.
+    for (ii = 0; ii < 3; ii++)
+    {
+        if (search_flag[ii] == 0)
+            continue;
+
+        if (search[ii][0] < 0)
+            break;
+
+        // "Snap" position to centre of grid square, in halfImg.
+        px = (search[ii][0] / 2 / (PYRAMID_SKIP_INTERVAL + 1)) * (PYRAMID_SKIP_INTERVAL + 1) + (PYRAMID_SKIP_INTERVAL + 1) / 2;
+        py = (search[ii][1] / 2 / (PYRAMID_SKIP_INTERVAL + 1)) * (PYRAMID_SKIP_INTERVAL + 1) + (PYRAMID_SKIP_INTERVAL + 1) / 2;
+
+        sx = px - hrx;
+        if (sx < 0)
+            sx = 0;
+
+        ex = px + hrx;
+        if (ex >= hxsize)
+            ex = hxsize - 1;
+
+        sy = py - hry;
+        if (sy < 0)
+            sy = 0;
+
+        ey = py + hry;
+        if (ey >= hysize)
+            ey = hysize - 1;
+
+        for (j = sy; j <= ey; j++)
+        {
+            pmf = &mfImage[j * hxsize + sx];
+
+            for (i = sx; i <= ex; i++)
+            {
+                *(pmf++) = 0;
+            }
+        }
+    }
+
+    // Second pass: get candidates in halfImg.
+    keep_num = 0;
+    ret      = 1;
+
+    for (ii = 0; ii < 3; ii++)
+    {
+        if (search_flag[ii] == 0)
+            continue;
+
+        if (search[ii][0] < 0)
+        {
+            if (ret)
+                return -1;
+            else
+                break;
+        }
+
+        px = (search[ii][0] / 2 / (PYRAMID_SKIP_INTERVAL + 1)) * (PYRAMID_SKIP_INTERVAL + 1) + (PYRAMID_SKIP_INTERVAL + 1) / 2;
+        py = (search[ii][1] / 2 / (PYRAMID_SKIP_INTERVAL + 1)) * (PYRAMID_SKIP_INTERVAL + 1) + (PYRAMID_SKIP_INTERVAL + 1) / 2;
+
+        for (j = py - hry; j <= py + hry; j += PYRAMID_SKIP_INTERVAL + 1)
+        {
+            if (j - htemp->yts1 * AR2_TEMP_SCALE < 0)
+                continue;
+
+            if (j + htemp->yts2 * AR2_TEMP_SCALE >= hysize)
+                break;
+
+            for (i = px - hrx; i <= px + hrx; i += PYRAMID_SKIP_INTERVAL + 1)
+            {
+                if (i - htemp->xts1 * AR2_TEMP_SCALE < 0)
+                    continue;
+
+                if (i + htemp->xts2 * AR2_TEMP_SCALE >= hxsize)
+                    break;
+
+                if (mfImage[j * hxsize + i])
+                    continue;
+
+                mfImage[j * hxsize + i] = 1;
+                if (ar2GetBestMatchingSubFine(halfImg, hxsize, hysize, AR_PIXEL_FORMAT_MONO, htemp, i, j, &wval) < 0)
+                {
+                    continue;
+                }
+
+                ret = 0;
+                updateCandidate(i, j, wval, &keep_num, cx, cy, cval);
+            }
+        }
+    }
+
+    // Third pass. Refine candidates at full resolution. Pixel (i, j) of halfImg is centred
+    // on (2i + 0.5, 2j + 0.5) in img.
+    for (l = 0; l < keep_num; l++)
+    {
+        cx[l] = cx[l] * 2 + 1;
+        cy[l] = cy[l] * 2 + 1;
+    }
+
+    return ar2GetBestMatchingRefine(img, xsize, ysize, AR_PIXEL_FORMAT_MONO, mtemp, keep_num, cx, cy, bx, by, val);
+}
+
+// Make htemp a half resolution copy of mtemp, for matching against an image downsampled by 2.
+// Each pixel of htemp is taken from a 3x3 block of mtemp, weighted 1-2-1 in x and y, so that
+// htemp pixels are centred on every second mtemp pixel. Pixels to which any NULL pixel
+// contributes are NULL. Returns -1 if htemp would be (nearly) empty or flat.
+static int ar2SetHalfTemplate(AR2TemplateT *mtemp, AR2TemplateT *htemp)
+{
+    static const int weight[3] = {1, 2, 1};
+    ARUint16         *p1, *p2;
+    int              sum, sum2, k;
+    int              vlen;
+    int              w, v;
+    int              i, j, ii, jj;
+
+    if (mtemp->xts1 < 3 || mtemp->xts2 < 3 || mtemp->yts1 < 3 || mtemp->yts2 < 3)
+        return -1;
+
+    htemp->xts1  = (mtemp->xts1 - 1) / 2;
+    htemp->xts2  = (mtemp->xts2 - 1) / 2;
+    htemp->yts1  = (mtemp->yts1 - 1) / 2;
+    htemp->yts2  = (mtemp->yts2 - 1) / 2;
+    htemp->xsize = htemp->xts1 + htemp->xts2 + 1;
+    htemp->ysize = htemp->yts1 + htemp->yts2 + 1;
+
+    p2  = htemp->img1;
+    sum = sum2 = k = 0;
+
+    for (j = -(htemp->yts1); j <= htemp->yts2; j++)
+    {
+        for (i = -(htemp->xts1); i <= htemp->xts2; i++)
+        {
+            // Centre of the 3x3 block in mtemp.
+            p1 = &(mtemp->img1[(j * 2 + mtemp->yts1) * mtemp->xsize + i * 2 + mtemp->xts1]);
+            w  = 0;
+
+            for (jj = -1; jj <= 1; jj++)
+            {
+                for (ii = -1; ii <= 1; ii++)
+                {
+                    v = p1[jj * mtemp->xsize + ii];
+                    if (v == AR2_TEMPLATE_NULL_PIXEL)
+                        break;
+
+                    w += v * weight[jj + 1] * weight[ii + 1];
+                }
+
+                if (ii <= 1)
+                    break;
+            }
+
+            if (jj <= 1)
+            {
+                *(p2++) = AR2_TEMPLATE_NULL_PIXEL;
+                continue;
+            }
+
+            w       = (w + 8) / 16;
+            *(p2++) = (ARUint16)w;
+            sum    += w;
+            sum2   += w * w;
+            k++;
+        }
+    }
+
+    if (k < htemp->xsize * htemp->ysize / 2)
+        return -1;
+
+    vlen = sum2 - sum * sum / k;
+    if (vlen <= 0)
+        return -1;
+
+    htemp->vlen     = (int)sqrtf((float)vlen);
+    htemp->sum      = sum;
+    htemp->validNum = k;
+
+    return 0;
+}
+
+// Search at full resolution in a (SKIP_INTERVAL*2+1)-pixel square around each of keep_num
+// candidate positions, for the best match of mtemp.
+static int ar2GetBestMatchingRefine(ARUint8 *img, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat, AR2TemplateT *mtemp,
+                                    int keep_num, int cx[KEEP_NUM], int cy[KEEP_NUM], int *bx, int *by, float *val)
+{
+    int      wval, wval2;
+    int      i, j, l;
+    int      ret;
+#if 0
+#else
+    ARUint32 *subImage1, *p11, *p12, w1;
+    ARUint32 *subImage2, *p21, *p22, w2;
+    ARUint32 subImage11[AR2_TEMP_SCALE];
+    ARUint32 subImage21[AR2_TEMP_SCALE];
+    ARUint8  *p3, *p4;
+#endif
+
     wval2 = 0;
     ret   = -1;
 #if 0
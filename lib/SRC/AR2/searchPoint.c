@@ -94,4 +94,48 @@ nosearch3:
     search[2][0] = -1;
     search[2][1] = -1;
     return;
-}
\ No newline at end of file
+}
+
+void ar2GetSearchWindow(const ARParamLT *cparamLT,
+                        const float trans1[3][4], const float trans2[3][4], const float trans3[3][4],
+                        AR2FeatureCoordT *feature, int searchSize, int searchMinSize,
+                        int search[3][2], int *rx, int *ry)
+{
+    float mx, my;
+    float ox1, ox2, ox3;
+    float oy1, oy2, oy3;
+    float ax, ay;
+
+    mx = feature->mx;
+    my = feature->my;
+
+    if (searchMinSize <= 0 || searchMinSize >= searchSize
+        || trans1 == NULL || trans2 == NULL || trans3 == NULL
+        || ar2MarkerCoord2ScreenCoord(cparamLT, trans1, mx, my, &ox1, &oy1) < 0
+        || ar2MarkerCoord2ScreenCoord(cparamLT, trans2, mx, my, &ox2, &oy2) < 0
+        || ar2MarkerCoord2ScreenCoord(cparamLT, trans3, mx, my, &ox3, &oy3) < 0)
+    {
+        ar2GetSearchPoint(cparamLT, trans1, trans2, trans3, feature, search);
+        *rx = *ry = searchSize;
+        return;
+    }
+
+    // The constant-acceleration prediction differs from the constant-velocity one (2*p1 - p2)
+    // by the acceleration (p1 - 2*p2 + p3). Centre the window between the two, and widen it
+    // in each axis by how far they disagree.
+    ax = ox1 - 2 * ox2 + ox3;
+    ay = oy1 - 2 * oy2 + oy3;
+
+    search[0][0] = (int)(2 * ox1 - ox2 + ax * 0.5F);
+    search[0][1] = (int)(2 * oy1 - oy2 + ay * 0.5F);
+    search[1][0] = search[1][1] = -1;
+    search[2][0] = search[2][1] = -1;
+
+    *rx = searchMinSize + (int)(fabsf(ax) * 0.5F + 0.5F);
+    if (*rx > searchSize)
+        *rx = searchSize;
+
+    *ry = searchMinSize + (int)(fabsf(ay) * 0.5F + 0.5F);
+    if (*ry > searchSize)
+        *ry = searchSize;
+}
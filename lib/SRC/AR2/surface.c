@@ -154,6 +154,8 @@ AR2SurfaceSetT* ar2ReadSurfaceSet(const char *filename, const char *ext, ARPattH
             return (NULL);
         }
 
+        surfaceSet->surface[i].featureIndex = ar2GenFeatureIndex(surfaceSet->surface[i].featureSet);
+
         ARLOGi("    end.\n");
 
         if (pattHandle)
@@ -164,6 +166,7 @@ AR2SurfaceSetT* ar2ReadSurfaceSet(const char *filename, const char *ext, ARPattH
             if (surfaceSet->surface[i].markerSet == NULL)
             {
                 ARLOGe("Error opening file '%s.mrk'.\n", name);
+                ar2FreeFeatureIndex(&surfaceSet->surface[i].featureIndex);
                 ar2FreeFeatureSet(&surfaceSet->surface[i].featureSet);
                 ar2FreeImageSet(&surfaceSet->surface[i].imageSet);
                 free(surfaceSet->surface);
@@ -249,6 +252,10 @@ AR2SurfaceSetT* ar2ReadSurfaceSet(const char *filename, const char *ext, ARPattH
     if (i < surfaceSet->num)
         exit(0);
 
+    surfaceSet->prevFeatureMax = AR2_SEARCH_FEATURE_MAX;
+    arMalloc(surfaceSet->prevFeature, AR2TemplateCandidateT, surfaceSet->prevFeatureMax + 1);
+    surfaceSet->prevFeature[0].flag = -1;
+
     return surfaceSet;
 }
 
@@ -278,6 +285,11 @@ int ar2FreeSurfaceSet(AR2SurfaceSetT **surfaceSet)
     {
         ar2FreeImageSet(&((*surfaceSet)->surface[i].imageSet));
         ar2FreeFeatureSet(&((*surfaceSet)->surface[i].featureSet));
+        if ((*surfaceSet)->surface[i].featureIndex != NULL)
+        {
+            ar2FreeFeatureIndex(&((*surfaceSet)->surface[i].featureIndex));
+        }
+
         if ((*surfaceSet)->surface[i].markerSet != NULL)
         {
             ar2FreeMarkerSet(&((*surfaceSet)->surface[i].markerSet));
@@ -287,6 +299,38 @@ int ar2FreeSurfaceSet(AR2SurfaceSetT **surfaceSet)
     }
 
     free((*surfaceSet)->surface);
+    free((*surfaceSet)->prevFeature);
+    free(*surfaceSet);
+    *surfaceSet = NULL;
+
+    return 0;
+}
+
+AR2SurfaceSetT* ar2ShareSurfaceSet(AR2SurfaceSetT *surfaceSet)
+{
+    AR2SurfaceSetT *shared;
+
+    if (surfaceSet == NULL)
+        return NULL;
+
+    arMalloc(shared, AR2SurfaceSetT, 1);
+    shared->surface = surfaceSet->surface;
+    shared->num     = surfaceSet->num;
+    shared->contNum = 0;
+
+    shared->prevFeatureMax = AR2_SEARCH_FEATURE_MAX;
+    arMalloc(shared->prevFeature, AR2TemplateCandidateT, shared->prevFeatureMax + 1);
+    shared->prevFeature[0].flag = -1;
+
+    return shared;
+}
+
+int ar2FreeSharedSurfaceSet(AR2SurfaceSetT **surfaceSet)
+{
+    if (*surfaceSet == NULL)
+        return -1;
+
+    free((*surfaceSet)->prevFeature);
     free(*surfaceSet);
     *surfaceSet = NULL;
 
@@ -106,6 +106,136 @@ int ar2FreeTemplate2(AR2Template2T *templ2)
 }
 #endif
 
+/*
+ * Homography taking observed screen coordinates near (ox, oy) to pixel coordinates in the
+ * reference image. Lens distortion is linearised across the template (span pixels either
+ * side of its centre), so a single homography serves every pixel of the template.
+ * Returns -1 if the template reaches outside the distortion lookup table or the pose is
+ * degenerate, in which case the template must be sampled pixel by pixel.
+ */
+static int ar2GetTemplateHomography(const ARParamLT *cparamLT, const float trans[3][4], const AR2ImageT *image,
+                                    const float ox, const float oy, const float span, float H[3][3])
+{
+    float inv[3][3], m[3][3], l[3][3];
+    float det, k;
+    float cx, cy, x1, y1, x2, y2;
+    int   i, j;
+
+    // Inverse of the marker plane to ideal screen homography.
+    inv[0][0] = trans[1][1] * trans[2][3] - trans[1][3] * trans[2][1];
+    inv[0][1] = trans[0][3] * trans[2][1] - trans[0][1] * trans[2][3];
+    inv[0][2] = trans[0][1] * trans[1][3] - trans[0][3] * trans[1][1];
+    inv[1][0] = trans[1][3] * trans[2][0] - trans[1][0] * trans[2][3];
+    inv[1][1] = trans[0][0] * trans[2][3] - trans[0][3] * trans[2][0];
+    inv[1][2] = trans[0][3] * trans[1][0] - trans[0][0] * trans[1][3];
+    inv[2][0] = trans[1][0] * trans[2][1] - trans[1][1] * trans[2][0];
+    inv[2][1] = trans[0][1] * trans[2][0] - trans[0][0] * trans[2][1];
+    inv[2][2] = trans[0][0] * trans[1][1] - trans[0][1] * trans[1][0];
+    det       = trans[0][0] * inv[0][0] + trans[0][1] * inv[1][0] + trans[0][3] * inv[2][0];
+    if (det == 0.0F)
+        return -1;
+
+    // Marker coordinates to reference image coordinates, as in ar2MarkerCoord2ImageCoord().
+    k = image->dpi / 25.4F;
+    for (j = 0; j < 3; j++)
+    {
+        m[0][j] = k * inv[0][j];
+        m[1][j] = image->ysize * inv[2][j] - k * inv[1][j];
+        m[2][j] = inv[2][j];
+    }
+
+    if (cparamLT == NULL)
+    {
+        for (j = 0; j < 3; j++)
+            for (i = 0; i < 3; i++)
+                H[j][i] = m[j][i];
+        return 0;
+    }
+
+    // Observed to ideal screen coordinates, linearised about the template centre.
+    if (arParamObserv2IdealLTf(&cparamLT->paramLTf, ox, oy, &cx, &cy) < 0)
+        return -1;
+    if (arParamObserv2IdealLTf(&cparamLT->paramLTf, ox - span, oy, &x1, &y1) < 0
+        || arParamObserv2IdealLTf(&cparamLT->paramLTf, ox + span, oy, &x2, &y2) < 0)
+        return -1;
+    l[0][0] = (x2 - x1) / (2.0F * span);
+    l[1][0] = (y2 - y1) / (2.0F * span);
+    if (arParamObserv2IdealLTf(&cparamLT->paramLTf, ox, oy - span, &x1, &y1) < 0
+        || arParamObserv2IdealLTf(&cparamLT->paramLTf, ox, oy + span, &x2, &y2) < 0)
+        return -1;
+    l[0][1]   = (x2 - x1) / (2.0F * span);
+    l[1][1]   = (y2 - y1) / (2.0F * span);
+    l[0][2]   = cx - l[0][0] * ox - l[0][1] * oy;
+    l[1][2]   = cy - l[1][0] * ox - l[1][1] * oy;
+    l[2][0]   = l[2][1] = 0.0F;
+    l[2][2]   = 1.0F;
+
+    for (j = 0; j < 3; j++)
+        for (i = 0; i < 3; i++)
+            H[j][i] = m[j][0] * l[0][i] + m[j][1] * l[1][i] + m[j][2] * l[2][i];
+
+    return 0;
+}
+
+/*
+ * Fill the template by stepping the homography H along each row, rather than inverting the
+ * projection for every pixel. Returns the number of valid pixels.
+ */
+static int ar2SetTemplateWarp(const float H[3][3], const ARUint8 *img, const int xsize, const int ysize,
+                              const int ix, const int iy, AR2TemplateT *templ, int *sum, int *sum2)
+{
+    ARUint16 *img1;
+    float    u, v, w, du, dv, dw;
+    float    fx, fy;
+    int      px, py;
+    int      ix2, iy2;
+    int      i, j, k;
+    ARUint8  pixel;
+
+    du = H[0][0] * AR2_TEMP_SCALE;
+    dv = H[1][0] * AR2_TEMP_SCALE;
+    dw = H[2][0] * AR2_TEMP_SCALE;
+
+    img1  = templ->img1;
+    *sum  = *sum2 = 0;
+    k     = 0;
+    iy2   = iy - (templ->yts1) * AR2_TEMP_SCALE;
+    for (j = -(templ->yts1); j <= templ->yts2; j++, iy2 += AR2_TEMP_SCALE)
+    {
+        ix2 = ix - (templ->xts1) * AR2_TEMP_SCALE;
+        u   = H[0][0] * ix2 + H[0][1] * iy2 + H[0][2];
+        v   = H[1][0] * ix2 + H[1][1] * iy2 + H[1][2];
+        w   = H[2][0] * ix2 + H[2][1] * iy2 + H[2][2];
+
+        for (i = -(templ->xts1); i <= templ->xts2; i++, u += du, v += dv, w += dw)
+        {
+            if (w == 0.0F)
+            {
+                *(img1++) = AR2_TEMPLATE_NULL_PIXEL;
+                continue;
+            }
+
+            fx = u / w;
+            fy = v / w;
+            px = (int)(fx + 0.5F);
+            py = (int)(fy + 0.5F);
+            if (px < 0 || px >= xsize || py < 0 || py >= ysize)
+            {
+                *(img1++) = AR2_TEMPLATE_NULL_PIXEL;
+                continue;
+            }
+
+            pixel     = img[py * xsize + px];
+            *(img1++) = pixel;
+            *sum     += pixel;
+            *sum2    += pixel * pixel;
+            k++;
+        }
+    }
+
+    return k;
+}
+
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
 int ar2SetTemplateSub(const ARParamLT *cparamLT, const float trans[3][4], AR2ImageSetT *imageSet,
                       AR2FeaturePointsT *featurePoints, int num, int blurLevel,
@@ -119,15 +249,22 @@ int ar2SetTemplateSub(const ARParamLT * cparamLT, const float trans[3][4], AR2Im
     float    mx, my;
     float    sx, sy;
     float    wtrans[3][4];
+    float    H[3][3];
+    AR2ImageT *image;
     ARUint16 *img1;
     int      sum, sum2;
     int      vlen;
     ARUint8  pixel;
     int      ix, iy;
     int      ix2, iy2;
+    int      span;
     int      ret;
     int      i, j, k;
 
+    image = ar2GetImageSetScale(imageSet, featurePoints->scale);
+    if (image == NULL)
+        return -1;
+
     if (cparamLT != NULL)
     {
 #ifdef ARDOUBLE_IS_FLOAT
@@ -147,6 +284,20 @@ int ar2SetTemplateSub(const ARParamLT * cparamLT, const float trans[3][4], AR2Im
         ix = (int)(sx + 0.5F);
         iy = (int)(sy + 0.5F);
 
+        span = templ->xts1;
+        if (templ->xts2 > span) span = templ->xts2;
+        if (templ->yts1 > span) span = templ->yts1;
+        if (templ->yts2 > span) span = templ->yts2;
+        if (ar2GetTemplateHomography(cparamLT, (const float (*)[4])wtrans, image, (float)ix, (float)iy, (float)(span * AR2_TEMP_SCALE), H) == 0)
+        {
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+            k = ar2SetTemplateWarp((const float (*)[3])H, image->imgBWBlur[blurLevel], image->xsize, image->ysize, ix, iy, templ, &sum, &sum2);
+#else
+            k = ar2SetTemplateWarp((const float (*)[3])H, image->imgBW, image->xsize, image->ysize, ix, iy, templ, &sum, &sum2);
+#endif
+            goto done;
+        }
+
         img1 = templ->img1;
         sum  = sum2 = 0;
         k    = 0;
@@ -164,7 +315,7 @@ int ar2SetTemplateSub(const ARParamLT * cparamLT, const float trans[3][4], AR2Im
                     continue;
                 }
 
-                ret = ar2GetImageValue(NULL, (const float (*)[4])wtrans, imageSet->scale[featurePoints->scale],
+                ret = ar2GetImageValue(NULL, (const float (*)[4])wtrans, image,
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
                                        sx, sy, blurLevel, &pixel);
 #else
@@ -194,6 +345,16 @@ int ar2SetTemplateSub(const ARParamLT * cparamLT, const float trans[3][4], AR2Im
         ix = (int)(sx + 0.5F);
         iy = (int)(sy + 0.5F);
 
+        if (ar2GetTemplateHomography(NULL, trans, image, (float)ix, (float)iy, 0.0F, H) == 0)
+        {
+#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
+            k = ar2SetTemplateWarp((const float (*)[3])H, image->imgBWBlur[blurLevel], image->xsize, image->ysize, ix, iy, templ, &sum, &sum2);
+#else
+            k = ar2SetTemplateWarp((const float (*)[3])H, image->imgBW, image->xsize, image->ysize, ix, iy, templ, &sum, &sum2);
+#endif
+            goto done;
+        }
+
         img1 = templ->img1;
         sum  = sum2 = 0;
         k    = 0;
@@ -205,7 +366,7 @@ int ar2SetTemplateSub(const ARParamLT * cparamLT, const float trans[3][4], AR2Im
 
             for (i = -(templ->xts1); i <= templ->xts2; i++, ix2 += AR2_TEMP_SCALE)
             {
-                ret = ar2GetImageValue(NULL, trans, imageSet->scale[featurePoints->scale],
+                ret = ar2GetImageValue(NULL, trans, image,
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
                                        (float)ix2, (float)iy2, blurLevel, &pixel);
 #else
@@ -226,6 +387,7 @@ int ar2SetTemplateSub(const ARParamLT * cparamLT, const float trans[3][4], AR2Im
         }
     }
 
+done:
     if (k == 0)
         return -1;
 
@@ -250,11 +412,16 @@ int ar2SetTemplate2Sub(const ARParamLT *cparamLT, const float trans[3][4], AR2Im
     int      sum12, sum22, sum32;
     int      vlen1, vlen2, vlen3;
     ARUint8  pixel1, pixel2, pixel3;
+    AR2ImageT *image;
     int      ix, iy;
     int      ix2, iy2;
     int      ret;
     int      i, j, k;
 
+    image = ar2GetImageSetScale(imageSet, featurePoints->scale);
+    if (image == NULL)
+        return -1;
+
     if (cparamLT != NULL)
     {
         arUtilMatMul(cparamLT->param.mat, trans, wtrans);
@@ -292,7 +459,7 @@ int ar2SetTemplate2Sub(const ARParamLT *cparamLT, const float trans[3][4], AR2Im
                     continue;
                 }
 
-                ret = ar2GetImageValue2(NULL, wtrans, imageSet->scale[featurePoints->scale],
+                ret = ar2GetImageValue2(NULL, wtrans, image,
                                         sx, sy, blurLevel, &pixel1, &pixel2, &pixel3);
                 if (ret < 0)
                 {
@@ -340,7 +507,7 @@ int ar2SetTemplate2Sub(const ARParamLT *cparamLT, const float trans[3][4], AR2Im
 
             for (i = -(templ2->xts1); i <= templ2->xts2; i++, ix2 += AR2_TEMP_SCALE)
             {
-                ret = ar2GetImageValue2(NULL, trans, imageSet->scale[featurePoints->scale],
+                ret = ar2GetImageValue2(NULL, trans, image,
                                         ix2, iy2, blurLevel, &pixel1, &pixel2, &pixel3);
                 if (ret < 0)
                 {
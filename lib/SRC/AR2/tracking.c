@@ -55,153 +55,300 @@ static float  ar2GetTransMatHomography(float initConv[3][4], float pos2d[][2], f
                                        float conv[3][4], int robustMode, float inlierProb);
 static float  ar2GetTransMatHomography2(float initConv[3][4], float pos2d[][2], float pos3d[][3], int num, float conv[3][4]);
 static float  ar2GetTransMatHomographyRobust(float initConv[3][4], float pos2d[][2], float pos3d[][3], int num, float conv[3][4], float inlierProb);
-static int    extractVisibleFeatures(const ARParamLT *cparamLT, const float trans1[][3][4], AR2SurfaceSetT *surfaceSet,
+static int    extractVisibleFeatures(const ARParamLT *cparamLT, int xsize, int ysize, const float trans1[][3][4], AR2SurfaceSetT *surfaceSet,
                                      AR2TemplateCandidateT candidate[],
-                                     AR2TemplateCandidateT candidate2[]);
-static int    extractVisibleFeaturesHomography(int xsize, int ysize, float trans1[][3][4], AR2SurfaceSetT *surfaceSet,
-                                               AR2TemplateCandidateT candidate[],
-                                               AR2TemplateCandidateT candidate2[]);
+                                     AR2TemplateCandidateT candidate2[], int candidateMax);
+static int    ar2TrackingSub(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet[], int surfaceSetNum,
+                             ARUint8 *dataPtr, AR_PIXEL_FORMAT pixFormat, float trans[][3][4], float err[], int result[]);
+static int    ar2TrackingGetTransMat(AR2HandleT *ar2Handle, AR2TrackingTargetT *target, AR2SurfaceSetT *surfaceSet, float trans[3][4], float *err);
+static int    allocTrackingTargets(AR2HandleT *ar2Handle, int targetNum);
+static int    allocTrackingBuffers(AR2HandleT *ar2Handle, AR2TrackingTargetT *target, AR2SurfaceSetT *surfaceSet);
+static int    getLumaImage(const ARUint8 *dataPtr, AR_PIXEL_FORMAT pixFormat, int pixelNum, ARUint8 *lumaImage);
+static void   getHalfImage(const ARUint8 *lumaImage, int xsize, int ysize, ARUint8 *halfImage);
+static void   getVisibleCells(const ARParamLT *cparamLT, int xsize, int ysize, const float trans[3][4], const AR2FeatureIndexT *featureIndex,
+                              ARUint8 cellVisible[], float cellDpi[][2]);
+static int    compareCandidateNum(const void *a, const void *b);
 static int    getDeltaS(float H[8], float dU[], float J_U_H[][8], int n);
 
 
 int ar2Tracking(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *dataPtr, float trans[3][4], float  *err)
 {
-    AR2TemplateCandidateT *candidatePtr;
-    AR2TemplateCandidateT *cp[AR2_THREAD_MAX];
-
-#if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-    float aveBlur;
-#endif
-    int num, num2;
-    int i, j, k;
+    int result;
 
     if (!ar2Handle || !surfaceSet || !dataPtr || !trans || !err)
         return (-1);
 
-    if (surfaceSet->contNum <= 0)
-    {
-        ARLOGd("ar2Tracking() error: ar2SetInitTrans() must be called first.\n");
-        return -2;
-    }
+    if (ar2TrackingSub(ar2Handle, &surfaceSet, 1, dataPtr, ar2Handle->pixFormat, (float (*)[3][4])trans, err, &result) < 0)
+        return (-1);
 
-    *err = 0.0F;
+    return result;
+}
 
-    for (i = 0; i < surfaceSet->num; i++)
-    {
-        arUtilMatMulf((const float (*)[4])surfaceSet->trans1, (const float (*)[4])surfaceSet->surface[i].trans, ar2Handle->wtrans1[i]);
-        if (surfaceSet->contNum > 1)
-            arUtilMatMulf((const float (*)[4])surfaceSet->trans2, (const float (*)[4])surfaceSet->surface[i].trans, ar2Handle->wtrans2[i]);
+int ar2TrackingMulti(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet[], int surfaceSetNum,
+                     ARUint8 *dataPtr, float trans[][3][4], float err[], int result[])
+{
+    AR_PIXEL_FORMAT pixFormat;
+    int             i;
 
-        if (surfaceSet->contNum > 2)
-            arUtilMatMulf((const float (*)[4])surfaceSet->trans3, (const float (*)[4])surfaceSet->surface[i].trans, ar2Handle->wtrans3[i]);
-    }
+    if (!ar2Handle || !surfaceSet || surfaceSetNum < 1 || !dataPtr || !trans || !err || !result)
+        return (-1);
 
-    if (ar2Handle->trackingMode == AR2_TRACKING_6DOF)
+    for (i = 0; i < surfaceSetNum; i++)
     {
-        extractVisibleFeatures(ar2Handle->cparamLT, ar2Handle->wtrans1, surfaceSet, ar2Handle->candidate, ar2Handle->candidate2);
+        if (!surfaceSet[i])
+            return (-1);
     }
-    else
+
+    // Convert the frame to luma once, so that each template match reads one byte per pixel.
+    pixFormat = ar2Handle->pixFormat;
+    if (arUtilGetPixelSize(pixFormat) > 1 && pixFormat != AR_PIXEL_FORMAT_420v && pixFormat != AR_PIXEL_FORMAT_420f && pixFormat != AR_PIXEL_FORMAT_NV21)
     {
-        extractVisibleFeaturesHomography(ar2Handle->xsize, ar2Handle->ysize, ar2Handle->wtrans1, surfaceSet, ar2Handle->candidate, ar2Handle->candidate2);
+        if (ar2Handle->lumaImage == NULL)
+        {
+            arMalloc(ar2Handle->lumaImage, ARUint8, ar2Handle->xsize * ar2Handle->ysize);
+        }
+
+        if (getLumaImage(dataPtr, pixFormat, ar2Handle->xsize * ar2Handle->ysize, ar2Handle->lumaImage) == 0)
+        {
+            dataPtr   = ar2Handle->lumaImage;
+            pixFormat = AR_PIXEL_FORMAT_MONO;
+        }
     }
 
-    candidatePtr = ar2Handle->candidate;
+    return ar2TrackingSub(ar2Handle, surfaceSet, surfaceSetNum, dataPtr, pixFormat, trans, err, result);
+}
+
+// Track each of surfaceSetNum surface sets in a frame. Templates are selected for every surface set
+// in rounds of up to threadNum per surface set, as ar2Tracking() always has, but all surface sets'
+// matches in a round are shared out between the tracking threads together.
+static int ar2TrackingSub(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet[], int surfaceSetNum,
+                          ARUint8 *dataPtr, AR_PIXEL_FORMAT pixFormat, float trans[][3][4], float err[], int result[])
+{
+    AR2TrackingTargetT  *target;
+    AR2Tracking2DParamT *job;
+    ARUint8             *halfPtr;
+    int                 jobNum, jobFirst, jobsPerThread;
+    int                 active;
+    int                 num2;
+    int                 t, i, j, k;
+
+    if (allocTrackingTargets(ar2Handle, surfaceSetNum) < 0)
+        return (-1);
+
+    active = 0;
+    for (t = 0; t < surfaceSetNum; t++)
+    {
+        target             = &(ar2Handle->target[t]);
+        target->surfaceSet = surfaceSet[t];
+        target->jobNum     = 0;
+        err[t]             = 0.0F;
+
+        if (surfaceSet[t]->contNum <= 0)
+        {
+            ARLOGd("ar2Tracking() error: ar2SetInitTrans() must be called first.\n");
+            result[t] = -2;
+            continue;
+        }
+
+        if (allocTrackingBuffers(ar2Handle, target, surfaceSet[t]) < 0)
+            return (-1);
+
+        for (i = 0; i < surfaceSet[t]->num; i++)
+        {
+            arUtilMatMulf((const float (*)[4])surfaceSet[t]->trans1, (const float (*)[4])surfaceSet[t]->surface[i].trans, target->wtrans1[i]);
+            if (surfaceSet[t]->contNum > 1)
+                arUtilMatMulf((const float (*)[4])surfaceSet[t]->trans2, (const float (*)[4])surfaceSet[t]->surface[i].trans, target->wtrans2[i]);
+
+            if (surfaceSet[t]->contNum > 2)
+                arUtilMatMulf((const float (*)[4])surfaceSet[t]->trans3, (const float (*)[4])surfaceSet[t]->surface[i].trans, target->wtrans3[i]);
+        }
+
+        if (ar2Handle->trackingMode == AR2_TRACKING_6DOF)
+        {
+            extractVisibleFeatures(ar2Handle->cparamLT, ar2Handle->cparamLT->param.xsize, ar2Handle->cparamLT->param.ysize, (const float (*)[3][4])target->wtrans1,
+                                   surfaceSet[t], target->candidate, target->candidate2, ar2Handle->candidateMax);
+        }
+        else
+        {
+            extractVisibleFeatures(NULL, ar2Handle->xsize, ar2Handle->ysize, (const float (*)[3][4])target->wtrans1,
+                                   surfaceSet[t], target->candidate, target->candidate2, ar2Handle->candidateMax);
+        }
+
+        target->candidatePtr = target->candidate;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-    aveBlur = 0.0F;
+        target->aveBlur = 0.0F;
 #endif
-    i   = 0; // Counts up to searchFeatureNum.
-    num = 0;
+        target->searchNum = 0; // Counts up to searchFeatureNum.
+        target->num       = 0;
+        target->jobNum    = 1; // Still selecting.
+        result[t]         = 0;
+        active++;
+    }
 
-    while (i < ar2Handle->searchFeatureNum)
+    // Downsample the frame once for the pyramid search, if it is a luma image.
+    halfPtr = NULL;
+    if (active > 0 && ar2Handle->searchPyramid
+        && (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_NV21))
     {
-        num2 = num;
+        if (ar2Handle->halfImage == NULL)
+        {
+            arMalloc(ar2Handle->halfImage, ARUint8, (ar2Handle->xsize / 2) * (ar2Handle->ysize / 2));
+        }
 
-        for (j = 0; j < ar2Handle->threadNum; j++)
+        getHalfImage(dataPtr, ar2Handle->xsize, ar2Handle->ysize, ar2Handle->halfImage);
+        halfPtr = ar2Handle->halfImage;
+    }
+
+    while (active > 0)
+    {
+        // Select up to threadNum templates from each surface set still selecting.
+        jobNum = 0;
+        for (t = 0; t < surfaceSetNum; t++)
         {
-            if (i == ar2Handle->searchFeatureNum)
-                break;
+            target = &(ar2Handle->target[t]);
+            if (result[t] != 0 || target->jobNum == 0)
+                continue;
+
+            target->jobFirst = jobNum;
+            num2             = target->num;
 
-            k = ar2SelectTemplate(candidatePtr, surfaceSet->prevFeature, num2, ar2Handle->pos, ar2Handle->xsize, ar2Handle->ysize);
-            if (k < 0)
+            for (j = 0; j < ar2Handle->threadNum; j++)
             {
-                if (candidatePtr == ar2Handle->candidate)
+                if (target->searchNum == ar2Handle->searchFeatureNum)
+                    break;
+
+                k = ar2SelectTemplate(target->candidatePtr, surfaceSet[t]->prevFeature, num2, target->pos, ar2Handle->xsize, ar2Handle->ysize);
+                if (k < 0)
                 {
-                    candidatePtr = ar2Handle->candidate2;
-                    k            = ar2SelectTemplate(candidatePtr, surfaceSet->prevFeature, num2, ar2Handle->pos, ar2Handle->xsize, ar2Handle->ysize);
-                    if (k < 0)
-                        break;         // PRL 2012-05-15: Give up if we can't select template from alternate candidate either.
+                    if (target->candidatePtr == target->candidate)
+                    {
+                        target->candidatePtr = target->candidate2;
+                        k                    = ar2SelectTemplate(target->candidatePtr, surfaceSet[t]->prevFeature, num2, target->pos, ar2Handle->xsize, ar2Handle->ysize);
+                        if (k < 0)
+                            break;     // PRL 2012-05-15: Give up if we can't select template from alternate candidate either.
+                    }
+                    else
+                        break;
                 }
-                else
-                    break;
+
+                target->pos[num2][0] = target->candidatePtr[k].sx;
+                target->pos[num2][1] = target->candidatePtr[k].sy;
+                job                  = &(ar2Handle->job[jobNum++]);
+                job->ar2Handle       = ar2Handle;
+                job->surfaceSet      = surfaceSet[t];
+                job->target          = target;
+                job->candidate       = &(target->candidatePtr[k]);
+                job->dataPtr         = dataPtr;
+                job->pixFormat       = pixFormat;
+                job->halfPtr         = halfPtr;
+
+                num2++;
+                if (num2 == 5)
+                    num2 = target->num;
+
+                target->searchNum++;
             }
 
-            cp[j]                        = &(candidatePtr[k]);
-            ar2Handle->pos[num2][0]      = candidatePtr[k].sx;
-            ar2Handle->pos[num2][1]      = candidatePtr[k].sy;
-            ar2Handle->arg[j].ar2Handle  = ar2Handle;
-            ar2Handle->arg[j].surfaceSet = surfaceSet;
-            ar2Handle->arg[j].candidate  = &(candidatePtr[k]);
-            ar2Handle->arg[j].dataPtr    = dataPtr;
+            target->jobNum = jobNum - target->jobFirst;
+            if (target->jobNum == 0)
+                active--;
+        }
 
-            threadStartSignal(ar2Handle->threadHandle[j]);
-            num2++;
-            if (num2 == 5)
-                num2 = num;
+        if (jobNum == 0)
+            break;
 
-            i++;
+        // Share the jobs out between the threads in contiguous runs.
+        jobsPerThread = (jobNum + ar2Handle->threadNum - 1) / ar2Handle->threadNum;
+        for (j = 0, jobFirst = 0; j < ar2Handle->threadNum && jobFirst < jobNum; j++, jobFirst += jobsPerThread)
+        {
+            ar2Handle->arg[j].job    = &(ar2Handle->job[jobFirst]);
+            ar2Handle->arg[j].jobNum = (jobNum - jobFirst < jobsPerThread) ? jobNum - jobFirst : jobsPerThread;
+            threadStartSignal(ar2Handle->threadHandle[j]);
         }
 
         k = j;
-        if (k == 0)
-            break;
-
         for (j = 0; j < k; j++)
         {
             threadEndWait(ar2Handle->threadHandle[j]);
+        }
+
+        for (t = 0; t < surfaceSetNum; t++)
+        {
+            target = &(ar2Handle->target[t]);
+            if (result[t] != 0 || target->jobNum == 0)
+                continue;
 
-            if (ar2Handle->arg[j].ret == 0 && ar2Handle->arg[j].result.sim > ar2Handle->simThresh)
+            for (j = target->jobFirst; j < target->jobFirst + target->jobNum; j++)
             {
-                if (ar2Handle->trackingMode == AR2_TRACKING_6DOF)
+                job = &(ar2Handle->job[j]);
+                if (job->ret == 0 && job->result.sim > ar2Handle->simThresh)
                 {
+                    if (ar2Handle->trackingMode == AR2_TRACKING_6DOF)
+                    {
 #ifdef ARDOUBLE_IS_FLOAT
-                    arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,
-                                        ar2Handle->arg[j].result.pos2d[0], ar2Handle->arg[j].result.pos2d[1],
-                                        &ar2Handle->pos2d[num][0], &ar2Handle->pos2d[num][1], ar2Handle->cparamLT->param.dist_function_version);
+                        arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,
+                                            job->result.pos2d[0], job->result.pos2d[1],
+                                            &target->pos2d[target->num][0], &target->pos2d[target->num][1], ar2Handle->cparamLT->param.dist_function_version);
 #else
-                    ARdouble pos2d0, pos2d1;
-                    arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,
-                                        (ARdouble)(ar2Handle->arg[j].result.pos2d[0]), (ARdouble)(ar2Handle->arg[j].result.pos2d[1]),
-                                        &pos2d0, &pos2d1, ar2Handle->cparamLT->param.dist_function_version);
-                    ar2Handle->pos2d[num][0] = (float)pos2d0;
-                    ar2Handle->pos2d[num][1] = (float)pos2d1;
+                        ARdouble pos2d0, pos2d1;
+                        arParamObserv2Ideal(ar2Handle->cparamLT->param.dist_factor,
+                                            (ARdouble)(job->result.pos2d[0]), (ARdouble)(job->result.pos2d[1]),
+                                            &pos2d0, &pos2d1, ar2Handle->cparamLT->param.dist_function_version);
+                        target->pos2d[target->num][0] = (float)pos2d0;
+                        target->pos2d[target->num][1] = (float)pos2d1;
 #endif
-                }
-                else
-                {
-                    ar2Handle->pos2d[num][0] = ar2Handle->arg[j].result.pos2d[0];
-                    ar2Handle->pos2d[num][1] = ar2Handle->arg[j].result.pos2d[1];
-                }
+                    }
+                    else
+                    {
+                        target->pos2d[target->num][0] = job->result.pos2d[0];
+                        target->pos2d[target->num][1] = job->result.pos2d[1];
+                    }
 
-                ar2Handle->pos3d[num][0]          = ar2Handle->arg[j].result.pos3d[0];
-                ar2Handle->pos3d[num][1]          = ar2Handle->arg[j].result.pos3d[1];
-                ar2Handle->pos3d[num][2]          = ar2Handle->arg[j].result.pos3d[2];
-                ar2Handle->pos[num][0]            = cp[j]->sx;
-                ar2Handle->pos[num][1]            = cp[j]->sy;
-                ar2Handle->usedFeature[num].snum  = cp[j]->snum;
-                ar2Handle->usedFeature[num].level = cp[j]->level;
-                ar2Handle->usedFeature[num].num   = cp[j]->num;
-                ar2Handle->usedFeature[num].flag  = 0;
+                    target->pos3d[target->num][0]          = job->result.pos3d[0];
+                    target->pos3d[target->num][1]          = job->result.pos3d[1];
+                    target->pos3d[target->num][2]          = job->result.pos3d[2];
+                    target->pos[target->num][0]            = job->candidate->sx;
+                    target->pos[target->num][1]            = job->candidate->sy;
+                    target->usedFeature[target->num].snum  = job->candidate->snum;
+                    target->usedFeature[target->num].level = job->candidate->level;
+                    target->usedFeature[target->num].num   = job->candidate->num;
+                    target->usedFeature[target->num].flag  = 0;
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-                aveBlur += ar2Handle->arg[j].result.blurLevel;
+                    target->aveBlur += job->result.blurLevel;
 #endif
-                num++;
+                    target->num++;
+                }
+            }
+
+            if (target->searchNum == ar2Handle->searchFeatureNum)
+            {
+                target->jobNum = 0;
+                active--;
             }
         }
     }
 
+    for (t = 0; t < surfaceSetNum; t++)
+    {
+        if (result[t] != 0)
+            continue;
+
+        result[t] = ar2TrackingGetTransMat(ar2Handle, &(ar2Handle->target[t]), surfaceSet[t], trans[t], &err[t]);
+    }
+
+    return 0;
+}
+
+// Estimate the pose of a surface set from the features found for it, and update its tracking history.
+static int ar2TrackingGetTransMat(AR2HandleT *ar2Handle, AR2TrackingTargetT *target, AR2SurfaceSetT *surfaceSet, float trans[3][4], float *err)
+{
+    int num;
+    int i, j;
+
+    num = target->num;
     for (i = 0; i < num; i++)
     {
-        surfaceSet->prevFeature[i] = ar2Handle->usedFeature[i];
+        surfaceSet->prevFeature[i] = target->usedFeature[i];
     }
 
     surfaceSet->prevFeature[num].flag = -1;
@@ -215,27 +362,27 @@ int ar2Tracking(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *data
             return -3;
         }
 
-        *err = ar2GetTransMat(ar2Handle->icpHandle, surfaceSet->trans1, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 0);
+        *err = ar2GetTransMat(ar2Handle->icpHandle, surfaceSet->trans1, target->pos2d, target->pos3d, num, trans, 0);
 // ARLOG("outlier  0%%: err = %f, num = %d\n", *err, num);
         if (*err > ar2Handle->trackingThresh)
         {
             icpSetInlierProbability(ar2Handle->icpHandle, 0.8F);
-            *err = ar2GetTransMat(ar2Handle->icpHandle, trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1);
+            *err = ar2GetTransMat(ar2Handle->icpHandle, trans, target->pos2d, target->pos3d, num, trans, 1);
 // ARLOG("outlier 20%%: err = %f, num = %d\n", *err, num);
             if (*err > ar2Handle->trackingThresh)
             {
                 icpSetInlierProbability(ar2Handle->icpHandle, 0.6F);
-                *err = ar2GetTransMat(ar2Handle->icpHandle, trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1);
+                *err = ar2GetTransMat(ar2Handle->icpHandle, trans, target->pos2d, target->pos3d, num, trans, 1);
 // ARLOG("outlier 60%%: err = %f, num = %d\n", *err, num);
                 if (*err > ar2Handle->trackingThresh)
                 {
                     icpSetInlierProbability(ar2Handle->icpHandle, 0.4F);
-                    *err = ar2GetTransMat(ar2Handle->icpHandle, trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1);
+                    *err = ar2GetTransMat(ar2Handle->icpHandle, trans, target->pos2d, target->pos3d, num, trans, 1);
 // ARLOG("outlier 60%%: err = %f, num = %d\n", *err, num);
                     if (*err > ar2Handle->trackingThresh)
                     {
                         icpSetInlierProbability(ar2Handle->icpHandle, 0.0F);
-                        *err = ar2GetTransMat(ar2Handle->icpHandle, trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1);
+                        *err = ar2GetTransMat(ar2Handle->icpHandle, trans, target->pos2d, target->pos3d, num, trans, 1);
 // ARLOG("outlier Max: err = %f, num = %d\n", *err, num);
                         if (*err > ar2Handle->trackingThresh)
                         {
@@ -259,23 +406,23 @@ int ar2Tracking(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *data
             return -3;
         }
 
-        *err = ar2GetTransMatHomography(surfaceSet->trans1, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 0, 1.0F);
+        *err = ar2GetTransMatHomography(surfaceSet->trans1, target->pos2d, target->pos3d, num, trans, 0, 1.0F);
 // ARLOG("outlier  0%%: err = %f, num = %d\n", *err, num);
         if (*err > ar2Handle->trackingThresh)
         {
-            *err = ar2GetTransMatHomography(trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1, 0.8F);
+            *err = ar2GetTransMatHomography(trans, target->pos2d, target->pos3d, num, trans, 1, 0.8F);
 // ARLOG("outlier 20%%: err = %f, num = %d\n", *err, num);
             if (*err > ar2Handle->trackingThresh)
             {
-                *err = ar2GetTransMatHomography(trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1, 0.6F);
+                *err = ar2GetTransMatHomography(trans, target->pos2d, target->pos3d, num, trans, 1, 0.6F);
 // ARLOG("outlier 40%%: err = %f, num = %d\n", *err, num);
                 if (*err > ar2Handle->trackingThresh)
                 {
-                    *err = ar2GetTransMatHomography(trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1, 0.4F);
+                    *err = ar2GetTransMatHomography(trans, target->pos2d, target->pos3d, num, trans, 1, 0.4F);
 // ARLOG("outlier 60%%: err = %f, num = %d\n", *err, num);
                     if (*err > ar2Handle->trackingThresh)
                     {
-                        *err = ar2GetTransMatHomography(trans, ar2Handle->pos2d, ar2Handle->pos3d, num, trans, 1, 0.0F);
+                        *err = ar2GetTransMatHomography(trans, target->pos2d, target->pos3d, num, trans, 1, 0.0F);
 // ARLOG("outlier Max: err = %f, num = %d\n", *err, num);
                         if (*err > ar2Handle->trackingThresh)
                         {
@@ -295,8 +442,8 @@ int ar2Tracking(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *data
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     if (ar2Handle->blurMethod == AR2_ADAPTIVE_BLUR)
     {
-        aveBlur               = aveBlur / num + 0.5F;
-        ar2Handle->blurLevel += (int)aveBlur - 1;
+        target->aveBlur               = target->aveBlur / num + 0.5F;
+        ar2Handle->blurLevel += (int)target->aveBlur - 1;
         if (ar2Handle->blurLevel < 1)
             ar2Handle->blurLevel = 1;
 
@@ -328,19 +475,30 @@ int ar2Tracking(AR2HandleT *ar2Handle, AR2SurfaceSetT *surfaceSet, ARUint8 *data
     return 0;
 }
 
-static int extractVisibleFeatures(const ARParamLT *cparamLT, const float trans1[][3][4], AR2SurfaceSetT *surfaceSet,
+// Features are visited cell by cell through each surface's feature index, skipping cells that
+// project outside the frame or whose resolution is outside the level's dpi range. Each level's
+// candidates are then put back in feature order. The cell tests are approximate: they use the
+// cells' corners without lens distortion, widened by AR2_TRACKING_CULL_SCREEN_MARGIN and
+// AR2_TRACKING_CULL_DPI_MARGIN. With strong distortion, or dpi varying steeply across a cell, a
+// feature near a culled cell's edge that visiting every feature would keep can be missed.
+// If cparamLT is NULL, trans1 holds homographies and the facing test is skipped.
+static int extractVisibleFeatures(const ARParamLT *cparamLT, int xsize, int ysize, const float trans1[][3][4], AR2SurfaceSetT *surfaceSet,
                                   AR2TemplateCandidateT candidate[],  // candidates inside DPI range of [mindpi, maxdpi].
-                                  AR2TemplateCandidateT candidate2[]) // candidates inside DPI range of [mindpi/2, maxdpi*2].
+                                  AR2TemplateCandidateT candidate2[], // candidates inside DPI range of [mindpi/2, maxdpi*2].
+                                  int candidateMax)
 {
-    float trans2[3][4];
-    float sx, sy;
-    float wpos[2], w[2];
-    float vdir[3], vlen;
-    int   xsize, ysize;
-    int   i, j, k, l, l2;
-
-    xsize = cparamLT->param.xsize;
-    ysize = cparamLT->param.ysize;
+    AR2FeatureIndexT  *featureIndex;
+    AR2FeaturePointsT *points;
+    ARUint8           cellVisible[AR2_FEATURE_INDEX_DIV_MAX * AR2_FEATURE_INDEX_DIV_MAX];
+    float             cellDpi[AR2_FEATURE_INDEX_DIV_MAX * AR2_FEATURE_INDEX_DIV_MAX][2];
+    float             trans2[3][4];
+    float             sx, sy;
+    float             wpos[2], w[2];
+    float             vdir[3], vlen;
+    int               cellNum, cellsVisited;
+    int               begin, end;
+    int               i, j, k, l, l2, m, n, c, c2;
+    int               lStart, l2Start;
 
     l = l2 = 0;
 
@@ -350,80 +508,130 @@ static int extractVisibleFeatures(const ARParamLT *cparamLT, const float trans1[
             for (k = 0; k < 4; k++)
                 trans2[j][k] = trans1[i][j][k];
 
+        featureIndex = surfaceSet->surface[i].featureIndex;
+        if (featureIndex)
+        {
+            getVisibleCells(cparamLT, xsize, ysize, (const float (*)[4])trans2, featureIndex, cellVisible, cellDpi);
+            cellNum = featureIndex->xdiv * featureIndex->ydiv;
+        }
+        else
+        {
+            cellNum = 1;
+        }
+
         for (j = 0; j < surfaceSet->surface[i].featureSet->num; j++)
         {
-            for (k = 0; k < surfaceSet->surface[i].featureSet->list[j].num; k++)
+            points       = &surfaceSet->surface[i].featureSet->list[j];
+            lStart       = l;
+            l2Start      = l2;
+            cellsVisited = 0;
+
+            for (c = 0; c < cellNum; c++)
             {
-                if (ar2MarkerCoord2ScreenCoord2(cparamLT, (const float (*)[4])trans2,
-                                                surfaceSet->surface[i].featureSet->list[j].coord[k].mx,
-                                                surfaceSet->surface[i].featureSet->list[j].coord[k].my,
-                                                &sx, &sy) < 0)
-                    continue;
+                if (featureIndex)
+                {
+                    if (!cellVisible[c]
+                        || cellDpi[c][1] < points->mindpi / 2
+                        || cellDpi[c][0] > points->maxdpi * 2)
+                        continue;
 
-                if (sx < 0 || sx >= xsize)
-                    continue;
+                    begin = featureIndex->cellStart[j * (cellNum + 1) + c];
+                    end   = featureIndex->cellStart[j * (cellNum + 1) + c + 1];
+                }
+                else
+                {
+                    begin = 0;
+                    end   = points->num;
+                }
 
-                if (sy < 0 || sy >= ysize)
+                if (begin == end)
                     continue;
 
-                vdir[0] = trans2[0][0] * surfaceSet->surface[i].featureSet->list[j].coord[k].mx
-                          + trans2[0][1] * surfaceSet->surface[i].featureSet->list[j].coord[k].my
-                          + trans2[0][3];
-                vdir[1] = trans2[1][0] * surfaceSet->surface[i].featureSet->list[j].coord[k].mx
-                          + trans2[1][1] * surfaceSet->surface[i].featureSet->list[j].coord[k].my
-                          + trans2[1][3];
-                vdir[2] = trans2[2][0] * surfaceSet->surface[i].featureSet->list[j].coord[k].mx
-                          + trans2[2][1] * surfaceSet->surface[i].featureSet->list[j].coord[k].my
-                          + trans2[2][3];
-                vlen     = sqrtf(vdir[0] * vdir[0] + vdir[1] * vdir[1] + vdir[2] * vdir[2]);
-                vdir[0] /= vlen;
-                vdir[1] /= vlen;
-                vdir[2] /= vlen;
-                if (vdir[0] * trans2[0][2] + vdir[1] * trans2[1][2] + vdir[2] * trans2[2][2] > -0.1f)
-                    continue;
+                cellsVisited++;
 
-                wpos[0] = surfaceSet->surface[i].featureSet->list[j].coord[k].mx;
-                wpos[1] = surfaceSet->surface[i].featureSet->list[j].coord[k].my;
-                ar2GetResolution(cparamLT, (const float (*)[4])trans2, wpos, w);
-                // if( w[0] <= surfaceSet->surface[i].featureSet->list[j].maxdpi
-                // && w[0] >= surfaceSet->surface[i].featureSet->list[j].mindpi ) {
-                if (w[1] <= surfaceSet->surface[i].featureSet->list[j].maxdpi
-                    && w[1] >= surfaceSet->surface[i].featureSet->list[j].mindpi)
+                for (m = begin; m < end; m++)
                 {
-                    if (l == AR2_TRACKING_CANDIDATE_MAX)
+                    k = (featureIndex) ? featureIndex->coordIndex[m] : m;
+
+                    if (ar2MarkerCoord2ScreenCoord2(cparamLT, (const float (*)[4])trans2,
+                                                    points->coord[k].mx, points->coord[k].my,
+                                                    &sx, &sy) < 0)
+                        continue;
+
+                    if (sx < 0 || sx >= xsize)
+                        continue;
+
+                    if (sy < 0 || sy >= ysize)
+                        continue;
+
+                    if (cparamLT != NULL)
                     {
-                        ARLOGe("### Feature candidates for tracking are overflow.\n");
-                        candidate[l].flag = -1;
-                        return -1;
+                        vdir[0]  = trans2[0][0] * points->coord[k].mx + trans2[0][1] * points->coord[k].my + trans2[0][3];
+                        vdir[1]  = trans2[1][0] * points->coord[k].mx + trans2[1][1] * points->coord[k].my + trans2[1][3];
+                        vdir[2]  = trans2[2][0] * points->coord[k].mx + trans2[2][1] * points->coord[k].my + trans2[2][3];
+                        vlen     = sqrtf(vdir[0] * vdir[0] + vdir[1] * vdir[1] + vdir[2] * vdir[2]);
+                        vdir[0] /= vlen;
+                        vdir[1] /= vlen;
+                        vdir[2] /= vlen;
+                        if (vdir[0] * trans2[0][2] + vdir[1] * trans2[1][2] + vdir[2] * trans2[2][2] > -0.1f)
+                            continue;
                     }
 
-                    candidate[l].snum  = i;
-                    candidate[l].level = j;
-                    candidate[l].num   = k;
-                    candidate[l].sx    = sx;
-                    candidate[l].sy    = sy;
-                    candidate[l].flag  = 0;
-                    l++;
-                }
-                else if (w[1] <= surfaceSet->surface[i].featureSet->list[j].maxdpi * 2
-                         && w[1] >= surfaceSet->surface[i].featureSet->list[j].mindpi / 2)
-                {
-                    if (l2 == AR2_TRACKING_CANDIDATE_MAX)
+                    wpos[0] = points->coord[k].mx;
+                    wpos[1] = points->coord[k].my;
+                    ar2GetResolution(cparamLT, (const float (*)[4])trans2, wpos, w);
+                    // if( w[0] <= points->maxdpi && w[0] >= points->mindpi ) {
+                    if (w[1] <= points->maxdpi && w[1] >= points->mindpi)
                     {
-                        candidate2[l2].flag = -1;
+                        if (l == candidateMax)
+                        {
+                            ARLOGe("### Feature candidates for tracking are overflow.\n");
+                            candidate[l].flag = -1;
+                            return -1;
+                        }
+
+                        candidate[l].snum  = i;
+                        candidate[l].level = j;
+                        candidate[l].num   = k;
+                        candidate[l].sx    = sx;
+                        candidate[l].sy    = sy;
+                        candidate[l].flag  = 0;
+                        l++;
                     }
-                    else
+                    else if (w[1] <= points->maxdpi * 2 && w[1] >= points->mindpi / 2)
                     {
-                        candidate2[l2].snum  = i;
-                        candidate2[l2].level = j;
-                        candidate2[l2].num   = k;
-                        candidate2[l2].sx    = sx;
-                        candidate2[l2].sy    = sy;
-                        candidate2[l2].flag  = 0;
-                        l2++;
+                        if (l2 == candidateMax)
+                        {
+                            // Keep the lowest numbered features of this level, as a full scan would.
+                            for (c2 = n = l2Start; n < l2; n++)
+                                if (candidate2[n].num > candidate2[c2].num) c2 = n;
+                            if (l2Start < l2 && candidate2[c2].num > k)
+                            {
+                                candidate2[c2].num = k;
+                                candidate2[c2].sx  = sx;
+                                candidate2[c2].sy  = sy;
+                            }
+                            candidate2[l2].flag = -1;
+                        }
+                        else
+                        {
+                            candidate2[l2].snum  = i;
+                            candidate2[l2].level = j;
+                            candidate2[l2].num   = k;
+                            candidate2[l2].sx    = sx;
+                            candidate2[l2].sy    = sy;
+                            candidate2[l2].flag  = 0;
+                            l2++;
+                        }
                     }
                 }
             }
+
+            if (cellsVisited > 1)
+            {
+                qsort(&candidate[lStart], l - lStart, sizeof(AR2TemplateCandidateT), compareCandidateNum);
+                qsort(&candidate2[l2Start], l2 - l2Start, sizeof(AR2TemplateCandidateT), compareCandidateNum);
+            }
         }
     }
 
@@ -433,108 +641,261 @@ static int extractVisibleFeatures(const ARParamLT *cparamLT, const float trans1[
     return 0;
 }
 
-static int extractVisibleFeaturesHomography(int xsize, int ysize, float trans1[][3][4], AR2SurfaceSetT *surfaceSet,
-                                            AR2TemplateCandidateT candidate[],
-                                            AR2TemplateCandidateT candidate2[])
+// Make sure the handle has state for at least targetNum surface sets, and room for a round of jobs for all of them.
+static int allocTrackingTargets(AR2HandleT *ar2Handle, int targetNum)
 {
-    float trans2[3][4];
-    float sx, sy;
-    float wpos[2], w[2];
-    // float       vdir[3], vlen;
-    int i, j, k, l, l2;
+    AR2TrackingTargetT  *target;
+    AR2Tracking2DParamT *job;
+    int                 i;
 
-    l = l2 = 0;
+    if (targetNum <= ar2Handle->targetMax)
+        return 0;
 
-    for (i = 0; i < surfaceSet->num; i++)
+    target = (AR2TrackingTargetT*)realloc(ar2Handle->target, sizeof(AR2TrackingTargetT) * targetNum);
+    if (target == NULL)
     {
-        for (j = 0; j < 3; j++)
-            for (k = 0; k < 4; k++)
-                trans2[j][k] = trans1[i][j][k];
+        ARLOGe("Out of memory!!\n");
+        return -1;
+    }
+    ar2Handle->target = target;
 
-        for (j = 0; j < surfaceSet->surface[i].featureSet->num; j++)
+    job = (AR2Tracking2DParamT*)realloc(ar2Handle->job, sizeof(AR2Tracking2DParamT) * ar2Handle->threadNum * targetNum);
+    if (job == NULL)
+    {
+        ARLOGe("Out of memory!!\n");
+        return -1;
+    }
+    ar2Handle->job = job;
+
+    for (i = ar2Handle->targetMax; i < targetNum; i++)
+    {
+        target             = &(ar2Handle->target[i]);
+        target->surfaceSet = NULL;
+        target->surfaceMax = 0;
+        target->wtrans1    = target->wtrans2 = target->wtrans3 = NULL;
+        target->pos        = (float (*)[2])malloc(sizeof(float[2]) * (ar2Handle->searchFeatureMax + ar2Handle->threadNum));
+        target->pos2d      = (float (*)[2])malloc(sizeof(float[2]) * ar2Handle->searchFeatureMax);
+        target->pos3d      = (float (*)[3])malloc(sizeof(float[3]) * ar2Handle->searchFeatureMax);
+        arMalloc(target->candidate, AR2TemplateCandidateT, ar2Handle->candidateMax + 1);
+        arMalloc(target->candidate2, AR2TemplateCandidateT, ar2Handle->candidateMax + 1);
+        arMalloc(target->usedFeature, AR2TemplateCandidateT, ar2Handle->searchFeatureMax);
+        ar2Handle->targetMax = i + 1; // So that ar2DeleteHandle() frees it.
+        if (!target->pos || !target->pos2d || !target->pos3d)
         {
-            for (k = 0; k < surfaceSet->surface[i].featureSet->list[j].num; k++)
-            {
-                if (ar2MarkerCoord2ScreenCoord2(NULL, (const float (*)[4])trans2,
-                                                surfaceSet->surface[i].featureSet->list[j].coord[k].mx,
-                                                surfaceSet->surface[i].featureSet->list[j].coord[k].my,
-                                                &sx, &sy) < 0)
-                    continue;
+            ARLOGe("Out of memory!!\n");
+            return -1;
+        }
+    }
 
-                if (sx < 0 || sx >= xsize)
-                    continue;
+    return 0;
+}
 
-                if (sy < 0 || sy >= ysize)
-                    continue;
+// Make sure the per-surface buffers of a target can hold every surface of the surface set,
+// and the surface set can record as many features as the handle may search for.
+static int allocTrackingBuffers(AR2HandleT *ar2Handle, AR2TrackingTargetT *target, AR2SurfaceSetT *surfaceSet)
+{
+    AR2TemplateCandidateT *prevFeature;
 
-/*
-                vdir[0] = trans2[0][0] * surfaceSet->surface[i].featureSet->list[j].coord[k].mx
- + trans2[0][1] * surfaceSet->surface[i].featureSet->list[j].coord[k].my
- + trans2[0][3];
-                vdir[1] = trans2[1][0] * surfaceSet->surface[i].featureSet->list[j].coord[k].mx
- + trans2[1][1] * surfaceSet->surface[i].featureSet->list[j].coord[k].my
- + trans2[1][3];
-                vdir[2] = trans2[2][0] * surfaceSet->surface[i].featureSet->list[j].coord[k].mx
- + trans2[2][1] * surfaceSet->surface[i].featureSet->list[j].coord[k].my
- + trans2[2][3];
-                vlen = sqrtf( vdir[0]*vdir[0] + vdir[1]*vdir[1] + vdir[2]*vdir[2] );
-                vdir[0] /= vlen;
-                vdir[1] /= vlen;
-                vdir[2] /= vlen;
-                if( vdir[0]*trans2[0][2] + vdir[1]*trans2[1][2] + vdir[2]*trans2[2][2] > -0.1 ) continue;
- */
+    // Contents are recalculated on every call, so need not be kept.
+    if (surfaceSet->num > target->surfaceMax)
+    {
+        free(target->wtrans1);
+        free(target->wtrans2);
+        free(target->wtrans3);
+        target->wtrans1 = (float (*)[3][4])malloc(sizeof(float[3][4]) * surfaceSet->num);
+        target->wtrans2 = (float (*)[3][4])malloc(sizeof(float[3][4]) * surfaceSet->num);
+        target->wtrans3 = (float (*)[3][4])malloc(sizeof(float[3][4]) * surfaceSet->num);
+        if (!target->wtrans1 || !target->wtrans2 || !target->wtrans3)
+        {
+            ARLOGe("Out of memory!!\n");
+            free(target->wtrans1);
+            free(target->wtrans2);
+            free(target->wtrans3);
+            target->wtrans1    = target->wtrans2 = target->wtrans3 = NULL;
+            target->surfaceMax = 0;
+            return -1;
+        }
 
-                wpos[0] = surfaceSet->surface[i].featureSet->list[j].coord[k].mx;
-                wpos[1] = surfaceSet->surface[i].featureSet->list[j].coord[k].my;
-                ar2GetResolution(NULL, (const float (*)[4])trans2, wpos, w);
-                // if( w[0] <= surfaceSet->surface[i].featureSet->list[j].maxdpi
-                // && w[0] >= surfaceSet->surface[i].featureSet->list[j].mindpi ) {
-                if (w[1] <= surfaceSet->surface[i].featureSet->list[j].maxdpi
-                    && w[1] >= surfaceSet->surface[i].featureSet->list[j].mindpi)
-                {
-                    if (l == AR2_TRACKING_CANDIDATE_MAX)
-                    {
-                        ARLOGe("### Feature candidates for tracking are overflow.\n");
-                        candidate[l].flag = -1;
-                        return -1;
-                    }
+        target->surfaceMax = surfaceSet->num;
+    }
 
-                    candidate[l].snum  = i;
-                    candidate[l].level = j;
-                    candidate[l].num   = k;
-                    candidate[l].sx    = sx;
-                    candidate[l].sy    = sy;
-                    candidate[l].flag  = 0;
-                    l++;
-                }
-                else if (w[1] <= surfaceSet->surface[i].featureSet->list[j].maxdpi * 2
-                         && w[1] >= surfaceSet->surface[i].featureSet->list[j].mindpi / 2)
-                {
-                    if (l2 == AR2_TRACKING_CANDIDATE_MAX)
-                    {
-                        candidate2[l2].flag = -1;
-                    }
-                    else
-                    {
-                        candidate2[l2].snum  = i;
-                        candidate2[l2].level = j;
-                        candidate2[l2].num   = k;
-                        candidate2[l2].sx    = sx;
-                        candidate2[l2].sy    = sy;
-                        candidate2[l2].flag  = 0;
-                        l2++;
-                    }
-                }
-            }
+    if (ar2Handle->searchFeatureMax > surfaceSet->prevFeatureMax)
+    {
+        prevFeature = (AR2TemplateCandidateT*)realloc(surfaceSet->prevFeature, sizeof(AR2TemplateCandidateT) * (ar2Handle->searchFeatureMax + 1));
+        if (prevFeature == NULL)
+        {
+            ARLOGe("Out of memory!!\n");
+            return -1;
         }
+
+        surfaceSet->prevFeature    = prevFeature;
+        surfaceSet->prevFeatureMax = ar2Handle->searchFeatureMax;
     }
 
-    candidate[l].flag   = -1;
-    candidate2[l2].flag = -1;
+    return 0;
+}
+
+// Convert a frame to the luma values ar2GetBestMatching() would read from it.
+// Returns -1 if the pixel format is not one ar2GetBestMatching() handles.
+static int getLumaImage(const ARUint8 *dataPtr, AR_PIXEL_FORMAT pixFormat, int pixelNum, ARUint8 *lumaImage)
+{
+    const ARUint8 *p;
+    int           i;
+
+    p = dataPtr;
+    if (pixFormat == AR_PIXEL_FORMAT_RGB || pixFormat == AR_PIXEL_FORMAT_BGR)
+    {
+        for (i = 0; i < pixelNum; i++, p += 3)
+            lumaImage[i] = (ARUint8)((p[0] + p[1] + p[2]) / 3);
+    }
+    else if (pixFormat == AR_PIXEL_FORMAT_RGBA || pixFormat == AR_PIXEL_FORMAT_BGRA)
+    {
+        for (i = 0; i < pixelNum; i++, p += 4)
+            lumaImage[i] = (ARUint8)((p[0] + p[1] + p[2]) / 3);
+    }
+    else if (pixFormat == AR_PIXEL_FORMAT_ARGB || pixFormat == AR_PIXEL_FORMAT_ABGR)
+    {
+        for (i = 0; i < pixelNum; i++, p += 4)
+            lumaImage[i] = (ARUint8)((p[1] + p[2] + p[3]) / 3);
+    }
+    else if (pixFormat == AR_PIXEL_FORMAT_2vuy)
+    {
+        for (i = 0; i < pixelNum; i++, p += 2)
+            lumaImage[i] = p[1];
+    }
+    else if (pixFormat == AR_PIXEL_FORMAT_yuvs)
+    {
+        for (i = 0; i < pixelNum; i++, p += 2)
+            lumaImage[i] = p[0];
+    }
+    else
+        return -1;
 
     return 0;
 }
 
+// Downsample a luma image by 2 in each dimension, each pixel of halfImage being the mean
+// of a 2x2 block of lumaImage. A trailing odd row or column is dropped.
+static void getHalfImage(const ARUint8 *lumaImage, int xsize, int ysize, ARUint8 *halfImage)
+{
+    const ARUint8 *p1, *p2;
+    int           hxsize, hysize;
+    int           i, j;
+
+    hxsize = xsize / 2;
+    hysize = ysize / 2;
+    for (j = 0; j < hysize; j++)
+    {
+        p1 = &lumaImage[(j * 2) * xsize];
+        p2 = p1 + xsize;
+        for (i = 0; i < hxsize; i++, p1 += 2, p2 += 2)
+        {
+            *(halfImage++) = (ARUint8)((p1[0] + p1[1] + p2[0] + p2[1] + 2) >> 2);
+        }
+    }
+}
+
+// Flag the cells of a feature index which may hold visible features, and get the range of
+// resolutions over each cell from the resolution at its corners. Cells with a corner behind
+// the camera are always visited.
+static void getVisibleCells(const ARParamLT *cparamLT, int xsize, int ysize, const float trans[3][4], const AR2FeatureIndexT *featureIndex,
+                            ARUint8 cellVisible[], float cellDpi[][2])
+{
+    float   wtrans[3][4];
+    float   vx[(AR2_FEATURE_INDEX_DIV_MAX + 1) * (AR2_FEATURE_INDEX_DIV_MAX + 1)];
+    float   vy[(AR2_FEATURE_INDEX_DIV_MAX + 1) * (AR2_FEATURE_INDEX_DIV_MAX + 1)];
+    float   vdpi[(AR2_FEATURE_INDEX_DIV_MAX + 1) * (AR2_FEATURE_INDEX_DIV_MAX + 1)];
+    ARUint8 vok[(AR2_FEATURE_INDEX_DIV_MAX + 1) * (AR2_FEATURE_INDEX_DIV_MAX + 1)];
+    float   pos[2], w[2];
+    float   h, xmargin, ymargin;
+    float   dmin, dmax;
+    int     corner[4];
+    int     left, right, top, bottom;
+    int     vxdiv;
+    int     i, j, k, v;
+
+    if (cparamLT != NULL)
+    {
+#ifdef ARDOUBLE_IS_FLOAT
+        arUtilMatMul(cparamLT->param.mat, trans, wtrans);
+#else
+        arUtilMatMuldff(cparamLT->param.mat, trans, wtrans);
+#endif
+    }
+    else
+    {
+        for (j = 0; j < 3; j++)
+            for (i = 0; i < 4; i++)
+                wtrans[j][i] = trans[j][i];
+    }
+
+    vxdiv = featureIndex->xdiv + 1;
+    for (j = 0; j <= featureIndex->ydiv; j++)
+    {
+        for (i = 0; i <= featureIndex->xdiv; i++)
+        {
+            v      = j * vxdiv + i;
+            pos[0] = featureIndex->mx + i * featureIndex->cellSize;
+            pos[1] = featureIndex->my + j * featureIndex->cellSize;
+            h      = wtrans[2][0] * pos[0] + wtrans[2][1] * pos[1] + wtrans[2][3];
+            if (h <= 0.0F)
+            {
+                vok[v] = 0;
+                continue;
+            }
+
+            vx[v] = (wtrans[0][0] * pos[0] + wtrans[0][1] * pos[1] + wtrans[0][3]) / h;
+            vy[v] = (wtrans[1][0] * pos[0] + wtrans[1][1] * pos[1] + wtrans[1][3]) / h;
+            ar2GetResolution(cparamLT, trans, pos, w);
+            vdpi[v] = w[1];
+            vok[v]  = 1;
+        }
+    }
+
+    xmargin = xsize * AR2_TRACKING_CULL_SCREEN_MARGIN;
+    ymargin = ysize * AR2_TRACKING_CULL_SCREEN_MARGIN;
+    for (j = 0; j < featureIndex->ydiv; j++)
+    {
+        for (i = 0; i < featureIndex->xdiv; i++)
+        {
+            corner[0] = j * vxdiv + i;
+            corner[1] = corner[0] + 1;
+            corner[2] = corner[0] + vxdiv;
+            corner[3] = corner[2] + 1;
+
+            v = j * featureIndex->xdiv + i;
+            if (!vok[corner[0]] || !vok[corner[1]] || !vok[corner[2]] || !vok[corner[3]])
+            {
+                cellVisible[v] = 1;
+                cellDpi[v][0]  = 0.0F;
+                cellDpi[v][1]  = 1e20F;
+                continue;
+            }
+
+            left = right = top = bottom = 0;
+            dmin = dmax = vdpi[corner[0]];
+            for (k = 0; k < 4; k++)
+            {
+                if (vx[corner[k]] < -xmargin) left++;
+                if (vx[corner[k]] > xsize + xmargin) right++;
+                if (vy[corner[k]] < -ymargin) top++;
+                if (vy[corner[k]] > ysize + ymargin) bottom++;
+                if (vdpi[corner[k]] < dmin) dmin = vdpi[corner[k]];
+                if (vdpi[corner[k]] > dmax) dmax = vdpi[corner[k]];
+            }
+
+            cellVisible[v] = !(left == 4 || right == 4 || top == 4 || bottom == 4);
+            cellDpi[v][0]  = dmin / AR2_TRACKING_CULL_DPI_MARGIN;
+            cellDpi[v][1]  = dmax * AR2_TRACKING_CULL_DPI_MARGIN;
+        }
+    }
+}
+
+static int compareCandidateNum(const void *a, const void *b)
+{
+    return ((const AR2TemplateCandidateT*)a)->num - ((const AR2TemplateCandidateT*)b)->num;
+}
+
 static float  ar2GetTransMat(ICPHandleT *icpHandle, float initConv[3][4], float pos2d[][2], float pos3d[][3], int num,
                              float conv[3][4], int robustMode)
 {
@@ -46,19 +46,21 @@
 #include <AR2/tracking.h>
 
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-static int ar2Tracking2dSub(AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TemplateCandidateT *candidate,
-                            ARUint8 *dataPtr, ARUint8 *mfImage, AR2TemplateT **templ,
+static int ar2Tracking2dSub(AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TrackingTargetT *target, AR2TemplateCandidateT *candidate,
+                            ARUint8 *dataPtr, AR_PIXEL_FORMAT pixFormat, ARUint8 *halfPtr, ARUint8 *mfImage, AR2TemplateT **templ, AR2TemplateT **templHalf,
                             AR2Template2T **templ2, AR2Tracking2DResultT *result);
 #else
-static int ar2Tracking2dSub(AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TemplateCandidateT *candidate,
-                            ARUint8 *dataPtr, ARUint8 *mfImage, AR2TemplateT **templ,
+static int ar2Tracking2dSub(AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TrackingTargetT *target, AR2TemplateCandidateT *candidate,
+                            ARUint8 *dataPtr, AR_PIXEL_FORMAT pixFormat, ARUint8 *halfPtr, ARUint8 *mfImage, AR2TemplateT **templ, AR2TemplateT **templHalf,
                             AR2Tracking2DResultT *result);
 #endif
 
 void* ar2Tracking2d(THREAD_HANDLE_T *threadHandle)
 {
     AR2Tracking2DParamT *arg;
+    AR2Tracking2DParamT *job;
     int                 ID;
+    int                 i;
 
     arg = (AR2Tracking2DParamT*)threadGetArg(threadHandle);
     ID  = threadGetID(threadHandle);
@@ -70,13 +72,18 @@ void* ar2Tracking2d(THREAD_HANDLE_T *threadHandle)
         if (threadStartWait(threadHandle) < 0)
             break;
 
+        for (i = 0; i < arg->jobNum; i++)
+        {
+            job = &(arg->job[i]);
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-        arg->ret = ar2Tracking2dSub(arg->ar2Handle, arg->surfaceSet, arg->candidate,
-                                    arg->dataPtr, arg->mfImage, &(arg->templ), &(arg->templ2), &(arg->result));
+            job->ret = ar2Tracking2dSub(job->ar2Handle, job->surfaceSet, job->target, job->candidate,
+                                        job->dataPtr, job->pixFormat, job->halfPtr, arg->mfImage, &(arg->templ), &(arg->templHalf), &(arg->templ2), &(job->result));
 #else
-        arg->ret = ar2Tracking2dSub(arg->ar2Handle, arg->surfaceSet, arg->candidate,
-                                    arg->dataPtr, arg->mfImage, &(arg->templ), &(arg->result));
+            job->ret = ar2Tracking2dSub(job->ar2Handle, job->surfaceSet, job->target, job->candidate,
+                                        job->dataPtr, job->pixFormat, job->halfPtr, arg->mfImage, &(arg->templ), &(arg->templHalf), &(job->result));
 #endif
+        }
+
         threadEndSignal(threadHandle);
     }
 
@@ -87,12 +94,12 @@ void* ar2Tracking2d(THREAD_HANDLE_T *threadHandle)
 
 
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-static int ar2Tracking2dSub(AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TemplateCandidateT *candidate,
-                            ARUint8 *dataPtr, ARUint8 *mfImage, AR2TemplateT **templ,
+static int ar2Tracking2dSub(AR2HandleT *handle, AR2SurfaceSetT *surfaceSet, AR2TrackingTargetT *target, AR2TemplateCandidateT *candidate,
+                            ARUint8 *dataPtr, AR_PIXEL_FORMAT pixFormat, ARUint8 *halfPtr, ARUint8 *mfImage, AR2TemplateT **templ, AR2TemplateT **templHalf,
                             AR2Template2T **templ2, AR2Tracking2DResultT *result)
 #else
-static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR2TemplateCandidateT * candidate,
-                            ARUint8 * dataPtr, ARUint8 * mfImage, AR2TemplateT ** templ,
+static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR2TrackingTargetT * target, AR2TemplateCandidateT * candidate,
+                            ARUint8 * dataPtr, AR_PIXEL_FORMAT pixFormat, ARUint8 * halfPtr, ARUint8 * mfImage, AR2TemplateT ** templ, AR2TemplateT ** templHalf,
                             AR2Tracking2DResultT * result)
 #endif
 {
@@ -101,6 +108,7 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
 #endif
     int snum, level, fnum;
     int search[3][2];
+    int rx, ry;
     int bx, by;
 
     snum  = candidate->snum;
@@ -110,6 +118,9 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
     if (*templ == NULL)
         *templ = ar2GenTemplate(handle->templateSize1, handle->templateSize2);
 
+    if (halfPtr != NULL && *templHalf == NULL)
+        *templHalf = ar2GenTemplate(handle->templateSize1, handle->templateSize2);
+
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     if (*templ2 == NULL)
         *templ2 = ar2GenTemplate2(handle->templateSize1, handle->templateSize2);
@@ -119,7 +130,7 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
     if (handle->blurMethod == AR2_CONSTANT_BLUR)
     {
         if (ar2SetTemplateSub(handle->cparamLT,
-                              (const float (*)[4])handle->wtrans1[snum],
+                              (const float (*)[4])target->wtrans1[snum],
                               surfaceSet->surface[snum].imageSet,
                               &(surfaceSet->surface[snum].featureSet->list[level]),
                               fnum,
@@ -137,7 +148,7 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
     else
     {
         if (ar2SetTemplate2Sub(handle->cparamLT,
-                               (const float (*)[4])handle->wtrans1[snum],
+                               (const float (*)[4])target->wtrans1[snum],
                                surfaceSet->surface[snum].imageSet,
                                &(surfaceSet->surface[snum].featureSet->list[level]),
                                fnum,
@@ -155,7 +166,7 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
 
 #else
     if (ar2SetTemplateSub(handle->cparamLT,
-                          (const float (*)[4])handle->wtrans1[snum],
+                          (const float (*)[4])target->wtrans1[snum],
                           surfaceSet->surface[snum].imageSet,
                           &(surfaceSet->surface[snum].featureSet->list[level]),
                           fnum,
@@ -170,46 +181,68 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
     }
 #endif
 
-    // Get the screen coordinates for up to three previous positions of this feature into search[][].
+    // Get the screen coordinates and radii of the windows in which to search for this feature,
+    // from up to three previous poses, into search[][], rx and ry.
     if (surfaceSet->contNum == 1)
     {
-        ar2GetSearchPoint(handle->cparamLT,
-                          (const float (*)[4])handle->wtrans1[snum], NULL, NULL,
-                          &(surfaceSet->surface[snum].featureSet->list[level].coord[fnum]),
-                          search);
+        ar2GetSearchWindow(handle->cparamLT,
+                           (const float (*)[4])target->wtrans1[snum], NULL, NULL,
+                           &(surfaceSet->surface[snum].featureSet->list[level].coord[fnum]),
+                           handle->searchSize, handle->searchMinSize,
+                           search, &rx, &ry);
     }
     else if (surfaceSet->contNum == 2)
     {
-        ar2GetSearchPoint(handle->cparamLT,
-                          (const float (*)[4])handle->wtrans1[snum],
-                          (const float (*)[4])handle->wtrans2[snum], NULL,
-                          &(surfaceSet->surface[snum].featureSet->list[level].coord[fnum]),
-                          search);
+        ar2GetSearchWindow(handle->cparamLT,
+                           (const float (*)[4])target->wtrans1[snum],
+                           (const float (*)[4])target->wtrans2[snum], NULL,
+                           &(surfaceSet->surface[snum].featureSet->list[level].coord[fnum]),
+                           handle->searchSize, handle->searchMinSize,
+                           search, &rx, &ry);
     }
     else
     {
-        ar2GetSearchPoint(handle->cparamLT,
-                          (const float (*)[4])handle->wtrans1[snum],
-                          (const float (*)[4])handle->wtrans2[snum],
-                          (const float (*)[4])handle->wtrans3[snum],
-                          &(surfaceSet->surface[snum].featureSet->list[level].coord[fnum]),
-                          search);
+        ar2GetSearchWindow(handle->cparamLT,
+                           (const float (*)[4])target->wtrans1[snum],
+                           (const float (*)[4])target->wtrans2[snum],
+                           (const float (*)[4])target->wtrans3[snum],
+                           &(surfaceSet->surface[snum].featureSet->list[level].coord[fnum]),
+                           handle->searchSize, handle->searchMinSize,
+                           search, &rx, &ry);
     }
 
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     if (handle->blurMethod == AR2_CONSTANT_BLUR)
     {
-        if (ar2GetBestMatching(dataPtr,
-                               mfImage,
-                               handle->xsize,
-                               handle->ysize,
-                               handle->pixFormat,
-                               *templ,
-                               handle->searchSize,
-                               handle->searchSize,
-                               search,
-                               &bx, &by,
-                               &(result->sim)) < 0)
+        if (halfPtr != NULL)
+        {
+            if (ar2GetBestMatchingPyramid(dataPtr,
+                                          halfPtr,
+                                          mfImage,
+                                          handle->xsize,
+                                          handle->ysize,
+                                          *templ,
+                                          *templHalf,
+                                          rx,
+                                          ry,
+                                          search,
+                                          &bx, &by,
+                                          &(result->sim)) < 0)
+            {
+                return -1;
+            }
+        }
+        else if (ar2GetBestMatching(dataPtr,
+                                    mfImage,
+                                    handle->xsize,
+                                    handle->ysize,
+                                    pixFormat,
+                                    *templ,
+                                    rx,
+                                    ry,
+                                    search,
+                                    &bx, &by,
+                                    &(result->sim)) < 0)
         {
             return -1;
         }
@@ -222,10 +255,10 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
                                 mfImage,
                                 handle->xsize,
                                 handle->ysize,
-                                handle->pixFormat,
+                                pixFormat,
                                 *templ2,
-                                handle->searchSize,
-                                handle->searchSize,
+                                rx,
+                                ry,
                                 search,
                                 &bx, &by,
                                 &(result->sim),
@@ -236,17 +269,35 @@ static int ar2Tracking2dSub(AR2HandleT * handle, AR2SurfaceSetT * surfaceSet, AR
     }
 
 #else
-    if (ar2GetBestMatching(dataPtr,
-                           mfImage,
-                           handle->xsize,
-                           handle->ysize,
-                           handle->pixFormat,
-                           *templ,
-                           handle->searchSize,
-                           handle->searchSize,
-                           search,
-                           &bx, &by,
-                           &(result->sim)) < 0)
+    if (halfPtr != NULL)
+    {
+        if (ar2GetBestMatchingPyramid(dataPtr,
+                                      halfPtr,
+                                      mfImage,
+                                      handle->xsize,
+                                      handle->ysize,
+                                      *templ,
+                                      *templHalf,
+                                      rx,
+                                      ry,
+                                      search,
+                                      &bx, &by,
+                                      &(result->sim)) < 0)
+        {
+            return -1;
+        }
+    }
+    else if (ar2GetBestMatching(dataPtr,
+                                mfImage,
+                                handle->xsize,
+                                handle->ysize,
+                                pixFormat,
+                                *templ,
+                                rx,
+                                ry,
+                                search,
+                                &bx, &by,
+                                &(result->sim)) < 0)
     {
         return -1;
     }
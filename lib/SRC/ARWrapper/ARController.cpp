@@ -56,6 +56,7 @@
 #endif
 #if HAVE_NFT
 #  include "trackingSub.h"
+#  include "pageResidency.h"
 #endif
 #include <stdarg.h>
 
@@ -69,6 +70,11 @@
 static const char LOG_TAG[]                 = "ARController (native)";
 PFN_LOGCALLBACK   ARController::logCallback = NULL;
 
+// Bits of PipelineResult::texturesDone, shifted left by the video source index.
+#define PIPELINE_TEXTURE_COLOR 0x01
+#define PIPELINE_TEXTURE_32    0x04
+#define PIPELINE_TEXTURE_GL    0x10
+
 ARController::ARController() :
     state(NOTHING_INITIALISED),
     versionString(NULL),
@@ -95,15 +101,26 @@ ARController::ARController() :
     m_arPattHandle(NULL),
     m_ar3DHandle(NULL),
     m_ar3DStereoHandle(NULL),
+    m_stereoDetectionThreadHandle(NULL),
+    m_stereoDetectionImage(NULL),
+    m_stereoDetectionResult(0),
 #if HAVE_NFT
     doNFTMarkerDetection(false),
     m_nftMultiMode(false),
     m_kpmRequired(true),
-    m_kpmBusy(false),
-    trackingThreadHandle(NULL),
+    m_nftMemoryBudget(0),
+    m_nftRecognitionThreads(1),
+    m_nftRecognitionMaxAge(0),
+    m_nftDetectionPass(0),
+    m_kpmLastStartPass(0),
+    m_kpmQueryPasses(0.0f),
     m_ar2Handle(NULL),
-    m_kpmHandle(NULL),
+    m_nftPageResidency(NULL),
 #endif
+    m_pipelined(false),
+    m_captureThreadHandle(NULL),
+    m_detectionThreadHandle(NULL),
+    m_pipelineQuit(false),
     m_error(ARW_ERROR_NONE)
 {
 #ifdef __APPLE__
@@ -113,13 +130,30 @@ ARController::ARController() :
 #if HAVE_NFT
     for (int i = 0; i < PAGES_MAX; i++)
         surfaceSet[i] = NULL;
+    for (int i = 0; i < NFT_RECOGNITION_THREADS_MAX; i++)
+    {
+        m_kpmBusy[i]             = false;
+        trackingThreadHandles[i] = NULL;
+        m_kpmHandles[i]          = NULL;
+    }
 #endif
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            m_pipelineFrames.slotAt(i).image[j]        = NULL;
+            m_pipelineResults.slotAt(i).frame.image[j] = NULL;
+        }
+    }
+
     pthread_mutex_init(&m_videoSourceLock, NULL);
+    pthread_mutex_init(&m_detectionLock, NULL);
 }
 
 ARController::~ARController()
 {
     shutdown();
+    pthread_mutex_destroy(&m_detectionLock);
     pthread_mutex_destroy(&m_videoSourceLock);
 #ifdef __APPLE__
     // closelog();
@@ -440,6 +474,10 @@ bool ARController::capture()
         return false;
     }
 
+    // In pipelined mode, frames are captured on the capture thread.
+    if (m_captureThreadHandle)
+        return true;
+
     if (!m_videoSource0->captureFrame())
     {
         logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::capture(): m_videoSource0->captureFrame() returned false, exiting returning false");
@@ -469,6 +507,18 @@ bool ARController::updateTexture(const int videoSourceIndex, Color *buffer)
         if (!vs)
             return false;
 
+        if (m_detectionThreadHandle)
+        {
+            // Push the frame the current marker poses came from.
+            PipelineResult &result = m_pipelineResults.front();
+            int            done    = PIPELINE_TEXTURE_COLOR << videoSourceIndex;
+            if ((result.texturesDone & done) || !vs->convertFrame(arVideoFrameRefGetBuffer(result.frame.image[videoSourceIndex]), NULL, buffer))
+                return false;
+
+            result.texturesDone |= done;
+            return true;
+        }
+
         return vs->updateTexture(buffer);
     }
     else
@@ -488,6 +538,18 @@ bool ARController::updateTexture32(const int videoSourceIndex, uint32_t *buffer)
         if (!vs)
             return false;
 
+        if (m_detectionThreadHandle)
+        {
+            // Push the frame the current marker poses came from.
+            PipelineResult &result = m_pipelineResults.front();
+            int            done    = PIPELINE_TEXTURE_32 << videoSourceIndex;
+            if ((result.texturesDone & done) || !vs->convertFrame32(arVideoFrameRefGetBuffer(result.frame.image[videoSourceIndex]), NULL, buffer))
+                return false;
+
+            result.texturesDone |= done;
+            return true;
+        }
+
         return vs->updateTexture32(buffer);
     }
     else
@@ -506,6 +568,20 @@ bool ARController::updateTextureGL(const int videoSourceIndex, const int texture
     if (!vs)
         return false;
 
+    if (m_detectionThreadHandle)
+    {
+        // Push the frame the current marker poses came from.
+        PipelineResult &result = m_pipelineResults.front();
+        int            done    = PIPELINE_TEXTURE_GL << videoSourceIndex;
+        if (!(result.texturesDone & done))
+        {
+            vs->uploadFrameGL(textureID, arVideoFrameRefGetBuffer(result.frame.image[videoSourceIndex]));
+            result.texturesDone |= done;
+        }
+
+        return true;
+    }
+
     vs->updateTextureGL(textureID);
     return true;
 }
@@ -564,6 +640,22 @@ bool ARController::update()
         }
     }
 
+    if (m_pipelined && !m_detectionThreadHandle)
+    {
+        if (!startPipeline())
+        {
+            logv(AR_LOG_LEVEL_ERROR, "ARController::update(): Error starting pipeline, falling back to synchronous mode.");
+            m_pipelined = false;
+        }
+    }
+
+    if (m_pipelined)
+    {
+        // Pick up the most recent completed detection pass, if there is a new one. Never waits.
+        m_pipelineResults.update();
+        return m_pipelineResults.front().success;
+    }
+
     // Get frame(s);
     ARUint8 *image0, *image1 = NULL;
     int     frameStamp0, frameStamp1;
@@ -607,13 +699,19 @@ bool ARController::update()
     m_videoSourceFrameStamp0 = frameStamp0;
     // logv("ARController::update() gotFrame");
 
+    return detect(image0, image1, NULL);
+}
+
+// private
+bool ARController::detect(ARUint8 *image0, ARUint8 *image1, ARVideoFrameRef *image0Ref)
+{
     //
     // Detect markers.
     //
 
     if (doMarkerDetection)
     {
-        logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::update(): if (doMarkerDetection) true");
+        logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::detect(): if (doMarkerDetection) true");
 
         ARMarkerInfo *markerInfo0 = NULL;
         ARMarkerInfo *markerInfo1 = NULL;
@@ -624,16 +722,27 @@ bool ARController::update()
         {
             if (!initAR())
             {
-                logv(AR_LOG_LEVEL_ERROR, "ARController::update(): Error initialising AR, exiting returning false");
+                logv(AR_LOG_LEVEL_ERROR, "ARController::detect(): Error initialising AR, exiting returning false");
                 return false;
             }
         }
 
+        // In stereo mode, start detection in image1 on the stereo detection thread, if there is one,
+        // so that it runs concurrently with detection in image0. The handles share only the (read-only) pattern handle.
+        bool stereoConcurrent = (m_videoSourceIsStereo && m_arHandle1 && m_stereoDetectionThreadHandle);
+        if (stereoConcurrent)
+        {
+            m_stereoDetectionImage = image1;
+            threadStartSignal(m_stereoDetectionThreadHandle);
+        }
+
         if (m_arHandle0)
         {
             if (arDetectMarker(m_arHandle0, image0) < 0)
             {
-                logv(AR_LOG_LEVEL_ERROR, "ARController::update(): Error: arDetectMarker(), exiting returning false");
+                logv(AR_LOG_LEVEL_ERROR, "ARController::detect(): Error: arDetectMarker(), exiting returning false");
+                if (stereoConcurrent)
+                    threadEndWait(m_stereoDetectionThreadHandle);
                 return false;
             }
 
@@ -643,9 +752,20 @@ bool ARController::update()
 
         if (m_videoSourceIsStereo && m_arHandle1)
         {
-            if (arDetectMarker(m_arHandle1, image1) < 0)
+            int ret;
+            if (stereoConcurrent)
+            {
+                threadEndWait(m_stereoDetectionThreadHandle);
+                ret = m_stereoDetectionResult;
+            }
+            else
+            {
+                ret = arDetectMarker(m_arHandle1, image1);
+            }
+
+            if (ret < 0)
             {
-                logv(AR_LOG_LEVEL_ERROR, "ARController::update(): Error: arDetectMarker(), exiting returning false");
+                logv(AR_LOG_LEVEL_ERROR, "ARController::detect(): Error: arDetectMarker(), exiting returning false");
                 return false;
             }
 
@@ -688,87 +808,160 @@ bool ARController::update()
 #if HAVE_NFT
     if (doNFTMarkerDetection)
     {
-        logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::update(): if (doNFTMarkerDetection) true");
+        logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::detect(): if (doNFTMarkerDetection) true");
 
-        if (!m_kpmHandle || !m_ar2Handle)
+        if (!m_kpmHandles[0] || !m_ar2Handle)
         {
             if (!initNFT())
             {
-                logv(AR_LOG_LEVEL_ERROR, "ARController::update(): Error initialising NFT, exiting returning false");
+                logv(AR_LOG_LEVEL_ERROR, "ARController::detect(): Error initialising NFT, exiting returning false");
                 return false;
             }
         }
 
-        if (!trackingThreadHandle)
+        if (!trackingThreadHandles[0])
         {
             loadNFTData();
         }
 
-        if (trackingThreadHandle)
+        if (trackingThreadHandles[0])
         {
-            // Do KPM tracking.
-            float err;
-            float trackingTrans[3][4];
+            m_nftDetectionPass++;
 
-            if (m_kpmRequired)
+            if (m_nftPageResidency)
+            {
+                pageResidencyUpdate(m_nftPageResidency);
+                int page = 0;
+                for (std::vector<ARMarker*>::iterator it = markers.begin(); it != markers.end(); ++it)
+                {
+                    if ((*it)->type == ARMarker::NFT)
+                        surfaceSet[page++] = ((ARMarkerNFT*)(*it))->surfaceSet;
+                }
+            }
+
+            // Collect the results of finished KPM recognition queries. With several threads, more than one
+            // may finish in a pass, so the results from the newest frames are applied first. Once a page
+            // is being tracked, further results for it are ignored.
+            float kpmTrans[NFT_RECOGNITION_THREADS_MAX][3][4];
+            int   kpmPage[NFT_RECOGNITION_THREADS_MAX];
+            int   kpmStamp[NFT_RECOGNITION_THREADS_MAX];
+            int   kpmResultNum = 0;
+
+            for (int i = 0; i < NFT_RECOGNITION_THREADS_MAX; i++)
+            {
+                if (!m_kpmBusy[i])
+                    continue;
+
+                float trackingTrans[3][4];
+                int   pageNo;
+                int   frameStamp;
+                int   ret = trackingInitGetResult(trackingThreadHandles[i], trackingTrans, &pageNo, &frameStamp);
+                if (ret == 0)
+                    continue; // Still running.
+
+                m_kpmBusy[i]     = false;
+                m_kpmQueryPasses = 0.75f * m_kpmQueryPasses + 0.25f * (float)(m_nftDetectionPass - frameStamp);
+                if (ret != 1)
+                {
+                    // logv("No page detected.");
+                    continue;
+                }
+
+                if (pageNo < 0 || pageNo >= PAGES_MAX)
+                {
+                    logv(AR_LOG_LEVEL_ERROR, "ARController::detect(): Detected bad page %d", pageNo);
+                    continue;
+                }
+
+                if (m_nftRecognitionMaxAge && m_nftDetectionPass - frameStamp > m_nftRecognitionMaxAge)
+                {
+                    logv(AR_LOG_LEVEL_DEBUG, "ARController::detect(): Discarding recognition of page %d, %d frames old.", pageNo, m_nftDetectionPass - frameStamp);
+                    continue;
+                }
+
+                // Insert, keeping the results in order from newest to oldest frame.
+                int j = kpmResultNum++;
+                for (; j > 0 && kpmStamp[j - 1] < frameStamp; j--)
+                {
+                    kpmPage[j]  = kpmPage[j - 1];
+                    kpmStamp[j] = kpmStamp[j - 1];
+                    memcpy(kpmTrans[j], kpmTrans[j - 1], sizeof(kpmTrans[j]));
+                }
+
+                kpmPage[j]  = pageNo;
+                kpmStamp[j] = frameStamp;
+                memcpy(kpmTrans[j], trackingTrans, sizeof(kpmTrans[j]));
+            }
+
+            // The AR2 pass below tracks each newly recognised page from its recognised pose into the current frame.
+            for (int i = 0; i < kpmResultNum; i++)
             {
-                if (!m_kpmBusy)
+                if (!surfaceSet[kpmPage[i]])
+                {
+                    // AR2 data not resident. Have it read, and track once KPM finds the page again.
+                    pageResidencyRequest(m_nftPageResidency, kpmPage[i]);
+                }
+                else if (surfaceSet[kpmPage[i]]->contNum < 1)
                 {
-                    trackingInitStart(trackingThreadHandle, image0);
-                    m_kpmBusy = true;
+                    // logv("Detected page %d.\n", kpmPage[i]);
+                    ar2SetInitTrans(surfaceSet[kpmPage[i]], kpmTrans[i]);                                     // Sets surfaceSet[page]->contNum = 1.
                 }
-                else
+            }
+
+            // Do AR2 tracking of all pages being tracked in one pass, and update NFT markers.
+            AR2SurfaceSetT *trackingSurfaceSet[PAGES_MAX];
+            float          trackingTransMulti[PAGES_MAX][3][4];
+            float          trackingErr[PAGES_MAX];
+            int            trackingResult[PAGES_MAX];
+            int            trackingIndex[PAGES_MAX];
+            int            trackingNum  = 0;
+            int            page         = 0;
+            int            pagesTracked = 0;
+            bool           success      = true;
+            ARdouble       *transL2R    = (m_videoSourceIsStereo ? (ARdouble*)m_transL2R : NULL);
+
+            for (std::vector<ARMarker*>::iterator it = markers.begin(); it != markers.end(); ++it)
+            {
+                if ((*it)->type == ARMarker::NFT)
                 {
-                    int ret;
-                    int pageNo;
-                    ret = trackingInitGetResult(trackingThreadHandle, trackingTrans, &pageNo);
-                    if (ret != 0)
+                    trackingIndex[page] = -1;
+                    if (surfaceSet[page] && surfaceSet[page]->contNum > 0)
                     {
-                        m_kpmBusy = false;
-                        if (ret == 1)
-                        {
-                            if (pageNo >= 0 && pageNo < PAGES_MAX)
-                            {
-                                if (surfaceSet[pageNo]->contNum < 1)
-                                {
-                                    // logv("Detected page %d.\n", pageNo);
-                                    ar2SetInitTrans(surfaceSet[pageNo], trackingTrans);                                     // Sets surfaceSet[page]->contNum = 1.
-                                }
-                            }
-                            else
-                            {
-                                logv(AR_LOG_LEVEL_ERROR, "ARController::update(): Detected bad page %d", pageNo);
-                            }
-                        }
-                        else   /*if (ret < 0)*/
-                        {
-                            // logv("No page detected.");
-                        }
+                        trackingIndex[page]               = trackingNum;
+                        trackingSurfaceSet[trackingNum++] = surfaceSet[page];
+                        if (m_nftPageResidency)
+                            pageResidencyRequest(m_nftPageResidency, page);
                     }
+
+                    page++;
                 }
             }
 
-            // Do AR2 tracking and update NFT markers.
-            int      page         = 0;
-            int      pagesTracked = 0;
-            bool     success      = true;
-            ARdouble *transL2R    = (m_videoSourceIsStereo ? (ARdouble*)m_transL2R : NULL);
+            if (trackingNum > 0)
+            {
+                if (ar2TrackingMulti(m_ar2Handle, trackingSurfaceSet, trackingNum, image0, trackingTransMulti, trackingErr, trackingResult) < 0)
+                {
+                    for (int i = 0; i < trackingNum; i++)
+                        trackingResult[i] = -1;
+                }
+            }
 
+            page = 0;
             for (std::vector<ARMarker*>::iterator it = markers.begin(); it != markers.end(); ++it)
             {
                 if ((*it)->type == ARMarker::NFT)
                 {
-                    if (surfaceSet[page]->contNum > 0)
+                    if (trackingIndex[page] >= 0)
                     {
-                        if (ar2Tracking(m_ar2Handle, surfaceSet[page], image0, trackingTrans, &err) < 0)
+                        if (trackingResult[trackingIndex[page]] < 0)
                         {
                             // logv("Tracking lost on page %d.", page);
                             success &= ((ARMarkerNFT*)(*it))->updateWithNFTResults(-1, NULL, NULL);
                         }
                         else
                         {
-                            // logv("Tracked page %d (pos = {% 4f, % 4f, % 4f}).\n", page, trackingTrans[0][3], trackingTrans[1][3], trackingTrans[2][3]);
-                            success &= ((ARMarkerNFT*)(*it))->updateWithNFTResults(page, trackingTrans, (ARdouble (*)[4])transL2R);
+                            // logv("Tracked page %d (pos = {% 4f, % 4f, % 4f}).\n", page, trackingTransMulti[trackingIndex[page]][0][3], trackingTransMulti[trackingIndex[page]][1][3], trackingTransMulti[trackingIndex[page]][2][3]);
+                            success &= ((ARMarkerNFT*)(*it))->updateWithNFTResults(page, trackingTransMulti[trackingIndex[page]], (ARdouble (*)[4])transL2R);
                             pagesTracked++;
                         }
                     }
@@ -778,14 +971,52 @@ bool ARController::update()
             }
 
             m_kpmRequired = (pagesTracked < (m_nftMultiMode ? page : 1));
-        } // trackingThreadHandle
+
+            // Start a recognition query on this frame as soon as a thread is free. With several threads,
+            // queries are spread out over the time one takes, so that their results come in evenly.
+            if (m_kpmRequired)
+            {
+                int threads = 0;
+                int idle    = -1;
+                for (int i = 0; i < NFT_RECOGNITION_THREADS_MAX && trackingThreadHandles[i]; i++)
+                {
+                    threads++;
+                    if (idle < 0 && !m_kpmBusy[i])
+                        idle = i;
+                }
+
+                if (idle >= 0 && (threads == 1 || (float)(m_nftDetectionPass - m_kpmLastStartPass) * threads >= m_kpmQueryPasses))
+                {
+                    if (image0Ref)
+                        trackingInitStartFrame(trackingThreadHandles[idle], image0Ref, m_nftDetectionPass);
+                    else
+                        trackingInitStart(trackingThreadHandles[idle], image0, m_nftDetectionPass);
+                    m_kpmBusy[idle]    = true;
+                    m_kpmLastStartPass = m_nftDetectionPass;
+                }
+            }
+        } // trackingThreadHandles[0]
     } // doNFTMarkerDetection
 #endif // HAVE_NFT
-    logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::update(): exiting, returning true");
+    logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::detect(): exiting, returning true");
 
     return true;
 }
 
+// private, static
+void* ARController::stereoDetectionMain(THREAD_HANDLE_T *threadHandle)
+{
+    ARController *controller = (ARController*)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0)
+    {
+        controller->m_stereoDetectionResult = arDetectMarker(controller->m_arHandle1, controller->m_stereoDetectionImage);
+        threadEndSignal(threadHandle);
+    }
+
+    return NULL;
+}
+
 bool ARController::initAR(void)
 {
     logv(AR_LOG_LEVEL_INFO, "ARController::initAR() called");
@@ -843,6 +1074,15 @@ bool ARController::initAR(void)
         arSetPattRatio(m_arHandle1, pattRatio);
         arSetPatternDetectionMode(m_arHandle1, patternDetectionMode);
         arSetMatrixCodeType(m_arHandle1, matrixCodeType);
+
+        // Detection in the two images is independent, so if there is more than one CPU, run it concurrently.
+        if (threadGetCPU() > 1)
+        {
+            if (!(m_stereoDetectionThreadHandle = threadInit(0, this, stereoDetectionMain)))
+            {
+                logv(AR_LOG_LEVEL_WARN, "ARController::initAR(): Unable to start stereo detection thread. Stereo detection will run sequentially.");
+            }
+        }
     }
 
     if (!m_videoSourceIsStereo)
@@ -868,6 +1108,12 @@ bool ARController::initAR(void)
     return true;
 
 bail2:
+    if (m_stereoDetectionThreadHandle)
+    {
+        threadWaitQuit(m_stereoDetectionThreadHandle);
+        threadFree(&m_stereoDetectionThreadHandle);
+    }
+
     arDeleteHandle(m_arHandle1);
     m_arHandle1 = NULL;
 bail1:
@@ -887,20 +1133,20 @@ bool ARController::initNFT(void)
     //
 
     // KPM init.
-    m_kpmHandle = kpmCreateHandle(m_videoSource0->getCameraParameters(), m_videoSource0->getPixelFormat());
-    if (!m_kpmHandle)
+    m_kpmHandles[0] = kpmCreateHandle(m_videoSource0->getCameraParameters(), m_videoSource0->getPixelFormat());
+    if (!m_kpmHandles[0])
     {
         logv(AR_LOG_LEVEL_ERROR, "ARController::initNFT(): Error: kpmCreatHandle, exiting, returning false");
         return (false);
     }
 
-    // kpmSetProcMode( m_kpmHandle, KpmProcHalfSize );
+    // kpmSetProcMode( m_kpmHandles[0], KpmProcHalfSize );
 
     // AR2 init.
     if ((m_ar2Handle = ar2CreateHandle(m_videoSource0->getCameraParameters(), m_videoSource0->getPixelFormat(), AR2_TRACKING_DEFAULT_THREAD_NUM)) == NULL)
     {
         logv(AR_LOG_LEVEL_ERROR, "ARController::initNFT(): Error: ar2CreateHandle, exiting, returning false");
-        kpmDeleteHandle(&m_kpmHandle);
+        kpmDeleteHandle(&m_kpmHandles[0]);
         return (false);
     }
 
@@ -935,13 +1181,20 @@ bool ARController::unloadNFTData(void)
 {
     int i;
 
-    if (trackingThreadHandle)
+    if (trackingThreadHandles[0])
+        logv(AR_LOG_LEVEL_INFO, "Stopping NFT tracking threads.");
+
+    for (i = 0; i < NFT_RECOGNITION_THREADS_MAX; i++)
     {
-        logv(AR_LOG_LEVEL_INFO, "Stopping NFT tracking thread.");
-        trackingInitQuit(&trackingThreadHandle);
-        m_kpmBusy = false;
+        trackingInitQuit(&trackingThreadHandles[i]);
+        m_kpmBusy[i] = false;
+        if (i > 0 && m_kpmHandles[i])
+            kpmDeleteHandle(&m_kpmHandles[i]);
     }
 
+    if (m_nftPageResidency)
+        pageResidencyQuit(&m_nftPageResidency);
+
     for (i = 0; i < PAGES_MAX; i++)
         surfaceSet[i] = NULL;                             // Discard weak-references.
 
@@ -952,8 +1205,8 @@ bool ARController::unloadNFTData(void)
 
 bool ARController::loadNFTData(void)
 {
-    // If data was already loaded, stop KPM tracking thread and unload previously loaded data.
-    if (trackingThreadHandle)
+    // If data was already loaded, stop KPM tracking threads and unload previously loaded data.
+    if (trackingThreadHandles[0])
     {
         logv(AR_LOG_LEVEL_INFO, "Reloading NFT data");
         unloadNFTData();
@@ -966,10 +1219,57 @@ bool ARController::loadNFTData(void)
     KpmRefDataSet *refDataSet = NULL;
     int           pageCount   = 0;
 
+    // Pages freed under a memory budget must all be resident again if the budget has been removed.
+    if (!m_nftMemoryBudget)
+    {
+        for (std::vector<ARMarker*>::iterator it = markers.begin(); it != markers.end(); ++it)
+        {
+            if ((*it)->type == ARMarker::NFT && !((ARMarkerNFT*)(*it))->surfaceSet)
+            {
+                logv(AR_LOG_LEVEL_INFO, "Loading %s.fset.", ((ARMarkerNFT*)(*it))->datasetPathname);
+                if ((((ARMarkerNFT*)(*it))->surfaceSet = ar2ReadSurfaceSet(((ARMarkerNFT*)(*it))->datasetPathname, "fset", NULL)) == NULL)
+                {
+                    logv(AR_LOG_LEVEL_ERROR, "ARController::loadNFTData(): Error reading data from %s.fset, exit(-1)", ((ARMarkerNFT*)(*it))->datasetPathname);
+                    exit(-1);
+                }
+            }
+        }
+    }
+
+    // If every dataset has been saved in the indexed format, the files can be mapped
+    // directly into the matcher rather than being parsed, merged, and re-indexed.
+    bool        mapped = true;
+    const char *mappedFilenames[PAGES_MAX];
+    int         mappedPageNos[PAGES_MAX];
+    for (std::vector<ARMarker*>::iterator it = markers.begin(); it != markers.end(); ++it)
+    {
+        if ((*it)->type == ARMarker::NFT && kpmRefDataSetFileIsIndexed(((ARMarkerNFT*)(*it))->datasetPathname, "fset3") != 1)
+        {
+            mapped = false;
+            break;
+        }
+    }
+
     for (std::vector<ARMarker*>::iterator it = markers.begin(); it != markers.end(); ++it)
     {
         if ((*it)->type == ARMarker::NFT)
         {
+            if (mapped)
+            {
+                mappedFilenames[pageCount] = ((ARMarkerNFT*)(*it))->datasetPathname;
+                mappedPageNos[pageCount]   = pageCount;
+                ((ARMarkerNFT*)(*it))->pageNo = pageCount;
+                logv(AR_LOG_LEVEL_INFO, "Mapping %s.fset3, assigned page no. %d.", ((ARMarkerNFT*)(*it))->datasetPathname, pageCount);
+                surfaceSet[pageCount] = ((ARMarkerNFT*)(*it))->surfaceSet;
+                pageCount++;
+                if (pageCount == PAGES_MAX)
+                {
+                    logv(AR_LOG_LEVEL_ERROR, "Maximum number of NFT pages (%d) loaded", PAGES_MAX);
+                    break;
+                }
+                continue;
+            }
+
             // Load KPM data.
             KpmRefDataSet *refDataSet2;
             logv(AR_LOG_LEVEL_INFO, "Reading %s.fset3", ((ARMarkerNFT*)(*it))->datasetPathname);
@@ -1008,23 +1308,71 @@ bool ARController::loadNFTData(void)
         }
     }
 
-    if (kpmSetRefDataSet(m_kpmHandle, refDataSet) < 0)
+    // Each recognition thread needs a KPM handle of its own.
+    int kpmHandleNum = 1;
+    for (; kpmHandleNum < m_nftRecognitionThreads; kpmHandleNum++)
+    {
+        if (!(m_kpmHandles[kpmHandleNum] = kpmCreateHandle(m_videoSource0->getCameraParameters(), m_videoSource0->getPixelFormat())))
+        {
+            logv(AR_LOG_LEVEL_WARN, "ARController::loadNFTData(): Unable to create KPM handle; using %d recognition threads.", kpmHandleNum);
+            break;
+        }
+    }
+
+    for (int i = 0; i < kpmHandleNum; i++)
     {
-        logv(AR_LOG_LEVEL_ERROR, "ARController::loadNFTData(): Error: kpmSetRefDataSet, exit(-1)");
-        exit(-1);
+        if (mapped)
+        {
+            if (kpmSetRefDataSetFilesMapped(m_kpmHandles[i], mappedFilenames, "fset3", mappedPageNos, pageCount) < 0)
+            {
+                logv(AR_LOG_LEVEL_ERROR, "ARController::loadNFTData(): Error: kpmSetRefDataSetFilesMapped, exit(-1)");
+                exit(-1);
+            }
+        }
+        else
+        {
+            if (kpmSetRefDataSet(m_kpmHandles[i], refDataSet) < 0)
+            {
+                logv(AR_LOG_LEVEL_ERROR, "ARController::loadNFTData(): Error: kpmSetRefDataSet, exit(-1)");
+                exit(-1);
+            }
+        }
     }
 
-    kpmDeleteRefDataSet(&refDataSet);
+    if (!mapped)
+        kpmDeleteRefDataSet(&refDataSet);
+
+    if (m_nftMemoryBudget && pageCount > 0)
+    {
+        logv(AR_LOG_LEVEL_INFO, "Keeping at most %d MB of NFT tracking data resident.", m_nftMemoryBudget);
+        m_nftPageResidency = pageResidencyInit(pageCount, (size_t)m_nftMemoryBudget * 1024 * 1024);
+        if (!m_nftPageResidency)
+        {
+            logv(AR_LOG_LEVEL_ERROR, "ARController::loadNFTData(): pageResidencyInit(), exit(-1)");
+            exit(-1);
+        }
+
+        for (std::vector<ARMarker*>::iterator it = markers.begin(); it != markers.end(); ++it)
+        {
+            if ((*it)->type == ARMarker::NFT && ((ARMarkerNFT*)(*it))->pageNo >= 0)
+                pageResidencySetPage(m_nftPageResidency, ((ARMarkerNFT*)(*it))->pageNo, ((ARMarkerNFT*)(*it))->datasetPathname, &((ARMarkerNFT*)(*it))->surfaceSet);
+        }
+    }
 
-    // Start the KPM tracking thread.
-    logv(AR_LOG_LEVEL_INFO, "Starting NFT tracking thread.");
-    trackingThreadHandle = trackingInitInit(m_kpmHandle);
-    if (!trackingThreadHandle)
+    // Start the KPM tracking threads.
+    logv(AR_LOG_LEVEL_INFO, "Starting %d NFT tracking thread(s).", kpmHandleNum);
+    for (int i = 0; i < kpmHandleNum; i++)
     {
-        logv(AR_LOG_LEVEL_ERROR, "ARController::loadNFTData(): trackingInitInit(), exit(-1)");
-        exit(-1);
+        trackingThreadHandles[i] = trackingInitInit(m_kpmHandles[i]);
+        if (!trackingThreadHandles[i])
+        {
+            logv(AR_LOG_LEVEL_ERROR, "ARController::loadNFTData(): trackingInitInit(), exit(-1)");
+            exit(-1);
+        }
     }
 
+    m_kpmQueryPasses = 0.0f;
+
     logv(AR_LOG_LEVEL_DEBUG, "Loading of NFT data complete, exiting, return true");
     return true;
 }
@@ -1039,11 +1387,14 @@ bool ARController::stopRunning()
         return false;
     }
 
+    // The pipeline threads use the video sources and tracking handles, so must be stopped first.
+    stopPipeline();
+
 #if HAVE_NFT
     // Tracking thread is holding a reference to the camera parameters. Closing the
     // video source will dispose of the camera parameters, thus invalidating this reference.
     // So must stop tracking before closing the video source.
-    if (trackingThreadHandle)
+    if (trackingThreadHandles[0])
     {
         logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::stopRunning(): calling unloadNFTData()");
         unloadNFTData();
@@ -1091,10 +1442,10 @@ bool ARController::stopRunning()
         ar2DeleteHandle(&m_ar2Handle); // Sets m_ar2Handle to NULL.
     }
 
-    if (m_kpmHandle)
+    if (m_kpmHandles[0])
     {
-        logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::stopRunning(): calling kpmDeleteHandle(&m_kpmHandle)");
-        kpmDeleteHandle(&m_kpmHandle); // Sets m_kpmHandle to NULL.
+        logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::stopRunning(): calling kpmDeleteHandle(&m_kpmHandles[0])");
+        kpmDeleteHandle(&m_kpmHandles[0]); // Sets m_kpmHandles[0] to NULL.
     }
 #endif
 
@@ -1119,6 +1470,13 @@ bool ARController::stopRunning()
         m_arHandle0 = NULL;
     }
 
+    if (m_stereoDetectionThreadHandle)
+    {
+        logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::stopRunning(): stopping stereo detection thread");
+        threadWaitQuit(m_stereoDetectionThreadHandle);
+        threadFree(&m_stereoDetectionThreadHandle);
+    }
+
     if (m_arHandle1)
     {
         logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::stopRunning(): if (m_arHandle1) true");
@@ -1174,6 +1532,270 @@ bool ARController::shutdown()
     return true;
 }
 
+// ----------------------------------------------------------------------------------------------------
+#pragma mark  Pipelined mode
+// ----------------------------------------------------------------------------------------------------
+
+void ARController::setPipelined(bool pipelined)
+{
+    if (pipelined == m_pipelined)
+        return;
+
+    m_pipelined = pipelined;
+    if (!pipelined)
+        stopPipeline(); // When enabling, the pipeline is started by the next update().
+
+    logv(AR_LOG_LEVEL_INFO, "Pipelined mode %s.", pipelined ? "enabled" : "disabled");
+}
+
+bool ARController::getPipelined() const
+{
+    return m_pipelined;
+}
+
+bool ARController::getMarkerState(ARMarker *marker, ARdouble matrix[16], ARdouble matrixR[16])
+{
+    if (!marker)
+        return false;
+
+    if (!m_detectionThreadHandle)
+    {
+        if (matrix)
+            memcpy(matrix, marker->transformationMatrix, sizeof(ARdouble) * 16);
+
+        if (matrixR)
+            memcpy(matrixR, marker->transformationMatrixR, sizeof(ARdouble) * 16);
+
+        return marker->visible;
+    }
+
+    std::vector<PipelineMarkerState>                 &states = m_pipelineResults.front().markers;
+    std::vector<PipelineMarkerState>::const_iterator it      = states.begin();
+
+    while (it != states.end())
+    {
+        if (it->UID == marker->UID)
+        {
+            if (matrix)
+                memcpy(matrix, it->transformationMatrix, sizeof(ARdouble) * 16);
+
+            if (matrixR)
+                memcpy(matrixR, it->transformationMatrixR, sizeof(ARdouble) * 16);
+
+            return it->visible;
+        }
+
+        ++it;
+    }
+
+    return false; // Marker added since the last completed detection pass.
+}
+
+// private
+bool ARController::startPipeline()
+{
+    VideoSource *vs[2] = {m_videoSource0, (m_videoSourceIsStereo ? m_videoSource1 : NULL)};
+
+    logv(AR_LOG_LEVEL_DEBUG, "ARWrapper::ARController::startPipeline(): called");
+
+    // Each slot of both queues gets a frame buffer per video source. The detection thread
+    // hands a frame on by exchanging buffers between the queues, so all must be the same size.
+    for (int i = 0; i < 3; i++)
+    {
+        PipelineFrame  &frame  = m_pipelineFrames.slotAt(i);
+        PipelineResult &result = m_pipelineResults.slotAt(i);
+
+        for (int j = 0; j < 2; j++)
+        {
+            if (vs[j])
+            {
+                frame.image[j]        = arVideoFrameRefCreate(vs[j]->getVideoWidth(), vs[j]->getVideoHeight(), vs[j]->getPixelFormat());
+                result.frame.image[j] = arVideoFrameRefCreate(vs[j]->getVideoWidth(), vs[j]->getVideoHeight(), vs[j]->getPixelFormat());
+                if (!frame.image[j] || !result.frame.image[j])
+                {
+                    logv(AR_LOG_LEVEL_ERROR, "ARController::startPipeline(): Out of memory.");
+                    goto bail;
+                }
+            }
+
+            frame.frameStamp[j]        = 0;
+            result.frame.frameStamp[j] = 0;
+        }
+
+        result.markers.clear();
+        result.success      = true;
+        result.texturesDone = ~0; // No frame yet.
+    }
+
+    m_pipelineFrames.reset();
+    m_pipelineResults.reset();
+    m_pipelineQuit = false;
+
+    // Each thread is started as soon as it exists, so that stopPipeline() can always wait for it.
+    if (!(m_detectionThreadHandle = threadInit(0, this, pipelineDetectionMain)))
+    {
+        logv(AR_LOG_LEVEL_ERROR, "ARController::startPipeline(): Unable to start detection thread.");
+        goto bail;
+    }
+
+    threadStartSignal(m_detectionThreadHandle);
+    if (!(m_captureThreadHandle = threadInit(1, this, pipelineCaptureMain)))
+    {
+        logv(AR_LOG_LEVEL_ERROR, "ARController::startPipeline(): Unable to start capture thread.");
+        goto bail;
+    }
+
+    threadStartSignal(m_captureThreadHandle);
+
+    logv(AR_LOG_LEVEL_INFO, "Pipeline started.");
+    return true;
+
+bail:
+    stopPipeline();
+    return false;
+}
+
+// private
+void ARController::stopPipeline()
+{
+    THREAD_HANDLE_T **threadHandle_p[2] = {&m_captureThreadHandle, &m_detectionThreadHandle};
+
+    m_pipelineQuit = true;
+    for (int i = 0; i < 2; i++)
+    {
+        if (*threadHandle_p[i])
+        {
+            threadEndWait(*threadHandle_p[i]);
+            threadWaitQuit(*threadHandle_p[i]);
+            threadFree(threadHandle_p[i]);
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            // The KPM thread may still hold a reference to one of these, in which case it frees it.
+            arVideoFrameRefRelease(&m_pipelineFrames.slotAt(i).image[j]);
+            arVideoFrameRefRelease(&m_pipelineResults.slotAt(i).frame.image[j]);
+        }
+
+        m_pipelineResults.slotAt(i).markers.clear();
+    }
+}
+
+// private, static
+void* ARController::pipelineCaptureMain(THREAD_HANDLE_T *threadHandle)
+{
+    ARController *controller = (ARController*)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0)
+    {
+        int sourceCount = (controller->m_videoSourceIsStereo ? 2 : 1);
+        int captured    = 0; // One bit per video source with a new frame in the back slot.
+
+        while (!controller->m_pipelineQuit)
+        {
+            PipelineFrame &frame   = controller->m_pipelineFrames.back();
+            bool          gotFrame = false;
+
+            // Copy out the frame under the video source lock, as on Android, frames are pushed into the video source from another thread.
+            controller->lockVideoSource();
+            for (int j = 0; j < sourceCount; j++)
+            {
+                VideoSource *vs = (j == 0 ? controller->m_videoSource0 : controller->m_videoSource1);
+                if (!vs->captureFrame() || !vs->getFrame())
+                    continue;
+
+                // If the KPM thread is still recognising in this buffer, leave it to that and fill a new one.
+                if (arVideoFrameRefIsShared(frame.image[j]))
+                {
+                    ARVideoFrameRef *image = arVideoFrameRefCreate(vs->getVideoWidth(), vs->getVideoHeight(), vs->getPixelFormat());
+                    if (!image)
+                        continue;
+
+                    arVideoFrameRefRelease(&frame.image[j]);
+                    frame.image[j] = image;
+                }
+
+                arVideoFrameRefFill(frame.image[j], vs->getFrame(), vs->getFrame2());
+
+                frame.frameStamp[j] = vs->getFrameStamp();
+                captured           |= 1 << j;
+                gotFrame            = true;
+            }
+
+            controller->unlockVideoSource();
+
+            if (captured == (1 << sourceCount) - 1)
+            {
+                controller->m_pipelineFrames.publish();
+                captured = 0;
+            }
+            else if (!gotFrame)
+            {
+                arUtilSleep(1);
+            }
+        }
+
+        threadEndSignal(threadHandle);
+    }
+
+    return NULL;
+}
+
+// private, static
+void* ARController::pipelineDetectionMain(THREAD_HANDLE_T *threadHandle)
+{
+    ARController *controller = (ARController*)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0)
+    {
+        while (!controller->m_pipelineQuit)
+        {
+            if (!controller->m_pipelineFrames.update())
+            {
+                arUtilSleep(1);
+                continue;
+            }
+
+            PipelineFrame  &frame  = controller->m_pipelineFrames.front();
+            PipelineResult &result = controller->m_pipelineResults.back();
+
+            controller->lockDetection();
+            result.success = controller->detect(arVideoFrameRefGetBuffer(frame.image[0]), arVideoFrameRefGetBuffer(frame.image[1]), frame.image[0]);
+
+            // Snapshot the marker states, as the markers themselves will change during the next pass.
+            result.markers.resize(controller->markers.size());
+            for (size_t i = 0; i < controller->markers.size(); i++)
+            {
+                ARMarker            *marker = controller->markers[i];
+                PipelineMarkerState &state  = result.markers[i];
+                state.UID     = marker->UID;
+                state.visible = marker->visible;
+                memcpy(state.transformationMatrix, marker->transformationMatrix, sizeof(ARdouble) * 16);
+                memcpy(state.transformationMatrixR, marker->transformationMatrixR, sizeof(ARdouble) * 16);
+            }
+
+            controller->unlockDetection();
+
+            // Pass the frame on with the results by exchanging buffers, rather than copying it.
+            for (int j = 0; j < 2; j++)
+            {
+                std::swap(frame.image[j], result.frame.image[j]);
+                result.frame.frameStamp[j] = frame.frameStamp[j];
+            }
+
+            result.texturesDone = 0;
+            controller->m_pipelineResults.publish();
+        }
+
+        threadEndSignal(threadHandle);
+    }
+
+    return NULL;
+}
+
 // ----------------------------------------------------------------------------------------------------
 #pragma mark  State queries
 // ----------------------------------------------------------------------------------------------------
@@ -1190,6 +1812,16 @@ void ARController::unlockVideoSource()
     pthread_mutex_unlock(&m_videoSourceLock);
 }
 
+void ARController::lockDetection()
+{
+    pthread_mutex_lock(&m_detectionLock);
+}
+
+void ARController::unlockDetection()
+{
+    pthread_mutex_unlock(&m_detectionLock);
+}
+
 bool ARController::getProjectionMatrix(const int videoSourceIndex, ARdouble proj[16])
 {
     if (videoSourceIndex < 0 || videoSourceIndex > (m_videoSourceIsStereo ? 1 : 0))
@@ -1243,6 +1875,8 @@ bool ARController::videoParameters(const int videoSourceIndex, int *width, int *
 // ----------------------------------------------------------------------------------------------------
 void ARController::setDebugMode(bool debug)
 {
+    lockDetection();
+
     debugMode = debug;
     if (m_arHandle0)
     {
@@ -1259,6 +1893,8 @@ void ARController::setDebugMode(bool debug)
             logv(AR_LOG_LEVEL_INFO, "Debug mode set to %s", debug ? "on." : "off.");
         }
     }
+
+    unlockDetection();
 }
 
 bool ARController::getDebugMode() const
@@ -1268,6 +1904,8 @@ bool ARController::getDebugMode() const
 
 void ARController::setImageProcMode(int mode)
 {
+    lockDetection();
+
     imageProcMode = mode;
 
     if (m_arHandle0)
@@ -1285,6 +1923,8 @@ void ARController::setImageProcMode(int mode)
             logv(AR_LOG_LEVEL_INFO, "Image proc. mode set to %d.", imageProcMode);
         }
     }
+
+    unlockDetection();
 }
 
 int ARController::getImageProcMode() const
@@ -1297,6 +1937,8 @@ void ARController::setThreshold(int thresh)
     if (thresh < 0 || thresh > 255)
         return;
 
+    lockDetection();
+
     threshold = thresh;
     if (m_arHandle0)
     {
@@ -1313,6 +1955,8 @@ void ARController::setThreshold(int thresh)
             logv(AR_LOG_LEVEL_INFO, "Threshold set to %d", threshold);
         }
     }
+
+    unlockDetection();
 }
 
 int ARController::getThreshold() const
@@ -1322,6 +1966,8 @@ int ARController::getThreshold() const
 
 void ARController::setThresholdMode(int mode)
 {
+    lockDetection();
+
     thresholdMode = (AR_LABELING_THRESH_MODE)mode;
     if (m_arHandle0)
     {
@@ -1338,6 +1984,8 @@ void ARController::setThresholdMode(int mode)
             logv(AR_LOG_LEVEL_INFO, "Threshold mode set to %d", (int)thresholdMode);
         }
     }
+
+    unlockDetection();
 }
 
 int ARController::getThresholdMode() const
@@ -1347,6 +1995,8 @@ int ARController::getThresholdMode() const
 
 void ARController::setLabelingMode(int mode)
 {
+    lockDetection();
+
     labelingMode = mode;
     if (m_arHandle0)
     {
@@ -1363,6 +2013,8 @@ void ARController::setLabelingMode(int mode)
             logv(AR_LOG_LEVEL_INFO, "Labeling mode set to %d", labelingMode);
         }
     }
+
+    unlockDetection();
 }
 
 int ARController::getLabelingMode() const
@@ -1372,6 +2024,8 @@ int ARController::getLabelingMode() const
 
 void ARController::setPatternDetectionMode(int mode)
 {
+    lockDetection();
+
     patternDetectionMode = mode;
     if (m_arHandle0)
     {
@@ -1388,6 +2042,8 @@ void ARController::setPatternDetectionMode(int mode)
             logv(AR_LOG_LEVEL_INFO, "Pattern detection mode set to %d.", patternDetectionMode);
         }
     }
+
+    unlockDetection();
 }
 
 int ARController::getPatternDetectionMode() const
@@ -1400,6 +2056,8 @@ void ARController::setPattRatio(float ratio)
     if (ratio <= 0.0f || ratio >= 1.0f)
         return;
 
+    lockDetection();
+
     pattRatio = (ARdouble)ratio;
     if (m_arHandle0)
     {
@@ -1416,6 +2074,8 @@ void ARController::setPattRatio(float ratio)
             logv(AR_LOG_LEVEL_INFO, "Pattern ratio size set to %d.", pattRatio);
         }
     }
+
+    unlockDetection();
 }
 
 float ARController::getPattRatio() const
@@ -1425,6 +2085,8 @@ float ARController::getPattRatio() const
 
 void ARController::setMatrixCodeType(int type)
 {
+    lockDetection();
+
     matrixCodeType = (AR_MATRIX_CODE_TYPE)type;
     if (m_arHandle0)
     {
@@ -1441,6 +2103,8 @@ void ARController::setMatrixCodeType(int type)
             logv(AR_LOG_LEVEL_INFO, "Matrix code type set to %d.", matrixCodeType);
         }
     }
+
+    unlockDetection();
 }
 
 int ARController::getMatrixCodeType() const
@@ -1451,7 +2115,9 @@ int ARController::getMatrixCodeType() const
 void ARController::setNFTMultiMode(bool on)
 {
 #if HAVE_NFT
+    lockDetection();
     m_nftMultiMode = on;
+    unlockDetection();
 #endif
 }
 
@@ -1464,6 +2130,85 @@ bool ARController::getNFTMultiMode() const
 #endif
 }
 
+void ARController::setNFTMemoryBudget(int megabytes)
+{
+#if HAVE_NFT
+    if (megabytes < 0)
+        megabytes = 0;
+
+    lockDetection();
+    if (m_nftPageResidency && megabytes)
+    {
+        pageResidencySetMemoryBudget(m_nftPageResidency, (size_t)megabytes * 1024 * 1024);
+    }
+    else if ((!m_nftMemoryBudget) != (!megabytes) && trackingThreadHandles[0])
+    {
+        unloadNFTData(); // loadNFTData() will be called on next update().
+    }
+
+    m_nftMemoryBudget = megabytes;
+    unlockDetection();
+#endif
+}
+
+int ARController::getNFTMemoryBudget() const
+{
+#if HAVE_NFT
+    return m_nftMemoryBudget;
+#else
+    return 0;
+#endif
+}
+
+void ARController::setNFTRecognitionThreads(int threads)
+{
+#if HAVE_NFT
+    if (threads < 1)
+        threads = 1;
+    else if (threads > NFT_RECOGNITION_THREADS_MAX)
+        threads = NFT_RECOGNITION_THREADS_MAX;
+
+    lockDetection();
+    if (threads != m_nftRecognitionThreads && trackingThreadHandles[0])
+    {
+        unloadNFTData(); // loadNFTData() will be called on next update().
+    }
+
+    m_nftRecognitionThreads = threads;
+    unlockDetection();
+#endif
+}
+
+int ARController::getNFTRecognitionThreads() const
+{
+#if HAVE_NFT
+    return m_nftRecognitionThreads;
+#else
+    return 0;
+#endif
+}
+
+void ARController::setNFTRecognitionMaxAge(int passes)
+{
+#if HAVE_NFT
+    if (passes < 0)
+        passes = 0;
+
+    lockDetection();
+    m_nftRecognitionMaxAge = passes;
+    unlockDetection();
+#endif
+}
+
+int ARController::getNFTRecognitionMaxAge() const
+{
+#if HAVE_NFT
+    return m_nftRecognitionMaxAge;
+#else
+    return 0;
+#endif
+}
+
 // ----------------------------------------------------------------------------------------------------
 #pragma mark Debug texture
 // ----------------------------------------------------------------------------------------------------
@@ -1483,12 +2228,15 @@ bool ARController::updateDebugTexture(const int videoSourceIndex, Color *buffer)
     if (!buffer)
         return false;
 
-    ARHandle *arHandle = (videoSourceIndex == 1 ? m_arHandle1 : m_arHandle0);
-    if (!arHandle)
-        return false;
+    // The debug image is written by detection, which may be running on another thread.
+    lockDetection();
 
-    if (!arHandle->labelInfo.bwImage)
+    ARHandle *arHandle = (videoSourceIndex == 1 ? m_arHandle1 : m_arHandle0);
+    if (!arHandle || !arHandle->labelInfo.bwImage)
+    {
+        unlockDetection();
         return false;
+    }
 
     // Get parameters from the tracker.
     uint8_t *src;
@@ -1538,6 +2286,8 @@ bool ARController::updateDebugTexture(const int videoSourceIndex, Color *buffer)
             }
         }
     }
+
+    unlockDetection();
     return true;
 #endif
 }
@@ -1559,12 +2309,15 @@ bool ARController::updateDebugTexture32(const int videoSourceIndex, uint32_t *bu
     if (!buffer)
         return false;
 
-    ARHandle *arHandle = (videoSourceIndex == 1 ? m_arHandle1 : m_arHandle0);
-    if (!arHandle)
-        return false;
+    // The debug image is written by detection, which may be running on another thread.
+    lockDetection();
 
-    if (!arHandle->labelInfo.bwImage)
+    ARHandle *arHandle = (videoSourceIndex == 1 ? m_arHandle1 : m_arHandle0);
+    if (!arHandle || !arHandle->labelInfo.bwImage)
+    {
+        unlockDetection();
         return false;
+    }
 
     uint8_t  *src;
     uint32_t *dest = buffer;
@@ -1604,6 +2357,8 @@ bool ARController::updateDebugTexture32(const int videoSourceIndex, uint32_t *bu
             }
         }
     }
+
+    unlockDetection();
     return true;
 #endif
 }
@@ -1620,7 +2375,12 @@ int ARController::addMarker(const char *cfg)
         return -1;
     }
 
+#if HAVE_NFT
+    // Under an NFT memory budget, pages' AR2 data is only read when the page residency manager needs it.
+    ARMarker *marker = ARMarker::newWithConfig(cfg, m_arPattHandle, m_nftMemoryBudget != 0);
+#else
     ARMarker *marker = ARMarker::newWithConfig(cfg, m_arPattHandle);
+#endif
     if (!marker)
     {
         logv(AR_LOG_LEVEL_ERROR, "Error: Failed to load marker.\n");
@@ -1651,6 +2411,7 @@ bool ARController::addMarker(ARMarker *marker)
         return false;
     }
 
+    lockDetection();
     markers.push_back(marker);
 
 #if HAVE_NFT
@@ -1660,7 +2421,7 @@ bool ARController::addMarker(ARMarker *marker)
             logv(AR_LOG_LEVEL_INFO, "First NFT marker added; enabling NFT marker detection.");
 
         doNFTMarkerDetection = true;
-        if (trackingThreadHandle)
+        if (trackingThreadHandles[0])
         {
             unloadNFTData(); // loadNFTData() will be called on next update().
         }
@@ -1672,6 +2433,7 @@ bool ARController::addMarker(ARMarker *marker)
 #if HAVE_NFT
 }
 #endif
+    unlockDetection();
 
     logv(AR_LOG_LEVEL_INFO, "Added marker (UID=%d), total markers loaded: %d.", marker->UID, countMarkers());
     return true;
@@ -1700,17 +2462,20 @@ bool ARController::removeMarker(ARMarker *marker)
         return false;
     }
 
+    lockDetection();
+
     int                              UID      = marker->UID;
     std::vector<ARMarker*>::iterator position = std::find(markers.begin(), markers.end(), marker);
     bool                             found    = (position != markers.end());
     if (!found)
     {
+        unlockDetection();
         logv(AR_LOG_LEVEL_ERROR, "ARController::removeMarker(): Could not find marker (UID=%d), exiting, returning false", UID);
         return false;
     }
 
 #if HAVE_NFT
-    if (marker->type == ARMarker::NFT && trackingThreadHandle)
+    if (marker->type == ARMarker::NFT && trackingThreadHandles[0])
     {
         unloadNFTData(); // If at least 1 NFT marker remains, loadNFTData() will be called on next update().
     }
@@ -1760,6 +2525,7 @@ bool ARController::removeMarker(ARMarker *marker)
         doMarkerDetection = false;
     }
 #endif
+    unlockDetection();
 
     logv(AR_LOG_LEVEL_INFO, "Removed marker (UID=%d), now %d markers loaded", UID, markerCount);
     logv(AR_LOG_LEVEL_DEBUG, "ARController::removeMarker(): exiting, returning %s", ((found) ? "true" : "false"));
@@ -1768,10 +2534,12 @@ bool ARController::removeMarker(ARMarker *marker)
 
 int ARController::removeAllMarkers()
 {
+    lockDetection();
+
     unsigned int count = countMarkers();
 
 #if HAVE_NFT
-    if (trackingThreadHandle)
+    if (trackingThreadHandles[0])
     {
         unloadNFTData();
     }
@@ -1781,6 +2549,7 @@ int ARController::removeAllMarkers()
 #if HAVE_NFT
     doNFTMarkerDetection = false;
 #endif
+    unlockDetection();
     logv(AR_LOG_LEVEL_INFO, "Removed all %d markers.", count);
 
     return count;
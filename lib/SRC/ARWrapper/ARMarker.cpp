@@ -279,7 +279,7 @@ std::vector<ARMarker*> ARMarker::newFromConfigDataFile(const char *markersConfig
 // multi;data/multi/marker.dat
 // nft;data/nft/pinball
 
-ARMarker* ARMarker::newWithConfig(const char *cfg, ARPattHandle *arPattHandle)
+ARMarker* ARMarker::newWithConfig(const char *cfg, ARPattHandle *arPattHandle, bool deferNFTData)
 {
     ARMarker *markerRet = NULL;
 
@@ -407,7 +407,7 @@ ARMarker* ARMarker::newWithConfig(const char *cfg, ARPattHandle *arPattHandle)
             if (char *config = strtok(NULL, ";"))
             {
                 markerRet = new ARMarkerNFT();
-                if (!((ARMarkerNFT*)markerRet)->load(config))
+                if (!((ARMarkerNFT*)markerRet)->load(config, deferNFTData))
                 {
                     // Marker failed to load, or was not added
                     delete markerRet;
@@ -430,6 +430,58 @@ ARMarker* ARMarker::newWithConfig(const char *cfg, ARPattHandle *arPattHandle)
     return (markerRet);
 }
 
+ARMarker* ARMarker::newSharingData(ARMarker *marker)
+{
+    ARMarker *markerRet = NULL;
+
+    if (!marker)
+        return NULL;
+
+    if (marker->type == SINGLE)
+    {
+        markerRet = new ARMarkerSquare();
+        if (!((ARMarkerSquare*)markerRet)->initSharingData((ARMarkerSquare*)marker))
+        {
+            delete markerRet;
+            markerRet = NULL;
+        }
+    }
+    else if (marker->type == MULTI)
+    {
+        markerRet = new ARMarkerMulti();
+        if (!((ARMarkerMulti*)markerRet)->initSharingData((ARMarkerMulti*)marker))
+        {
+            delete markerRet;
+            markerRet = NULL;
+        }
+    }
+#if HAVE_NFT
+    else if (marker->type == NFT)
+    {
+        markerRet = new ARMarkerNFT();
+        if (!((ARMarkerNFT*)markerRet)->initSharingData((ARMarkerNFT*)marker))
+        {
+            delete markerRet;
+            markerRet = NULL;
+        }
+    }
+#endif // HAVE_NFT
+
+    if (!markerRet)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "Error: Unable to share data of marker %d.", marker->UID);
+        return NULL;
+    }
+
+    markerRet->UID = marker->UID;
+    markerRet->setPositionScalefactor(marker->positionScalefactor());
+    markerRet->setFilterSampleRate(marker->filterSampleRate());
+    markerRet->setFilterCutoffFrequency(marker->filterCutoffFrequency());
+    markerRet->setFiltered(marker->isFiltered());
+
+    return (markerRet);
+}
+
 ARMarker::ARMarker(MarkerType type) :
     m_ftmi(NULL),
     m_filterCutoffFrequency(AR_FILTER_TRANS_MAT_CUTOFF_FREQ_DEFAULT),
@@ -110,6 +110,29 @@ bool ARMarkerMulti::load(const char *multiConfig, ARPattHandle *arPattHandle)
     return true;
 }
 
+bool ARMarkerMulti::initSharingData(ARMarkerMulti *marker)
+{
+    if (!marker || !marker->config)
+        return false;
+
+    if (m_loaded)
+        unload();
+
+    // The configuration holds pose state, so each marker needs a copy of its own.
+    arMalloc(config, ARMultiMarkerInfoT, 1);
+    *config = *marker->config;
+    arMalloc(config->marker, ARMultiEachMarkerInfoT, config->marker_num);
+    memcpy(config->marker, marker->config->marker, sizeof(ARMultiEachMarkerInfoT) * config->marker_num);
+    config->prevF = 0;
+
+    robustFlag = marker->robustFlag;
+
+    visible = visiblePrev = false;
+
+    m_loaded = true;
+    return true;
+}
+
 bool ARMarkerMulti::unload()
 {
     if (m_loaded)
@@ -42,9 +42,11 @@
 
 ARMarkerNFT::ARMarkerNFT() : ARMarker(NFT),
     m_loaded(false),
+    m_sharedData(false),
     m_nftScale(1.0f),
     pageNo(-1),
-    datasetPathname(NULL)
+    datasetPathname(NULL),
+    surfaceSet(NULL)
 {}
 
 ARMarkerNFT::~ARMarkerNFT()
@@ -53,13 +55,28 @@ ARMarkerNFT::~ARMarkerNFT()
         unload();
 }
 
-bool ARMarkerNFT::load(const char *dataSetPathname_in)
+bool ARMarkerNFT::load(const char *dataSetPathname_in, bool deferAR2Data)
 {
     if (m_loaded)
         unload();
 
     visible = visiblePrev = false;
 
+    // If the AR2 data will be read later, just get the page size from the image set header.
+    int   xsize, ysize;
+    float dpi;
+    if (deferAR2Data && ar2ReadImageSetInfo((char*)dataSetPathname_in, &xsize, &ysize, &dpi) == 0)
+    {
+        datasetPathname = strdup(dataSetPathname_in);
+
+        allocatePatterns(1);
+        patterns[0]->loadISetSize(xsize, ysize, dpi, m_nftScale);
+
+        m_loaded = true;
+
+        return true;
+    }
+
     // Load AR2 data.
     ARController::logv("Loading %s.fset.", dataSetPathname_in);
     if ((surfaceSet = ar2ReadSurfaceSet(dataSetPathname_in, "fset", NULL)) == NULL)
@@ -78,6 +95,33 @@ bool ARMarkerNFT::load(const char *dataSetPathname_in)
     return true;
 }
 
+bool ARMarkerNFT::initSharingData(ARMarkerNFT *marker)
+{
+    if (!marker || !marker->surfaceSet)
+        return false;
+
+    if (m_loaded)
+        unload();
+
+    visible = visiblePrev = false;
+
+    if ((surfaceSet = ar2ShareSurfaceSet(marker->surfaceSet)) == NULL)
+    {
+        ARController::logv("Error sharing data of %s.fset", marker->datasetPathname);
+        return (false);
+    }
+
+    m_sharedData    = true;
+    datasetPathname = strdup(marker->datasetPathname);
+    pageNo          = marker->pageNo;
+    robustFlag      = marker->robustFlag;
+    m_nftScale      = marker->m_nftScale;
+
+    m_loaded = true;
+
+    return true;
+}
+
 bool ARMarkerNFT::unload()
 {
     if (m_loaded)
@@ -86,8 +130,16 @@ bool ARMarkerNFT::unload()
         pageNo = -1;
         if (surfaceSet)
         {
-            ARController::logv("Unloading %s.fset.", datasetPathname);
-            ar2FreeSurfaceSet(&surfaceSet); // Sets surfaceSet to NULL.
+            if (m_sharedData)
+            {
+                ar2FreeSharedSurfaceSet(&surfaceSet); // Sets surfaceSet to NULL.
+                m_sharedData = false;
+            }
+            else
+            {
+                ARController::logv("Unloading %s.fset.", datasetPathname);
+                ar2FreeSurfaceSet(&surfaceSet); // Sets surfaceSet to NULL.
+            }
         }
 
         if (datasetPathname)
@@ -130,8 +182,18 @@ bool ARMarkerNFT::updateWithNFTResults(int detectedPage, float trackingTrans[3][
 
 void ARMarkerNFT::setNFTScale(const float scale)
 {
+    if (surfaceSet)
+    {
+        patterns[0]->loadISet(surfaceSet->surface[0].imageSet, scale);
+    }
+    else if (m_nftScale != 0.0f)
+    {
+        // AR2 data has been freed by the page residency manager, so rescale the existing size.
+        patterns[0]->m_width  *= scale / m_nftScale;
+        patterns[0]->m_height *= scale / m_nftScale;
+    }
+
     m_nftScale = scale;
-    patterns[0]->loadISet(surfaceSet->surface[0].imageSet, m_nftScale);
 }
 
 float ARMarkerNFT::getNFTScale()
@@ -171,6 +171,27 @@ bool ARMarkerSquare::initWithBarcode(int barcodeID, ARdouble width)
     return true;
 }
 
+bool ARMarkerSquare::initSharingData(ARMarkerSquare *marker)
+{
+    if (!marker || marker->patt_id < 0)
+        return false;
+
+    if (m_loaded)
+        unload();
+
+    m_arPattHandle        = NULL;   // Pattern is freed by the marker which loaded it.
+    patt_id               = marker->patt_id;
+    patt_type             = marker->patt_type;
+    m_width               = marker->m_width;
+    m_cfMin               = marker->m_cfMin;
+    useContPoseEstimation = marker->useContPoseEstimation;
+
+    visible = visiblePrev = false;
+
+    m_loaded = true;
+    return true;
+}
+
 ARdouble ARMarkerSquare::getConfidence()
 {
     return (m_cf);
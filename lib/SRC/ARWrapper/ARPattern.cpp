@@ -129,12 +129,19 @@ bool ARPattern::loadISet(const AR2ImageSetT *imageSet, float nftScale)
     if (imageSet && imageSet->scale)
     {
         AR2ImageT *image = imageSet->scale[0]; // Assume best scale (largest image) is first entry in array scale[index] (index is in range [0, imageSet->num - 1]).
-        m_width  = image->xsize * 25.4f / image->dpi * nftScale;
-        m_height = image->ysize * 25.4f / image->dpi * nftScale;
+        loadISetSize(image->xsize, image->ysize, image->dpi, nftScale);
     }
 
     return true;
 }
+
+bool ARPattern::loadISetSize(int xsize, int ysize, float dpi, float nftScale)
+{
+    m_width  = xsize * 25.4f / dpi * nftScale;
+    m_height = ysize * 25.4f / dpi * nftScale;
+
+    return true;
+}
 #endif
 
 void ARPattern::freeImage()
@@ -666,6 +666,70 @@ EXPORT_API bool arwGetNFTMultiMode()
     return gARTK->getNFTMultiMode();
 }
 
+EXPORT_API void arwSetNFTMemoryBudget(int megabytes)
+{
+    if (!gARTK)
+        return;
+
+    gARTK->setNFTMemoryBudget(megabytes);
+}
+
+EXPORT_API int arwGetNFTMemoryBudget()
+{
+    if (!gARTK)
+        return 0;
+
+    return gARTK->getNFTMemoryBudget();
+}
+
+EXPORT_API void arwSetNFTRecognitionThreads(int threads)
+{
+    if (!gARTK)
+        return;
+
+    gARTK->setNFTRecognitionThreads(threads);
+}
+
+EXPORT_API int arwGetNFTRecognitionThreads()
+{
+    if (!gARTK)
+        return 0;
+
+    return gARTK->getNFTRecognitionThreads();
+}
+
+EXPORT_API void arwSetNFTRecognitionMaxAge(int frames)
+{
+    if (!gARTK)
+        return;
+
+    gARTK->setNFTRecognitionMaxAge(frames);
+}
+
+EXPORT_API int arwGetNFTRecognitionMaxAge()
+{
+    if (!gARTK)
+        return 0;
+
+    return gARTK->getNFTRecognitionMaxAge();
+}
+
+EXPORT_API void arwSetPipelined(bool on)
+{
+    if (!gARTK)
+        return;
+
+    gARTK->setPipelined(on);
+}
+
+EXPORT_API bool arwGetPipelined()
+{
+    if (!gARTK)
+        return false;
+
+    return gARTK->getPipelined();
+}
+
 
 // ----------------------------------------------------------------------------------------------------
 #pragma mark  Marker management
@@ -708,12 +772,14 @@ EXPORT_API bool arwQueryMarkerVisibility(int markerUID)
         return false;
     }
 
-    return marker->visible;
+    return gARTK->getMarkerState(marker, NULL, NULL);
 }
 
 EXPORT_API bool arwQueryMarkerTransformation(int markerUID, float matrix[16])
 {
     ARMarker *marker;
+    ARdouble m[16] = {0};
+    bool     visible;
 
     if (!gARTK)
         return false;
@@ -724,15 +790,20 @@ EXPORT_API bool arwQueryMarkerTransformation(int markerUID, float matrix[16])
         return false;
     }
 
+    visible = gARTK->getMarkerState(marker, m, NULL);
+
     for (int i = 0; i < 16; i++)
-        matrix[i] = (float)marker->transformationMatrix[i];
+        matrix[i] = (float)m[i];
 
-    return marker->visible;
+    return visible;
 }
 
 EXPORT_API bool arwQueryMarkerTransformationStereo(int markerUID, float matrixL[16], float matrixR[16])
 {
     ARMarker *marker;
+    ARdouble mL[16] = {0};
+    ARdouble mR[16] = {0};
+    bool     visible;
 
     if (!gARTK)
         return false;
@@ -743,13 +814,15 @@ EXPORT_API bool arwQueryMarkerTransformationStereo(int markerUID, float matrixL[
         return false;
     }
 
+    visible = gARTK->getMarkerState(marker, mL, mR);
+
     for (int i = 0; i < 16; i++)
-        matrixL[i] = (float)marker->transformationMatrix[i];
+        matrixL[i] = (float)mL[i];
 
     for (int i = 0; i < 16; i++)
-        matrixR[i] = (float)marker->transformationMatrixR[i];
+        matrixR[i] = (float)mR[i];
 
-    return marker->visible;
+    return visible;
 }
 
 // ----------------------------------------------------------------------------------------------------
@@ -892,6 +965,8 @@ EXPORT_API void arwSetMarkerOptionBool(int markerUID, int option, bool value)
         return;
     }
 
+    // In pipelined mode, the detection thread reads the marker's settings.
+    gARTK->lockDetection();
     switch (option)
     {
     case ARW_MARKER_OPTION_FILTERED:
@@ -908,6 +983,7 @@ EXPORT_API void arwSetMarkerOptionBool(int markerUID, int option, bool value)
         gARTK->logv(AR_LOG_LEVEL_ERROR, "arwSetMarkerOptionBool(): Unrecognised option %d.", option);
         break;
     }
+    gARTK->unlockDetection();
 }
 
 EXPORT_API int arwGetMarkerOptionInt(int markerUID, int option)
@@ -952,6 +1028,7 @@ EXPORT_API void arwSetMarkerOptionInt(int markerUID, int option, int value)
         return;
     }
 
+    gARTK->lockDetection();
     switch (option)
     {
     case ARW_MARKER_OPTION_MULTI_MIN_SUBMARKERS:
@@ -964,6 +1041,7 @@ EXPORT_API void arwSetMarkerOptionInt(int markerUID, int option, int value)
         gARTK->logv(AR_LOG_LEVEL_ERROR, "arwSetMarkerOptionInt(): Unrecognised option %d.", option);
         break;
     }
+    gARTK->unlockDetection();
 }
 
 EXPORT_API float arwGetMarkerOptionFloat(int markerUID, int option)
@@ -1054,6 +1132,7 @@ EXPORT_API void arwSetMarkerOptionFloat(int markerUID, int option, float value)
         return;
     }
 
+    gARTK->lockDetection();
     switch (option)
     {
     case ARW_MARKER_OPTION_FILTER_SAMPLE_RATE:
@@ -1093,6 +1172,7 @@ EXPORT_API void arwSetMarkerOptionFloat(int markerUID, int option, float value)
         gARTK->logv(AR_LOG_LEVEL_ERROR, "arwSetMarkerOptionFloat(): Unrecognised option %d.", option);
         break;
     }
+    gARTK->unlockDetection();
 }
 
 // ----------------------------------------------------------------------------------------------------
@@ -1189,6 +1269,14 @@ JNIEXPORT void JNICALL        JNIFUNCTION(arwSetImageProcMode(JNIEnv * env, jobj
 JNIEXPORT jint JNICALL        JNIFUNCTION(arwGetImageProcMode(JNIEnv * env, jobject obj));
 JNIEXPORT void JNICALL        JNIFUNCTION(arwSetNFTMultiMode(JNIEnv * env, jobject obj, jboolean on));
 JNIEXPORT jboolean JNICALL    JNIFUNCTION(arwGetNFTMultiMode(JNIEnv * env, jobject obj));
+JNIEXPORT void JNICALL        JNIFUNCTION(arwSetNFTMemoryBudget(JNIEnv * env, jobject obj, jint megabytes));
+JNIEXPORT jint JNICALL        JNIFUNCTION(arwGetNFTMemoryBudget(JNIEnv * env, jobject obj));
+JNIEXPORT void JNICALL        JNIFUNCTION(arwSetNFTRecognitionThreads(JNIEnv * env, jobject obj, jint threads));
+JNIEXPORT jint JNICALL        JNIFUNCTION(arwGetNFTRecognitionThreads(JNIEnv * env, jobject obj));
+JNIEXPORT void JNICALL        JNIFUNCTION(arwSetNFTRecognitionMaxAge(JNIEnv * env, jobject obj, jint frames));
+JNIEXPORT jint JNICALL        JNIFUNCTION(arwGetNFTRecognitionMaxAge(JNIEnv * env, jobject obj));
+JNIEXPORT void JNICALL        JNIFUNCTION(arwSetPipelined(JNIEnv * env, jobject obj, jboolean on));
+JNIEXPORT jboolean JNICALL    JNIFUNCTION(arwGetPipelined(JNIEnv * env, jobject obj));
 
 JNIEXPORT void JNICALL     JNIFUNCTION(arwSetMarkerOptionBool(JNIEnv * env, jobject obj, jint markerUID, jint option, jboolean value));
 JNIEXPORT void JNICALL     JNIFUNCTION(arwSetMarkerOptionInt(JNIEnv * env, jobject obj, jint markerUID, jint option, jint value));
@@ -1552,6 +1640,46 @@ JNIEXPORT jboolean JNICALL JNIFUNCTION(arwGetNFTMultiMode(JNIEnv * env, jobject
     return arwGetNFTMultiMode();
 }
 
+JNIEXPORT void JNICALL JNIFUNCTION(arwSetNFTMemoryBudget(JNIEnv * env, jobject obj, jint megabytes))
+{
+    arwSetNFTMemoryBudget(megabytes);
+}
+
+JNIEXPORT jint JNICALL JNIFUNCTION(arwGetNFTMemoryBudget(JNIEnv * env, jobject obj))
+{
+    return arwGetNFTMemoryBudget();
+}
+
+JNIEXPORT void JNICALL JNIFUNCTION(arwSetNFTRecognitionThreads(JNIEnv * env, jobject obj, jint threads))
+{
+    arwSetNFTRecognitionThreads(threads);
+}
+
+JNIEXPORT jint JNICALL JNIFUNCTION(arwGetNFTRecognitionThreads(JNIEnv * env, jobject obj))
+{
+    return arwGetNFTRecognitionThreads();
+}
+
+JNIEXPORT void JNICALL JNIFUNCTION(arwSetNFTRecognitionMaxAge(JNIEnv * env, jobject obj, jint frames))
+{
+    arwSetNFTRecognitionMaxAge(frames);
+}
+
+JNIEXPORT jint JNICALL JNIFUNCTION(arwGetNFTRecognitionMaxAge(JNIEnv * env, jobject obj))
+{
+    return arwGetNFTRecognitionMaxAge();
+}
+
+JNIEXPORT void JNICALL JNIFUNCTION(arwSetPipelined(JNIEnv * env, jobject obj, jboolean on))
+{
+    arwSetPipelined(on);
+}
+
+JNIEXPORT jboolean JNICALL JNIFUNCTION(arwGetPipelined(JNIEnv * env, jobject obj))
+{
+    return arwGetPipelined();
+}
+
 JNIEXPORT void JNICALL JNIFUNCTION(arwSetMarkerOptionInt(JNIEnv * env, jobject obj, jint markerUID, jint option, jint value))
 {
     return arwSetMarkerOptionInt(markerUID, option, value);
@@ -0,0 +1,933 @@
+/*
+ *  ARTrackingServer.cpp
+ *  ARToolKit5
+ *
+ *  Tracks a common set of markers in the video streams of many cameras in one process.
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *
+ */
+
+#include <ARWrapper/ARTrackingServer.h>
+
+#include <chrono>
+
+// Milliseconds on a clock which is not affected by changes to the system time.
+static double timeNow()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct ARTrackingServer::Camera
+{
+    struct MarkerState
+    {
+        int      UID;
+        bool     visible;
+        ARdouble transformationMatrix[16];
+    };
+
+    char                   *vconf;
+    char                   *cparaName;
+    VideoSource            *videoSource;
+    bool                   initialised;         ///< The handles below have been created for the video source's frame size and camera parameters.
+    bool                   initFailed;
+    ARHandle               *arHandle;
+    AR3DHandle             *ar3DHandle;
+    std::vector<ARMarker*> markers;             ///< This camera's counterparts of the server's markers, in the same order.
+    bool                   busy;                ///< A thread is processing a frame. Guarded by m_scheduleLock.
+#if HAVE_NFT
+    AR2HandleT             *ar2Handle;
+    KpmHandle              *kpmHandle;
+    AR2SurfaceSetT         *surfaceSet[PAGES_MAX]; ///< Weak references to the surface sets of this camera's NFT markers, by page.
+    ARUint8                *kpmImage;           ///< Copy of the frame most recently passed to NFT recognition.
+    int                    kpmImageSize;        ///< Bytes per image.
+    // Guarded by m_scheduleLock.
+    bool                   kpmPending;          ///< Recognition has been requested in kpmImage, but no thread has taken it yet.
+    bool                   kpmRunning;
+    bool                   kpmResultReady;
+    int                    kpmPage;             ///< Page recognised, or -1 if none.
+    float                  kpmTrans[3][4];
+    double                 kpmRequestTime;
+#endif
+    pthread_mutex_t          resultLock;        ///< Guards the results and stats below.
+    std::vector<MarkerState> states;
+    CameraStats              stats;
+    double                   latencySum;
+    double                   recognitionLatencySum;
+    double                   firstFrameTime;
+    double                   lastFrameTime;
+
+    Camera() :
+        vconf(NULL),
+        cparaName(NULL),
+        videoSource(NULL),
+        initialised(false),
+        initFailed(false),
+        arHandle(NULL),
+        ar3DHandle(NULL),
+        busy(false)
+#if HAVE_NFT
+        ,
+        ar2Handle(NULL),
+        kpmHandle(NULL),
+        kpmImage(NULL),
+        kpmImageSize(0),
+        kpmPending(false),
+        kpmRunning(false),
+        kpmResultReady(false),
+        kpmPage(-1),
+        kpmRequestTime(0.0)
+#endif
+    {
+        pthread_mutex_init(&resultLock, NULL);
+        resetStats();
+    }
+
+    ~Camera()
+    {
+        pthread_mutex_destroy(&resultLock);
+        free(vconf);
+        free(cparaName);
+    }
+
+    void resetStats()
+    {
+        memset(&stats, 0, sizeof(stats));
+        latencySum            = 0.0;
+        recognitionLatencySum = 0.0;
+        firstFrameTime        = 0.0;
+        lastFrameTime         = 0.0;
+    }
+};
+
+ARTrackingServer::ARTrackingServer() :
+    m_arPattHandle(NULL),
+    m_patternDetectionMode(AR_DEFAULT_PATTERN_DETECTION_MODE),
+    m_matrixCodeType(AR_MATRIX_CODE_TYPE_DEFAULT),
+    m_doMarkerDetection(false),
+#if HAVE_NFT
+    m_doNFTMarkerDetection(false),
+    m_nftMultiMode(false),
+    m_nftPageCount(0),
+    m_nftMapped(false),
+    m_kpmRefDataSet(NULL),
+#endif
+    m_running(false),
+    m_workerQuit(false),
+    m_nextCamera(0),
+    m_recognitionJobs(0),
+    m_recognitionJobsMax(1)
+{
+    pthread_mutex_init(&m_scheduleLock, NULL);
+
+    if ((m_arPattHandle = arPattCreateHandle2(AR_PATT_SIZE1, AR_PATT_NUM_MAX)) == NULL)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer: Error: arPattCreateHandle2.");
+    }
+}
+
+ARTrackingServer::~ARTrackingServer()
+{
+    stop();
+
+    for (std::vector<Camera*>::iterator it = m_cameras.begin(); it != m_cameras.end(); ++it)
+        delete *it;
+
+    m_cameras.clear();
+
+    for (std::vector<ARMarker*>::iterator it = m_markers.begin(); it != m_markers.end(); ++it)
+        delete *it;
+
+    m_markers.clear();
+
+    if (m_arPattHandle)
+        arPattDeleteHandle(m_arPattHandle);
+
+    pthread_mutex_destroy(&m_scheduleLock);
+}
+
+int ARTrackingServer::addMarker(const char *cfg)
+{
+    if (m_running)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::addMarker(): Error: markers cannot be added while running.");
+        return -1;
+    }
+
+    if (!m_arPattHandle)
+        return -1;
+
+    ARMarker *marker = ARMarker::newWithConfig(cfg, m_arPattHandle);
+    if (!marker)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::addMarker(): Error: Failed to load marker.");
+        return -1;
+    }
+
+    m_markers.push_back(marker);
+#if HAVE_NFT
+    if (marker->type == ARMarker::NFT)
+        m_doNFTMarkerDetection = true;
+    else
+#endif
+    m_doMarkerDetection = true;
+
+    ARController::logv(AR_LOG_LEVEL_INFO, "ARTrackingServer: Added marker (UID=%d), total markers loaded: %d.", marker->UID, (int)m_markers.size());
+    return marker->UID;
+}
+
+int ARTrackingServer::addCamera(const char *vconf, const char *cparaName)
+{
+    if (m_running)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::addCamera(): Error: cameras cannot be added while running.");
+        return -1;
+    }
+
+    Camera *camera = new Camera();
+    camera->vconf     = (vconf ? strdup(vconf) : NULL);
+    camera->cparaName = (cparaName ? strdup(cparaName) : NULL);
+    m_cameras.push_back(camera);
+
+    return ((int)m_cameras.size() - 1);
+}
+
+int ARTrackingServer::cameraCount()
+{
+    return ((int)m_cameras.size());
+}
+
+void ARTrackingServer::setPatternDetectionMode(int mode)
+{
+    m_patternDetectionMode = mode;
+}
+
+void ARTrackingServer::setMatrixCodeType(AR_MATRIX_CODE_TYPE type)
+{
+    m_matrixCodeType = type;
+}
+
+void ARTrackingServer::setNFTMultiMode(bool on)
+{
+#if HAVE_NFT
+    m_nftMultiMode = on;
+#endif
+}
+
+bool ARTrackingServer::isRunning()
+{
+    return m_running;
+}
+
+bool ARTrackingServer::start(int workerThreads)
+{
+    int threads;
+
+    if (m_running)
+        return true;
+
+    if (m_cameras.empty())
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::start(): Error: no cameras.");
+        return false;
+    }
+
+#if HAVE_NFT
+    if (m_doNFTMarkerDetection && !loadNFTData())
+        return false;
+#endif
+
+    for (size_t i = 0; i < m_cameras.size(); i++)
+    {
+        Camera *camera = m_cameras[i];
+
+        for (size_t j = 0; j < m_markers.size(); j++)
+        {
+            ARMarker *marker = ARMarker::newSharingData(m_markers[j]);
+            if (!marker)
+                goto bail;
+
+            camera->markers.push_back(marker);
+        }
+
+        camera->states.resize(m_markers.size());
+        for (size_t j = 0; j < m_markers.size(); j++)
+        {
+            camera->states[j].UID     = m_markers[j]->UID;
+            camera->states[j].visible = false;
+        }
+
+        camera->resetStats();
+
+        camera->videoSource = VideoSource::newVideoSource();
+        camera->videoSource->configure(camera->vconf, camera->cparaName, NULL, 0);
+        if (!camera->videoSource->open())
+        {
+            ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::start(): Error: unable to open video source for camera %d.", (int)i);
+            goto bail;
+        }
+    }
+
+    threads = (workerThreads > 0 ? workerThreads : threadGetCPU());
+    if (threads < 1)
+        threads = 1;
+
+    m_recognitionJobsMax = (threads > 1 ? threads / 2 : 1);
+    m_recognitionJobs    = 0;
+    m_nextCamera         = 0;
+    m_workerQuit         = false;
+
+    // Each thread is started as soon as it exists, so that stop() can always wait for it.
+    for (int i = 0; i < threads; i++)
+    {
+        THREAD_HANDLE_T *threadHandle = threadInit(i, this, workerMain);
+        if (!threadHandle)
+        {
+            ARController::logv(AR_LOG_LEVEL_WARN, "ARTrackingServer::start(): Unable to start worker thread; using %d threads.", i);
+            break;
+        }
+
+        threadStartSignal(threadHandle);
+        m_workerThreadHandles.push_back(threadHandle);
+    }
+
+    if (m_workerThreadHandles.empty())
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::start(): Error: unable to start any worker threads.");
+        goto bail;
+    }
+
+    ARController::logv(AR_LOG_LEVEL_INFO, "ARTrackingServer: Started %d cameras on %d threads.", (int)m_cameras.size(), (int)m_workerThreadHandles.size());
+    m_running = true;
+    return true;
+
+bail:
+    for (std::vector<Camera*>::iterator it = m_cameras.begin(); it != m_cameras.end(); ++it)
+        finalCamera(*it);
+
+#if HAVE_NFT
+    unloadNFTData();
+#endif
+    return false;
+}
+
+void ARTrackingServer::stop()
+{
+    if (!m_running)
+        return;
+
+    m_workerQuit = true;
+    for (std::vector<THREAD_HANDLE_T*>::iterator it = m_workerThreadHandles.begin(); it != m_workerThreadHandles.end(); ++it)
+    {
+        threadEndWait(*it);
+        threadWaitQuit(*it);
+        threadFree(&(*it));
+    }
+
+    m_workerThreadHandles.clear();
+
+    for (std::vector<Camera*>::iterator it = m_cameras.begin(); it != m_cameras.end(); ++it)
+        finalCamera(*it);
+
+#if HAVE_NFT
+    unloadNFTData();
+#endif
+
+    m_running = false;
+    ARController::logv(AR_LOG_LEVEL_INFO, "ARTrackingServer: Stopped.");
+}
+
+bool ARTrackingServer::getMarkerState(int camera, int UID, ARdouble matrix[16])
+{
+    bool visible = false;
+
+    if (camera < 0 || camera >= (int)m_cameras.size())
+        return false;
+
+    Camera *c = m_cameras[camera];
+    pthread_mutex_lock(&c->resultLock);
+    for (size_t i = 0; i < c->states.size(); i++)
+    {
+        if (c->states[i].UID == UID)
+        {
+            visible = c->states[i].visible;
+            if (visible && matrix)
+                memcpy(matrix, c->states[i].transformationMatrix, sizeof(ARdouble) * 16);
+
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&c->resultLock);
+
+    return visible;
+}
+
+bool ARTrackingServer::getCameraStats(int camera, CameraStats *stats)
+{
+    if (camera < 0 || camera >= (int)m_cameras.size() || !stats)
+        return false;
+
+    Camera *c = m_cameras[camera];
+    pthread_mutex_lock(&c->resultLock);
+    *stats = c->stats;
+    if (c->stats.framesProcessed > 0)
+        stats->latencyMean = c->latencySum / c->stats.framesProcessed;
+
+    if (c->stats.framesProcessed > 1)
+        stats->frameIntervalMean = (c->lastFrameTime - c->firstFrameTime) / (c->stats.framesProcessed - 1);
+
+    if (c->stats.recognitionQueries > 0)
+        stats->recognitionLatencyMean = c->recognitionLatencySum / c->stats.recognitionQueries;
+
+    pthread_mutex_unlock(&c->resultLock);
+
+    return true;
+}
+
+#if HAVE_NFT
+// private
+bool ARTrackingServer::loadNFTData()
+{
+    KpmRefDataSet *refDataSet = NULL;
+
+    m_nftPageCount = 0;
+
+    // If every dataset has been saved in the indexed format, each camera's KPM handle maps the files,
+    // so that there is one copy of the database in memory however many cameras there are.
+    m_nftMapped = true;
+    for (std::vector<ARMarker*>::iterator it = m_markers.begin(); it != m_markers.end(); ++it)
+    {
+        if ((*it)->type == ARMarker::NFT && kpmRefDataSetFileIsIndexed(((ARMarkerNFT*)(*it))->datasetPathname, "fset3") != 1)
+        {
+            m_nftMapped = false;
+            ARController::logv(AR_LOG_LEVEL_WARN, "ARTrackingServer: %s.fset3 is not indexed, so the KPM database will be copied for each camera.", ((ARMarkerNFT*)(*it))->datasetPathname);
+            break;
+        }
+    }
+
+    for (std::vector<ARMarker*>::iterator it = m_markers.begin(); it != m_markers.end(); ++it)
+    {
+        if ((*it)->type != ARMarker::NFT)
+            continue;
+
+        ARMarkerNFT *marker = (ARMarkerNFT*)(*it);
+        if (m_nftPageCount == PAGES_MAX)
+        {
+            ARController::logv(AR_LOG_LEVEL_ERROR, "Maximum number of NFT pages (%d) loaded", PAGES_MAX);
+            marker->pageNo = -1;
+            continue;
+        }
+
+        if (m_nftMapped)
+        {
+            m_nftFilenames[m_nftPageCount] = marker->datasetPathname;
+            m_nftPageNos[m_nftPageCount]   = m_nftPageCount;
+        }
+        else
+        {
+            KpmRefDataSet *refDataSet2;
+            ARController::logv(AR_LOG_LEVEL_INFO, "Reading %s.fset3", marker->datasetPathname);
+            if (kpmLoadRefDataSet(marker->datasetPathname, "fset3", &refDataSet2) < 0)
+            {
+                ARController::logv(AR_LOG_LEVEL_ERROR, "Error reading KPM data from %s.fset3", marker->datasetPathname);
+                marker->pageNo = -1;
+                continue;
+            }
+
+            if (kpmChangePageNoOfRefDataSet(refDataSet2, KpmChangePageNoAllPages, m_nftPageCount) < 0 || kpmMergeRefDataSet(&refDataSet, &refDataSet2) < 0)
+            {
+                ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::loadNFTData(): Error merging KPM data from %s.fset3", marker->datasetPathname);
+                kpmDeleteRefDataSet(&refDataSet2);
+                marker->pageNo = -1;
+                continue;
+            }
+        }
+
+        marker->pageNo = m_nftPageCount;
+        ARController::logv(AR_LOG_LEVEL_INFO, "%s assigned page no. %d.", marker->datasetPathname, m_nftPageCount);
+        m_nftPageCount++;
+    }
+
+    m_kpmRefDataSet = refDataSet;
+    return true;
+}
+
+// private
+void ARTrackingServer::unloadNFTData()
+{
+    if (m_kpmRefDataSet)
+        kpmDeleteRefDataSet(&m_kpmRefDataSet);
+
+    m_nftPageCount = 0;
+}
+#else  // !HAVE_NFT
+bool ARTrackingServer::loadNFTData()
+{
+    return true;
+}
+
+void ARTrackingServer::unloadNFTData()
+{}
+#endif // HAVE_NFT
+
+// private
+// Creates the camera's handles. Called on a worker thread once the camera has delivered its first frame, as
+// only then are its frame size and camera parameters known.
+bool ARTrackingServer::initCamera(Camera *camera)
+{
+    ARParamLT       *cparamLT  = camera->videoSource->getCameraParameters();
+    AR_PIXEL_FORMAT pixFormat  = camera->videoSource->getPixelFormat();
+
+    if (!cparamLT)
+        return false;
+
+    if ((camera->arHandle = arCreateHandle(cparamLT)) == NULL)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::initCamera(): Error: arCreateHandle()");
+        return false;
+    }
+
+    if (arSetPixelFormat(camera->arHandle, pixFormat) < 0)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::initCamera(): Error: arSetPixelFormat");
+        return false;
+    }
+
+    arPattAttach(camera->arHandle, m_arPattHandle);
+    arSetPatternDetectionMode(camera->arHandle, m_patternDetectionMode);
+    arSetMatrixCodeType(camera->arHandle, m_matrixCodeType);
+
+    if ((camera->ar3DHandle = ar3DCreateHandle(&cparamLT->param)) == NULL)
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::initCamera(): Error: ar3DCreateHandle");
+        return false;
+    }
+
+#if HAVE_NFT
+    if (m_nftPageCount > 0)
+    {
+        if ((camera->kpmHandle = kpmCreateHandle(cparamLT, pixFormat)) == NULL)
+        {
+            ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::initCamera(): Error: kpmCreateHandle");
+            return false;
+        }
+
+        if ((m_nftMapped ? kpmSetRefDataSetFilesMapped(camera->kpmHandle, m_nftFilenames, "fset3", m_nftPageNos, m_nftPageCount)
+             : kpmSetRefDataSet(camera->kpmHandle, m_kpmRefDataSet)) < 0)
+        {
+            ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::initCamera(): Error: unable to set KPM data");
+            return false;
+        }
+
+        // Parallelism comes from the worker threads, so each camera tracks on one thread of its own.
+        if ((camera->ar2Handle = ar2CreateHandle(cparamLT, pixFormat, 1)) == NULL)
+        {
+            ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer::initCamera(): Error: ar2CreateHandle");
+            return false;
+        }
+
+        ar2SetTrackingThresh(camera->ar2Handle, 5.0);
+        ar2SetSimThresh(camera->ar2Handle, 0.50);
+        ar2SetSearchFeatureNum(camera->ar2Handle, 16);
+        ar2SetSearchSize(camera->ar2Handle, 12);
+        ar2SetTemplateSize1(camera->ar2Handle, 6);
+        ar2SetTemplateSize2(camera->ar2Handle, 6);
+
+        camera->kpmImageSize = camera->videoSource->getVideoWidth() * camera->videoSource->getVideoHeight() * arUtilGetPixelSize(pixFormat);
+        if ((camera->kpmImage = (ARUint8*)malloc(camera->kpmImageSize)) == NULL)
+            return false;
+
+        for (int i = 0; i < PAGES_MAX; i++)
+            camera->surfaceSet[i] = NULL;
+
+        for (std::vector<ARMarker*>::iterator it = camera->markers.begin(); it != camera->markers.end(); ++it)
+        {
+            if ((*it)->type == ARMarker::NFT && ((ARMarkerNFT*)(*it))->pageNo >= 0)
+                camera->surfaceSet[((ARMarkerNFT*)(*it))->pageNo] = ((ARMarkerNFT*)(*it))->surfaceSet;
+        }
+    }
+#endif
+
+    camera->initialised = true;
+    return true;
+}
+
+// private
+// Closes the camera and frees everything created by start() and initCamera(). Only called while no thread is running.
+void ARTrackingServer::finalCamera(Camera *camera)
+{
+    if (camera->videoSource)
+    {
+        camera->videoSource->close();
+        delete camera->videoSource;
+        camera->videoSource = NULL;
+    }
+
+#if HAVE_NFT
+    if (camera->ar2Handle)
+        ar2DeleteHandle(&camera->ar2Handle);
+
+    if (camera->kpmHandle)
+        kpmDeleteHandle(&camera->kpmHandle);
+
+    free(camera->kpmImage);
+    camera->kpmImage = NULL;
+    camera->kpmPending     = false;
+    camera->kpmRunning     = false;
+    camera->kpmResultReady = false;
+#endif
+
+    if (camera->ar3DHandle)
+    {
+        ar3DDeleteHandle(&camera->ar3DHandle);
+        camera->ar3DHandle = NULL;
+    }
+
+    if (camera->arHandle)
+    {
+        arPattDetach(camera->arHandle);
+        arDeleteHandle(camera->arHandle);
+        camera->arHandle = NULL;
+    }
+
+    for (std::vector<ARMarker*>::iterator it = camera->markers.begin(); it != camera->markers.end(); ++it)
+        delete *it;
+
+    camera->markers.clear();
+
+    pthread_mutex_lock(&camera->resultLock);
+    camera->states.clear();
+    pthread_mutex_unlock(&camera->resultLock);
+
+    camera->initialised = false;
+    camera->initFailed  = false;
+    camera->busy        = false;
+}
+
+// private
+// Runs one job, if there is one: either a recognition query, or processing of the next camera which is not
+// already being processed.
+// Returns true if a job was done, false if there was nothing to do.
+bool ARTrackingServer::runJob()
+{
+    Camera *camera    = NULL;
+    int    cameraNum  = (int)m_cameras.size();
+#if HAVE_NFT
+    bool   recognition = false;
+#endif
+
+    pthread_mutex_lock(&m_scheduleLock);
+#if HAVE_NFT
+    if (m_recognitionJobs < m_recognitionJobsMax)
+    {
+        for (int i = 0; i < cameraNum; i++)
+        {
+            Camera *c = m_cameras[(m_nextCamera + i) % cameraNum];
+            if (c->kpmPending)
+            {
+                c->kpmPending = false;
+                c->kpmRunning = true;
+                m_recognitionJobs++;
+                camera      = c;
+                recognition = true;
+                break;
+            }
+        }
+    }
+#endif
+    if (!camera)
+    {
+        for (int i = 0; i < cameraNum; i++)
+        {
+            Camera *c = m_cameras[(m_nextCamera + i) % cameraNum];
+            if (!c->busy)
+            {
+                c->busy      = true;
+                camera       = c;
+                m_nextCamera = (m_nextCamera + i + 1) % cameraNum;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&m_scheduleLock);
+
+    if (!camera)
+        return false;
+
+#if HAVE_NFT
+    if (recognition)
+    {
+        recognise(camera);
+        return true;
+    }
+#endif
+
+    bool worked = processFrame(camera);
+
+    pthread_mutex_lock(&m_scheduleLock);
+    camera->busy = false;
+    pthread_mutex_unlock(&m_scheduleLock);
+
+    return worked;
+}
+
+// private
+// Detects and tracks markers in the camera's next frame, if it has one.
+// Returns true if a frame was processed.
+bool ARTrackingServer::processFrame(Camera *camera)
+{
+    if (camera->initFailed || !camera->videoSource->isRunning())
+        return false;
+
+    if (!camera->videoSource->captureFrame() || !camera->videoSource->getFrame())
+        return false;
+
+    double  frameTime = timeNow();
+    ARUint8 *image    = camera->videoSource->getFrame();
+
+    if (!camera->initialised && !initCamera(camera))
+    {
+        ARController::logv(AR_LOG_LEVEL_ERROR, "ARTrackingServer: Error initialising camera; it will not be processed.");
+        camera->initFailed = true;
+        return false;
+    }
+
+    if (m_doMarkerDetection)
+    {
+        ARMarkerInfo *markerInfo = NULL;
+        int          markerNum   = 0;
+
+        if (arDetectMarker(camera->arHandle, image) == 0)
+        {
+            markerInfo = arGetMarker(camera->arHandle);
+            markerNum  = arGetMarkerNum(camera->arHandle);
+        }
+
+        for (std::vector<ARMarker*>::iterator it = camera->markers.begin(); it != camera->markers.end(); ++it)
+        {
+            if ((*it)->type == ARMarker::SINGLE)
+                ((ARMarkerSquare*)(*it))->updateWithDetectedMarkers(markerInfo, markerNum, camera->ar3DHandle);
+            else if ((*it)->type == ARMarker::MULTI)
+                ((ARMarkerMulti*)(*it))->updateWithDetectedMarkers(markerInfo, markerNum, camera->ar3DHandle);
+        }
+    }
+
+#if HAVE_NFT
+    if (m_doNFTMarkerDetection && camera->kpmHandle)
+        trackNFT(camera, image, frameTime);
+#endif
+
+    double now = timeNow();
+
+    pthread_mutex_lock(&camera->resultLock);
+    for (size_t i = 0; i < camera->markers.size(); i++)
+    {
+        camera->states[i].visible = camera->markers[i]->visible;
+        if (camera->markers[i]->visible)
+            memcpy(camera->states[i].transformationMatrix, camera->markers[i]->transformationMatrix, sizeof(ARdouble) * 16);
+    }
+
+    if (camera->stats.framesProcessed == 0)
+        camera->firstFrameTime = frameTime;
+
+    camera->lastFrameTime = frameTime;
+    camera->stats.framesProcessed++;
+    camera->latencySum += now - frameTime;
+    if (now - frameTime > camera->stats.latencyMax)
+        camera->stats.latencyMax = now - frameTime;
+
+    pthread_mutex_unlock(&camera->resultLock);
+
+    return true;
+}
+
+#if HAVE_NFT
+// private
+// As in ARController::detect(), but with one recognition query at a time per camera, run as a job on the worker threads.
+void ARTrackingServer::trackNFT(Camera *camera, ARUint8 *image, double frameTime)
+{
+    bool  kpmFound = false;
+    int   kpmPage  = -1;
+    float kpmTrans[3][4];
+
+    pthread_mutex_lock(&m_scheduleLock);
+    if (camera->kpmResultReady)
+    {
+        camera->kpmResultReady = false;
+        if (camera->kpmPage >= 0 && camera->kpmPage < m_nftPageCount)
+        {
+            kpmFound = true;
+            kpmPage  = camera->kpmPage;
+            memcpy(kpmTrans, camera->kpmTrans, sizeof(kpmTrans));
+        }
+    }
+
+    pthread_mutex_unlock(&m_scheduleLock);
+
+    if (kpmFound && camera->surfaceSet[kpmPage] && camera->surfaceSet[kpmPage]->contNum < 1)
+        ar2SetInitTrans(camera->surfaceSet[kpmPage], kpmTrans);   // Sets surfaceSet[page]->contNum = 1.
+
+    // Do AR2 tracking of all pages being tracked in one pass, and update NFT markers.
+    AR2SurfaceSetT *trackingSurfaceSet[PAGES_MAX];
+    float          trackingTransMulti[PAGES_MAX][3][4];
+    float          trackingErr[PAGES_MAX];
+    int            trackingResult[PAGES_MAX];
+    int            trackingIndex[PAGES_MAX];
+    int            trackingNum  = 0;
+    int            pagesTracked = 0;
+
+    for (int page = 0; page < m_nftPageCount; page++)
+    {
+        trackingIndex[page] = -1;
+        if (camera->surfaceSet[page] && camera->surfaceSet[page]->contNum > 0)
+        {
+            trackingIndex[page]               = trackingNum;
+            trackingSurfaceSet[trackingNum++] = camera->surfaceSet[page];
+        }
+    }
+
+    if (trackingNum > 0)
+    {
+        if (ar2TrackingMulti(camera->ar2Handle, trackingSurfaceSet, trackingNum, image, trackingTransMulti, trackingErr, trackingResult) < 0)
+        {
+            for (int i = 0; i < trackingNum; i++)
+                trackingResult[i] = -1;
+        }
+    }
+
+    for (std::vector<ARMarker*>::iterator it = camera->markers.begin(); it != camera->markers.end(); ++it)
+    {
+        if ((*it)->type != ARMarker::NFT)
+            continue;
+
+        ARMarkerNFT *marker = (ARMarkerNFT*)(*it);
+        int         page    = marker->pageNo;
+        if (page >= 0 && trackingIndex[page] >= 0 && trackingResult[trackingIndex[page]] >= 0)
+        {
+            marker->updateWithNFTResults(page, trackingTransMulti[trackingIndex[page]]);
+            pagesTracked++;
+        }
+        else
+        {
+            marker->updateWithNFTResults(-1, NULL);
+        }
+    }
+
+    // Request recognition in this frame, unless a query is already waiting or running for this camera.
+    if (pagesTracked < (m_nftMultiMode ? m_nftPageCount : 1))
+    {
+        pthread_mutex_lock(&m_scheduleLock);
+        if (!camera->kpmPending && !camera->kpmRunning)
+        {
+            memcpy(camera->kpmImage, image, camera->kpmImageSize);
+            camera->kpmRequestTime = frameTime;
+            camera->kpmPending     = true;
+        }
+
+        pthread_mutex_unlock(&m_scheduleLock);
+    }
+}
+
+// private
+// Runs the camera's pending recognition query. Tracking of the camera's later frames continues on other threads meanwhile.
+void ARTrackingServer::recognise(Camera *camera)
+{
+    KpmResult *kpmResult    = NULL;
+    int       kpmResultNum  = 0;
+    int       page          = -1;
+    float     trans[3][4];
+    float     err           = 0.0f;
+
+    kpmMatching(camera->kpmHandle, camera->kpmImage);
+    kpmGetResult(camera->kpmHandle, &kpmResult, &kpmResultNum);
+
+    for (int i = 0; i < kpmResultNum; i++)
+    {
+        if (kpmResult[i].camPoseF != 0)
+            continue;
+
+        if (page < 0 || err > kpmResult[i].error)    // Take the first or best result.
+        {
+            page = kpmResult[i].pageNo;
+            memcpy(trans, kpmResult[i].camPose, sizeof(trans));
+            err = kpmResult[i].error;
+        }
+    }
+
+    // Once kpmRunning is cleared, the next request may overwrite kpmRequestTime.
+    double latency = timeNow() - camera->kpmRequestTime;
+
+    pthread_mutex_lock(&m_scheduleLock);
+    camera->kpmPage = page;
+    if (page >= 0)
+        memcpy(camera->kpmTrans, trans, sizeof(trans));
+
+    camera->kpmResultReady = true;
+    camera->kpmRunning     = false;
+    m_recognitionJobs--;
+    pthread_mutex_unlock(&m_scheduleLock);
+
+    pthread_mutex_lock(&camera->resultLock);
+    camera->stats.recognitionQueries++;
+    camera->recognitionLatencySum += latency;
+    pthread_mutex_unlock(&camera->resultLock);
+}
+#endif // HAVE_NFT
+
+// private, static
+void* ARTrackingServer::workerMain(THREAD_HANDLE_T *threadHandle)
+{
+    ARTrackingServer *server = (ARTrackingServer*)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0)
+    {
+        int idle = 0;
+
+        // Sleep only once every camera has been found to have no new frame.
+        while (!server->m_workerQuit)
+        {
+            if (server->runJob())
+            {
+                idle = 0;
+            }
+            else if (++idle >= (int)server->m_cameras.size())
+            {
+                arUtilSleep(1);
+                idle = 0;
+            }
+        }
+
+        threadEndSignal(threadHandle);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,388 @@
+/*
+ *  pageResidency.c
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *  Copyright 2010-2015 ARToolworks, Inc.
+ *
+ *  Author(s): Philip Lamb
+ *
+ */
+
+#include "pageResidency.h"
+
+#if HAVE_NFT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A newly read page is not freed for this many frames, so that recognition has time to find it
+// again and tracking to start. Without this, a tight budget could free it in the frame it arrives.
+#define PAGE_RESIDENCY_NEW_PAGE_FRAMES 30
+
+typedef struct
+{
+    char           *datasetPathname;
+    AR2SurfaceSetT **surfaceSet_p;          // Caller-owned location of the page's surface set. NULL when not resident.
+    unsigned long  lastUsed;                // Frame in which the page was last requested or read.
+    unsigned long  loadedFrame;             // Frame in which the page was read.
+    int            requested;               // Waiting to be read.
+    int            failed;                  // Reading failed, don't try again.
+} PageResidencyPage;
+
+struct _PageResidencyHandle
+{
+    PageResidencyPage *page;
+    int               pageNum;
+    size_t            memoryBudget;
+    size_t            memoryUsed;
+    unsigned long     frame;
+    THREAD_HANDLE_T   *threadHandle;
+    int               loadPage;             // Page being read by the loader thread, or -1.
+    AR2SurfaceSetT    *loadResult;          // Written by the loader thread.
+};
+
+static void* pageResidencyMain(THREAD_HANDLE_T *threadHandle);
+static size_t pageResidencyGetMemoryUsed(const PageResidencyHandle *handle);
+static size_t surfaceSetGetSize(const AR2SurfaceSetT *surfaceSet);
+static size_t imageSetGetSize(const AR2ImageSetT *imageSet);
+
+
+PageResidencyHandle* pageResidencyInit(int pageNum, size_t memoryBudget)
+{
+    PageResidencyHandle *handle;
+
+    if (pageNum <= 0)
+    {
+        ARLOGe("pageResidencyInit(): Error: invalid pageNum %d.\n", pageNum);
+        return (NULL);
+    }
+
+    arMallocClear(handle, PageResidencyHandle, 1);
+    arMallocClear(handle->page, PageResidencyPage, pageNum);
+    handle->pageNum      = pageNum;
+    handle->memoryBudget = memoryBudget;
+    handle->loadPage     = -1;
+
+    handle->threadHandle = threadInit(0, handle, pageResidencyMain);
+    if (!handle->threadHandle)
+    {
+        ARLOGe("pageResidencyInit(): Error starting loader thread.\n");
+        free(handle->page);
+        free(handle);
+        return (NULL);
+    }
+
+    return handle;
+}
+
+int pageResidencySetPage(PageResidencyHandle *handle, int page, const char *datasetPathname, AR2SurfaceSetT **surfaceSet_p)
+{
+    PageResidencyPage *p;
+
+    if (!handle || page < 0 || page >= handle->pageNum || !datasetPathname || !surfaceSet_p)
+    {
+        ARLOGe("pageResidencySetPage(): Error: invalid parameter.\n");
+        return (-1);
+    }
+
+    if (handle->loadPage == page)
+    {
+        ARLOGe("pageResidencySetPage(): Error: page %d is being read.\n", page);
+        return (-1);
+    }
+
+    p = &handle->page[page];
+    free(p->datasetPathname);
+    arMalloc(p->datasetPathname, char, strlen(datasetPathname) + 1);
+    strcpy(p->datasetPathname, datasetPathname);
+    p->surfaceSet_p    = surfaceSet_p;
+    p->lastUsed        = handle->frame;
+    p->loadedFrame     = handle->frame;
+    p->requested       = 0;
+    p->failed          = 0;
+    handle->memoryUsed = pageResidencyGetMemoryUsed(handle);
+
+    return 0;
+}
+
+int pageResidencySetMemoryBudget(PageResidencyHandle *handle, size_t memoryBudget)
+{
+    if (!handle)
+        return (-1);
+
+    handle->memoryBudget = memoryBudget;
+    return 0;
+}
+
+int pageResidencyRequest(PageResidencyHandle *handle, int page)
+{
+    PageResidencyPage *p;
+
+    if (!handle || page < 0 || page >= handle->pageNum)
+        return (-1);
+
+    p = &handle->page[page];
+    if (!p->surfaceSet_p)
+        return (-1);
+
+    p->lastUsed = handle->frame;
+    if (!*p->surfaceSet_p && !p->failed && handle->loadPage != page)
+        p->requested = 1;
+
+    return 0;
+}
+
+size_t pageResidencyUpdate(PageResidencyHandle *handle)
+{
+    PageResidencyPage *p;
+    int               i, victim;
+
+    if (!handle)
+        return 0;
+
+    handle->frame++;
+
+    // Collect the page read by the loader thread.
+    if (handle->loadPage >= 0 && threadGetStatus(handle->threadHandle))
+    {
+        threadEndWait(handle->threadHandle);
+        p = &handle->page[handle->loadPage];
+        if (handle->loadResult)
+        {
+            *p->surfaceSet_p   = handle->loadResult;
+            p->lastUsed        = handle->frame;
+            p->loadedFrame     = handle->frame;
+            handle->memoryUsed = pageResidencyGetMemoryUsed(handle);
+            handle->loadResult = NULL;
+        }
+        else
+        {
+            ARLOGe("Error reading AR2 data from %s.fset.\n", p->datasetPathname);
+            p->failed = 1;
+        }
+
+        handle->loadPage = -1;
+    }
+
+    // Start reading the most recently requested page.
+    if (handle->loadPage < 0)
+    {
+        for (i = 0; i < handle->pageNum; i++)
+        {
+            p = &handle->page[i];
+            if (p->requested && (handle->loadPage < 0 || p->lastUsed > handle->page[handle->loadPage].lastUsed))
+                handle->loadPage = i;
+        }
+
+        if (handle->loadPage >= 0)
+        {
+            handle->page[handle->loadPage].requested = 0;
+            threadStartSignal(handle->threadHandle);
+        }
+    }
+
+    // Free the least recently used pages that are not being tracked, nor newly read, until back under budget.
+    while (handle->memoryUsed > handle->memoryBudget)
+    {
+        victim = -1;
+
+        for (i = 0; i < handle->pageNum; i++)
+        {
+            p = &handle->page[i];
+            if (!p->surfaceSet_p || !*p->surfaceSet_p || (*p->surfaceSet_p)->contNum > 0
+                || handle->frame - p->loadedFrame < PAGE_RESIDENCY_NEW_PAGE_FRAMES)
+                continue;
+
+            if (victim < 0 || p->lastUsed < handle->page[victim].lastUsed)
+                victim = i;
+        }
+
+        if (victim < 0)
+            break;
+
+        p = &handle->page[victim];
+        ARLOGd("Freeing AR2 data from %s.fset.\n", p->datasetPathname);
+        ar2FreeSurfaceSet(p->surfaceSet_p); // Sets *p->surfaceSet_p to NULL.
+        handle->memoryUsed = pageResidencyGetMemoryUsed(handle);
+    }
+
+    return handle->memoryUsed;
+}
+
+int pageResidencyQuit(PageResidencyHandle **handle_p)
+{
+    PageResidencyHandle *handle;
+    int                 i;
+
+    if (!handle_p)
+    {
+        ARLOGe("pageResidencyQuit(): Error: NULL handle_p.\n");
+        return (-1);
+    }
+
+    if (!*handle_p)
+        return 0;
+
+    handle = *handle_p;
+
+    // Let any read in progress finish, and hand the result to its page.
+    if (handle->loadPage >= 0)
+    {
+        threadEndWait(handle->threadHandle);
+        if (handle->loadResult)
+            *handle->page[handle->loadPage].surfaceSet_p = handle->loadResult;
+    }
+
+    threadWaitQuit(handle->threadHandle);
+    threadFree(&handle->threadHandle);
+
+    for (i = 0; i < handle->pageNum; i++)
+        free(handle->page[i].datasetPathname);
+
+    free(handle->page);
+    free(handle);
+    *handle_p = NULL;
+
+    return 0;
+}
+
+static void* pageResidencyMain(THREAD_HANDLE_T *threadHandle)
+{
+    PageResidencyHandle *handle;
+    AR2SurfaceSetT      *surfaceSet;
+    int                 i, j;
+
+    handle = (PageResidencyHandle*)threadGetArg(threadHandle);
+    if (!handle)
+    {
+        ARLOGe("Error starting page loader thread: empty PageResidencyHandle.\n");
+        return (NULL);
+    }
+
+    while (threadStartWait(threadHandle) == 0)
+    {
+        surfaceSet = ar2ReadSurfaceSet(handle->page[handle->loadPage].datasetPathname, "fset", NULL);
+        if (surfaceSet)
+        {
+            // Generate every scale now, rather than on the first frames the page is tracked.
+            for (i = 0; i < surfaceSet->num; i++)
+            {
+                for (j = 1; j < surfaceSet->surface[i].imageSet->num; j++)
+                    ar2GetImageSetScale(surfaceSet->surface[i].imageSet, j);
+            }
+        }
+
+        handle->loadResult = surfaceSet;
+        threadEndSignal(threadHandle);
+    }
+
+    return (NULL);
+}
+
+// Image sets read from the same file are shared between surface sets, so each is counted once
+// however many resident pages use it.
+static size_t pageResidencyGetMemoryUsed(const PageResidencyHandle *handle)
+{
+    const AR2SurfaceSetT *surfaceSet, *surfaceSet2;
+    const AR2ImageSetT   *imageSet;
+    size_t               size = 0;
+    int                  i, j, i2, j2;
+    int                  counted;
+
+    for (i = 0; i < handle->pageNum; i++)
+    {
+        if (!handle->page[i].surfaceSet_p || !(surfaceSet = *handle->page[i].surfaceSet_p))
+            continue;
+
+        size += surfaceSetGetSize(surfaceSet);
+        for (j = 0; j < surfaceSet->num; j++)
+        {
+            imageSet = surfaceSet->surface[j].imageSet;
+            counted  = 0;
+            for (i2 = 0; i2 <= i && !counted; i2++)
+            {
+                if (!handle->page[i2].surfaceSet_p || !(surfaceSet2 = *handle->page[i2].surfaceSet_p))
+                    continue;
+
+                for (j2 = 0; j2 < (i2 < i ? surfaceSet2->num : j) && !counted; j2++)
+                    counted = (surfaceSet2->surface[j2].imageSet == imageSet);
+            }
+
+            if (!counted)
+                size += imageSetGetSize(imageSet);
+        }
+    }
+
+    return size;
+}
+
+// Excludes the image sets, which may be shared.
+static size_t surfaceSetGetSize(const AR2SurfaceSetT *surfaceSet)
+{
+    const AR2FeatureSetT   *featureSet;
+    const AR2FeatureIndexT *featureIndex;
+    size_t                 size;
+    int                    i, j;
+
+    size = sizeof(AR2SurfaceSetT) + surfaceSet->num * sizeof(AR2SurfaceT)
+           + (surfaceSet->prevFeatureMax + 1) * sizeof(AR2TemplateCandidateT);
+
+    for (i = 0; i < surfaceSet->num; i++)
+    {
+        featureSet = surfaceSet->surface[i].featureSet;
+        for (j = 0; j < featureSet->num; j++)
+            size += sizeof(AR2FeaturePointsT) + featureSet->list[j].num * sizeof(AR2FeatureCoordT);
+
+        featureIndex = surfaceSet->surface[i].featureIndex;
+        if (featureIndex)
+        {
+            size += sizeof(AR2FeatureIndexT) + featureIndex->levelNum * (featureIndex->xdiv * featureIndex->ydiv + 1) * sizeof(int);
+            for (j = 0; j < featureSet->num; j++)
+                size += featureSet->list[j].num * sizeof(int);
+        }
+    }
+
+    return size;
+}
+
+static size_t imageSetGetSize(const AR2ImageSetT *imageSet)
+{
+    size_t size;
+    int    i;
+
+    // Count every scale, as all will be generated once the page is tracked.
+    size = sizeof(AR2ImageSetT) + imageSet->num * sizeof(AR2ImageT*);
+    for (i = 0; i < imageSet->num; i++)
+        size += sizeof(AR2ImageT) + (size_t)imageSet->scale[i]->xsize * imageSet->scale[i]->ysize;
+
+    return size;
+}
+#endif // HAVE_NFT
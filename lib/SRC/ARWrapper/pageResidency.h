@@ -0,0 +1,81 @@
+/*
+ *  pageResidency.h
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *  Copyright 2010-2015 ARToolworks, Inc.
+ *
+ *  Author(s): Philip Lamb
+ *
+ */
+
+#ifndef PAGE_RESIDENCY_H
+#define PAGE_RESIDENCY_H
+
+#include <ARWrapper/Platform.h>
+
+#if HAVE_NFT
+
+#include <stddef.h>
+#include <thread_sub.h>
+#include <AR2/tracking.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Keeps the AR2 data (image sets and feature sets) of at most a given number of bytes of NFT
+// pages resident. Pages are read on a background thread when requested, and the least recently
+// tracked pages are freed when the budget is exceeded. Pages still being tracked (contNum > 0),
+// and pages read in the last few frames, are never freed. Image sets shared between pages are
+// counted once. The KPM data used for recognition is not managed here.
+//
+// The surface set of each page lives in a location owned by the caller (e.g. ARMarkerNFT::surfaceSet),
+// which is set to NULL while the page is not resident. That location is only written from
+// pageResidencyUpdate() and pageResidencyQuit(), so callers need no locking of their own.
+typedef struct _PageResidencyHandle PageResidencyHandle;
+
+PageResidencyHandle* pageResidencyInit(int pageNum, size_t memoryBudget);
+int pageResidencySetPage(PageResidencyHandle *handle, int page, const char *datasetPathname, AR2SurfaceSetT **surfaceSet_p);
+int pageResidencySetMemoryBudget(PageResidencyHandle *handle, size_t memoryBudget);
+
+// Marks page as used in the current frame. If it is not resident, it is queued to be read in the background.
+int pageResidencyRequest(PageResidencyHandle *handle, int page);
+
+// Call once per frame. Installs any page read since the last call, starts reading the next
+// queued page, and frees pages beyond the memory budget. Returns the number of bytes resident.
+size_t pageResidencyUpdate(PageResidencyHandle *handle);
+
+int pageResidencyQuit(PageResidencyHandle **handle_p);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // HAVE_NFT
+#endif // !PAGE_RESIDENCY_H
@@ -46,12 +46,14 @@
 
 typedef struct
 {
-    KpmHandle *kpmHandle;                   // KPM-related data.
-    ARUint8   *imagePtr;                    // Pointer to image being tracked.
-    int       imageSize;                    // Bytes per image.
-    float     trans[3][4];                  // Transform containing pose of tracked image.
-    int       page;                         // Assigned page number of tracked image.
-    int       flag;                         // Tracked successfully.
+    KpmHandle       *kpmHandle;             // KPM-related data.
+    ARUint8         *imagePtr;              // Copy of the frame passed to trackingInitStart().
+    int             imageSize;              // Bytes per image.
+    ARVideoFrameRef *frame;                 // Reference to the frame passed to trackingInitStartFrame(), released by the tracking thread when done.
+    int             frameStamp;             // Caller's stamp for the frame being tracked, returned with the result.
+    float           trans[3][4];            // Transform containing pose of tracked image.
+    int             page;                   // Assigned page number of tracked image.
+    int             flag;                   // Tracked successfully.
 } TrackingInitHandle;
 
 static void* trackingInitMain(THREAD_HANDLE_T *threadHandle);
@@ -74,6 +76,7 @@ int trackingInitQuit(THREAD_HANDLE_T **threadHandle_p)
     trackingInitHandle = (TrackingInitHandle*)threadGetArg(*threadHandle_p);
     if (trackingInitHandle)
     {
+        arVideoFrameRefRelease(&trackingInitHandle->frame);
         free(trackingInitHandle->imagePtr);
         free(trackingInitHandle);
     }
@@ -100,13 +103,20 @@ THREAD_HANDLE_T* trackingInitInit(KpmHandle *kpmHandle)
     trackingInitHandle->kpmHandle = kpmHandle;
     trackingInitHandle->imageSize = kpmHandleGetXSize(kpmHandle) * kpmHandleGetYSize(kpmHandle) * arUtilGetPixelSize(kpmHandleGetPixelFormat(kpmHandle));
     trackingInitHandle->imagePtr  = (ARUint8*)malloc(trackingInitHandle->imageSize);
+    trackingInitHandle->frame     = NULL;
     trackingInitHandle->flag      = 0;
 
     threadHandle = threadInit(0, trackingInitHandle, trackingInitMain);
+    if (!threadHandle)
+    {
+        free(trackingInitHandle->imagePtr);
+        free(trackingInitHandle);
+    }
+
     return threadHandle;
 }
 
-int trackingInitStart(THREAD_HANDLE_T *threadHandle, ARUint8 *imagePtr)
+int trackingInitStart(THREAD_HANDLE_T *threadHandle, ARUint8 *imagePtr, int frameStamp)
 {
     TrackingInitHandle *trackingInitHandle;
 
@@ -124,12 +134,37 @@ int trackingInitStart(THREAD_HANDLE_T *threadHandle, ARUint8 *imagePtr)
     }
 
     memcpy(trackingInitHandle->imagePtr, imagePtr, trackingInitHandle->imageSize);
+    trackingInitHandle->frameStamp = frameStamp;
+    threadStartSignal(threadHandle);
+
+    return 0;
+}
+
+int trackingInitStartFrame(THREAD_HANDLE_T *threadHandle, ARVideoFrameRef *frame, int frameStamp)
+{
+    TrackingInitHandle *trackingInitHandle;
+
+    if (!threadHandle || !frame)
+    {
+        ARLOGe("trackingInitStartFrame(): Error: NULL threadHandle or frame.\n");
+        return (-1);
+    }
+
+    trackingInitHandle = (TrackingInitHandle*)threadGetArg(threadHandle);
+    if (!trackingInitHandle)
+    {
+        ARLOGe("trackingInitStartFrame(): Error: NULL trackingInitHandle.\n");
+        return (-1);
+    }
+
+    trackingInitHandle->frame      = arVideoFrameRefRetain(frame);
+    trackingInitHandle->frameStamp = frameStamp;
     threadStartSignal(threadHandle);
 
     return 0;
 }
 
-int trackingInitGetResult(THREAD_HANDLE_T *threadHandle, float trans[3][4], int *page)
+int trackingInitGetResult(THREAD_HANDLE_T *threadHandle, float trans[3][4], int *page, int *frameStamp)
 {
     TrackingInitHandle *trackingInitHandle;
     int                i, j;
@@ -148,6 +183,9 @@ int trackingInitGetResult(THREAD_HANDLE_T *threadHandle, float trans[3][4], int
     if (!trackingInitHandle)
         return (-1);
 
+    if (frameStamp)
+        *frameStamp = trackingInitHandle->frameStamp;
+
     if (trackingInitHandle->flag)
     {
         for (j = 0; j < 3; j++)
@@ -167,7 +205,6 @@ static void* trackingInitMain(THREAD_HANDLE_T *threadHandle)
     KpmHandle          *kpmHandle;
     KpmResult          *kpmResult = NULL;
     int                kpmResultNum;
-    ARUint8            *imagePtr;
     float              err;
     int                i, j, k;
 
@@ -185,10 +222,9 @@ static void* trackingInitMain(THREAD_HANDLE_T *threadHandle)
     }
 
     kpmHandle = trackingInitHandle->kpmHandle;
-    imagePtr  = trackingInitHandle->imagePtr;
-    if (!kpmHandle || !imagePtr)
+    if (!kpmHandle)
     {
-        ARLOGe("Error starting tracking thread: empty kpmHandle/imagePtr.\n");
+        ARLOGe("Error starting tracking thread: empty kpmHandle.\n");
         return (NULL);
     }
 
@@ -201,7 +237,8 @@ static void* trackingInitMain(THREAD_HANDLE_T *threadHandle)
         if (threadStartWait(threadHandle) < 0)
             break;
 
-        kpmMatching(kpmHandle, imagePtr);
+        kpmMatching(kpmHandle, (trackingInitHandle->frame ? arVideoFrameRefGetBuffer(trackingInitHandle->frame) : trackingInitHandle->imagePtr));
+        arVideoFrameRefRelease(&trackingInitHandle->frame);
         trackingInitHandle->flag = 0;
 
         for (i = 0; i < kpmResultNum; i++)
@@ -44,14 +44,17 @@
 
 #include <thread_sub.h>
 #include <KPM/kpm.h>
+#include <AR/video.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 THREAD_HANDLE_T* trackingInitInit(KpmHandle *kpmHandle);
-int trackingInitStart(THREAD_HANDLE_T *threadHandle, ARUint8 *imagePtr);
-int trackingInitGetResult(THREAD_HANDLE_T * threadHandle, float trans[3][4], int *page);
+int trackingInitStart(THREAD_HANDLE_T *threadHandle, ARUint8 *imagePtr, int frameStamp);        // Copies the frame.
+int trackingInitStartFrame(THREAD_HANDLE_T *threadHandle, ARVideoFrameRef *frame, int frameStamp);  // Holds a reference to the frame, without copying, until recognition is done.
+// Returns 0 if recognition is still running, 1 if a page was recognised, or -1 if none was. frameStamp (may be NULL) receives the stamp passed when it was started.
+int trackingInitGetResult(THREAD_HANDLE_T * threadHandle, float trans[3][4], int *page, int *frameStamp);
 int trackingInitQuit(THREAD_HANDLE_T **threadHandle_p);
 
 #ifdef __cplusplus
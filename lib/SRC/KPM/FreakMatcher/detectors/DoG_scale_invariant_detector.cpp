@@ -504,9 +504,8 @@ void DoGScaleInvariantDetector::pruneFeatures()
     ASSERT(mBuckets.size() == mNumBucketsX, "Buckets are not allocated");
     ASSERT(mBuckets[0].size() == mNumBucketsY, "Buckets are not allocated");
 
-    std::vector<FeaturePoint> points;
     PruneDoGFeatures(mBuckets,
-                     points,
+                     mTmpPrunedFeaturePoints,
                      mFeaturePoints,
                      (int)mNumBucketsX,
                      (int)mNumBucketsY,
@@ -514,7 +513,7 @@ void DoGScaleInvariantDetector::pruneFeatures()
                      (int)mHeight,
                      (int)mMaxNumFeaturePoints);
 
-    mFeaturePoints.swap(points);
+    mFeaturePoints.swap(mTmpPrunedFeaturePoints);
 
     ASSERT(mFeaturePoints.size() <= mMaxNumFeaturePoints, "Too many feature points");
 }
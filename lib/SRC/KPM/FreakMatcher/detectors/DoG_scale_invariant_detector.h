@@ -286,6 +286,9 @@ std::vector<FeaturePoint> mFeaturePoints;
 // Tmp vector of extracted feature points that have orientation values
 std::vector<FeaturePoint> mTmpOrientatedFeaturePoints;
 
+// Tmp vector of feature points that survive pruning
+std::vector<FeaturePoint> mTmpPrunedFeaturePoints;
+
 // Maximum number of feature points
 size_t mMaxNumFeaturePoints;
 
@@ -412,8 +412,19 @@ void BinomialPyramid32f::apply_filter(Image &dst, const Image &src)
 
 void BinomialPyramid32f::apply_filter_twice(Image &dst, const Image &src)
 {
-    Image tmp((unsigned char*)&mTemp_f32_2[0], src.type(), src.width(), src.height(), (int)src.step(), 1);
-
-    apply_filter(tmp, src);
-    apply_filter(dst, tmp);
+    ASSERT(dst.type() == IMAGE_F32, "Destination image should be a float");
+    ASSERT(src.type() == IMAGE_F32, "Source image should be a float");
+
+    // Filter via the raw temporary buffer, since wrapping it in an Image would
+    // allocate a reference count on every call.
+    binomial_4th_order(&mTemp_f32_2[0],
+                       &mTemp_f32_1[0],
+                       (const float*)src.get(),
+                       src.width(),
+                       src.height());
+    binomial_4th_order((float*)dst.get(),
+                       &mTemp_f32_1[0],
+                       &mTemp_f32_2[0],
+                       src.width(),
+                       src.height());
 }
\ No newline at end of file
@@ -70,9 +70,9 @@ void VisualDatabaseFacade::addImage(unsigned char *grayImage,
                                     size_t height,
                                     int image_id)
 {
-    Image img;
+    // The image is only read while the pyramid is built, so it need not be copied.
+    Image img(grayImage, IMAGE_UINT8, width, height, (int)width, 1);
 
-    img.deepCopy(Image(grayImage, IMAGE_UINT8, width, height, (int)width, 1));
     mVisualDbImpl->mVdb->addImage(img, image_id);
 }
 
@@ -97,6 +97,43 @@ void VisualDatabaseFacade::addFreakFeaturesAndDescriptors(const std::vector<Feat
     mVisualDbImpl->mPoint3d[image_id] = points3D;
 }
 
+bool VisualDatabaseFacade::addMappedKeyframe(const FeaturePoint *featurePoints,
+                                             const unsigned char *descriptors,
+                                             const vision::Point3d<float> *points3D,
+                                             size_t numFeatures,
+                                             const index_node_record_t *indexNodes,
+                                             int numIndexNodes,
+                                             const int *indexReverse,
+                                             int numIndexReverse,
+                                             size_t width,
+                                             size_t height,
+                                             int image_id,
+                                             std::shared_ptr<const void> owner)
+{
+    std::shared_ptr<Keyframe<96>> keyframe(new Keyframe<96>());
+
+    keyframe->setWidth((int)width);
+    keyframe->setHeight((int)height);
+    keyframe->store().setNumBytesPerFeature(96);
+    keyframe->store().points().assign(featurePoints, featurePoints + numFeatures);
+    keyframe->store().setExternalFeatures(descriptors, owner);
+    if (!keyframe->loadIndex(indexNodes, numIndexNodes, indexReverse, numIndexReverse))
+    {
+        return false;
+    }
+
+    mVisualDbImpl->mVdb->addKeyframe(keyframe, image_id);
+    mVisualDbImpl->mPoint3d[image_id].assign(points3D, points3D + numFeatures);
+    return true;
+}
+
+void VisualDatabaseFacade::getIndexRecords(int image_id,
+                                           std::vector<index_node_record_t> &indexNodes,
+                                           std::vector<int> &indexReverse) const
+{
+    mVisualDbImpl->mVdb->keyframe(image_id)->index().serialize(indexNodes, indexReverse);
+}
+
 void VisualDatabaseFacade::computeFreakFeaturesAndDescriptors(unsigned char *grayImage,
                                                               size_t width,
                                                               size_t height,
@@ -120,6 +157,16 @@ bool VisualDatabaseFacade::query(unsigned char *grayImage,
     return mVisualDbImpl->mVdb->query(img);
 }
 
+void VisualDatabaseFacade::setQueryFeatureReuse(int tileSize, int threshold)
+{
+    mVisualDbImpl->mVdb->setQueryFeatureReuse(tileSize, threshold);
+}
+
+void VisualDatabaseFacade::setProgressiveQuery(int batchSize, int inlierThreshold)
+{
+    mVisualDbImpl->mVdb->setProgressiveQuery(batchSize > 0 ? batchSize : 0, inlierThreshold > 0 ? inlierThreshold : 0);
+}
+
 bool VisualDatabaseFacade::erase(int image_id)
 {
     return mVisualDbImpl->mVdb->erase(image_id);
@@ -147,7 +194,9 @@ const std::vector<FeaturePoint>&VisualDatabaseFacade::getFeaturePoints(int image
 
 const std::vector<unsigned char>&VisualDatabaseFacade::getDescriptors(int image_id) const
 {
-    return mVisualDbImpl->mVdb->keyframe(image_id)->store().features();
+    const BinaryFeatureStore &store = mVisualDbImpl->mVdb->keyframe(image_id)->store();
+    ASSERT(!store.hasExternalFeatures(), "Descriptors of a mapped image are not held in a vector");
+    return store.features();
 }
 
 const std::vector<vision::Point3d<float>>&VisualDatabaseFacade::get3DFeaturePoints(int image_id) const
@@ -40,11 +40,14 @@
 #include <matchers/feature_point.h>
 #include <utils/point.h>
 #include <matchers/matcher_types.h>
+#include <matchers/binary_hierarchical_clustering.h>
 
 namespace vision
 {
 class VisualDatabaseImpl;
 
+typedef NodeRecord<96> index_node_record_t;
+
 class VisualDatabaseFacade
 {
 public:
@@ -61,6 +64,33 @@ void addFreakFeaturesAndDescriptors(const std::vector<FeaturePoint> &featurePoin
                                     size_t height,
                                     int image_id);
 
+/**
+ * Add a keyframe from a pre-built dataset (e.g. a memory-mapped .fset3). The
+ * descriptors are referenced in place, and OWNER is held for as long as the
+ * keyframe exists. The index is rebuilt from its serialized records rather
+ * than being re-clustered.
+ * @return False if the index records are inconsistent.
+ */
+bool addMappedKeyframe(const FeaturePoint *featurePoints,
+                       const unsigned char *descriptors,
+                       const vision::Point3d<float> *points3D,
+                       size_t numFeatures,
+                       const index_node_record_t *indexNodes,
+                       int numIndexNodes,
+                       const int *indexReverse,
+                       int numIndexReverse,
+                       size_t width,
+                       size_t height,
+                       int image_id,
+                       std::shared_ptr<const void> owner);
+
+/**
+ * Serialize the feature index of a keyframe.
+ */
+void getIndexRecords(int image_id,
+                     std::vector<index_node_record_t> &indexNodes,
+                     std::vector<int> &indexReverse) const;
+
 void computeFreakFeaturesAndDescriptors(unsigned char *grayImage,
                                         size_t width, size_t height,
                                         std::vector<FeaturePoint> &featurePoints,
@@ -68,6 +98,18 @@ void computeFreakFeaturesAndDescriptors(unsigned char *grayImage,
 
 bool query(unsigned char *grayImage, size_t width, size_t height);
 
+/**
+ * Reuse query features between consecutive queries in image tiles whose luma
+ * has not changed by more than THRESHOLD. A TILE_SIZE of 0 disables reuse.
+ */
+void setQueryFeatureReuse(int tileSize, int threshold);
+
+/**
+ * Match query features in score-ordered batches of BATCHSIZE and stop once an
+ * image has INLIERTHRESHOLD verified inliers. A BATCHSIZE of 0 disables this.
+ */
+void setProgressiveQuery(int batchSize, int inlierThreshold);
+
 
 bool erase(int image_id);
 
@@ -79,6 +121,9 @@ const float* matchedGeometry();
 
 const std::vector<FeaturePoint>&getFeaturePoints(int image_id) const;
 
+/**
+ * Not available for keyframes added with addMappedKeyframe(), whose descriptors are not held in a vector.
+ */
 const std::vector<unsigned char>&getDescriptors(int image_id) const;
 
 const std::vector<vision::Point3d<float>>&get3DFeaturePoints(int image_id) const;
@@ -88,6 +88,18 @@ void Logger::write(LoggerPriorityLevel level, const char *fmt, ...)
     va_end(arg_list);
 }
 
+bool Logger::allow(LoggerPriorityLevel level) const
+{
+    for (size_t i = 0; i < mFrontendSinkFilters.size(); i++)
+    {
+        if (mFrontendSinkFilters[i]->allow(level))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void Logger::addSinkFilter(FrontendSinkFilterPtr &f)
 {
     mFrontendSinkFilters.push_back(f);
@@ -186,6 +186,12 @@ static Logger&getInstance()
 void write(LoggerPriorityLevel level, const std::string &str);
 void write(LoggerPriorityLevel level, const char *fmt, ...);
 
+/**
+ * Check if any sink filter would log a message with LEVEL, so that the
+ * message need not be formatted otherwise.
+ */
+bool allow(LoggerPriorityLevel level) const;
+
 /**
  * Add a front-end sink filter.
  */
@@ -203,42 +209,48 @@ Logger();
 
 #if defined(ENABLE_LOGGER) && defined(ENABLE_FATAL)
 #define LOG_FATAL(FMT, ...) \
-    vision::Logger::getInstance().write(vision::LOGGER_FATAL, LOGGER_FORMAT(FMT, LOGGER_FATAL_MESSAGE), ## __VA_ARGS__);
+    if (vision::Logger::getInstance().allow(vision::LOGGER_FATAL)) \
+        vision::Logger::getInstance().write(vision::LOGGER_FATAL, LOGGER_FORMAT(FMT, LOGGER_FATAL_MESSAGE), ## __VA_ARGS__);
 #else
 #define LOG_FATAL(FMT, ...)
 #endif
 
 #if defined(ENABLE_LOGGER) && defined(ENABLE_ERROR)
 #define LOG_ERROR(FMT, ...) \
-    vision::Logger::getInstance().write(vision::LOGGER_ERROR, LOGGER_FORMAT(FMT, LOGGER_ERROR_MESSAGE), ## __VA_ARGS__);
+    if (vision::Logger::getInstance().allow(vision::LOGGER_ERROR)) \
+        vision::Logger::getInstance().write(vision::LOGGER_ERROR, LOGGER_FORMAT(FMT, LOGGER_ERROR_MESSAGE), ## __VA_ARGS__);
 #else
 #define LOG_ERROR(FMT, ...)
 #endif
 
 #if defined(ENABLE_LOGGER) && defined(ENABLE_WARNING)
 #define LOG_WARNING(FMT, ...) \
-    vision::Logger::getInstance().write(vision::LOGGER_WARNING, LOGGER_FORMAT(FMT, LOGGER_WARNING_MESSAGE), ## __VA_ARGS__);
+    if (vision::Logger::getInstance().allow(vision::LOGGER_WARNING)) \
+        vision::Logger::getInstance().write(vision::LOGGER_WARNING, LOGGER_FORMAT(FMT, LOGGER_WARNING_MESSAGE), ## __VA_ARGS__);
 #else
 #define LOG_WARNING(FMT, ...)
 #endif
 
 #if defined(ENABLE_LOGGER) && defined(ENABLE_INFO)
 #define LOG_INFO(FMT, ...) \
-    vision::Logger::getInstance().write(vision::LOGGER_INFO, LOGGER_FORMAT(FMT, LOGGER_INFO_MESSAGE), ## __VA_ARGS__);
+    if (vision::Logger::getInstance().allow(vision::LOGGER_INFO)) \
+        vision::Logger::getInstance().write(vision::LOGGER_INFO, LOGGER_FORMAT(FMT, LOGGER_INFO_MESSAGE), ## __VA_ARGS__);
 #else
 #define LOG_INFO(FMT, ...)
 #endif
 
 #if defined(ENABLE_LOGGER) && defined(ENABLE_DEBUG)
 #define LOG_DEBUG(FMT, ...) \
-    vision::Logger::getInstance().write(vision::LOGGER_DEBUG, LOGGER_FORMAT(FMT, LOGGER_DEBUG_MESSAGE), ## __VA_ARGS__);
+    if (vision::Logger::getInstance().allow(vision::LOGGER_DEBUG)) \
+        vision::Logger::getInstance().write(vision::LOGGER_DEBUG, LOGGER_FORMAT(FMT, LOGGER_DEBUG_MESSAGE), ## __VA_ARGS__);
 #else
 #define LOG_DEBUG(FMT, ...)
 #endif
 
 #if defined(ENABLE_LOGGER) && defined(ENABLE_TRACE)
 #define LOG_TRACE(FMT, ...) \
-    vision::Logger::getInstance().write(vision::LOGGER_TRACE, LOGGER_FORMAT(FMT, LOGGER_TRACE_MESSAGE), ## __VA_ARGS__);
+    if (vision::Logger::getInstance().allow(vision::LOGGER_TRACE)) \
+        vision::Logger::getInstance().write(vision::LOGGER_TRACE, LOGGER_FORMAT(FMT, LOGGER_TRACE_MESSAGE), ## __VA_ARGS__);
 #else
 #define LOG_TRACE(FMT, ...)
 #endif
\ No newline at end of file
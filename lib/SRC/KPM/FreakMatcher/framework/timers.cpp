@@ -99,5 +99,5 @@ ScopedTimer::ScopedTimer(const char *str)
 ScopedTimer::~ScopedTimer()
 {
     mTimer.stop();
-    LOG_INFO("%s: %f ms", mStr.c_str(), mTimer.duration_in_milliseconds());
+    LOG_INFO("%s: %f ms", mStr, mTimer.duration_in_milliseconds());
 }
\ No newline at end of file
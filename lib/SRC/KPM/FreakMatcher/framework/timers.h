@@ -95,8 +95,8 @@ private:
 
 // The actual timer
 Timer mTimer;
-// Description
-std::string mStr;
+// Description. Must outlive the timer, e.g. a string literal.
+const char *mStr;
 };     // ScopedTimer
 
 #define TIMED(X) if (ScopedTimer _ScopedTimer = X)
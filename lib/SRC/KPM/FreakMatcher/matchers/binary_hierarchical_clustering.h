@@ -39,6 +39,7 @@
 
 #include <unordered_map>
 #include <queue>
+#include <stdint.h>
 
 namespace vision
 {
@@ -46,6 +47,24 @@ namespace vision
 template<int NUM_BYTES_PER_FEATURE>
 class Node;
 
+/**
+ * Fixed-layout record of a node, used to store a built tree in a file. The
+ * children of a node are stored contiguously starting at FIRSTCHILD and the
+ * reverse index of a leaf is the range [FIRSTINDEX, FIRSTINDEX+NUMINDICES) of
+ * a separate array.
+ */
+template<int NUM_BYTES_PER_FEATURE>
+struct NodeRecord
+{
+    int32_t       id;
+    int32_t       leaf;
+    int32_t       firstChild;
+    int32_t       numChildren;
+    int32_t       firstIndex;
+    int32_t       numIndices;
+    unsigned char center[NUM_BYTES_PER_FEATURE];
+};     // NodeRecord
+
 /**
  * The nodes in the tree are sorted as they are visited when a QUERY is done. This class
  * represents an entry in a priority queue to revisit certains nodes in a back-trace.
@@ -140,6 +159,14 @@ inline bool leaf() const
     return mLeaf;
 }
 
+/**
+ * @return Feature center
+ */
+inline const unsigned char* center() const
+{
+    return mCenter;
+}
+
 /**
  * @return Get children
  */
@@ -169,13 +196,14 @@ inline const std::vector<int>&reverseIndex() const
  */
 inline void nearest(std::vector<const node_t*> &nodes,
                     queue_t &queue,
-                    const unsigned char *feature) const
+                    const unsigned char *feature,
+                    std::vector<queue_item_t> &v) const
 {
     unsigned int mind = std::numeric_limits<unsigned int>::max();
     int          mini = -1;
 
     // Compute the distance to each cluster center
-    std::vector<queue_item_t> v(mChildren.size());
+    v.resize(mChildren.size());
 
     for (size_t i = 0; i < v.size(); i++)
     {
@@ -262,6 +290,7 @@ typedef std::unordered_map<int, std::vector<int>> cluster_map_t;
 
 typedef PriorityQueueItem<NUM_BYTES_PER_FEATURE> queue_item_t;
 typedef std::priority_queue<queue_item_t> queue_t;
+typedef NodeRecord<NUM_BYTES_PER_FEATURE> node_record_t;
 
 BinaryHierarchicalClustering();
 ~BinaryHierarchicalClustering() {}
@@ -276,6 +305,22 @@ void build(const unsigned char *features, int num_features);
  */
 int query(const unsigned char *feature) const;
 
+/**
+ * Flatten the tree into node records (breadth first) and a reverse index array.
+ */
+void serialize(std::vector<node_record_t> &nodes, std::vector<int> &reverseIndex) const;
+
+/**
+ * Rebuild the tree from records written by serialize(). NUM_FEATURES is the
+ * size of the feature set the tree indexes, used to validate the records.
+ * @return False if the records are inconsistent.
+ */
+bool deserialize(const node_record_t *nodes,
+                 int num_nodes,
+                 const int *reverseIndex,
+                 int num_reverse_index,
+                 int num_features);
+
 /**
  * @return Reverse index after a QUERY.
  */
@@ -352,6 +397,10 @@ mutable std::vector<int> mQueryReverseIndex;
 // Node queue
 mutable queue_t mQueue;
 
+// Scratch space for query
+mutable std::vector<const node_t*> mQueryNodes;
+mutable std::vector<queue_item_t>  mQueryItems;
+
 // Number of nodes popped off the priority queue
 mutable int mNumNodesPopped;
 
@@ -383,6 +432,17 @@ void build(node_t *node, const unsigned char *features, int num_features, const
  * Recursive function query function.
  */
 void query(queue_t &queue, const node_t *node, const unsigned char *feature) const;
+
+/**
+ * Recursive function to rebuild a node and its children from records.
+ */
+bool deserialize(node_t *node,
+                 const node_record_t *nodes,
+                 int num_nodes,
+                 int record,
+                 const int *reverseIndex,
+                 int num_reverse_index,
+                 int num_features);
 };     // BinaryHierarchicalClustering
 
 template<int NUM_BYTES_PER_FEATURE>
@@ -524,13 +584,17 @@ void BinaryHierarchicalClustering<NUM_BYTES_PER_FEATURE>::query(queue_t &queue,
     }
     else
     {
-        std::vector<const node_t*> nodes;
-        node->nearest(nodes, queue, feature);
+        // The nearest children are appended to a shared stack, and removed
+        // again once they have been visited.
+        size_t first = mQueryNodes.size();
+        node->nearest(mQueryNodes, queue, feature, mQueryItems);
+        size_t last = mQueryNodes.size();
 
-        for (size_t i = 0; i < nodes.size(); i++)
+        for (size_t i = first; i < last; i++)
         {
-            query(queue, nodes[i], feature);
+            query(queue, mQueryNodes[i], feature);
         }
+        mQueryNodes.resize(first);
 
         // Pop a node from the queue
         if (mNumNodesPopped < mMaxNodesToPop && !queue.empty())
@@ -542,4 +606,122 @@ void BinaryHierarchicalClustering<NUM_BYTES_PER_FEATURE>::query(queue_t &queue,
         }
     }
 }
-} // vision
\ No newline at end of file
+template<int NUM_BYTES_PER_FEATURE>
+void BinaryHierarchicalClustering<NUM_BYTES_PER_FEATURE>::serialize(std::vector<node_record_t> &nodes, std::vector<int> &reverseIndex) const
+{
+    nodes.clear();
+    reverseIndex.clear();
+
+    if (!mRoot.get())
+    {
+        return;
+    }
+
+    std::vector<const node_t*> order;
+    order.push_back(mRoot.get());
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const node_t  *node = order[i];
+        node_record_t record;
+
+        record.id          = node->id();
+        record.leaf        = node->leaf() ? 1 : 0;
+        record.firstChild  = (int32_t)(order.size());
+        record.numChildren = (int32_t)node->children().size();
+        record.firstIndex  = (int32_t)reverseIndex.size();
+        record.numIndices  = (int32_t)node->reverseIndex().size();
+        CopyVector(record.center, node->center(), NUM_BYTES_PER_FEATURE);
+
+        for (size_t j = 0; j < node->children().size(); j++)
+        {
+            order.push_back(node->children()[j]);
+        }
+
+        reverseIndex.insert(reverseIndex.end(), node->reverseIndex().begin(), node->reverseIndex().end());
+        nodes.push_back(record);
+    }
+}
+
+template<int NUM_BYTES_PER_FEATURE>
+bool BinaryHierarchicalClustering<NUM_BYTES_PER_FEATURE>::deserialize(const node_record_t *nodes,
+                                                                      int num_nodes,
+                                                                      const int *reverseIndex,
+                                                                      int num_reverse_index,
+                                                                      int num_features)
+{
+    mRoot.reset();
+    mNextNodeId = 0;
+
+    if (!nodes || num_nodes <= 0)
+    {
+        return false;
+    }
+
+    mRoot.reset(new node_t(nodes[0].id));
+    if (!deserialize(mRoot.get(), nodes, num_nodes, 0, reverseIndex, num_reverse_index, num_features))
+    {
+        mRoot.reset();
+        return false;
+    }
+
+    for (int i = 0; i < num_nodes; i++)
+    {
+        mNextNodeId = max2(mNextNodeId, (int)nodes[i].id + 1);
+    }
+
+    return true;
+}
+
+template<int NUM_BYTES_PER_FEATURE>
+bool BinaryHierarchicalClustering<NUM_BYTES_PER_FEATURE>::deserialize(node_t *node,
+                                                                      const node_record_t *nodes,
+                                                                      int num_nodes,
+                                                                      int record,
+                                                                      const int *reverseIndex,
+                                                                      int num_reverse_index,
+                                                                      int num_features)
+{
+    const node_record_t &r = nodes[record];
+
+    node->leaf(r.leaf != 0);
+
+    if (r.numIndices < 0 || r.firstIndex < 0 || r.firstIndex > num_reverse_index - r.numIndices)
+    {
+        return false;
+    }
+
+    node->reverseIndex().assign(reverseIndex + r.firstIndex, reverseIndex + r.firstIndex + r.numIndices);
+
+    for (int i = 0; i < r.numIndices; i++)
+    {
+        if (node->reverseIndex()[i] < 0 || node->reverseIndex()[i] >= num_features)
+        {
+            return false;
+        }
+    }
+
+    // Records are written breadth first, so children always follow their
+    // parent. This also guarantees the recursion terminates.
+    if (r.numChildren < 0 || r.firstChild <= record || r.firstChild > num_nodes - r.numChildren)
+    {
+        return false;
+    }
+
+    node->children().reserve(r.numChildren);
+
+    for (int i = 0; i < r.numChildren; i++)
+    {
+        int    child     = r.firstChild + i;
+        node_t *new_node = new node_t(nodes[child].id, nodes[child].center);
+
+        node->children().push_back(new_node);
+        if (!deserialize(new_node, nodes, num_nodes, child, reverseIndex, num_reverse_index, num_features))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+} // vision
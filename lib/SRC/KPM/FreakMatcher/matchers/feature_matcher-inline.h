@@ -132,18 +132,30 @@ template<int FEATURE_SIZE>
 size_t BinaryFeatureMatcher<FEATURE_SIZE>::match(const BinaryFeatureStore *features1,
                                                  const BinaryFeatureStore *features2,
                                                  const index_t &index2)
+{
+    return match(features1, features2, index2, 0, features1->size());
+}
+
+template<int FEATURE_SIZE>
+size_t BinaryFeatureMatcher<FEATURE_SIZE>::match(const BinaryFeatureStore *features1,
+                                                 const BinaryFeatureStore *features2,
+                                                 const index_t &index2,
+                                                 size_t begin,
+                                                 size_t end)
 {
     mMatches.clear();
 
-    if (features1->size() == 0 ||
+    ASSERT(begin <= end && end <= features1->size(), "Invalid range");
+
+    if (begin == end ||
         features2->size() == 0)
     {
         return 0;
     }
 
-    mMatches.reserve(features1->size());
+    mMatches.reserve(end - begin);
 
-    for (size_t i = 0; i < features1->size(); i++)
+    for (size_t i = begin; i < end; i++)
     {
         unsigned int first_best  = std::numeric_limits<unsigned int>::max();
         unsigned int second_best = std::numeric_limits<unsigned int>::max();
@@ -203,7 +215,7 @@ size_t BinaryFeatureMatcher<FEATURE_SIZE>::match(const BinaryFeatureStore *featu
         }
     }
 
-    ASSERT(mMatches.size() <= features1->size(), "Number of matches should be lower");
+    ASSERT(mMatches.size() <= end - begin, "Number of matches should be lower");
     return mMatches.size();
 }
 
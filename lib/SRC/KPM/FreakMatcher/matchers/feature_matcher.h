@@ -87,6 +87,17 @@ size_t match(const BinaryFeatureStore *features1,
              const BinaryFeatureStore *features2,
              const index_t &index2);
 
+/**
+ * Match the features [BEGIN,END) of store 1 to store 2 with an index on
+ * features2. Match indices refer to the full stores.
+ * @return Number of matches
+ */
+size_t match(const BinaryFeatureStore *features1,
+             const BinaryFeatureStore *features2,
+             const index_t &index2,
+             size_t begin,
+             size_t end);
+
 /**
  * Match two feature stores given a homography from the features in store 1 to
  * store 2. The THRESHOLD is a spatial threshold in pixels to restrict the number
@@ -35,8 +35,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
+#include <memory>
 #include "feature_point.h"
+#include <framework/error.h>
 
 // #include <boost/serialization/serialization.hpp>
 // #include <boost/serialization/vector.hpp>
@@ -51,9 +54,9 @@ class BinaryFeatureStore
 public:
 
 BinaryFeatureStore(int bytesPerFeature)
-    : mNumBytesPerFeature(bytesPerFeature) {}
+    : mNumBytesPerFeature(bytesPerFeature), mExternalFeatures(NULL) {}
 BinaryFeatureStore()
-    : mNumBytesPerFeature(0) {}
+    : mNumBytesPerFeature(0), mExternalFeatures(NULL) {}
 ~BinaryFeatureStore() {}
 
 /**
@@ -61,10 +64,40 @@ BinaryFeatureStore()
  */
 inline void resize(size_t numFeatures)
 {
+    mExternalFeatures = NULL;
+    mExternalOwner.reset();
     mFeatures.resize(mNumBytesPerFeature * numFeatures, 0);
     mPoints.resize(numFeatures);
 }
 
+/**
+ * Use feature data owned by someone else (e.g. a memory-mapped dataset) instead
+ * of the internal vector. The data must hold size() features and stays valid
+ * for as long as OWNER is referenced. Such a store is read-only.
+ */
+inline void setExternalFeatures(const unsigned char *features, std::shared_ptr<const void> owner)
+{
+    mFeatures.clear();
+    mExternalFeatures = features;
+    mExternalOwner    = owner;
+}
+
+/**
+ * @return True if the features are not owned by this store.
+ */
+inline bool hasExternalFeatures() const
+{
+    return mExternalFeatures != NULL;
+}
+
+/**
+ * @return Pointer to the contiguous feature data.
+ */
+inline const unsigned char* featureData() const
+{
+    return mExternalFeatures ? mExternalFeatures : (mFeatures.empty() ? NULL : &mFeatures[0]);
+}
+
 /**
  * @return Number of features.
  */
@@ -90,10 +123,12 @@ inline int numBytesPerFeature() const
 }
 
 /**
- * @return Vector of features
+ * @return Vector of features. Empty if the store uses external features, which
+ * cannot be modified, so the non-const accessor may not be used on such a store.
  */
 inline std::vector<unsigned char>&features()
 {
+    ASSERT(!mExternalFeatures, "Store uses external features");
     return mFeatures;
 }
 inline const std::vector<unsigned char>&features() const
@@ -106,11 +141,12 @@ inline const std::vector<unsigned char>&features() const
  */
 inline unsigned char* feature(size_t i)
 {
+    ASSERT(!mExternalFeatures, "Store uses external features");
     return &mFeatures[i * mNumBytesPerFeature];
 }
 inline const unsigned char* feature(size_t i) const
 {
-    return &mFeatures[i * mNumBytesPerFeature];
+    return featureData() + i * mNumBytesPerFeature;
 }
 
 /**
@@ -145,6 +181,8 @@ void copy(const BinaryFeatureStore &store)
     mNumBytesPerFeature = store.mNumBytesPerFeature;
     mFeatures           = store.mFeatures;
     mPoints             = store.mPoints;
+    mExternalFeatures   = store.mExternalFeatures;
+    mExternalOwner      = store.mExternalOwner;
 }
 
 //
@@ -168,5 +206,9 @@ std::vector<unsigned char> mFeatures;
 
 // Vector of feature points
 std::vector<FeaturePoint> mPoints;
+
+// Features held outside of this store, and a reference keeping them alive
+const unsigned char         *mExternalFeatures;
+std::shared_ptr<const void> mExternalOwner;
 };
 } // vision
\ No newline at end of file
@@ -146,7 +146,8 @@ void FREAKExtractor::layout84(std::vector<receptor> &receptors,
 
 void FREAKExtractor::extract(BinaryFeatureStore &store,
                              const GaussianScaleSpacePyramid *pyramid,
-                             const std::vector<FeaturePoint> &points)
+                             const std::vector<FeaturePoint> &points,
+                             std::vector<size_t> *extracted)
 {
 #ifdef FREAK_DEBUG
     mMappedPoints0.clear();
@@ -183,7 +184,8 @@ void FREAKExtractor::extract(BinaryFeatureStore &store,
                    mSigmaRing3,
                    mSigmaRing4,
                    mSigmaRing5,
-                   mExpansionFactor
+                   mExpansionFactor,
+                   extracted
 #ifdef FREAK_DEBUG
                    ,
                    mMappedPoints0,
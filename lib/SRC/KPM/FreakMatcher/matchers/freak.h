@@ -74,11 +74,32 @@ void layout84(std::vector<receptor> &receptors,
               std::vector<std::vector<int>> &tests);
 
 /**
- * Extract a 96 byte descriptor.
+ * Extract a 96 byte descriptor. Points too close to the image border are dropped;
+ * if EXTRACTED is not NULL, on return it holds the index in POINTS of each
+ * feature in the store.
  */
 void extract(BinaryFeatureStore &store,
              const GaussianScaleSpacePyramid *pyramid,
-             const std::vector<FeaturePoint> &points);
+             const std::vector<FeaturePoint> &points,
+             std::vector<size_t> *extracted = NULL);
+
+/**
+ * @return Radius (in pixels) of the image region that the descriptor of a
+ * point with feature scale SCALE depends on.
+ */
+inline float supportRadius(float scale) const
+{
+    float transform_scale = scale * mExpansionFactor;
+
+    if (transform_scale < 1)
+    {
+        transform_scale = 1;
+    }
+
+    // Outer ring plus two standard deviations of its receptive field, and a
+    // pixel on either side for bilinear interpolation.
+    return transform_scale * (1 + 2 * mSigmaRing5) + 2;
+}
 
 #ifdef FREAK_DEBUG
 std::vector<Point2d<float>> mMappedPoints0;
@@ -531,7 +552,8 @@ inline void ExtractFREAK84(BinaryFeatureStore &store,
                            float sigma_ring3,
                            float sigma_ring4,
                            float sigma_ring5,
-                           float expansion_factor
+                           float expansion_factor,
+                           std::vector<size_t> *extracted
 #ifdef FREAK_DEBUG
                            ,
                            std::vector<Point2d<float>> &mapped_ring0,
@@ -556,6 +578,11 @@ inline void ExtractFREAK84(BinaryFeatureStore &store,
     ASSERT(store.size() == points.size(), "Feature store has not been allocated");
     size_t num_points = 0;
 
+    if (extracted)
+    {
+        extracted->clear();
+    }
+
     for (size_t i = 0; i < points.size(); i++)
     {
 #ifdef FREAK_DEBUG
@@ -634,6 +661,10 @@ inline void ExtractFREAK84(BinaryFeatureStore &store,
 
         store.point(num_points) = points[i];
         num_points++;
+        if (extracted)
+        {
+            extracted->push_back(i);
+        }
     }
 
     ASSERT(num_points == points.size(), "Should be same size");
@@ -38,6 +38,8 @@
 
 using namespace vision;
 
+const unsigned int HoughSimilarityVoting::kEmptyVoteSlot;
+
 HoughSimilarityVoting::HoughSimilarityVoting()
     : mRefImageWidth(0)
     , mRefImageHeight(0)
@@ -98,7 +100,49 @@ void HoughSimilarityVoting::init(float minX,
     else
         mAutoAdjustXYNumBins = false;
 
-    mVotes.clear();
+    clearVotes();
+}
+
+void HoughSimilarityVoting::clearVotes()
+{
+    for (size_t i = 0; i < mVoteSlots.size(); i++)
+    {
+        mVoteBins[mVoteSlots[i]] = kEmptyVoteSlot;
+    }
+    mVoteSlots.clear();
+}
+
+void HoughSimilarityVoting::reserveVotes(size_t numBins)
+{
+    size_t size = 64;
+    while (size < numBins * 2)
+    {
+        size <<= 1;
+    }
+    if (size <= mVoteBins.size())
+    {
+        return;
+    }
+
+    // Re-insert any votes already cast into the larger table
+    std::vector<unsigned int> bins;
+    std::vector<unsigned int> counts;
+    bins.reserve(mVoteSlots.size());
+    counts.reserve(mVoteSlots.size());
+    for (size_t i = 0; i < mVoteSlots.size(); i++)
+    {
+        bins.push_back(mVoteBins[mVoteSlots[i]]);
+        counts.push_back(mVoteCounts[mVoteSlots[i]]);
+    }
+
+    mVoteBins.assign(size, kEmptyVoteSlot);
+    mVoteCounts.resize(size);
+    mVoteSlots.clear();
+    mVoteSlots.reserve(size / 2);
+    for (size_t i = 0; i < bins.size(); i++)
+    {
+        voteAtIndex(bins[i], counts[i]);
+    }
 }
 
 void HoughSimilarityVoting::vote(const float *ins, const float *ref, int size)
@@ -106,12 +150,15 @@ void HoughSimilarityVoting::vote(const float *ins, const float *ref, int size)
     float x, y, angle, scale;
     int   num_features_that_cast_vote;
 
-    mVotes.clear();
+    clearVotes();
     if (size == 0)
     {
         return;
     }
 
+    // Each correspondence votes for up to 16 bins
+    reserveVotes((size_t)size * 16);
+
     mSubBinLocations.resize(size * 4);
     mSubBinLocationIndices.resize(size);
     if (mAutoAdjustXYNumBins)
@@ -161,13 +208,14 @@ void HoughSimilarityVoting::vote(const float *ins, const float *ref, int size)
 void HoughSimilarityVoting::getVotes(vote_vector_t &votes, int threshold) const
 {
     votes.clear();
-    votes.reserve(mVotes.size());
+    votes.reserve(mVoteSlots.size());
 
-    for (hash_t::const_iterator it = mVotes.begin(); it != mVotes.end(); it++)
+    for (size_t i = 0; i < mVoteSlots.size(); i++)
     {
-        if (it->second >= threshold)
+        unsigned int slot = mVoteSlots[i];
+        if (mVoteCounts[slot] >= (unsigned int)threshold)
         {
-            votes.push_back(std::make_pair(it->second, it->first));
+            votes.push_back(std::make_pair(mVoteCounts[slot], mVoteBins[slot]));
         }
     }
 }
@@ -177,12 +225,13 @@ void HoughSimilarityVoting::getMaximumNumberOfVotes(float &maxVotes, int &maxInd
     maxVotes = 0;
     maxIndex = -1;
 
-    for (hash_t::const_iterator it = mVotes.begin(); it != mVotes.end(); it++)
+    for (size_t i = 0; i < mVoteSlots.size(); i++)
     {
-        if (it->second > maxVotes)
+        unsigned int slot = mVoteSlots[i];
+        if (mVoteCounts[slot] > maxVotes)
         {
-            maxIndex = it->first;
-            maxVotes = it->second;
+            maxIndex = mVoteBins[slot];
+            maxVotes = mVoteCounts[slot];
         }
     }
 }
@@ -216,8 +265,10 @@ void HoughSimilarityVoting::getSimilarityFromIndex(float &x, float &y, float &an
 
 void HoughSimilarityVoting::autoAdjustXYNumBins(const float *ins, const float *ref, int size)
 {
-    int                max_dim = max2<int>(mRefImageWidth, mRefImageHeight);
-    std::vector<float> projected_dim(size);
+    int                max_dim        = max2<int>(mRefImageWidth, mRefImageHeight);
+    std::vector<float> &projected_dim = mProjectedDimBuffer;
+
+    projected_dim.resize(size);
 
     ASSERT(size > 0, "size must be positive");
     ASSERT(mRefImageWidth > 0, "width must be positive");
@@ -40,7 +40,6 @@
 #include <framework/error.h>
 
 #include <vector>
-#include <unordered_map>
 
 namespace vision
 {
@@ -51,7 +50,6 @@ class HoughSimilarityVoting
 {
 public:
 
-typedef std::unordered_map<unsigned int, unsigned int> hash_t;
 typedef std::pair<int /*size*/, int /*index*/> vote_t;
 typedef std::vector<vote_t> vote_vector_t;
 
@@ -98,7 +96,7 @@ inline void setMinMaxXY(float minX, float maxX, float minY, float maxY)
     mMaxX = maxX;
     mMinY = minY;
     mMaxY = maxY;
-    mVotes.clear();
+    clearVotes();
 }
 
 /**
@@ -289,25 +287,57 @@ float mfBinScale;
 int mA;         // mNumXBins*mNumYBins
 int mB;         // mNumXBins*mNumYBins*mNumAngleBins
 
-mutable hash_t mVotes;
+// Votes per bin, in an open-addressing hash table whose size is a power of two.
+// The table is kept between calls and only grows, so once it is large enough
+// voting does not allocate.
+static const unsigned int kEmptyVoteSlot = 0xffffffff;
+std::vector<unsigned int> mVoteBins;    // Bin index held in each slot, or kEmptyVoteSlot
+std::vector<unsigned int> mVoteCounts;  // Votes for the bin held in each slot
+std::vector<unsigned int> mVoteSlots;   // Occupied slots, in the order their bins were first voted for
 
 std::vector<float> mSubBinLocations;
 std::vector<int>   mSubBinLocationIndices;
 
+// Reused by autoAdjustXYNumBins()
+std::vector<float> mProjectedDimBuffer;
+
+/**
+ * Remove all votes, keeping the table.
+ */
+void clearVotes();
+
+/**
+ * Make room in the table for at least NUMBINS distinct bins.
+ */
+void reserveVotes(size_t numBins);
+
 /**
  * Cast a vote to an similarity index
  */
 inline void voteAtIndex(int index, unsigned int weight)
 {
     ASSERT(index >= 0, "index out of range");
-    const hash_t::iterator it = mVotes.find(index);
-    if (it == mVotes.end())
+    if ((mVoteSlots.size() + 1) * 2 > mVoteBins.size())
+    {
+        reserveVotes(mVoteSlots.size() + 1);
+    }
+
+    unsigned int mask = (unsigned int)mVoteBins.size() - 1;
+    unsigned int slot = ((unsigned int)index * 2654435761u) & mask;
+    while (mVoteBins[slot] != kEmptyVoteSlot && mVoteBins[slot] != (unsigned int)index)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    if (mVoteBins[slot] == kEmptyVoteSlot)
     {
-        mVotes.insert(std::pair<unsigned int, unsigned int>(index, weight));
+        mVoteBins[slot]   = index;
+        mVoteCounts[slot] = weight;
+        mVoteSlots.push_back(slot);
     }
     else
     {
-        it->second += weight;
+        mVoteCounts[slot] += weight;
     }
 }
 
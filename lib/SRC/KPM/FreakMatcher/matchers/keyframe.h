@@ -100,6 +100,15 @@ inline const index_t&index() const
  */
 void buildIndex();
 
+/**
+ * Restore an index serialized from a keyframe with the same features,
+ * instead of building it.
+ */
+bool loadIndex(const typename index_t::node_record_t *nodes,
+               int num_nodes,
+               const int *reverseIndex,
+               int num_reverse_index);
+
 /**
  * Copy a keyframe.
  */
@@ -132,15 +141,36 @@ BinaryFeatureStore mStore;
 
 // Feature index
 index_t mIndex;
+
+/**
+ * Set the index parameters used for both built and loaded indices.
+ */
+void setIndexParameters();
 };     // Keyframe
 
 template<int NUM_BYTES_PER_FEATURE>
-void Keyframe<NUM_BYTES_PER_FEATURE>::buildIndex()
+void Keyframe<NUM_BYTES_PER_FEATURE>::setIndexParameters()
 {
     mIndex.setNumHypotheses(128);
     mIndex.setNumCenters(8);
     mIndex.setMaxNodesToPop(8);
     mIndex.setMinFeaturesPerNode(16);
-    mIndex.build(&mStore.features()[0], (int)mStore.size());
+}
+
+template<int NUM_BYTES_PER_FEATURE>
+void Keyframe<NUM_BYTES_PER_FEATURE>::buildIndex()
+{
+    setIndexParameters();
+    mIndex.build(mStore.featureData(), (int)mStore.size());
+}
+
+template<int NUM_BYTES_PER_FEATURE>
+bool Keyframe<NUM_BYTES_PER_FEATURE>::loadIndex(const typename index_t::node_record_t *nodes,
+                                                int num_nodes,
+                                                const int *reverseIndex,
+                                                int num_reverse_index)
+{
+    setIndexParameters();
+    return mIndex.deserialize(nodes, num_nodes, reverseIndex, num_reverse_index, (int)mStore.size());
 }
 } // vision
\ No newline at end of file
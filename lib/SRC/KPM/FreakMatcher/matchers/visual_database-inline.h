@@ -43,6 +43,12 @@
 #include <math/math_io.h>
 #include <matchers/visual_database.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
 
 namespace vision
 {
@@ -71,6 +77,18 @@ VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::VisualDatabase()
     mMinNumInliers             = kMinNumInliers;
 
     mUseFeatureIndex = kUseFeatureIndex;
+
+    mProgressiveBatchSize       = 0;
+    mProgressiveInlierThreshold = 0;
+
+    mReuseTileSize          = 0;
+    mReuseThreshold         = 0;
+    mReuseValid             = false;
+    mReuseWidth             = 0;
+    mReuseHeight            = 0;
+    mReuseTilesX            = 0;
+    mReuseTilesY            = 0;
+    mNumReusedQueryFeatures = 0;
 }
 
 template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
@@ -124,7 +142,7 @@ void VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::addImage(const GaussianS
     keyframe->setHeight((int)pyramid->images()[0].height());
     TIMED("Extract Features")
     {
-        FindFeatures<FEATURE_EXTRACTOR, kBytesPerFeature>(keyframe.get(), pyramid, &mDetector, &mFeatureExtractor);
+        FindFeatures<FEATURE_EXTRACTOR, kBytesPerFeature>(keyframe.get(), pyramid, &mDetector, &mFeatureExtractor, mFeaturePointsBuffer);
     }
     LOG_INFO("Found %d features", keyframe->store().size());
 
@@ -150,9 +168,148 @@ void VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::addKeyframe(keyframe_ptr
     mKeyframeMap[id] = keyframe;
 }
 
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+typename VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::keyframe_ptr_t VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::newQueryKeyframe(int width, int height)
+{
+    keyframe_ptr_t keyframe;
+
+    // The spare keyframe can only be recycled if nobody else holds on to it
+    keyframe.swap(mSpareQueryKeyframe);
+    if (!keyframe || !keyframe.unique())
+    {
+        keyframe.reset(new keyframe_t());
+    }
+
+    keyframe->setWidth(width);
+    keyframe->setHeight(height);
+    return keyframe;
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+void VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::setQueryKeyframe(keyframe_ptr_t keyframe)
+{
+    mSpareQueryKeyframe = mQueryKeyframe;
+    mQueryKeyframe      = keyframe;
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+void VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::setProgressiveQuery(size_t batch_size, size_t inlier_threshold)
+{
+    mProgressiveBatchSize       = batch_size;
+    mProgressiveInlierThreshold = std::max(inlier_threshold, mMinNumInliers);
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+void VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::setQueryFeatureReuse(int tile_size, int threshold)
+{
+    if (tile_size < 0)
+    {
+        tile_size = 0;
+    }
+
+    if (tile_size != mReuseTileSize)
+    {
+        mReuseValid = false;
+    }
+
+    mReuseTileSize  = tile_size;
+    mReuseThreshold = threshold;
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+size_t VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::findChangedTiles(const Image &image)
+{
+    size_t num_changed = 0;
+
+    for (size_t ty = 0; ty < mReuseTilesY; ty++)
+    {
+        size_t y0 = ty * mReuseTileSize;
+        size_t y1 = std::min(y0 + mReuseTileSize, mReuseHeight);
+
+        for (size_t tx = 0; tx < mReuseTilesX; tx++)
+        {
+            size_t x0 = tx * mReuseTileSize;
+            size_t x1 = std::min(x0 + mReuseTileSize, mReuseWidth);
+
+            unsigned int sad = 0;
+            for (size_t y = y0; y < y1; y++)
+            {
+                const unsigned char *cur = image.get<unsigned char>(y);
+                const unsigned char *ref = &mReuseReference[y * mReuseWidth];
+                for (size_t x = x0; x < x1; x++)
+                {
+                    sad += std::abs((int)cur[x] - (int)ref[x]);
+                }
+            }
+
+            bool changed = sad > (unsigned int)mReuseThreshold * (unsigned int)((x1 - x0) * (y1 - y0));
+            mReuseTileChanged[ty * mReuseTilesX + tx] = changed;
+            num_changed += changed;
+        }
+    }
+
+    return num_changed;
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+void VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::updateReuseReference(const Image &image, bool all)
+{
+    if (all)
+    {
+        mReuseWidth  = image.width();
+        mReuseHeight = image.height();
+        mReuseTilesX = (mReuseWidth + mReuseTileSize - 1) / mReuseTileSize;
+        mReuseTilesY = (mReuseHeight + mReuseTileSize - 1) / mReuseTileSize;
+        mReuseReference.resize(mReuseWidth * mReuseHeight);
+        mReuseTileChanged.assign(mReuseTilesX * mReuseTilesY, 1);
+    }
+
+    for (size_t ty = 0; ty < mReuseTilesY; ty++)
+    {
+        size_t y0 = ty * mReuseTileSize;
+        size_t y1 = std::min(y0 + mReuseTileSize, mReuseHeight);
+
+        for (size_t tx = 0; tx < mReuseTilesX; tx++)
+        {
+            if (!mReuseTileChanged[ty * mReuseTilesX + tx])
+            {
+                continue;
+            }
+
+            size_t x0 = tx * mReuseTileSize;
+            size_t x1 = std::min(x0 + mReuseTileSize, mReuseWidth);
+            for (size_t y = y0; y < y1; y++)
+            {
+                memcpy(&mReuseReference[y * mReuseWidth + x0], image.get<unsigned char>(y) + x0, x1 - x0);
+            }
+        }
+    }
+}
+
 template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
 bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::query(const vision::Image &image) throw(Exception)
 {
+    bool incremental = mReuseTileSize > 0 &&
+                       mReuseValid &&
+                       mQueryKeyframe &&
+                       image.type() == IMAGE_UINT8 &&
+                       image.width() == mReuseWidth &&
+                       image.height() == mReuseHeight;
+
+    if (incremental)
+    {
+        size_t num_changed;
+        TIMED("Find Changed Tiles")
+        {
+            num_changed = findChangedTiles(image);
+        }
+        if (num_changed == 0)
+        {
+            mNumReusedQueryFeatures = mQueryKeyframe->store().size();
+            return query(mQueryKeyframe.get());
+        }
+    }
+
     // Allocate pyramid
     if (mPyramid.images().size() == 0 ||
         mPyramid.images()[0].width() != image.width() ||
@@ -168,12 +325,150 @@ bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::query(const vision::Imag
         mPyramid.build(image);
     }
 
-    return query(&mPyramid);
+    if (incremental)
+    {
+        bool found = queryIncremental(&mPyramid);
+        updateReuseReference(image, false);
+        return found;
+    }
+
+    bool found = query(&mPyramid);
+    if (mReuseTileSize > 0 && image.type() == IMAGE_UINT8)
+    {
+        updateReuseReference(image, true);
+        mReuseValid = true;
+    }
+    return found;
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::queryIncremental(const GaussianScaleSpacePyramid *pyramid) throw(Exception)
+{
+    // Detect feature points
+    TIMED("Detect Features")
+    {
+        mDetector.detect(pyramid);
+    }
+
+    // Bucket the previous query points by tile so they can be looked up
+    const STORE                      &previous = mQueryKeyframe->store();
+    std::vector<std::vector<size_t>> previous_buckets(mReuseTilesX * mReuseTilesY);
+    for (size_t i = 0; i < previous.size(); i++)
+    {
+        const FeaturePoint &p = previous.point(i);
+        size_t             tx = std::min((size_t)std::max(p.x, 0.f) / mReuseTileSize, mReuseTilesX - 1);
+        size_t             ty = std::min((size_t)std::max(p.y, 0.f) / mReuseTileSize, mReuseTilesY - 1);
+        previous_buckets[ty * mReuseTilesX + tx].push_back(i);
+    }
+
+    // Split the new points into those whose descriptor can be carried over
+    // from the previous query and those which need to be extracted
+    std::vector<FeaturePoint> extract_points;
+    std::vector<FeaturePoint> reuse_points;
+    std::vector<size_t>       reuse_index;
+    std::vector<float>        extract_scores;
+    std::vector<float>        reuse_scores;
+    extract_points.reserve(mDetector.features().size());
+    for (size_t i = 0; i < mDetector.features().size(); i++)
+    {
+        const DoGScaleInvariantDetector::FeaturePoint &dp = mDetector.features()[i];
+        FeaturePoint p(dp.x, dp.y, dp.angle, dp.sigma, dp.score > 0);
+
+        // Does the support of the descriptor lie in unchanged tiles only?
+        float  r         = mFeatureExtractor.supportRadius(p.scale);
+        int    tx0       = std::max((int)std::floor((p.x - r) / mReuseTileSize), 0);
+        int    ty0       = std::max((int)std::floor((p.y - r) / mReuseTileSize), 0);
+        int    tx1       = std::min((int)std::floor((p.x + r) / mReuseTileSize), (int)mReuseTilesX - 1);
+        int    ty1       = std::min((int)std::floor((p.y + r) / mReuseTileSize), (int)mReuseTilesY - 1);
+        bool   unchanged = true;
+        for (int ty = ty0; ty <= ty1 && unchanged; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                if (mReuseTileChanged[ty * mReuseTilesX + tx])
+                {
+                    unchanged = false;
+                    break;
+                }
+            }
+        }
+
+        // Find the same point in the previous query
+        int match = -1;
+        if (unchanged)
+        {
+            size_t                     tx     = std::min((size_t)std::max(p.x, 0.f) / mReuseTileSize, mReuseTilesX - 1);
+            size_t                     ty     = std::min((size_t)std::max(p.y, 0.f) / mReuseTileSize, mReuseTilesY - 1);
+            const std::vector<size_t> &bucket = previous_buckets[ty * mReuseTilesX + tx];
+            for (size_t j = 0; j < bucket.size(); j++)
+            {
+                const FeaturePoint &q          = previous.point(bucket[j]);
+                float              angle_diff = std::abs(q.angle - p.angle);
+                if (angle_diff > PI)
+                {
+                    angle_diff = 2 * PI - angle_diff;
+                }
+                if (q.maxima == p.maxima &&
+                    std::abs(q.x - p.x) < 0.5f &&
+                    std::abs(q.y - p.y) < 0.5f &&
+                    std::abs(q.scale - p.scale) < 0.05f * p.scale &&
+                    angle_diff < 0.05f)
+                {
+                    match = (int)bucket[j];
+                    break;
+                }
+            }
+        }
+
+        if (match >= 0)
+        {
+            reuse_points.push_back(p);
+            reuse_index.push_back(match);
+            reuse_scores.push_back(std::abs(dp.score));
+        }
+        else
+        {
+            extract_points.push_back(p);
+            extract_scores.push_back(std::abs(dp.score));
+        }
+    }
+
+    // Extract the descriptors that could not be carried over and append the rest
+    keyframe_ptr_t keyframe = newQueryKeyframe((int)pyramid->images()[0].width(), (int)pyramid->images()[0].height());
+    TIMED("Extract Features")
+    {
+        mFeatureExtractor.extract(keyframe->store(), pyramid, extract_points, &mExtractedIndexBuffer);
+    }
+
+    STORE  &store          = keyframe->store();
+    size_t num_extracted   = store.size();
+    int    bytes_per_point = store.numBytesPerFeature();
+    store.resize(num_extracted + reuse_points.size());
+    for (size_t i = 0; i < reuse_points.size(); i++)
+    {
+        store.point(num_extracted + i) = reuse_points[i];
+        memcpy(store.feature(num_extracted + i), previous.feature(reuse_index[i]), bytes_per_point);
+    }
+    mNumReusedQueryFeatures = reuse_points.size();
+
+    mQueryScores.resize(num_extracted);
+    for (size_t i = 0; i < num_extracted; i++)
+    {
+        mQueryScores[i] = extract_scores[mExtractedIndexBuffer[i]];
+    }
+    mQueryScores.insert(mQueryScores.end(), reuse_scores.begin(), reuse_scores.end());
+    LOG_INFO("Found %d features in query (%d reused)", store.size(), reuse_points.size());
+
+    setQueryKeyframe(keyframe);
+    return query(mQueryKeyframe.get());
 }
 
 template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
 bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::query(const GaussianScaleSpacePyramid *pyramid) throw(Exception)
 {
+    mReuseValid             = false;
+    mNumReusedQueryFeatures = 0;
+
     // Allocate detector
     if (mDetector.width() != pyramid->images()[0].width() ||
         mDetector.height() != pyramid->images()[0].height())
@@ -182,26 +477,35 @@ bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::query(const GaussianScal
     }
 
     // Find the features on the image
-    mQueryKeyframe.reset(new keyframe_t());
-    mQueryKeyframe->setWidth((int)pyramid->images()[0].width());
-    mQueryKeyframe->setHeight((int)pyramid->images()[0].height());
+    setQueryKeyframe(newQueryKeyframe((int)pyramid->images()[0].width(), (int)pyramid->images()[0].height()));
     TIMED("Extract Features")
     {
-        FindFeatures<FEATURE_EXTRACTOR, kBytesPerFeature>(mQueryKeyframe.get(), pyramid, &mDetector, &mFeatureExtractor);
+        FindFeatures<FEATURE_EXTRACTOR, kBytesPerFeature>(mQueryKeyframe.get(), pyramid, &mDetector, &mFeatureExtractor, mFeaturePointsBuffer, &mExtractedIndexBuffer);
     }
     LOG_INFO("Found %d features in query", mQueryKeyframe->store().size());
 
+    mQueryScores.resize(mExtractedIndexBuffer.size());
+    for (size_t i = 0; i < mQueryScores.size(); i++)
+    {
+        mQueryScores[i] = std::abs(mDetector.features()[mExtractedIndexBuffer[i]].score);
+    }
+
     return query(mQueryKeyframe.get());
 }
 
 template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
 bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::query(const keyframe_t *query_keyframe) throw(Exception)
 {
+    if (mProgressiveBatchSize > 0 &&
+        mUseFeatureIndex &&
+        query_keyframe->store().size() > mProgressiveBatchSize)
+    {
+        return queryProgressive(query_keyframe);
+    }
+
     mMatchedInliers.clear();
     mMatchedId = -1;
 
-    const std::vector<FeaturePoint> &query_points = query_keyframe->store().points();
-
     // Loop over all the images in the database
     typename keyframe_map_t::const_iterator it = mKeyframeMap.begin();
 
@@ -225,156 +529,283 @@ bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::query(const keyframe_t *
             }
         }
 
-        const std::vector<FeaturePoint> &ref_points = it->second->store().points();
-        // std::cout<<"ref_points-"<<ref_points.size()<<std::endl;
-        // std::cout<<"query_points-"<<query_points.size()<<std::endl;
-
-        //
-        // Vote for a transformation based on the correspondences
-        //
-
-        int max_hough_index = -1;
-        TIMED("Hough Voting (1)")
+        matches_t &inliers = mInliersBuffer;
+        float     H[9];
+        if (!verifyMatches(inliers, H, query_keyframe, it->second.get(), mMatcher.matches()))
         {
-            max_hough_index = FindHoughSimilarity(mHoughSimilarityVoting,
-                                                  query_points,
-                                                  ref_points,
-                                                  mMatcher.matches(),
-                                                  query_keyframe->width(),
-                                                  query_keyframe->height(),
-                                                  it->second->width(),
-                                                  it->second->height());
-            if (max_hough_index < 0)
-            {
-                continue;
-            }
+            continue;
         }
 
-        matches_t hough_matches;
-        TIMED("Find Hough Matches (1)")
+        // std::cout<<"inliers-"<<inliers.size()<<std::endl;
+        if (inliers.size() >= mMinNumInliers && inliers.size() > mMatchedInliers.size())
         {
-            FindHoughMatches(hough_matches,
-                             mHoughSimilarityVoting,
-                             mMatcher.matches(),
-                             max_hough_index,
-                             kHoughBinDelta);
+            CopyVector9(mMatchedGeometry, H);
+            mMatchedInliers.swap(inliers);
+            mMatchedId = it->first;
         }
+    }
+
+    return mMatchedId >= 0;
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::queryProgressive(const keyframe_t *query_keyframe) throw(Exception)
+{
+    mMatchedInliers.clear();
+    mMatchedId = -1;
+
+    const STORE &query_store = query_keyframe->store();
+    size_t      num_points   = query_store.size();
+
+    // Visit the query features strongest first (ties in original order). The
+    // scores always match the features of a keyframe this database detected;
+    // a keyframe supplied by the caller has none, so is visited in order.
+    std::vector<std::pair<float, size_t>> &ranked = mProgressiveRanking;
+    ranked.resize(num_points);
+    for (size_t i = 0; i < num_points; i++)
+    {
+        ranked[i] = std::make_pair(mQueryScores.size() == num_points ? mQueryScores[i] : 0.f, num_points - i);
+    }
+    std::sort(ranked.begin(), ranked.end(), std::greater<std::pair<float, size_t>>());
+
+    std::vector<size_t> &order = mProgressiveOrder;
+    order.resize(num_points);
+    for (size_t i = 0; i < num_points; i++)
+    {
+        order[i] = num_points - ranked[i].second;
+    }
 
-        //
-        // Estimate the transformation between the two images
-        //
+    // The features matched so far, in score order
+    keyframe_t &batch_keyframe = mProgressiveKeyframe;
+    batch_keyframe.setWidth(query_keyframe->width());
+    batch_keyframe.setHeight(query_keyframe->height());
+    STORE &batch_store = batch_keyframe.store();
+    batch_store.setNumBytesPerFeature(query_store.numBytesPerFeature());
+    batch_store.resize(0);
+
+    // Putative matches accumulated over the batches, per database keyframe
+    std::vector<matches_t> &keyframe_matches = mProgressiveMatches;
+    keyframe_matches.resize(mKeyframeMap.size());
+    for (size_t k = 0; k < keyframe_matches.size(); k++)
+    {
+        keyframe_matches[k].clear();
+    }
+    size_t num_queried = 0;
+
+    while (num_queried < num_points)
+    {
+        size_t begin = num_queried;
+        size_t end   = std::min(num_queried + mProgressiveBatchSize, num_points);
+
+        batch_store.resize(end);
+        for (size_t i = begin; i < end; i++)
+        {
+            batch_store.point(i) = query_store.point(order[i]);
+            memcpy(batch_store.feature(i), query_store.feature(order[i]), query_store.numBytesPerFeature());
+        }
+        num_queried = end;
 
-        float H[9];
-        TIMED("Estimate Homography (1)")
+        typename keyframe_map_t::const_iterator it = mKeyframeMap.begin();
+        for (size_t k = 0; it != mKeyframeMap.end(); it++, k++)
         {
-            if (!EstimateHomography(H,
-                                    query_points,
-                                    ref_points,
-                                    hough_matches,
-                                    mRobustHomography,
-                                    it->second->width(),
-                                    it->second->height()))
+            TIMED("Find Matches (1)")
+            {
+                mMatcher.match(&batch_store, &it->second->store(), it->second->index(), begin, end);
+                keyframe_matches[k].insert(keyframe_matches[k].end(), mMatcher.matches().begin(), mMatcher.matches().end());
+            }
+            if (keyframe_matches[k].size() < mMinNumInliers)
             {
                 continue;
             }
-        }
-
-        //
-        // Find the inliers
-        //
 
-        matches_t inliers;
-        TIMED("Find Inliers (1)")
-        {
-            FindInliers(inliers, H, query_points, ref_points, hough_matches, mHomographyInlierThreshold);
-            if (inliers.size() < mMinNumInliers)
+            matches_t &inliers = mInliersBuffer;
+            float     H[9];
+            if (!verifyMatches(inliers, H, &batch_keyframe, it->second.get(), keyframe_matches[k]))
             {
                 continue;
             }
+
+            if (inliers.size() >= mMinNumInliers && inliers.size() > mMatchedInliers.size())
+            {
+                CopyVector9(mMatchedGeometry, H);
+                mMatchedInliers.swap(inliers);
+                mMatchedId = it->first;
+            }
+        }
+
+        if (mMatchedId >= 0 && mMatchedInliers.size() >= mProgressiveInlierThreshold)
+        {
+            break;
         }
+    }
+    LOG_INFO("Progressive query stopped after %d of %d features", num_queried, num_points);
+
+    // Refer the inliers back to the query keyframe
+    for (size_t i = 0; i < mMatchedInliers.size(); i++)
+    {
+        mMatchedInliers[i].ins = (int)order[mMatchedInliers[i].ins];
+    }
+
+    return mMatchedId >= 0;
+}
+
+template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
+bool VisualDatabase<FEATURE_EXTRACTOR, STORE, MATCHER>::verifyMatches(matches_t &inliers,
+                                                                       float H[9],
+                                                                       const keyframe_t *query_keyframe,
+                                                                       const keyframe_t *ref_keyframe,
+                                                                       const matches_t &matches)
+{
+    const std::vector<FeaturePoint> &query_points = query_keyframe->store().points();
+    const std::vector<FeaturePoint> &ref_points = ref_keyframe->store().points();
+
+    inliers.clear();
+    // std::cout<<"ref_points-"<<ref_points.size()<<std::endl;
+    // std::cout<<"query_points-"<<query_points.size()<<std::endl;
 
-        //
-        // Use the estimated homography to find more inliers
-        //
+    //
+    // Vote for a transformation based on the correspondences
+    //
 
-        TIMED("Find Matches (2)")
+    int max_hough_index = -1;
+    TIMED("Hough Voting (1)")
+    {
+        max_hough_index = FindHoughSimilarity(mHoughSimilarityVoting,
+                                              query_points,
+                                              ref_points,
+                                              matches,
+                                              query_keyframe->width(),
+                                              query_keyframe->height(),
+                                              ref_keyframe->width(),
+                                              ref_keyframe->height(),
+                                              mHoughQueryBuffer,
+                                              mHoughRefBuffer);
+        if (max_hough_index < 0)
         {
-            if (mMatcher.match(&query_keyframe->store(),
-                               &it->second->store(),
-                               H,
-                               10) < mMinNumInliers)
-            {
-                continue;
-            }
+            return false;
         }
+    }
 
-        //
-        // Vote for a similarity with new matches
-        //
+    matches_t &hough_matches = mHoughMatchesBuffer;
+    TIMED("Find Hough Matches (1)")
+    {
+        FindHoughMatches(hough_matches,
+                         mHoughSimilarityVoting,
+                         matches,
+                         max_hough_index,
+                         kHoughBinDelta);
+    }
 
-        TIMED("Hough Voting (2)")
+    //
+    // Estimate the transformation between the two images
+    //
+
+    TIMED("Estimate Homography (1)")
+    {
+        if (!EstimateHomography(H,
+                                query_points,
+                                ref_points,
+                                hough_matches,
+                                mRobustHomography,
+                                ref_keyframe->width(),
+                                ref_keyframe->height(),
+                                mHomographySrcBuffer,
+                                mHomographyDstBuffer))
         {
-            max_hough_index = FindHoughSimilarity(mHoughSimilarityVoting,
-                                                  query_points,
-                                                  ref_points,
-                                                  mMatcher.matches(),
-                                                  query_keyframe->width(),
-                                                  query_keyframe->height(),
-                                                  it->second->width(),
-                                                  it->second->height());
-            if (max_hough_index < 0)
-            {
-                continue;
-            }
+            return false;
         }
+    }
+
+    //
+    // Find the inliers
+    //
 
-        TIMED("Find Hough Matches (2)")
+    TIMED("Find Inliers (1)")
+    {
+        FindInliers(inliers, H, query_points, ref_points, hough_matches, mHomographyInlierThreshold);
+        if (inliers.size() < mMinNumInliers)
         {
-            FindHoughMatches(hough_matches,
-                             mHoughSimilarityVoting,
-                             mMatcher.matches(),
-                             max_hough_index,
-                             kHoughBinDelta);
+            return false;
         }
+    }
 
-        //
-        // Re-estimate the homography
-        //
+    //
+    // Use the estimated homography to find more inliers
+    //
 
-        TIMED("Estimate Homography (2)")
+    TIMED("Find Matches (2)")
+    {
+        if (mMatcher.match(&query_keyframe->store(),
+                           &ref_keyframe->store(),
+                           H,
+                           10) < mMinNumInliers)
         {
-            if (!EstimateHomography(H,
-                                    query_points,
-                                    ref_points,
-                                    hough_matches,
-                                    mRobustHomography,
-                                    it->second->width(),
-                                    it->second->height()))
-            {
-                continue;
-            }
+            return false;
         }
+    }
 
-        //
-        // Check if this is the best match based on number of inliers
-        //
+    //
+    // Vote for a similarity with new matches
+    //
 
-        inliers.clear();
-        TIMED("Find Inliers (2)")
+    TIMED("Hough Voting (2)")
+    {
+        max_hough_index = FindHoughSimilarity(mHoughSimilarityVoting,
+                                              query_points,
+                                              ref_points,
+                                              mMatcher.matches(),
+                                              query_keyframe->width(),
+                                              query_keyframe->height(),
+                                              ref_keyframe->width(),
+                                              ref_keyframe->height(),
+                                              mHoughQueryBuffer,
+                                              mHoughRefBuffer);
+        if (max_hough_index < 0)
         {
-            FindInliers(inliers, H, query_points, ref_points, hough_matches, mHomographyInlierThreshold);
+            return false;
         }
+    }
 
-        // std::cout<<"inliers-"<<inliers.size()<<std::endl;
-        if (inliers.size() >= mMinNumInliers && inliers.size() > mMatchedInliers.size())
+    TIMED("Find Hough Matches (2)")
+    {
+        FindHoughMatches(hough_matches,
+                         mHoughSimilarityVoting,
+                         mMatcher.matches(),
+                         max_hough_index,
+                         kHoughBinDelta);
+    }
+
+    //
+    // Re-estimate the homography
+    //
+
+    TIMED("Estimate Homography (2)")
+    {
+        if (!EstimateHomography(H,
+                                query_points,
+                                ref_points,
+                                hough_matches,
+                                mRobustHomography,
+                                ref_keyframe->width(),
+                                ref_keyframe->height(),
+                                mHomographySrcBuffer,
+                                mHomographyDstBuffer))
         {
-            CopyVector9(mMatchedGeometry, H);
-            mMatchedInliers.swap(inliers);
-            mMatchedId = it->first;
+            return false;
         }
     }
 
-    return mMatchedId >= 0;
+    //
+    // Check if this is the best match based on number of inliers
+    //
+
+    inliers.clear();
+    TIMED("Find Inliers (2)")
+    {
+        FindInliers(inliers, H, query_points, ref_points, hough_matches, mHomographyInlierThreshold);
+    }
+
+    return true;
 }
 
 template<typename FEATURE_EXTRACTOR, typename STORE, typename MATCHER>
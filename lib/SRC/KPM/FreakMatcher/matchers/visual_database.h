@@ -104,6 +104,50 @@ bool query(const Image &image) throw(Exception);
 bool query(const GaussianScaleSpacePyramid *pyramid) throw(Exception);
 bool query(const keyframe_t *query_keyframe) throw(Exception);
 
+/**
+ * Enable progressive querying. Query features are matched in batches of
+ * BATCH_SIZE, strongest first, and each database image with enough putative
+ * matches is verified after every batch. The query stops as soon as an image
+ * has at least INLIER_THRESHOLD verified inliers. A BATCH_SIZE of 0 disables
+ * progressive querying, so that all features are matched at once.
+ */
+void setProgressiveQuery(size_t batch_size, size_t inlier_threshold);
+
+/**
+ * @return Batch size for progressive querying, or 0 if disabled.
+ */
+inline size_t progressiveBatchSize() const
+{
+    return mProgressiveBatchSize;
+}
+
+/**
+ * Enable reuse of query features between consecutive image queries. The query
+ * image is divided into TILE_SIZE x TILE_SIZE tiles, and a tile is considered
+ * changed when its mean absolute luma difference from the image its features
+ * were computed from exceeds THRESHOLD. Descriptors of points whose support
+ * lies only in unchanged tiles are carried over rather than re-extracted, and
+ * if no tile has changed the previous query features are reused as they are.
+ * A TILE_SIZE of 0 disables reuse.
+ */
+void setQueryFeatureReuse(int tile_size, int threshold);
+
+/**
+ * @return Tile size for query feature reuse, or 0 if disabled.
+ */
+inline int queryFeatureReuseTileSize() const
+{
+    return mReuseTileSize;
+}
+
+/**
+ * @return Number of query descriptors carried over from the previous query.
+ */
+inline size_t numReusedQueryFeatures() const
+{
+    return mNumReusedQueryFeatures;
+}
+
 /**
  * Erase an ID.
  */
@@ -204,6 +248,51 @@ inline size_t minNumInliers() const
 
 private:
 
+/**
+ * @return A keyframe for the next query, reusing the storage of an earlier one
+ * where possible.
+ */
+keyframe_ptr_t newQueryKeyframe(int width, int height);
+
+/**
+ * Make KEYFRAME the current query keyframe.
+ */
+void setQueryKeyframe(keyframe_ptr_t keyframe);
+
+/**
+ * Geometrically verify the putative MATCHES between a query and a database
+ * keyframe, refining them with a guided search.
+ * @return False if no homography was found, otherwise the homography H and its INLIERS
+ */
+bool verifyMatches(matches_t &inliers,
+                   float H[9],
+                   const keyframe_t *query_keyframe,
+                   const keyframe_t *ref_keyframe,
+                   const matches_t &matches);
+
+/**
+ * Query the database in score-ordered batches of query features.
+ */
+bool queryProgressive(const keyframe_t *query_keyframe) throw(Exception);
+
+/**
+ * Mark the tiles of IMAGE that differ from the reuse reference.
+ * @return Number of changed tiles
+ */
+size_t findChangedTiles(const Image &image);
+
+/**
+ * Copy the changed tiles (or the whole image if ALL is set) of IMAGE to the
+ * reuse reference.
+ */
+void updateReuseReference(const Image &image, bool all);
+
+/**
+ * Detect features on PYRAMID, extracting descriptors only for points whose
+ * support overlaps a changed tile, and query with the result.
+ */
+bool queryIncremental(const GaussianScaleSpacePyramid *pyramid) throw(Exception);
+
 size_t mMinNumInliers;
 float  mHomographyInlierThreshold;
 
@@ -236,16 +325,55 @@ HoughSimilarityVoting mHoughSimilarityVoting;
 
 // Robust homography estimation
 RobustHomography<float> mRobustHomography;
+
+// Progressive querying
+size_t mProgressiveBatchSize;
+size_t mProgressiveInlierThreshold;
+
+// Absolute detector score of each query feature
+std::vector<float>  mQueryScores;
+std::vector<size_t> mExtractedIndexBuffer;
+
+// Query keyframe storage that can be reused by the next query
+keyframe_ptr_t mSpareQueryKeyframe;
+
+// Buffers reused between queries
+std::vector<FeaturePoint>             mFeaturePointsBuffer;
+matches_t                             mHoughMatchesBuffer;
+matches_t                             mInliersBuffer;
+std::vector<float>                    mHoughQueryBuffer;
+std::vector<float>                    mHoughRefBuffer;
+std::vector<vision::Point2d<float>>   mHomographySrcBuffer;
+std::vector<vision::Point2d<float>>   mHomographyDstBuffer;
+keyframe_t                            mProgressiveKeyframe;
+std::vector<matches_t>                mProgressiveMatches;
+std::vector<std::pair<float, size_t>> mProgressiveRanking;
+std::vector<size_t>                   mProgressiveOrder;
+
+// Query feature reuse
+int                        mReuseTileSize;
+int                        mReuseThreshold;
+bool                       mReuseValid;
+size_t                     mReuseWidth;
+size_t                     mReuseHeight;
+size_t                     mReuseTilesX;
+size_t                     mReuseTilesY;
+std::vector<unsigned char> mReuseReference;
+std::vector<unsigned char> mReuseTileChanged;
+size_t                     mNumReusedQueryFeatures;
 };     // VisualDatabase
 
 /**
- * Find feature points in an image.
+ * Find feature points in an image. If EXTRACTED is not NULL, on return it holds
+ * the index in the detector's features of each feature in the keyframe.
  */
 template<typename FEATURE_EXTRACTOR, int NUM_BYTES_PER_FEATURE>
 void FindFeatures(Keyframe<NUM_BYTES_PER_FEATURE> *keyframe,
                   const GaussianScaleSpacePyramid *pyramid,
                   DoGScaleInvariantDetector *detector,
-                  FEATURE_EXTRACTOR *extractor)
+                  FEATURE_EXTRACTOR *extractor,
+                  std::vector<FeaturePoint> &points,
+                  std::vector<size_t> *extracted = NULL)
 {
     ASSERT(pyramid, "Pyramid is NULL");
     ASSERT(detector, "Detector is NULL");
@@ -263,7 +391,7 @@ void FindFeatures(Keyframe<NUM_BYTES_PER_FEATURE> *keyframe,
     // Copy the points
     //
 
-    std::vector<FeaturePoint> points(detector->features().size());
+    points.resize(detector->features().size());
 
     for (size_t i = 0; i < detector->features().size(); i++)
     {
@@ -275,7 +403,7 @@ void FindFeatures(Keyframe<NUM_BYTES_PER_FEATURE> *keyframe,
     // Extract features
     //
 
-    extractor->extract(keyframe->store(), pyramid, points);
+    extractor->extract(keyframe->store(), pyramid, points, extracted);
 }
 
 /**
@@ -329,10 +457,17 @@ inline int FindHoughSimilarity(HoughSimilarityVoting &hough,
                                int insWidth,
                                int insHeigth,
                                int refWidth,
-                               int refHeight)
+                               int refHeight,
+                               std::vector<float> &query,
+                               std::vector<float> &ref)
 {
-    std::vector<float> query(4 * matches.size());
-    std::vector<float> ref(4 * matches.size());
+    if (matches.empty())
+    {
+        return -1;
+    }
+
+    query.resize(4 * matches.size());
+    ref.resize(4 * matches.size());
 
     // Extract the data from the features
     for (size_t i = 0; i < matches.size(); i++)
@@ -412,10 +547,17 @@ inline bool EstimateHomography(float H[9],
                                const matches_t &matches,
                                RobustHomography<float> &estimator,
                                int refWidth,
-                               int refHeight)
+                               int refHeight,
+                               std::vector<vision::Point2d<float>> &srcPoints,
+                               std::vector<vision::Point2d<float>> &dstPoints)
 {
-    std::vector<vision::Point2d<float>> srcPoints(matches.size());
-    std::vector<vision::Point2d<float>> dstPoints(matches.size());
+    if (matches.empty())
+    {
+        return false;
+    }
+
+    srcPoints.resize(matches.size());
+    dstPoints.resize(matches.size());
 
     //
     // Copy correspondences
@@ -0,0 +1,138 @@
+/*
+ *  kpmFileMap.c
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC. All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <KPM/kpm.h>
+#include "kpmFileMap.h"
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+KpmFileMap* kpmFileMapOpen(const char *filename, const char *ext)
+{
+    KpmFileMap *fileMap;
+    char       *buf;
+    size_t     len;
+
+    if (!filename)
+        return (NULL);
+
+    len = strlen(filename) + (ext ? strlen(ext) + 1 : 0) + 1;
+    arMalloc(buf, char, len);
+    if (ext)
+        sprintf(buf, "%s.%s", filename, ext);
+    else
+        strcpy(buf, filename);
+
+    arMallocClear(fileMap, KpmFileMap, 1);
+
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    fileMap->file = CreateFileA(buf, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileMap->file == INVALID_HANDLE_VALUE)
+        goto bail;
+
+    if (!GetFileSizeEx(fileMap->file, &size) || size.QuadPart == 0)
+        goto bail1;
+
+    fileMap->size    = (size_t)size.QuadPart;
+    fileMap->mapping = CreateFileMapping(fileMap->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!fileMap->mapping)
+        goto bail1;
+
+    fileMap->base = (const unsigned char*)MapViewOfFile(fileMap->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!fileMap->base)
+    {
+        CloseHandle(fileMap->mapping);
+        goto bail1;
+    }
+
+    free(buf);
+    return (fileMap);
+
+bail1:
+    CloseHandle(fileMap->file);
+#else
+    struct stat st;
+    void        *base;
+    int         fd;
+
+    fd = open(buf, O_RDONLY);
+    if (fd < 0)
+        goto bail;
+
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        close(fd);
+        goto bail;
+    }
+
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference to the file.
+    if (base == MAP_FAILED)
+        goto bail;
+
+    fileMap->base = (const unsigned char*)base;
+    fileMap->size = (size_t)st.st_size;
+
+    free(buf);
+    return (fileMap);
+#endif
+
+bail:
+    free(fileMap);
+    free(buf);
+    return (NULL);
+}
+
+void kpmFileMapClose(KpmFileMap *fileMap)
+{
+    if (!fileMap)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(fileMap->base);
+    CloseHandle(fileMap->mapping);
+    CloseHandle(fileMap->file);
+#else
+    munmap((void*)fileMap->base, fileMap->size);
+#endif
+    free(fileMap);
+}
@@ -90,6 +90,11 @@ static KpmHandle* kpmCreateHandleCore(ARParamLT *cparamLT, int xsize, int ysize,
     kpmHandle->detectedMaxFeature = -1;
 #if !BINARY_FEATURE
     kpmHandle->surfThreadNum = -1;
+#else
+    kpmHandle->reuseTileSize              = 0;
+    kpmHandle->reuseThreshold             = 0;
+    kpmHandle->progressiveBatchSize       = 0;
+    kpmHandle->progressiveInlierThreshold = 0;
 #endif
 
     kpmHandle->refDataSet.refPoint = NULL;
@@ -99,6 +104,9 @@ static KpmHandle* kpmCreateHandleCore(ARParamLT *cparamLT, int xsize, int ysize,
 
     kpmHandle->inDataSet.coord = NULL;
     kpmHandle->inDataSet.num   = 0;
+    kpmHandle->inDataSetMax    = 0;
+    kpmHandle->inImageBW       = NULL;
+    kpmHandle->inImageBWSize   = 0;
 
 #if !BINARY_FEATURE
     kpmHandle->preRANSAC.num   = 0;
@@ -262,6 +270,62 @@ int kpmSetSurfThreadNum(KpmHandle *kpmHandle, int surfThreadNum)
     return 0;
 }
 
+int kpmSetProgressiveMatching(KpmHandle *kpmHandle, int batchSize, int inlierThreshold)
+{
+#if BINARY_FEATURE
+    if (!kpmHandle || batchSize < 0 || inlierThreshold < 0)
+        return -1;
+
+    kpmHandle->progressiveBatchSize       = batchSize;
+    kpmHandle->progressiveInlierThreshold = inlierThreshold;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+int kpmGetProgressiveMatching(KpmHandle *kpmHandle, int *batchSize, int *inlierThreshold)
+{
+#if BINARY_FEATURE
+    if (!kpmHandle || !batchSize || !inlierThreshold)
+        return -1;
+
+    *batchSize       = kpmHandle->progressiveBatchSize;
+    *inlierThreshold = kpmHandle->progressiveInlierThreshold;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+int kpmSetFeatureReuse(KpmHandle *kpmHandle, int tileSize, int threshold)
+{
+#if BINARY_FEATURE
+    if (!kpmHandle || tileSize < 0 || threshold < 0)
+        return -1;
+
+    kpmHandle->reuseTileSize  = tileSize;
+    kpmHandle->reuseThreshold = threshold;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+int kpmGetFeatureReuse(KpmHandle *kpmHandle, int *tileSize, int *threshold)
+{
+#if BINARY_FEATURE
+    if (!kpmHandle || !tileSize || !threshold)
+        return -1;
+
+    *tileSize  = kpmHandle->reuseTileSize;
+    *threshold = kpmHandle->reuseThreshold;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
 
 
 int kpmDeleteHandle(KpmHandle **kpmHandle)
@@ -314,6 +378,8 @@ int kpmDeleteHandle(KpmHandle **kpmHandle)
         free((*kpmHandle)->inDataSet.coord);
     }
 
+    free((*kpmHandle)->inImageBW);
+
     free(*kpmHandle);
     *kpmHandle = NULL;
 
@@ -42,6 +42,7 @@
 
 #include <KPM/kpm.h>
 #include "kpmPrivate.h"
+#include "kpmFileMap.h"
 #if BINARY_FEATURE
 extern "C" {
 #  include <jpeglib.h>
@@ -199,11 +200,10 @@ int kpmLoadImageDb(KpmHandle *kpmHandle, const char *filename)
 int kpmSetRefDataSet(KpmHandle *kpmHandle, KpmRefDataSet *refDataSet)
 {
 #if !BINARY_FEATURE
-    CAnnMatch2 *ann2;
-#endif
-
+    CAnnMatch2    *ann2;
     FeatureVector featureVector;
-    int           i, j;
+#endif
+    int i, j;
 
     if (!kpmHandle || !refDataSet)
     {
@@ -331,7 +331,8 @@ int kpmSetRefDataSet(KpmHandle *kpmHandle, KpmRefDataSet *refDataSet)
 #else
     if (kpmHandle->refDataSet.num != 0)
     {
-        featureVector.num = kpmHandle->refDataSet.num;
+        std::vector<std::vector<int> > groups;
+        kpmRefDataSetGroupByImage(&(kpmHandle->refDataSet), groups);
 
         int db_id = 0;
 
@@ -339,26 +340,25 @@ int kpmSetRefDataSet(KpmHandle *kpmHandle, KpmRefDataSet *refDataSet)
         {
             for (int m = 0; m < kpmHandle->refDataSet.pageInfo[k].imageNum; m++)
             {
+                const std::vector<int>              &group = groups[db_id];
                 std::vector<vision::FeaturePoint>   points;
                 std::vector<vision::Point3d<float>> points_3d;
                 std::vector<unsigned char>          descriptors;
 
-                for (int i = 0; i < featureVector.num; i++)
+                points.reserve(group.size());
+                points_3d.reserve(group.size());
+                descriptors.reserve(group.size() * FREAK_SUB_DIMENSION);
+
+                for (size_t n = 0; n < group.size(); n++)
                 {
-                    if (kpmHandle->refDataSet.refPoint[i].refImageNo == kpmHandle->refDataSet.pageInfo[k].imageInfo[m].imageNo
-                        && kpmHandle->refDataSet.refPoint[i].pageNo == kpmHandle->refDataSet.pageInfo[k].pageNo)
-                    {
-                        points.push_back(vision::FeaturePoint(kpmHandle->refDataSet.refPoint[i].coord2D.x,
-                                                              kpmHandle->refDataSet.refPoint[i].coord2D.y,
-                                                              kpmHandle->refDataSet.refPoint[i].featureVec.angle,
-                                                              kpmHandle->refDataSet.refPoint[i].featureVec.scale,
-                                                              kpmHandle->refDataSet.refPoint[i].featureVec.maxima));
-                        points_3d.push_back(vision::Point3d<float>(kpmHandle->refDataSet.refPoint[i].coord3D.x,
-                                                                   kpmHandle->refDataSet.refPoint[i].coord3D.y,                                                                  0));
-
-                        for (int j = 0; j < FREAK_SUB_DIMENSION; j++)
-                            descriptors.push_back(kpmHandle->refDataSet.refPoint[i].featureVec.v[j]);
-                    }
+                    const KpmRefData &refPoint = kpmHandle->refDataSet.refPoint[group[n]];
+                    points.push_back(vision::FeaturePoint(refPoint.coord2D.x,
+                                                          refPoint.coord2D.y,
+                                                          refPoint.featureVec.angle,
+                                                          refPoint.featureVec.scale,
+                                                          refPoint.featureVec.maxima));
+                    points_3d.push_back(vision::Point3d<float>(refPoint.coord3D.x, refPoint.coord3D.y, 0));
+                    descriptors.insert(descriptors.end(), refPoint.featureVec.v, refPoint.featureVec.v + FREAK_SUB_DIMENSION);
                 }
 
                 ARLOGi("points-%d\n", points.size());
@@ -381,6 +381,11 @@ int kpmSetRefDataSetFile(KpmHandle *kpmHandle, const char *filename, const char
         return -1;
     }
 
+#if BINARY_FEATURE
+    if (kpmRefDataSetFileIsIndexed(filename, ext) == 1)
+        return (kpmSetRefDataSetFilesMapped(kpmHandle, &filename, ext, NULL, 1));
+#endif
+
     if (kpmLoadRefDataSet(filename, ext, &refDataSet) < 0)
         return -1;
 
@@ -395,6 +400,184 @@ int kpmSetRefDataSetFile(KpmHandle *kpmHandle, const char *filename, const char
     return 0;
 }
 
+#if BINARY_FEATURE
+static void kpmFileMapRelease(KpmFileMap *fileMap)
+{
+    kpmFileMapClose(fileMap);
+}
+
+// Adds the keyframes of one indexed file to the matcher, collecting its page and image info.
+static int kpmAddRefDataSetFileMapped(KpmHandle *kpmHandle, const char *filename, const char *ext, const int *pageNo, int *db_id,
+                                      std::vector<int> &pageNos, std::vector<std::vector<KpmImageInfo> > &imageInfos)
+{
+    KpmFileMap               *fileMap;
+    const KpmIndexedKeyframe *keyframes;
+    int                      keyframeNum;
+    int                      i, j;
+
+    fileMap = kpmFileMapOpen(filename, ext);
+    if (!fileMap)
+    {
+        ARLOGe("Error loading KPM data: unable to map file '%s%s%s' for reading.\n", filename, (ext ? "." : ""), (ext ? ext : ""));
+        return (-1);
+    }
+
+    // Every keyframe built from this file holds a reference; the file is unmapped when the last is released.
+    std::shared_ptr<const void> owner(fileMap, kpmFileMapRelease);
+
+    keyframes = kpmIndexedGetKeyframes(fileMap->base, fileMap->size, &keyframeNum);
+    if (!keyframes)
+    {
+        ARLOGe("Error loading KPM data: '%s%s%s' is not a valid indexed dataset.\n", filename, (ext ? "." : ""), (ext ? ext : ""));
+        return (-1);
+    }
+
+    for (i = 0; i < keyframeNum; i++)
+    {
+        const KpmIndexedKeyframe *kf = &keyframes[i];
+        KpmImageInfo             imageInfo;
+        int                      page;
+
+        page = (pageNo && kf->pageNo >= 0) ? *pageNo : kf->pageNo;
+
+        if (kf->featureNum > 0)
+        {
+            if (*db_id >= DB_IMAGE_MAX)
+            {
+                ARLOGe("Error loading KPM data: more than %d images.\n", DB_IMAGE_MAX);
+                return (-1);
+            }
+
+            if (!kpmHandle->freakMatcher->addMappedKeyframe((const vision::FeaturePoint*)(fileMap->base + kf->pointsOffset),
+                                                            fileMap->base + kf->featuresOffset,
+                                                            (const vision::Point3d<float>*)(fileMap->base + kf->points3DOffset),
+                                                            kf->featureNum,
+                                                            (const vision::index_node_record_t*)(fileMap->base + kf->nodesOffset),
+                                                            kf->nodeNum,
+                                                            (const int*)(fileMap->base + kf->reverseIndexOffset),
+                                                            kf->reverseIndexNum,
+                                                            kf->width,
+                                                            kf->height,
+                                                            *db_id,
+                                                            owner))
+            {
+                ARLOGe("Error loading KPM data: corrupt feature index in '%s%s%s'.\n", filename, (ext ? "." : ""), (ext ? ext : ""));
+                return (-1);
+            }
+
+            kpmHandle->pageIDs[(*db_id)++] = page;
+        }
+
+        imageInfo.width   = kf->width;
+        imageInfo.height  = kf->height;
+        imageInfo.imageNo = kf->imageNo;
+
+        for (j = 0; j < (int)pageNos.size(); j++)
+            if (pageNos[j] == page)
+                break;
+
+        if (j == (int)pageNos.size())
+        {
+            pageNos.push_back(page);
+            imageInfos.push_back(std::vector<KpmImageInfo>());
+        }
+
+        imageInfos[j].push_back(imageInfo);
+    }
+
+    return (0);
+}
+#endif // BINARY_FEATURE
+
+int kpmSetRefDataSetFilesMapped(KpmHandle *kpmHandle, const char *filenames[], const char *ext, const int pageNos[], int num)
+{
+#if BINARY_FEATURE
+    std::vector<int>                        pages;
+    std::vector<std::vector<KpmImageInfo> > imageInfos;
+    int                                     db_id;
+    int                                     i;
+
+    if (!kpmHandle || !filenames || num <= 0)
+    {
+        ARLOGe("kpmSetRefDataSetFilesMapped(): NULL kpmHandle/filenames or no files.\n");
+        return -1;
+    }
+
+    // Start from an empty database. Dropping the old keyframes also releases any files they mapped.
+    delete kpmHandle->freakMatcher;
+    kpmHandle->freakMatcher = new vision::VisualDatabaseFacade;
+
+    if (kpmHandle->refDataSet.refPoint != NULL)
+    {
+        free(kpmHandle->refDataSet.refPoint);
+        kpmHandle->refDataSet.refPoint = NULL;
+    }
+
+    kpmHandle->refDataSet.num = 0;
+
+    if (kpmHandle->refDataSet.pageInfo != NULL)
+    {
+        for (i = 0; i < kpmHandle->refDataSet.pageNum; i++)
+        {
+            if (kpmHandle->refDataSet.pageInfo[i].imageInfo != NULL)
+                free(kpmHandle->refDataSet.pageInfo[i].imageInfo);
+        }
+
+        free(kpmHandle->refDataSet.pageInfo);
+        kpmHandle->refDataSet.pageInfo = NULL;
+    }
+
+    kpmHandle->refDataSet.pageNum = 0;
+
+    if (kpmHandle->result != NULL)
+    {
+        free(kpmHandle->result);
+        kpmHandle->result    = NULL;
+        kpmHandle->resultNum = 0;
+    }
+
+    db_id = 0;
+
+    for (i = 0; i < num; i++)
+    {
+        if (kpmAddRefDataSetFileMapped(kpmHandle, filenames[i], ext, (pageNos ? &pageNos[i] : NULL), &db_id, pages, imageInfos) < 0)
+        {
+            delete kpmHandle->freakMatcher;
+            kpmHandle->freakMatcher = new vision::VisualDatabaseFacade;
+            return -1;
+        }
+    }
+
+    // The points themselves stay in the mapped files; only page and image info is kept in the handle's dataset.
+    kpmHandle->refDataSet.pageNum = (int)pages.size();
+    if (kpmHandle->refDataSet.pageNum > 0)
+    {
+        arMalloc(kpmHandle->refDataSet.pageInfo, KpmPageInfo, kpmHandle->refDataSet.pageNum);
+
+        for (i = 0; i < kpmHandle->refDataSet.pageNum; i++)
+        {
+            kpmHandle->refDataSet.pageInfo[i].pageNo   = pages[i];
+            kpmHandle->refDataSet.pageInfo[i].imageNum = (int)imageInfos[i].size();
+            arMalloc(kpmHandle->refDataSet.pageInfo[i].imageInfo, KpmImageInfo, imageInfos[i].size());
+            memcpy(kpmHandle->refDataSet.pageInfo[i].imageInfo, &imageInfos[i][0], imageInfos[i].size() * sizeof(KpmImageInfo));
+        }
+
+        kpmHandle->resultNum = kpmHandle->refDataSet.pageNum;
+        arMalloc(kpmHandle->result, KpmResult, kpmHandle->resultNum);
+
+        for (i = 0; i < kpmHandle->resultNum; i++)
+        {
+            kpmHandle->result[i].skipF = 0;
+        }
+    }
+
+    return 0;
+#else
+    ARLOGe("kpmSetRefDataSetFilesMapped(): indexed datasets require binary features.\n");
+    return -1;
+#endif
+}
+
 int kpmSetRefDataSetFileOld(KpmHandle *kpmHandle, const char *filename, const char *ext)
 {
     KpmRefDataSet *refDataSet;
@@ -509,16 +692,21 @@ int kpmMatching(KpmHandle *kpmHandle, ARUint8 *inImage)
     if (procMode == KpmProcFullSize && (kpmHandle->pixFormat == AR_PIXEL_FORMAT_MONO || kpmHandle->pixFormat == AR_PIXEL_FORMAT_420v || kpmHandle->pixFormat == AR_PIXEL_FORMAT_420f || kpmHandle->pixFormat == AR_PIXEL_FORMAT_NV21))
     {
         inImageBW = inImage;
+        xsize2    = xsize;
+        ysize2    = ysize;
     }
     else
     {
-        inImageBW = kpmUtilGenBWImage(inImage, kpmHandle->pixFormat, xsize, ysize, procMode, &xsize2, &ysize2);
+        inImageBW = kpmUtilGenBWImageBuffer(inImage, kpmHandle->pixFormat, xsize, ysize, procMode, &xsize2, &ysize2,
+                                            &kpmHandle->inImageBW, &kpmHandle->inImageBWSize);
         if (inImageBW == NULL)
             return -1;
     }
 
 #if BINARY_FEATURE
-    kpmHandle->freakMatcher->query(inImageBW, xsize, ysize);
+    kpmHandle->freakMatcher->setProgressiveQuery(kpmHandle->progressiveBatchSize, kpmHandle->progressiveInlierThreshold);
+    kpmHandle->freakMatcher->setQueryFeatureReuse(kpmHandle->reuseTileSize, kpmHandle->reuseThreshold);
+    kpmHandle->freakMatcher->query(inImageBW, xsize2, ysize2);
     kpmHandle->inDataSet.num = (int)kpmHandle->freakMatcher->getQueryFeaturePoints().size();
 #else
     surfSubExtractFeaturePoint(kpmHandle->surfHandle, inImageBW, kpmHandle->skipRegion.region, kpmHandle->skipRegion.regionNum);
@@ -528,21 +716,26 @@ int kpmMatching(KpmHandle *kpmHandle, ARUint8 *inImage)
 
     if (kpmHandle->inDataSet.num != 0)
     {
-        if (kpmHandle->inDataSet.coord != NULL)
-            free(kpmHandle->inDataSet.coord);
+        // Per-query buffers only ever grow, so are not reallocated once they are large enough.
+        if (kpmHandle->inDataSet.num > kpmHandle->inDataSetMax)
+        {
+            if (kpmHandle->inDataSet.coord != NULL)
+                free(kpmHandle->inDataSet.coord);
 
 #if !BINARY_FEATURE
-        if (kpmHandle->preRANSAC.match != NULL)
-            free(kpmHandle->preRANSAC.match);
+            if (kpmHandle->preRANSAC.match != NULL)
+                free(kpmHandle->preRANSAC.match);
 
-        if (kpmHandle->aftRANSAC.match != NULL)
-            free(kpmHandle->aftRANSAC.match);
+            if (kpmHandle->aftRANSAC.match != NULL)
+                free(kpmHandle->aftRANSAC.match);
 #endif
-        arMalloc(kpmHandle->inDataSet.coord, KpmCoord2D,     kpmHandle->inDataSet.num);
+            arMalloc(kpmHandle->inDataSet.coord, KpmCoord2D,     kpmHandle->inDataSet.num);
 #if !BINARY_FEATURE
-        arMalloc(kpmHandle->preRANSAC.match, KpmMatchData,   kpmHandle->inDataSet.num);
-        arMalloc(kpmHandle->aftRANSAC.match, KpmMatchData,   kpmHandle->inDataSet.num);
+            arMalloc(kpmHandle->preRANSAC.match, KpmMatchData,   kpmHandle->inDataSet.num);
+            arMalloc(kpmHandle->aftRANSAC.match, KpmMatchData,   kpmHandle->inDataSet.num);
 #endif
+            kpmHandle->inDataSetMax = kpmHandle->inDataSet.num;
+        }
 #if BINARY_FEATURE
 #else
         arMalloc(featureVector.sf,           SurfFeature,    kpmHandle->inDataSet.num);
@@ -836,9 +1029,6 @@ int kpmMatching(KpmHandle *kpmHandle, ARUint8 *inImage)
     for (i = 0; i < kpmHandle->resultNum; i++)
         kpmHandle->result[i].skipF = 0;
 
-    if (inImageBW != inImage)
-        free(inImageBW);
-
     return 0;
 }
 
@@ -36,12 +36,57 @@
 #ifndef __kpmPrivate_h__
 #define __kpmPrivate_h__
 
+#include <stdint.h>
+#include <vector>
 #if BINARY_FEATURE
 #include <facade/visual_database_facade.h>
 #else
 #include <KPM/surfSub.h>
 #endif
 #define DB_IMAGE_MAX 1024
+
+// Indexed .fset3 layout. A header is followed by one KpmIndexedKeyframe
+// record per image, and then by the per-keyframe data sections, each of
+// which starts at a multiple of KPM_INDEXED_ALIGN bytes from the start of
+// the file. Multi-byte values are in host byte order, as for the plain format.
+#define KPM_INDEXED_MAGIC   "KPMI"
+#define KPM_INDEXED_VERSION 1
+#define KPM_INDEXED_ALIGN   16
+
+typedef struct
+{
+    char    magic[4];
+    int32_t version;
+    int32_t bytesPerFeature;
+    int32_t featurePointSize;       // sizeof(vision::FeaturePoint) of the writer.
+    int32_t nodeRecordSize;         // sizeof(vision::index_node_record_t) of the writer.
+    int32_t keyframeNum;
+    int32_t reserved[2];
+} KpmIndexedHeader;
+
+typedef struct
+{
+    int32_t  pageNo;
+    int32_t  imageNo;
+    int32_t  width;
+    int32_t  height;
+    int32_t  featureNum;
+    int32_t  nodeNum;
+    int32_t  reverseIndexNum;
+    int32_t  reserved;
+    uint64_t pointsOffset;          // vision::FeaturePoint[featureNum]
+    uint64_t points3DOffset;        // vision::Point3d<float>[featureNum]
+    uint64_t featuresOffset;        // unsigned char[featureNum * bytesPerFeature]
+    uint64_t nodesOffset;           // vision::index_node_record_t[nodeNum]
+    uint64_t reverseIndexOffset;    // int32_t[reverseIndexNum]
+} KpmIndexedKeyframe;
+
+// Checks the header and keyframe table of an indexed .fset3 file held in memory.
+// Returns the keyframe table (and its length in *keyframeNum), or NULL if the data is not a valid indexed file.
+const KpmIndexedKeyframe* kpmIndexedGetKeyframes(const unsigned char *base, size_t size, int *keyframeNum);
+
+// Collects, for every image of every page of 'refDataSet' (in pageInfo order), the indices of its refPoints.
+void kpmRefDataSetGroupByImage(const KpmRefDataSet *refDataSet, std::vector<std::vector<int> > &groups);
 #if !BINARY_FEATURE
 typedef struct
 {
@@ -76,10 +121,18 @@ struct _KpmHandle
     int             detectedMaxFeature;
 #if !BINARY_FEATURE
     int surfThreadNum;
+#else
+    int reuseTileSize;
+    int reuseThreshold;
+    int progressiveBatchSize;
+    int progressiveInlierThreshold;
 #endif
 
     KpmRefDataSet   refDataSet;
     KpmInputDataSet inDataSet;
+    int             inDataSetMax;       // Capacity of inDataSet.coord (and the RANSAC match arrays).
+    ARUint8         *inImageBW;         // Reusable luma buffer for non-mono formats or reduced processing sizes.
+    int             inImageBWSize;
 #if !BINARY_FEATURE
     KpmMatchResult preRANSAC;
     KpmMatchResult aftRANSAC;
@@ -37,11 +37,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <map>
 #include <AR/ar.h>
 #include <KPM/kpm.h>
 #include <KPM/kpmType.h>
 #include "kpmPrivate.h"
 #include "kpmFopen.h"
+#include "kpmFileMap.h"
 
 #if BINARY_FEATURE
 #include <facade/visual_database_facade.h>
@@ -622,11 +625,383 @@ bailBadWrite:
     return -1;
 }
 
+void kpmRefDataSetGroupByImage(const KpmRefDataSet *refDataSet, std::vector<std::vector<int> > &groups)
+{
+    std::map<std::pair<int, int>, std::vector<int> >                 groupsOfImage;
+    std::map<std::pair<int, int>, std::vector<int> >::const_iterator it;
+    int                                                              groupNum;
+    int                                                              i, j;
+
+    groupNum = 0;
+
+    for (i = 0; i < refDataSet->pageNum; i++)
+    {
+        for (j = 0; j < refDataSet->pageInfo[i].imageNum; j++)
+        {
+            groupsOfImage[std::make_pair(refDataSet->pageInfo[i].pageNo, refDataSet->pageInfo[i].imageInfo[j].imageNo)].push_back(groupNum++);
+        }
+    }
+
+    groups.assign(groupNum, std::vector<int>());
+
+    // One pass over the points, rather than one pass per image.
+    for (i = 0; i < refDataSet->num; i++)
+    {
+        it = groupsOfImage.find(std::make_pair(refDataSet->refPoint[i].pageNo, refDataSet->refPoint[i].refImageNo));
+        if (it == groupsOfImage.end())
+            continue;
+
+        for (j = 0; j < (int)it->second.size(); j++)
+        {
+            groups[it->second[j]].push_back(i);
+        }
+    }
+}
+
+#if BINARY_FEATURE
+static uint64_t kpmIndexedAlign(uint64_t offset)
+{
+    return ((offset + KPM_INDEXED_ALIGN - 1) / KPM_INDEXED_ALIGN * KPM_INDEXED_ALIGN);
+}
+
+// Pads the file with zeroes up to 'offset', then writes 'size' bytes of 'data'.
+static int kpmIndexedWriteSection(FILE *fp, uint64_t *pos, uint64_t offset, const void *data, size_t size)
+{
+    static const unsigned char zero[KPM_INDEXED_ALIGN] = {0};
+    size_t                     n;
+
+    while (*pos < offset)
+    {
+        n = (size_t)(offset - *pos < sizeof(zero) ? offset - *pos : sizeof(zero));
+        if (fwrite(zero, 1, n, fp) != n)
+            return (-1);
+
+        *pos += n;
+    }
+
+    if (size && fwrite(data, 1, size, fp) != size)
+        return (-1);
+
+    *pos += size;
+    return (0);
+}
+
+// Checks that 'num' elements of 'elemSize' bytes at 'offset' lie within the file and are aligned.
+static bool kpmIndexedSectionValid(uint64_t offset, int32_t num, size_t elemSize, size_t size)
+{
+    if (num < 0 || offset % KPM_INDEXED_ALIGN != 0 || offset > size)
+        return (false);
+
+    return ((uint64_t)num <= (size - offset) / elemSize);
+}
+#endif // BINARY_FEATURE
+
+const KpmIndexedKeyframe* kpmIndexedGetKeyframes(const unsigned char *base, size_t size, int *keyframeNum)
+{
+#if BINARY_FEATURE
+    const KpmIndexedHeader   *header;
+    const KpmIndexedKeyframe *keyframes;
+    int                      i;
+
+    if (!base || size < sizeof(KpmIndexedHeader))
+        return (NULL);
+
+    header = (const KpmIndexedHeader*)base;
+    if (memcmp(header->magic, KPM_INDEXED_MAGIC, sizeof(header->magic)) != 0)
+        return (NULL);
+
+    if (header->version != KPM_INDEXED_VERSION)
+    {
+        ARLOGe("Error loading KPM data: unsupported indexed dataset version %d.\n", header->version);
+        return (NULL);
+    }
+
+    if (header->bytesPerFeature != FREAK_SUB_DIMENSION || header->featurePointSize != (int32_t)sizeof(vision::FeaturePoint)
+        || header->nodeRecordSize != (int32_t)sizeof(vision::index_node_record_t))
+    {
+        ARLOGe("Error loading KPM data: indexed dataset was written with an incompatible layout.\n");
+        return (NULL);
+    }
+
+    if (header->keyframeNum < 0 || (uint64_t)header->keyframeNum > (size - sizeof(KpmIndexedHeader)) / sizeof(KpmIndexedKeyframe))
+        goto bail;
+
+    keyframes = (const KpmIndexedKeyframe*)(base + sizeof(KpmIndexedHeader));
+
+    for (i = 0; i < header->keyframeNum; i++)
+    {
+        const KpmIndexedKeyframe *kf = &keyframes[i];
+
+        if (!kpmIndexedSectionValid(kf->pointsOffset,       kf->featureNum,      sizeof(vision::FeaturePoint), size)
+            || !kpmIndexedSectionValid(kf->points3DOffset,  kf->featureNum,      sizeof(vision::Point3d<float>), size)
+            || !kpmIndexedSectionValid(kf->featuresOffset,  kf->featureNum,      FREAK_SUB_DIMENSION, size)
+            || !kpmIndexedSectionValid(kf->nodesOffset,     kf->nodeNum,         sizeof(vision::index_node_record_t), size)
+            || !kpmIndexedSectionValid(kf->reverseIndexOffset, kf->reverseIndexNum, sizeof(int32_t), size))
+            goto bail;
+
+        if (kf->featureNum > 0 && kf->nodeNum <= 0)
+            goto bail;
+    }
+
+    *keyframeNum = header->keyframeNum;
+    return (keyframes);
+
+bail:
+    ARLOGe("Error loading KPM data: indexed dataset is truncated or corrupt.\n");
+    return (NULL);
+#else
+    return (NULL);
+#endif
+}
+
+int kpmSaveRefDataSetIndexed(const char *filename, const char *ext, KpmRefDataSet *refDataSet)
+{
+#if BINARY_FEATURE
+    KpmIndexedHeader                                   header;
+    std::vector<KpmIndexedKeyframe>                    keyframes;
+    std::vector<std::vector<int> >                     groups;
+    std::vector<std::vector<vision::FeaturePoint> >    points;
+    std::vector<std::vector<vision::Point3d<float> > > points3D;
+    std::vector<std::vector<unsigned char> >           descriptors;
+    std::vector<std::vector<vision::index_node_record_t> > nodes;
+    std::vector<std::vector<int> >                     reverseIndex;
+    vision::VisualDatabaseFacade                       freakMatcher;
+    FILE                                               *fp;
+    char                                               fmode[] = "wb";
+    uint64_t                                           offset, pos;
+    int                                                keyframeNum;
+    int                                                i, j, k;
+
+    if (!filename || !refDataSet)
+    {
+        ARLOGe("kpmSaveRefDataSetIndexed(): NULL filename/refDataSet.\n");
+        return (-1);
+    }
+
+    kpmRefDataSetGroupByImage(refDataSet, groups);
+    keyframeNum = (int)groups.size();
+
+    keyframes.resize(keyframeNum);
+    points.resize(keyframeNum);
+    points3D.resize(keyframeNum);
+    descriptors.resize(keyframeNum);
+    nodes.resize(keyframeNum);
+    reverseIndex.resize(keyframeNum);
+
+    // Build the same keyframes and indices kpmSetRefDataSet() would, and lay them out.
+    offset = kpmIndexedAlign(sizeof(KpmIndexedHeader) + keyframeNum * sizeof(KpmIndexedKeyframe));
+    k      = 0;
+
+    for (i = 0; i < refDataSet->pageNum; i++)
+    {
+        for (j = 0; j < refDataSet->pageInfo[i].imageNum; j++, k++)
+        {
+            KpmIndexedKeyframe *kf = &keyframes[k];
+
+            for (size_t l = 0; l < groups[k].size(); l++)
+            {
+                const KpmRefData *ref = &(refDataSet->refPoint[groups[k][l]]);
+                points[k].push_back(vision::FeaturePoint(ref->coord2D.x, ref->coord2D.y, ref->featureVec.angle, ref->featureVec.scale, ref->featureVec.maxima != 0));
+                points3D[k].push_back(vision::Point3d<float>(ref->coord3D.x, ref->coord3D.y, 0));
+                descriptors[k].insert(descriptors[k].end(), ref->featureVec.v, ref->featureVec.v + FREAK_SUB_DIMENSION);
+            }
+
+            if (!points[k].empty())
+            {
+                freakMatcher.addFreakFeaturesAndDescriptors(points[k], descriptors[k], points3D[k], refDataSet->pageInfo[i].imageInfo[j].width, refDataSet->pageInfo[i].imageInfo[j].height, k);
+                freakMatcher.getIndexRecords(k, nodes[k], reverseIndex[k]);
+            }
+
+            memset(kf, 0, sizeof(KpmIndexedKeyframe));
+            kf->pageNo             = refDataSet->pageInfo[i].pageNo;
+            kf->imageNo            = refDataSet->pageInfo[i].imageInfo[j].imageNo;
+            kf->width              = refDataSet->pageInfo[i].imageInfo[j].width;
+            kf->height             = refDataSet->pageInfo[i].imageInfo[j].height;
+            kf->featureNum         = (int32_t)points[k].size();
+            kf->nodeNum            = (int32_t)nodes[k].size();
+            kf->reverseIndexNum    = (int32_t)reverseIndex[k].size();
+            kf->pointsOffset       = offset;
+            offset                 = kpmIndexedAlign(offset + kf->featureNum * sizeof(vision::FeaturePoint));
+            kf->points3DOffset     = offset;
+            offset                 = kpmIndexedAlign(offset + kf->featureNum * sizeof(vision::Point3d<float>));
+            kf->featuresOffset     = offset;
+            offset                 = kpmIndexedAlign(offset + kf->featureNum * FREAK_SUB_DIMENSION);
+            kf->nodesOffset        = offset;
+            offset                 = kpmIndexedAlign(offset + kf->nodeNum * sizeof(vision::index_node_record_t));
+            kf->reverseIndexOffset = offset;
+            offset                 = kpmIndexedAlign(offset + kf->reverseIndexNum * sizeof(int32_t));
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KPM_INDEXED_MAGIC, sizeof(header.magic));
+    header.version          = KPM_INDEXED_VERSION;
+    header.bytesPerFeature  = FREAK_SUB_DIMENSION;
+    header.featurePointSize = (int32_t)sizeof(vision::FeaturePoint);
+    header.nodeRecordSize   = (int32_t)sizeof(vision::index_node_record_t);
+    header.keyframeNum      = keyframeNum;
+
+    fp = kpmFopen(filename, ext, fmode);
+    if (fp == NULL)
+    {
+        ARLOGe("Error saving KPM data: unable to open file '%s%s%s' for writing.\n", filename, (ext ? "." : ""), (ext ? ext : ""));
+        return (-1);
+    }
+
+    pos = 0;
+    if (kpmIndexedWriteSection(fp, &pos, 0, &header, sizeof(header)) < 0)
+        goto bailBadWrite;
+
+    if (keyframeNum && kpmIndexedWriteSection(fp, &pos, pos, &keyframes[0], keyframeNum * sizeof(KpmIndexedKeyframe)) < 0)
+        goto bailBadWrite;
+
+    for (k = 0; k < keyframeNum; k++)
+    {
+        if (!keyframes[k].featureNum)
+            continue;
+
+        if (kpmIndexedWriteSection(fp, &pos, keyframes[k].pointsOffset,       &points[k][0],       points[k].size() * sizeof(vision::FeaturePoint)) < 0
+            || kpmIndexedWriteSection(fp, &pos, keyframes[k].points3DOffset,  &points3D[k][0],     points3D[k].size() * sizeof(vision::Point3d<float>)) < 0
+            || kpmIndexedWriteSection(fp, &pos, keyframes[k].featuresOffset,  &descriptors[k][0],  descriptors[k].size()) < 0
+            || kpmIndexedWriteSection(fp, &pos, keyframes[k].nodesOffset,     &nodes[k][0],        nodes[k].size() * sizeof(vision::index_node_record_t)) < 0
+            || kpmIndexedWriteSection(fp, &pos, keyframes[k].reverseIndexOffset, &reverseIndex[k][0], reverseIndex[k].size() * sizeof(int32_t)) < 0)
+            goto bailBadWrite;
+    }
+
+    fclose(fp);
+    return (0);
+
+bailBadWrite:
+    ARLOGe("Error saving KPM data: error writing data.\n");
+    fclose(fp);
+    return (-1);
+#else
+    ARLOGe("kpmSaveRefDataSetIndexed(): indexed datasets require binary features.\n");
+    return (-1);
+#endif
+}
+
+int kpmRefDataSetFileIsIndexed(const char *filename, const char *ext)
+{
+    FILE *fp;
+    char fmode[] = "rb";
+    char magic[4];
+    int  ret;
+
+    fp = kpmFopen(filename, ext, fmode);
+    if (!fp)
+        return (-1);
+
+    ret = (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, KPM_INDEXED_MAGIC, sizeof(magic)) == 0);
+    fclose(fp);
+
+    return (ret);
+}
+
+// Unpacks an indexed file into a plain KpmRefDataSet, e.g. for merging or display.
+static int kpmLoadRefDataSetIndexed(const char *filename, const char *ext, KpmRefDataSet **refDataSetPtr)
+{
+#if BINARY_FEATURE
+    KpmFileMap               *fileMap;
+    const KpmIndexedKeyframe *keyframes;
+    KpmRefDataSet            *refDataSet;
+    std::vector<int>         pageNos;
+    std::vector<std::vector<KpmImageInfo> > imageInfos;
+    int                      keyframeNum;
+    int                      i, j, k;
+
+    fileMap = kpmFileMapOpen(filename, ext);
+    if (!fileMap)
+    {
+        ARLOGe("Error loading KPM data: unable to map file '%s%s%s' for reading.\n", filename, (ext ? "." : ""), (ext ? ext : ""));
+        return (-1);
+    }
+
+    keyframes = kpmIndexedGetKeyframes(fileMap->base, fileMap->size, &keyframeNum);
+    if (!keyframes)
+    {
+        kpmFileMapClose(fileMap);
+        return (-1);
+    }
+
+    arMallocClear(refDataSet, KpmRefDataSet, 1);
+
+    for (k = 0; k < keyframeNum; k++)
+        refDataSet->num += keyframes[k].featureNum;
+
+    if (refDataSet->num)
+        arMalloc(refDataSet->refPoint, KpmRefData, refDataSet->num);
+
+    i = 0;
+
+    for (k = 0; k < keyframeNum; k++)
+    {
+        const KpmIndexedKeyframe     *kf         = &keyframes[k];
+        const vision::FeaturePoint   *points     = (const vision::FeaturePoint*)(fileMap->base + kf->pointsOffset);
+        const vision::Point3d<float> *points3D   = (const vision::Point3d<float>*)(fileMap->base + kf->points3DOffset);
+        const unsigned char          *features   = fileMap->base + kf->featuresOffset;
+        KpmImageInfo                 imageInfo;
+
+        for (j = 0; j < kf->featureNum; j++, i++)
+        {
+            KpmRefData *ref = &(refDataSet->refPoint[i]);
+            ref->coord2D.x         = points[j].x;
+            ref->coord2D.y         = points[j].y;
+            ref->coord3D.x         = points3D[j].x;
+            ref->coord3D.y         = points3D[j].y;
+            memcpy(ref->featureVec.v, features + j * FREAK_SUB_DIMENSION, FREAK_SUB_DIMENSION);
+            ref->featureVec.angle  = points[j].angle;
+            ref->featureVec.scale  = points[j].scale;
+            ref->featureVec.maxima = (int)points[j].maxima;
+            ref->pageNo            = kf->pageNo;
+            ref->refImageNo        = kf->imageNo;
+        }
+
+        imageInfo.width   = kf->width;
+        imageInfo.height  = kf->height;
+        imageInfo.imageNo = kf->imageNo;
+
+        for (j = 0; j < (int)pageNos.size(); j++)
+            if (pageNos[j] == kf->pageNo)
+                break;
+
+        if (j == (int)pageNos.size())
+        {
+            pageNos.push_back(kf->pageNo);
+            imageInfos.push_back(std::vector<KpmImageInfo>());
+        }
+
+        imageInfos[j].push_back(imageInfo);
+    }
+
+    kpmFileMapClose(fileMap);
+
+    refDataSet->pageNum = (int)pageNos.size();
+    if (refDataSet->pageNum)
+        arMalloc(refDataSet->pageInfo, KpmPageInfo, refDataSet->pageNum);
+
+    for (i = 0; i < refDataSet->pageNum; i++)
+    {
+        refDataSet->pageInfo[i].pageNo   = pageNos[i];
+        refDataSet->pageInfo[i].imageNum = (int)imageInfos[i].size();
+        arMalloc(refDataSet->pageInfo[i].imageInfo, KpmImageInfo, refDataSet->pageInfo[i].imageNum);
+        memcpy(refDataSet->pageInfo[i].imageInfo, &imageInfos[i][0], refDataSet->pageInfo[i].imageNum * sizeof(KpmImageInfo));
+    }
+
+    *refDataSetPtr = refDataSet;
+    return (0);
+#else
+    ARLOGe("Error loading KPM data: indexed datasets require binary features.\n");
+    return (-1);
+#endif
+}
+
 int kpmLoadRefDataSet(const char *filename, const char *ext, KpmRefDataSet **refDataSetPtr)
 {
     KpmRefDataSet *refDataSet;
     FILE          *fp;
     char          fmode[] = "rb";
+    char          magic[4];
     int           i, j;
 
     if (!filename || !refDataSetPtr)
@@ -642,6 +1017,14 @@ int kpmLoadRefDataSet(const char *filename, const char *ext, KpmRefDataSet **ref
         return (-1);
     }
 
+    if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, KPM_INDEXED_MAGIC, sizeof(magic)) == 0)
+    {
+        fclose(fp);
+        return (kpmLoadRefDataSetIndexed(filename, ext, refDataSetPtr));
+    }
+
+    rewind(fp);
+
     arMallocClear(refDataSet, KpmRefDataSet, 1);
 
     if (fread(&(refDataSet->num), sizeof(int), 1, fp) != 1)
@@ -652,28 +1035,38 @@ int kpmLoadRefDataSet(const char *filename, const char *ext, KpmRefDataSet **ref
 
     arMalloc(refDataSet->refPoint, KpmRefData, refDataSet->num); // each KpmRefData = 68 floats, 3 ints = 284 bytes.
 
-    for (i = 0; i < refDataSet->num; i++)
+    // The file holds the fields of each refPoint back-to-back. When KpmRefData has no padding, that is
+    // exactly its in-memory layout, so read the whole array at once.
+    if (sizeof(KpmRefData) == 2 * sizeof(KpmCoord2D) + sizeof(((KpmRefData*)0)->featureVec) + 2 * sizeof(int))
     {
-        if (fread(&(refDataSet->refPoint[i].coord2D), sizeof(KpmCoord2D), 1, fp) != 1)
+        if (fread(refDataSet->refPoint, sizeof(KpmRefData), refDataSet->num, fp) != (size_t)refDataSet->num)
             goto bailBadRead;
+    }
+    else
+    {
+        for (i = 0; i < refDataSet->num; i++)
+        {
+            if (fread(&(refDataSet->refPoint[i].coord2D), sizeof(KpmCoord2D), 1, fp) != 1)
+                goto bailBadRead;
 
-        if (fread(&(refDataSet->refPoint[i].coord3D), sizeof(KpmCoord2D), 1, fp) != 1)
-            goto bailBadRead;
+            if (fread(&(refDataSet->refPoint[i].coord3D), sizeof(KpmCoord2D), 1, fp) != 1)
+                goto bailBadRead;
 
 #if BINARY_FEATURE
-        if (fread(&(refDataSet->refPoint[i].featureVec), sizeof(FreakFeature), 1, fp) != 1)
-            goto bailBadRead;
+            if (fread(&(refDataSet->refPoint[i].featureVec), sizeof(FreakFeature), 1, fp) != 1)
+                goto bailBadRead;
 
 #else
-        if (fread(&(refDataSet->refPoint[i].featureVec), sizeof(SurfFeature), 1, fp) != 1)
-            goto bailBadRead;
+            if (fread(&(refDataSet->refPoint[i].featureVec), sizeof(SurfFeature), 1, fp) != 1)
+                goto bailBadRead;
 #endif
 
-        if (fread(&(refDataSet->refPoint[i].pageNo),     sizeof(int), 1, fp) != 1)
-            goto bailBadRead;
+            if (fread(&(refDataSet->refPoint[i].pageNo),     sizeof(int), 1, fp) != 1)
+                goto bailBadRead;
 
-        if (fread(&(refDataSet->refPoint[i].refImageNo), sizeof(int), 1, fp) != 1)
-            goto bailBadRead;
+            if (fread(&(refDataSet->refPoint[i].refImageNo), sizeof(int), 1, fp) != 1)
+                goto bailBadRead;
+        }
     }
 
     if (fread(&(refDataSet->pageNum), sizeof(int), 1, fp) != 1)
@@ -37,6 +37,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <AR/ar.h>
 #include <AR/icp.h>
 #include <KPM/kpm.h>
@@ -48,11 +49,23 @@
 #include <KPM/surfSub.h>
 #endif
 
-static ARUint8* genBWImageFull(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize);
-static ARUint8* genBWImageHalf(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize);
-static ARUint8* genBWImageOneThird(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize);
-static ARUint8* genBWImageTwoThird(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize);
-static ARUint8* genBWImageQuart(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize);
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define KPM_BW_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define KPM_BW_SSE2 1
+#endif
+
+#define KPM_BW_CHUNK 384    // Source columns per chunk in genBWImage(). Divisible by 2, 3 and 4.
+
+static int  bwPixelChannels(AR_PIXEL_FORMAT pixFormat);
+static void bwRowSums(ARUint16 *dst, const ARUint8 *src, AR_PIXEL_FORMAT pixFormat, int n);
+static void bwScaleFull(ARUint8 *dst, const ARUint16 *s0, int n, int channels);
+static void bwScaleHalf(ARUint8 *dst, const ARUint16 *s0, const ARUint16 *s1, int n, int channels);
+template <int D, int S, typename T> static void bwScaleOneThird(ARUint8 *dst, const T *s0, const T *s1, const T *s2, int n);
+template <int D, int S, typename T> static void bwScaleTwoThird(ARUint8 *dst1, ARUint8 *dst2, const T *s0, const T *s1, const T *s2, int n);
+static void bwScaleQuart(ARUint8 *dst, const ARUint16 *s0, const ARUint16 *s1, const ARUint16 *s2, const ARUint16 *s3, int n, int channels);
 
 
 #if !BINARY_FEATURE
@@ -175,28 +188,163 @@ int kpmUtilGetCorner(ARUint8 *inImage, AR_PIXEL_FORMAT pixFormat, int xsize, int
     return 0;
 }
 
-ARUint8* kpmUtilGenBWImage(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int procMode, int *newXsize, int *newYsize)
+static int kpmUtilGetBWImageSize(int xsize, int ysize, int procMode, int *newXsize, int *newYsize)
 {
     if (procMode == KpmProcFullSize)
     {
-        return genBWImageFull(image, pixFormat, xsize, ysize, newXsize, newYsize);
+        *newXsize = xsize;
+        *newYsize = ysize;
     }
     else if (procMode == KpmProcTwoThirdSize)
     {
-        return genBWImageTwoThird(image, pixFormat, xsize, ysize, newXsize, newYsize);
+        *newXsize = xsize / 3 * 2;
+        *newYsize = ysize / 3 * 2;
     }
     else if (procMode == KpmProcHalfSize)
     {
-        return genBWImageHalf(image, pixFormat, xsize, ysize, newXsize, newYsize);
+        *newXsize = xsize / 2;
+        *newYsize = ysize / 2;
     }
     else if (procMode == KpmProcOneThirdSize)
     {
-        return genBWImageOneThird(image, pixFormat, xsize, ysize, newXsize, newYsize);
+        *newXsize = xsize / 3;
+        *newYsize = ysize / 3;
     }
     else
     {
-        return genBWImageQuart(image, pixFormat, xsize, ysize, newXsize, newYsize);
+        *newXsize = xsize / 4;
+        *newYsize = ysize / 4;
     }
+
+    return (*newXsize) * (*newYsize);
+}
+
+static ARUint8* genBWImage(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int procMode, int *newXsize, int *newYsize, ARUint8 *newImage)
+{
+    ARUint16  sums[4][KPM_BW_CHUNK];
+    ARUint8  *src, *dst;
+    int       pixelSize, channels;
+    int       rows, blocks, cols;
+    int       i, j, k, n;
+
+    kpmUtilGetBWImageSize(xsize, ysize, procMode, newXsize, newYsize);
+
+    channels = bwPixelChannels(pixFormat);
+    if (!channels)
+        return newImage;
+    pixelSize = arUtilGetPixelSize(pixFormat);
+
+    if (procMode == KpmProcFullSize && pixelSize == 1)
+    {
+        memcpy(newImage, image, xsize * ysize);
+        return newImage;
+    }
+
+    // Number of source rows per block of output rows.
+    if (procMode == KpmProcFullSize)
+        rows = 1;
+    else if (procMode == KpmProcHalfSize)
+        rows = 2;
+    else if (procMode == KpmProcOneThirdSize || procMode == KpmProcTwoThirdSize)
+        rows = 3;
+    else
+        rows = 4;
+
+    if (procMode == KpmProcTwoThirdSize)
+    {
+        blocks = *newYsize / 2;
+        cols   = *newXsize / 2 * 3;
+    }
+    else
+    {
+        blocks = *newYsize;
+        cols   = *newXsize * rows;
+    }
+
+    for (j = 0; j < blocks; j++)
+    {
+        src = image + xsize * pixelSize * rows * j;
+        dst = newImage + *newXsize * (procMode == KpmProcTwoThirdSize ? 2 * j : j);
+
+        // Single-channel formats at one third and two thirds are resampled straight from the source.
+        if (channels == 1 && rows == 3)
+        {
+            if (pixelSize == 1)
+            {
+                if (procMode == KpmProcTwoThirdSize)
+                    bwScaleTwoThird<9, 1>(dst, dst + *newXsize, src, src + xsize, src + xsize * 2, cols / 3);
+                else
+                    bwScaleOneThird<9, 1>(dst, src, src + xsize, src + xsize * 2, cols / 3);
+            }
+            else
+            {
+                src += (pixFormat == AR_PIXEL_FORMAT_2vuy) ? 1 : 0;    // Offset of Y within each 2-byte pixel.
+                if (procMode == KpmProcTwoThirdSize)
+                    bwScaleTwoThird<9, 2>(dst, dst + *newXsize, src, src + xsize * 2, src + xsize * 4, cols / 3);
+                else
+                    bwScaleOneThird<9, 2>(dst, src, src + xsize * 2, src + xsize * 4, cols / 3);
+            }
+            continue;
+        }
+
+        // Otherwise process each block in column chunks so the row sums stay in cache.
+        for (i = 0; i < cols; i += KPM_BW_CHUNK)
+        {
+            n = (cols - i < KPM_BW_CHUNK) ? cols - i : KPM_BW_CHUNK;
+            for (k = 0; k < rows; k++)
+                bwRowSums(sums[k], src + (xsize * k + i) * pixelSize, pixFormat, n);
+
+            if (procMode == KpmProcFullSize)
+                bwScaleFull(dst + i, sums[0], n, channels);
+            else if (procMode == KpmProcTwoThirdSize)
+            {
+                if (channels == 3)
+                    bwScaleTwoThird<27, 1>(dst + i / 3 * 2, dst + *newXsize + i / 3 * 2, sums[0], sums[1], sums[2], n / 3);
+                else
+                    bwScaleTwoThird<9, 1>(dst + i / 3 * 2, dst + *newXsize + i / 3 * 2, sums[0], sums[1], sums[2], n / 3);
+            }
+            else if (procMode == KpmProcHalfSize)
+                bwScaleHalf(dst + i / 2, sums[0], sums[1], n / 2, channels);
+            else if (procMode == KpmProcOneThirdSize)
+            {
+                if (channels == 3)
+                    bwScaleOneThird<27, 1>(dst + i / 3, sums[0], sums[1], sums[2], n / 3);
+                else
+                    bwScaleOneThird<9, 1>(dst + i / 3, sums[0], sums[1], sums[2], n / 3);
+            }
+            else
+                bwScaleQuart(dst + i / 4, sums[0], sums[1], sums[2], sums[3], n / 4, channels);
+        }
+    }
+
+    return newImage;
+}
+
+ARUint8* kpmUtilGenBWImage(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int procMode, int *newXsize, int *newYsize)
+{
+    ARUint8 *newImage;
+
+    arMalloc(newImage, ARUint8, kpmUtilGetBWImageSize(xsize, ysize, procMode, newXsize, newYsize));
+    return genBWImage(image, pixFormat, xsize, ysize, procMode, newXsize, newYsize, newImage);
+}
+
+ARUint8* kpmUtilGenBWImageBuffer(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int procMode, int *newXsize, int *newYsize,
+                                 ARUint8 **buffer, int *bufferSize)
+{
+    int size;
+
+    if (!buffer || !bufferSize)
+        return NULL;
+
+    size = kpmUtilGetBWImageSize(xsize, ysize, procMode, newXsize, newYsize);
+    if (*buffer == NULL || *bufferSize < size)
+    {
+        free(*buffer);
+        arMalloc(*buffer, ARUint8, size);
+        *bufferSize = size;
+    }
+
+    return genBWImage(image, pixFormat, xsize, ysize, procMode, newXsize, newYsize, *buffer);
 }
 
 #if !BINARY_FEATURE
@@ -530,821 +678,288 @@ int kpmUtilGetPoseHomography(KpmMatchResult *matchData, KpmRefDataSet *refDataSe
 }
 #endif
 
-static ARUint8* genBWImageFull(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize)
+/*
+ * Luma conversion kernels.
+ *
+ * The first stage reduces each pixel of one source row to the unnormalised sum of its
+ * colour channels (or its Y value for luma formats). The second stage resamples the row
+ * sums of one block of source rows into the output, dividing by the number of samples.
+ * Integer arithmetic is the same as computing the whole box sum per output pixel, so
+ * the result is identical whether or not a SIMD path is taken.
+ */
+static int bwPixelChannels(AR_PIXEL_FORMAT pixFormat)
 {
-    ARUint8 *newImage, *p;
-    int     xsize2, ysize2;
-    int     i, j;
-
-    *newXsize = xsize2 = xsize;
-    *newYsize = ysize2 = ysize;
-    arMalloc(newImage, ARUint8, xsize * ysize);
-
-    if (pixFormat == AR_PIXEL_FORMAT_RGB || pixFormat == AR_PIXEL_FORMAT_BGR)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*image + (int)*(image + 1) + (int)*(image + 2)) / 3;
-                image += 3;
-            }
-        }
+    switch (pixFormat)
+    {
+    case AR_PIXEL_FORMAT_RGB:
+    case AR_PIXEL_FORMAT_BGR:
+    case AR_PIXEL_FORMAT_RGBA:
+    case AR_PIXEL_FORMAT_BGRA:
+    case AR_PIXEL_FORMAT_ABGR:
+    case AR_PIXEL_FORMAT_ARGB:
+        return 3;
+
+    case AR_PIXEL_FORMAT_MONO:
+    case AR_PIXEL_FORMAT_420f:
+    case AR_PIXEL_FORMAT_420v:
+    case AR_PIXEL_FORMAT_NV21:
+    case AR_PIXEL_FORMAT_2vuy:
+    case AR_PIXEL_FORMAT_yuvs:
+        return 1;
+
+    default:
+        return 0;
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_RGBA || pixFormat == AR_PIXEL_FORMAT_BGRA)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*image + (int)*(image + 1) + (int)*(image + 2)) / 3;
-                image += 4;
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_ABGR || pixFormat == AR_PIXEL_FORMAT_ARGB)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(image + 1) + (int)*(image + 2) + (int)*(image + 3)) / 3;
-                image += 4;
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_NV21)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = *(image++);
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_2vuy)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = *(image + 1);
-                image += 2;
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_yuvs)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = *image;
-                image += 2;
-            }
-        }
-    }
-
-    return newImage;
 }
 
-static ARUint8* genBWImageHalf(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize)
+static void bwRowSums(ARUint16 *dst, const ARUint8 *src, AR_PIXEL_FORMAT pixFormat, int n)
 {
-    ARUint8 *newImage;
-    ARUint8 *p, *p1, *p2;
-    int     xsize2, ysize2;
-    int     i, j;
-
-    *newXsize = xsize2 = xsize / 2;
-    *newYsize = ysize2 = ysize / 2;
-    arMalloc(newImage, ARUint8, xsize2 * ysize2);
+    int i = 0;
 
     if (pixFormat == AR_PIXEL_FORMAT_RGB || pixFormat == AR_PIXEL_FORMAT_BGR)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 3 * (j * 2 + 0);
-            p2 = image + xsize * 3 * (j * 2 + 1);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)
-                          + (int)*(p1 + 3) + (int)*(p1 + 4) + (int)*(p1 + 5)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)
-                          + (int)*(p2 + 3) + (int)*(p2 + 4) + (int)*(p2 + 5)) / 12;
-                p1 += 6;
-                p2 += 6;
-            }
-        }
+        for (; i < n; i++, src += 3)
+            dst[i] = (ARUint16)((int)src[0] + (int)src[1] + (int)src[2]);
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_RGBA || pixFormat == AR_PIXEL_FORMAT_BGRA)
+    else if (pixFormat == AR_PIXEL_FORMAT_RGBA || pixFormat == AR_PIXEL_FORMAT_BGRA
+             || pixFormat == AR_PIXEL_FORMAT_ABGR || pixFormat == AR_PIXEL_FORMAT_ARGB)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
+        // Offset of the first colour channel; the remaining byte is alpha.
+        const int c = (pixFormat == AR_PIXEL_FORMAT_ABGR || pixFormat == AR_PIXEL_FORMAT_ARGB) ? 1 : 0;
+#if KPM_BW_NEON
+        for (; i + 8 <= n; i += 8, src += 32)
         {
-            p1 = image + xsize * 4 * (j * 2 + 0);
-            p2 = image + xsize * 4 * (j * 2 + 1);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)
-                          + (int)*(p1 + 4) + (int)*(p1 + 5) + (int)*(p1 + 6)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)
-                          + (int)*(p2 + 4) + (int)*(p2 + 5) + (int)*(p2 + 6)) / 12;
-                p1 += 8;
-                p2 += 8;
-            }
+            uint8x8x4_t px = vld4_u8(src);
+            uint16x8_t  s  = vaddw_u8(vaddl_u8(px.val[c], px.val[c + 1]), px.val[c + 2]);
+            vst1q_u16(dst + i, s);
         }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_ABGR || pixFormat == AR_PIXEL_FORMAT_ARGB)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
+#elif KPM_BW_SSE2
+        const __m128i mask = _mm_set1_epi32(c ? (int)0xFFFFFF00 : 0x00FFFFFF);
+        const __m128i lo   = _mm_set1_epi16(0x00FF);
+        const __m128i one  = _mm_set1_epi16(1);
+        for (; i + 8 <= n; i += 8, src += 32)
         {
-            p1 = image + xsize * 4 * (j * 2 + 0);
-            p2 = image + xsize * 4 * (j * 2 + 1);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 1) + (int)*(p1 + 2) + (int)*(p1 + 3)
-                          + (int)*(p1 + 5) + (int)*(p1 + 6) + (int)*(p1 + 7)
-                          + (int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)
-                          + (int)*(p2 + 5) + (int)*(p2 + 6) + (int)*(p2 + 7)) / 12;
-                p1 += 8;
-                p2 += 8;
-            }
+            __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)src), mask);
+            __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + 16)), mask);
+            // Add the even and odd bytes of each 16-bit half, then the two halves of each pixel.
+            a = _mm_madd_epi16(_mm_add_epi16(_mm_and_si128(a, lo), _mm_srli_epi16(a, 8)), one);
+            b = _mm_madd_epi16(_mm_add_epi16(_mm_and_si128(b, lo), _mm_srli_epi16(b, 8)), one);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
         }
+#endif
+        for (; i < n; i++, src += 4)
+            dst[i] = (ARUint16)((int)src[c] + (int)src[c + 1] + (int)src[c + 2]);
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_NV21)
+    else if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420f
+             || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_NV21)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
+#if KPM_BW_NEON
+        for (; i + 16 <= n; i += 16, src += 16)
         {
-            p1 = image + xsize * (j * 2 + 0);
-            p2 = image + xsize * (j * 2 + 1);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1)) / 4;
-                p1 += 2;
-                p2 += 2;
-            }
+            uint8x16_t px = vld1q_u8(src);
+            vst1q_u16(dst + i, vmovl_u8(vget_low_u8(px)));
+            vst1q_u16(dst + i + 8, vmovl_u8(vget_high_u8(px)));
         }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_2vuy)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
+#elif KPM_BW_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= n; i += 16, src += 16)
         {
-            p1 = image + xsize * 2 * (j * 2 + 0);
-            p2 = image + xsize * 2 * (j * 2 + 1);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 1) + (int)*(p1 + 3)
-                          + (int)*(p2 + 1) + (int)*(p2 + 3)) / 4;
-                p1 += 4;
-                p2 += 4;
-            }
+            __m128i px = _mm_loadu_si128((const __m128i*)src);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(px, zero));
+            _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(px, zero));
         }
+#endif
+        for (; i < n; i++)
+            dst[i] = *(src++);
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_yuvs)
+    else if (pixFormat == AR_PIXEL_FORMAT_2vuy || pixFormat == AR_PIXEL_FORMAT_yuvs)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
+        // Offset of Y within each 2-byte pixel.
+        const int c = (pixFormat == AR_PIXEL_FORMAT_2vuy) ? 1 : 0;
+#if KPM_BW_NEON
+        for (; i + 8 <= n; i += 8, src += 16)
         {
-            p1 = image + xsize * 2 * (j * 2 + 0);
-            p2 = image + xsize * 2 * (j * 2 + 1);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 2)
-                          + (int)*(p2 + 0) + (int)*(p2 + 2)) / 4;
-                p1 += 4;
-                p2 += 4;
-            }
+            uint8x8x2_t px = vld2_u8(src);
+            vst1q_u16(dst + i, vmovl_u8(px.val[c]));
         }
+#elif KPM_BW_SSE2
+        const __m128i lo = _mm_set1_epi16(0x00FF);
+        for (; i + 8 <= n; i += 8, src += 16)
+        {
+            __m128i px = _mm_loadu_si128((const __m128i*)src);
+            _mm_storeu_si128((__m128i*)(dst + i), c ? _mm_srli_epi16(px, 8) : _mm_and_si128(px, lo));
+        }
+#endif
+        for (; i < n; i++, src += 2)
+            dst[i] = src[c];
     }
-
-    return newImage;
 }
 
-static ARUint8* genBWImageQuart(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize)
+#if KPM_BW_NEON
+// Exact division of 16-bit lanes by 3.
+static inline uint16x8_t bwDiv3(uint16x8_t x)
 {
-    ARUint8 *newImage;
-    ARUint8 *p, *p1, *p2, *p3, *p4;
-    int     xsize2, ysize2;
-    int     i, j;
+    uint32x4_t l = vmull_n_u16(vget_low_u16(x), 0xAAAB);
+    uint32x4_t h = vmull_n_u16(vget_high_u16(x), 0xAAAB);
+    return vshrq_n_u16(vcombine_u16(vshrn_n_u32(l, 16), vshrn_n_u32(h, 16)), 1);
+}
+#elif KPM_BW_SSE2
+// Exact division of 16-bit lanes by 3.
+static inline __m128i bwDiv3(__m128i x)
+{
+    return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16((short)0xAAAB)), 1);
+}
+#endif
 
-    *newXsize = xsize2 = xsize / 4;
-    *newYsize = ysize2 = ysize / 4;
-    arMalloc(newImage, ARUint8, xsize2 * ysize2);
+// dst[i] = s0[i] / channels
+static void bwScaleFull(ARUint8 *dst, const ARUint16 *s0, int n, int channels)
+{
+    int i = 0;
 
-    if (pixFormat == AR_PIXEL_FORMAT_RGB || pixFormat == AR_PIXEL_FORMAT_BGR)
+#if KPM_BW_NEON
+    for (; i + 8 <= n; i += 8)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 3 * (j * 4 + 0);
-            p2 = image + xsize * 3 * (j * 4 + 1);
-            p3 = image + xsize * 3 * (j * 4 + 2);
-            p4 = image + xsize * 3 * (j * 4 + 3);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)
-                          + (int)*(p1 + 3) + (int)*(p1 + 4) + (int)*(p1 + 5)
-                          + (int)*(p1 + 6) + (int)*(p1 + 7) + (int)*(p1 + 8)
-                          + (int)*(p1 + 9) + (int)*(p1 + 10) + (int)*(p1 + 11)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)
-                          + (int)*(p2 + 3) + (int)*(p2 + 4) + (int)*(p2 + 5)
-                          + (int)*(p2 + 6) + (int)*(p2 + 7) + (int)*(p2 + 8)
-                          + (int)*(p2 + 9) + (int)*(p2 + 10) + (int)*(p2 + 11)
-                          + (int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2)
-                          + (int)*(p3 + 3) + (int)*(p3 + 4) + (int)*(p3 + 5)
-                          + (int)*(p3 + 6) + (int)*(p3 + 7) + (int)*(p3 + 8)
-                          + (int)*(p3 + 9) + (int)*(p3 + 10) + (int)*(p3 + 11)
-                          + (int)*(p4 + 0) + (int)*(p4 + 1) + (int)*(p4 + 2)
-                          + (int)*(p4 + 3) + (int)*(p4 + 4) + (int)*(p4 + 5)
-                          + (int)*(p4 + 6) + (int)*(p4 + 7) + (int)*(p4 + 8)
-                          + (int)*(p4 + 9) + (int)*(p4 + 10) + (int)*(p4 + 11)) / 48;
-                p1 += 12;
-                p2 += 12;
-                p3 += 12;
-                p4 += 12;
-            }
-        }
+        uint16x8_t s = vld1q_u16(s0 + i);
+        if (channels == 3) s = bwDiv3(s);
+        vst1_u8(dst + i, vmovn_u16(s));
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_RGBA || pixFormat == AR_PIXEL_FORMAT_BGRA)
+#elif KPM_BW_SSE2
+    for (; i + 16 <= n; i += 16)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
+        __m128i a = _mm_loadu_si128((const __m128i*)(s0 + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s0 + i + 8));
+        if (channels == 3)
         {
-            p1 = image + xsize * 4 * (j * 4 + 0);
-            p2 = image + xsize * 4 * (j * 4 + 1);
-            p3 = image + xsize * 4 * (j * 4 + 2);
-            p4 = image + xsize * 4 * (j * 4 + 3);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)
-                          + (int)*(p1 + 4) + (int)*(p1 + 5) + (int)*(p1 + 6)
-                          + (int)*(p1 + 8) + (int)*(p1 + 9) + (int)*(p1 + 10)
-                          + (int)*(p1 + 12) + (int)*(p1 + 13) + (int)*(p1 + 14)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)
-                          + (int)*(p2 + 4) + (int)*(p2 + 5) + (int)*(p2 + 6)
-                          + (int)*(p2 + 8) + (int)*(p2 + 9) + (int)*(p2 + 10)
-                          + (int)*(p2 + 12) + (int)*(p2 + 13) + (int)*(p2 + 14)
-                          + (int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2)
-                          + (int)*(p3 + 4) + (int)*(p3 + 5) + (int)*(p3 + 6)
-                          + (int)*(p3 + 8) + (int)*(p3 + 9) + (int)*(p3 + 10)
-                          + (int)*(p3 + 12) + (int)*(p3 + 13) + (int)*(p3 + 14)
-                          + (int)*(p4 + 0) + (int)*(p4 + 1) + (int)*(p4 + 2)
-                          + (int)*(p4 + 4) + (int)*(p4 + 5) + (int)*(p4 + 6)
-                          + (int)*(p4 + 8) + (int)*(p4 + 9) + (int)*(p4 + 10)
-                          + (int)*(p4 + 12) + (int)*(p4 + 13) + (int)*(p4 + 14)) / 48;
-                p1 += 16;
-                p2 += 16;
-                p3 += 16;
-                p4 += 16;
-            }
+            a = bwDiv3(a);
+            b = bwDiv3(b);
         }
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_ABGR || pixFormat == AR_PIXEL_FORMAT_ARGB)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 4 * (j * 4 + 0);
-            p2 = image + xsize * 4 * (j * 4 + 1);
-            p3 = image + xsize * 4 * (j * 4 + 2);
-            p4 = image + xsize * 4 * (j * 4 + 3);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 1) + (int)*(p1 + 2) + (int)*(p1 + 3)
-                          + (int)*(p1 + 5) + (int)*(p1 + 6) + (int)*(p1 + 7)
-                          + (int)*(p1 + 9) + (int)*(p1 + 10) + (int)*(p1 + 11)
-                          + (int)*(p1 + 13) + (int)*(p1 + 14) + (int)*(p1 + 15)
-                          + (int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)
-                          + (int)*(p2 + 5) + (int)*(p2 + 6) + (int)*(p2 + 7)
-                          + (int)*(p2 + 9) + (int)*(p2 + 10) + (int)*(p2 + 11)
-                          + (int)*(p2 + 13) + (int)*(p2 + 14) + (int)*(p2 + 15)
-                          + (int)*(p3 + 1) + (int)*(p3 + 2) + (int)*(p3 + 3)
-                          + (int)*(p3 + 5) + (int)*(p3 + 6) + (int)*(p3 + 7)
-                          + (int)*(p3 + 9) + (int)*(p3 + 10) + (int)*(p3 + 11)
-                          + (int)*(p3 + 13) + (int)*(p3 + 14) + (int)*(p3 + 15)
-                          + (int)*(p4 + 1) + (int)*(p4 + 2) + (int)*(p4 + 3)
-                          + (int)*(p4 + 5) + (int)*(p4 + 6) + (int)*(p4 + 7)
-                          + (int)*(p4 + 9) + (int)*(p4 + 10) + (int)*(p4 + 11)
-                          + (int)*(p4 + 13) + (int)*(p4 + 14) + (int)*(p4 + 15)) / 48;
-                p1 += 16;
-                p2 += 16;
-                p3 += 16;
-                p4 += 16;
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_NV21)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * (j * 4 + 0);
-            p2 = image + xsize * (j * 4 + 1);
-            p3 = image + xsize * (j * 4 + 2);
-            p4 = image + xsize * (j * 4 + 3);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2) + (int)*(p1 + 3)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)
-                          + (int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2) + (int)*(p3 + 3)
-                          + (int)*(p4 + 0) + (int)*(p4 + 1) + (int)*(p4 + 2) + (int)*(p4 + 3)) / 16;
-                p1 += 4;
-                p2 += 4;
-                p3 += 4;
-                p4 += 4;
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_2vuy)
+#endif
+    if (channels == 3)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 2 * (j * 4 + 0);
-            p2 = image + xsize * 2 * (j * 4 + 1);
-            p3 = image + xsize * 2 * (j * 4 + 2);
-            p4 = image + xsize * 2 * (j * 4 + 3);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 1) + (int)*(p1 + 3) + (int)*(p1 + 5) + (int)*(p1 + 7)
-                          + (int)*(p2 + 1) + (int)*(p2 + 3) + (int)*(p2 + 5) + (int)*(p2 + 7)
-                          + (int)*(p3 + 1) + (int)*(p3 + 3) + (int)*(p3 + 5) + (int)*(p3 + 7)
-                          + (int)*(p4 + 1) + (int)*(p4 + 3) + (int)*(p4 + 5) + (int)*(p4 + 7)) / 16;
-                p1 += 8;
-                p2 += 8;
-                p3 += 8;
-                p4 += 8;
-            }
-        }
+        for (; i < n; i++)
+            dst[i] = s0[i] / 3;
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_yuvs)
+    else
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 2 * (j * 4 + 0);
-            p2 = image + xsize * 2 * (j * 4 + 1);
-            p3 = image + xsize * 2 * (j * 4 + 2);
-            p4 = image + xsize * 2 * (j * 4 + 3);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 2) + (int)*(p1 + 4) + (int)*(p1 + 6)
-                          + (int)*(p2 + 0) + (int)*(p2 + 2) + (int)*(p2 + 4) + (int)*(p2 + 6)
-                          + (int)*(p3 + 0) + (int)*(p3 + 2) + (int)*(p3 + 4) + (int)*(p3 + 6)
-                          + (int)*(p4 + 0) + (int)*(p4 + 2) + (int)*(p4 + 4) + (int)*(p4 + 6)) / 16;
-                p1 += 8;
-                p2 += 8;
-                p3 += 8;
-                p4 += 8;
-            }
-        }
+        for (; i < n; i++)
+            dst[i] = (ARUint8)s0[i];
     }
-
-    return newImage;
 }
 
-
-static ARUint8* genBWImageOneThird(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize)
+// dst[i] = 2x2 box sum / (4 * channels)
+static void bwScaleHalf(ARUint8 *dst, const ARUint16 *s0, const ARUint16 *s1, int n, int channels)
 {
-    ARUint8 *newImage;
-    ARUint8 *p, *p1, *p2, *p3;
-    int     xsize2, ysize2;
-    int     i, j;
-
-    *newXsize = xsize2 = xsize / 3;
-    *newYsize = ysize2 = ysize / 3;
-    arMalloc(newImage, ARUint8, xsize2 * ysize2);
+    int i = 0;
 
-    if (pixFormat == AR_PIXEL_FORMAT_RGB || pixFormat == AR_PIXEL_FORMAT_BGR)
+#if KPM_BW_NEON
+    for (; i + 8 <= n; i += 8)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 3 * (j * 3 + 0);
-            p2 = image + xsize * 3 * (j * 3 + 1);
-            p3 = image + xsize * 3 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)
-                          + (int)*(p1 + 3) + (int)*(p1 + 4) + (int)*(p1 + 5)
-                          + (int)*(p1 + 6) + (int)*(p1 + 7) + (int)*(p1 + 8)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)
-                          + (int)*(p2 + 3) + (int)*(p2 + 4) + (int)*(p2 + 5)
-                          + (int)*(p2 + 6) + (int)*(p2 + 7) + (int)*(p2 + 8)
-                          + (int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2)
-                          + (int)*(p3 + 3) + (int)*(p3 + 4) + (int)*(p3 + 5)
-                          + (int)*(p3 + 6) + (int)*(p3 + 7) + (int)*(p3 + 8)) / 27;
-                p1 += 9;
-                p2 += 9;
-                p3 += 9;
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_RGBA || pixFormat == AR_PIXEL_FORMAT_BGRA)
-    {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 4 * (j * 3 + 0);
-            p2 = image + xsize * 4 * (j * 3 + 1);
-            p3 = image + xsize * 4 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)
-                          + (int)*(p1 + 4) + (int)*(p1 + 5) + (int)*(p1 + 6)
-                          + (int)*(p1 + 8) + (int)*(p1 + 9) + (int)*(p1 + 10)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)
-                          + (int)*(p2 + 4) + (int)*(p2 + 5) + (int)*(p2 + 6)
-                          + (int)*(p2 + 8) + (int)*(p2 + 9) + (int)*(p2 + 10)
-                          + (int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2)
-                          + (int)*(p3 + 4) + (int)*(p3 + 5) + (int)*(p3 + 6)
-                          + (int)*(p3 + 8) + (int)*(p3 + 9) + (int)*(p3 + 10)) / 27;
-                p1 += 12;
-                p2 += 12;
-                p3 += 12;
-            }
-        }
+        uint16x8_t a = vaddq_u16(vld1q_u16(s0 + 2 * i), vld1q_u16(s1 + 2 * i));
+        uint16x8_t b = vaddq_u16(vld1q_u16(s0 + 2 * i + 8), vld1q_u16(s1 + 2 * i + 8));
+        uint16x8_t s = vshrq_n_u16(vcombine_u16(vmovn_u32(vpaddlq_u16(a)), vmovn_u32(vpaddlq_u16(b))), 2);
+        if (channels == 3) s = bwDiv3(s);
+        vst1_u8(dst + i, vmovn_u16(s));
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_ABGR || pixFormat == AR_PIXEL_FORMAT_ARGB)
+#elif KPM_BW_SSE2
+    const __m128i one = _mm_set1_epi16(1);
+    for (; i + 8 <= n; i += 8)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 4 * (j * 3 + 0);
-            p2 = image + xsize * 4 * (j * 3 + 1);
-            p3 = image + xsize * 4 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 1) + (int)*(p1 + 2) + (int)*(p1 + 3)
-                          + (int)*(p1 + 5) + (int)*(p1 + 6) + (int)*(p1 + 7)
-                          + (int)*(p1 + 9) + (int)*(p1 + 10) + (int)*(p1 + 11)
-                          + (int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)
-                          + (int)*(p2 + 5) + (int)*(p2 + 6) + (int)*(p2 + 7)
-                          + (int)*(p2 + 9) + (int)*(p2 + 10) + (int)*(p2 + 11)
-                          + (int)*(p3 + 1) + (int)*(p3 + 2) + (int)*(p3 + 3)
-                          + (int)*(p3 + 5) + (int)*(p3 + 6) + (int)*(p3 + 7)
-                          + (int)*(p3 + 9) + (int)*(p3 + 10) + (int)*(p3 + 11)) / 27;
-                p1 += 12;
-                p2 += 12;
-                p3 += 12;
-            }
-        }
+        __m128i a = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(s0 + 2 * i)), _mm_loadu_si128((const __m128i*)(s1 + 2 * i)));
+        __m128i b = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(s0 + 2 * i + 8)), _mm_loadu_si128((const __m128i*)(s1 + 2 * i + 8)));
+        __m128i s = _mm_srli_epi16(_mm_packs_epi32(_mm_madd_epi16(a, one), _mm_madd_epi16(b, one)), 2);
+        if (channels == 3) s = bwDiv3(s);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(s, s));
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_NV21)
+#endif
+    for (; i < n; i++)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * (j * 3 + 0);
-            p2 = image + xsize * (j * 3 + 1);
-            p3 = image + xsize * (j * 3 + 2);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)
-                          + (int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)
-                          + (int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2)) / 9;
-                p1 += 3;
-                p2 += 3;
-                p3 += 3;
-            }
-        }
+        int s = (int)s0[2 * i] + (int)s0[2 * i + 1] + (int)s1[2 * i] + (int)s1[2 * i + 1];
+        dst[i] = (channels == 3) ? s / 12 : s / 4;
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_2vuy)
-    {
-        p = newImage;
+}
 
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 2 * (j * 3 + 0);
-            p2 = image + xsize * 2 * (j * 3 + 1);
-            p3 = image + xsize * 2 * (j * 3 + 2);
+// dst[i] = 3x3 box sum / D, reading every S'th element of the rows.
+template <int D, int S, typename T>
+static void bwScaleOneThird(ARUint8 *dst, const T *s0, const T *s1, const T *s2, int n)
+{
+    int i;
 
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 1) + (int)*(p1 + 3) + (int)*(p1 + 5)
-                          + (int)*(p2 + 1) + (int)*(p2 + 3) + (int)*(p2 + 5)
-                          + (int)*(p3 + 1) + (int)*(p3 + 3) + (int)*(p3 + 5)) / 9;
-                p1 += 6;
-                p2 += 6;
-                p3 += 6;
-            }
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_yuvs)
+    for (i = 0; i < n; i++, s0 += 3 * S, s1 += 3 * S, s2 += 3 * S)
     {
-        p = newImage;
-
-        for (j = 0; j < ysize2; j++)
-        {
-            p1 = image + xsize * 2 * (j * 3 + 0);
-            p2 = image + xsize * 2 * (j * 3 + 1);
-            p3 = image + xsize * 2 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2; i++)
-            {
-                *(p++) = ((int)*(p1 + 0) + (int)*(p1 + 2) + (int)*(p1 + 4)
-                          + (int)*(p2 + 0) + (int)*(p2 + 2) + (int)*(p2 + 4)
-                          + (int)*(p3 + 0) + (int)*(p3 + 2) + (int)*(p3 + 4)) / 9;
-                p1 += 6;
-                p2 += 6;
-                p3 += 6;
-            }
-        }
+        dst[i] = ((int)s0[0] + (int)s0[S] + (int)s0[2 * S]
+                  + (int)s1[0] + (int)s1[S] + (int)s1[2 * S]
+                  + (int)s2[0] + (int)s2[S] + (int)s2[2 * S]) / D;
     }
-
-    return newImage;
 }
 
-static ARUint8* genBWImageTwoThird(ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, int *newXsize, int *newYsize)
+// Each 3x3 block of the source produces a 2x2 block of the output. The middle row and
+// column are shared between output pixels with half weight, and the centre with quarter.
+template <int D, int S, typename T>
+static void bwScaleTwoThird(ARUint8 *dst1, ARUint8 *dst2, const T *s0, const T *s1, const T *s2, int n)
 {
-    ARUint8 *newImage;
-    ARUint8 *q1, *q2, *p1, *p2, *p3;
-    int     xsize2, ysize2;
-    int     i, j;
-
-    *newXsize = xsize2 = xsize / 3 * 2;
-    *newYsize = ysize2 = ysize / 3 * 2;
-    arMalloc(newImage, ARUint8, xsize2 * ysize2);
-
-    if (pixFormat == AR_PIXEL_FORMAT_RGB || pixFormat == AR_PIXEL_FORMAT_BGR)
-    {
-        q1 = newImage;
-        q2 = newImage + xsize2;
+    int i;
 
-        for (j = 0; j < ysize2 / 2; j++)
-        {
-            p1 = image + xsize * 3 * (j * 3 + 0);
-            p2 = image + xsize * 3 * (j * 3 + 1);
-            p3 = image + xsize * 3 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2 / 2; i++)
-            {
-                *(q1++) = (((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2))
-                           + ((int)*(p1 + 3) + (int)*(p1 + 4) + (int)*(p1 + 5)) / 2
-                           + ((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 2
-                           + ((int)*(p2 + 3) + (int)*(p2 + 4) + (int)*(p2 + 5)) / 4) * 4 / 27;
-                *(q2++) = (((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 2
-                           + ((int)*(p2 + 3) + (int)*(p2 + 4) + (int)*(p2 + 5)) / 4
-                           + ((int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2))
-                           + ((int)*(p3 + 3) + (int)*(p3 + 4) + (int)*(p3 + 5)) / 2) * 4 / 27;
-                p1     += 3;
-                p2     += 3;
-                p3     += 3;
-                *(q1++) = (((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)) / 2
-                           + ((int)*(p1 + 3) + (int)*(p1 + 4) + (int)*(p1 + 5))
-                           + ((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 4
-                           + ((int)*(p2 + 3) + (int)*(p2 + 4) + (int)*(p2 + 5)) / 2) * 4 / 27;
-                *(q2++) = (((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 4
-                           + ((int)*(p2 + 3) + (int)*(p2 + 4) + (int)*(p2 + 5)) / 2
-                           + ((int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2)) / 2
-                           + ((int)*(p3 + 3) + (int)*(p3 + 4) + (int)*(p3 + 5))) * 4 / 27;
-
-                p1 += 6;
-                p2 += 6;
-                p3 += 6;
-            }
-
-            q1 += xsize2;
-            q2 += xsize2;
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_RGBA || pixFormat == AR_PIXEL_FORMAT_BGRA)
+    for (i = 0; i < n; i++, s0 += 3 * S, s1 += 3 * S, s2 += 3 * S)
     {
-        q1 = newImage;
-        q2 = newImage + xsize2;
-
-        for (j = 0; j < ysize2 / 2; j++)
-        {
-            p1 = image + xsize * 4 * (j * 3 + 0);
-            p2 = image + xsize * 4 * (j * 3 + 1);
-            p3 = image + xsize * 4 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2 / 2; i++)
-            {
-                *(q1++) = (((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2))
-                           + ((int)*(p1 + 4) + (int)*(p1 + 5) + (int)*(p1 + 6)) / 2
-                           + ((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 2
-                           + ((int)*(p2 + 4) + (int)*(p2 + 5) + (int)*(p2 + 6)) / 4) * 4 / 27;
-                *(q2++) = (((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 2
-                           + ((int)*(p2 + 4) + (int)*(p2 + 5) + (int)*(p2 + 6)) / 4
-                           + ((int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2))
-                           + ((int)*(p3 + 4) + (int)*(p3 + 5) + (int)*(p3 + 6)) / 2) * 4 / 27;
-                p1     += 4;
-                p2     += 4;
-                p3     += 4;
-                *(q1++) = (((int)*(p1 + 0) + (int)*(p1 + 1) + (int)*(p1 + 2)) / 2
-                           + ((int)*(p1 + 4) + (int)*(p1 + 4) + (int)*(p1 + 4))
-                           + ((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 4
-                           + ((int)*(p2 + 4) + (int)*(p2 + 5) + (int)*(p2 + 6)) / 2) * 4 / 27;
-                *(q2++) = (((int)*(p2 + 0) + (int)*(p2 + 1) + (int)*(p2 + 2)) / 4
-                           + ((int)*(p2 + 4) + (int)*(p2 + 5) + (int)*(p2 + 6)) / 2
-                           + ((int)*(p3 + 0) + (int)*(p3 + 1) + (int)*(p3 + 2)) / 2
-                           + ((int)*(p3 + 4) + (int)*(p3 + 5) + (int)*(p3 + 6))) * 4 / 27;
-
-                p1 += 8;
-                p2 += 8;
-                p3 += 8;
-            }
-
-            q1 += xsize2;
-            q2 += xsize2;
-        }
+        *(dst1++) = ((int)s0[0] + (int)s0[S] / 2 + (int)s1[0] / 2 + (int)s1[S] / 4) * 4 / D;
+        *(dst2++) = ((int)s1[0] / 2 + (int)s1[S] / 4 + (int)s2[0] + (int)s2[S] / 2) * 4 / D;
+        *(dst1++) = ((int)s0[S] / 2 + (int)s0[2 * S] + (int)s1[S] / 4 + (int)s1[2 * S] / 2) * 4 / D;
+        *(dst2++) = ((int)s1[S] / 4 + (int)s1[2 * S] / 2 + (int)s2[S] / 2 + (int)s2[2 * S]) * 4 / D;
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_ABGR || pixFormat == AR_PIXEL_FORMAT_ARGB)
-    {
-        q1 = newImage;
-        q2 = newImage + xsize2;
-
-        for (j = 0; j < ysize2 / 2; j++)
-        {
-            p1 = image + xsize * 4 * (j * 3 + 0);
-            p2 = image + xsize * 4 * (j * 3 + 1);
-            p3 = image + xsize * 4 * (j * 3 + 2);
+}
 
-            for (i = 0; i < xsize2 / 2; i++)
-            {
-                *(q1++) = (((int)*(p1 + 1) + (int)*(p1 + 2) + (int)*(p1 + 3))
-                           + ((int)*(p1 + 5) + (int)*(p1 + 6) + (int)*(p1 + 7)) / 2
-                           + ((int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)) / 2
-                           + ((int)*(p2 + 5) + (int)*(p2 + 6) + (int)*(p2 + 7)) / 4) * 4 / 27;
-                *(q2++) = (((int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)) / 2
-                           + ((int)*(p2 + 5) + (int)*(p2 + 6) + (int)*(p2 + 7)) / 4
-                           + ((int)*(p3 + 1) + (int)*(p3 + 2) + (int)*(p3 + 3))
-                           + ((int)*(p3 + 5) + (int)*(p3 + 6) + (int)*(p3 + 7)) / 2) * 4 / 27;
-                p1     += 4;
-                p2     += 4;
-                p3     += 4;
-                *(q1++) = (((int)*(p1 + 1) + (int)*(p1 + 2) + (int)*(p1 + 3)) / 2
-                           + ((int)*(p1 + 5) + (int)*(p1 + 6) + (int)*(p1 + 7))
-                           + ((int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)) / 4
-                           + ((int)*(p2 + 5) + (int)*(p2 + 6) + (int)*(p2 + 7)) / 2) * 4 / 27;
-                *(q2++) = (((int)*(p2 + 1) + (int)*(p2 + 2) + (int)*(p2 + 3)) / 4
-                           + ((int)*(p2 + 5) + (int)*(p2 + 6) + (int)*(p2 + 7)) / 2
-                           + ((int)*(p3 + 1) + (int)*(p3 + 2) + (int)*(p3 + 3)) / 2
-                           + ((int)*(p3 + 5) + (int)*(p3 + 6) + (int)*(p3 + 7))) * 4 / 27;
-
-                p1 += 8;
-                p2 += 8;
-                p3 += 8;
-            }
+// dst[i] = 4x4 box sum / (16 * channels)
+static void bwScaleQuart(ARUint8 *dst, const ARUint16 *s0, const ARUint16 *s1, const ARUint16 *s2, const ARUint16 *s3, int n, int channels)
+{
+    int i = 0;
 
-            q1 += xsize2;
-            q2 += xsize2;
-        }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_NV21)
+#if KPM_BW_NEON
+    for (; i + 8 <= n; i += 8)
     {
-        q1 = newImage;
-        q2 = newImage + xsize2;
-
-        for (j = 0; j < ysize2 / 2; j++)
+        uint16x8_t r[4];
+        for (int k = 0; k < 4; k++)
         {
-            p1 = image + xsize * (j * 3 + 0);
-            p2 = image + xsize * (j * 3 + 1);
-            p3 = image + xsize * (j * 3 + 2);
-
-            for (i = 0; i < xsize2 / 2; i++)
-            {
-                *(q1++) = ((int)*(p1 + 0) + (int)*(p1 + 1) / 2
-                           + (int)*(p2 + 0) / 2 + (int)*(p2 + 1) / 4) * 4 / 9;
-                *(q2++) = ((int)*(p2 + 0) / 2 + (int)*(p2 + 1) / 4
-                           + (int)*(p3 + 0) + (int)*(p3 + 1) / 2) * 4 / 9;
-                p1++;
-                p2++;
-                p3++;
-                *(q1++) = ((int)*(p1 + 0) / 2 + (int)*(p1 + 1)
-                           + (int)*(p2 + 0) / 4 + (int)*(p2 + 1) / 2) * 4 / 9;
-                *(q2++) = ((int)*(p2 + 0) / 4 + (int)*(p2 + 1) / 2
-                           + (int)*(p3 + 0) / 2 + (int)*(p3 + 1)) * 4 / 9;
-                p1 += 2;
-                p2 += 2;
-                p3 += 2;
-            }
-
-            q1 += xsize2;
-            q2 += xsize2;
+            int o = 4 * i + 8 * k;
+            r[k] = vaddq_u16(vaddq_u16(vld1q_u16(s0 + o), vld1q_u16(s1 + o)), vaddq_u16(vld1q_u16(s2 + o), vld1q_u16(s3 + o)));
         }
-    }
-    else if (pixFormat == AR_PIXEL_FORMAT_2vuy)
-    {
-        q1 = newImage;
-        q2 = newImage + xsize2;
-
-        for (j = 0; j < ysize2 / 2; j++)
+        // Pairwise sums twice give the sum of each group of four columns.
+        uint16x8_t a = vcombine_u16(vmovn_u32(vpaddlq_u16(r[0])), vmovn_u32(vpaddlq_u16(r[1])));
+        uint16x8_t b = vcombine_u16(vmovn_u32(vpaddlq_u16(r[2])), vmovn_u32(vpaddlq_u16(r[3])));
+        uint16x8_t s = vshrq_n_u16(vcombine_u16(vmovn_u32(vpaddlq_u16(a)), vmovn_u32(vpaddlq_u16(b))), 4);
+        if (channels == 3) s = bwDiv3(s);
+        vst1_u8(dst + i, vmovn_u16(s));
+    }
+#elif KPM_BW_SSE2
+    const __m128i one = _mm_set1_epi16(1);
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i r[4];
+        for (int k = 0; k < 4; k++)
         {
-            p1 = image + xsize * 2 * (j * 3 + 0);
-            p2 = image + xsize * 2 * (j * 3 + 1);
-            p3 = image + xsize * 2 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2 / 2; i++)
-            {
-                *(q1++) = ((int)*(p1 + 1) + (int)*(p1 + 3) / 2
-                           + (int)*(p2 + 1) / 2 + (int)*(p2 + 3) / 4) * 4 / 9;
-                *(q2++) = ((int)*(p2 + 1) / 2 + (int)*(p2 + 3) / 4
-                           + (int)*(p3 + 1) + (int)*(p3 + 3) / 2) * 4 / 9;
-                p1     += 2;
-                p2     += 2;
-                p3     += 2;
-                *(q1++) = ((int)*(p1 + 1) / 2 + (int)*(p1 + 3)
-                           + (int)*(p2 + 1) / 4 + (int)*(p2 + 3) / 2) * 4 / 9;
-                *(q2++) = ((int)*(p2 + 1) / 4 + (int)*(p2 + 3) / 2
-                           + (int)*(p3 + 1) / 2 + (int)*(p3 + 3)) * 4 / 9;
-                p1 += 4;
-                p2 += 4;
-                p3 += 4;
-            }
-
-            q1 += xsize2;
-            q2 += xsize2;
+            int o = 4 * i + 8 * k;
+            r[k] = _mm_add_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)(s0 + o)), _mm_loadu_si128((const __m128i*)(s1 + o))),
+                                 _mm_add_epi16(_mm_loadu_si128((const __m128i*)(s2 + o)), _mm_loadu_si128((const __m128i*)(s3 + o))));
         }
+        // Pairwise sums twice give the sum of each group of four columns.
+        __m128i a = _mm_madd_epi16(_mm_packs_epi32(_mm_madd_epi16(r[0], one), _mm_madd_epi16(r[1], one)), one);
+        __m128i b = _mm_madd_epi16(_mm_packs_epi32(_mm_madd_epi16(r[2], one), _mm_madd_epi16(r[3], one)), one);
+        __m128i s = _mm_srli_epi16(_mm_packs_epi32(a, b), 4);
+        if (channels == 3) s = bwDiv3(s);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(s, s));
     }
-    else if (pixFormat == AR_PIXEL_FORMAT_yuvs)
+#endif
+    for (; i < n; i++)
     {
-        q1 = newImage;
-        q2 = newImage + xsize2;
-
-        for (j = 0; j < ysize2 / 2; j++)
-        {
-            p1 = image + xsize * 2 * (j * 3 + 0);
-            p2 = image + xsize * 2 * (j * 3 + 1);
-            p3 = image + xsize * 2 * (j * 3 + 2);
-
-            for (i = 0; i < xsize2 / 2; i++)
-            {
-                *(q1++) = ((int)*(p1 + 0) + (int)*(p1 + 2) / 2
-                           + (int)*(p2 + 0) / 2 + (int)*(p2 + 2) / 4) * 4 / 9;
-                *(q2++) = ((int)*(p2 + 0) / 2 + (int)*(p2 + 2) / 4
-                           + (int)*(p3 + 0) + (int)*(p3 + 2) / 2) * 4 / 9;
-                p1     += 2;
-                p2     += 2;
-                p3     += 2;
-                *(q1++) = ((int)*(p1 + 0) / 2 + (int)*(p1 + 2)
-                           + (int)*(p2 + 0) / 4 + (int)*(p2 + 2) / 2) * 4 / 9;
-                *(q2++) = ((int)*(p2 + 0) / 4 + (int)*(p2 + 2) / 2
-                           + (int)*(p3 + 0) / 2 + (int)*(p3 + 2)) * 4 / 9;
-                p1 += 4;
-                p2 += 4;
-                p3 += 4;
-            }
-
-            q1 += xsize2;
-            q2 += xsize2;
-        }
+        int s = 0;
+        for (int k = 0; k < 4; k++)
+            s += (int)s0[4 * i + k] + (int)s1[4 * i + k] + (int)s2[4 * i + k] + (int)s3[4 * i + k];
+        dst[i] = (channels == 3) ? s / 48 : s / 16;
     }
-
-    return newImage;
 }
 
+
 #if !BINARY_FEATURE
 static int kpmUtilGetInitPoseHomography(float *sCoord, float *wCoord, int num, float initPose[3][4])
 {
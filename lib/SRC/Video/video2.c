@@ -166,6 +166,10 @@ static int ar2VideoGetDeviceWithConfig(const char *config, const char **configSt
             {
                 device = AR_VIDEO_DEVICE_IMAGE;
             }
+            else if (strcmp(b, "-device=RawSeq") == 0)
+            {
+                device = AR_VIDEO_DEVICE_RAWSEQ;
+            }
             else if (strcmp(b, "-device=Android") == 0)
             {
                 device = AR_VIDEO_DEVICE_ANDROID;
@@ -291,6 +295,12 @@ ARVideoSourceInfoListT* ar2VideoCreateSourceInfoList(const char *config_in)
         return (NULL);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (device == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return (NULL);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (device == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -497,6 +507,17 @@ AR2VideoParamT* ar2VideoOpen(const char *config_in)
 #endif
     }
 
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+#ifdef AR_INPUT_RAWSEQ
+        if ((vid->device.rawSeq = ar2VideoOpenRawSeq(config)) != NULL)
+            return vid;
+
+#else
+        ARLOGe("ar2VideoOpen: Error: device \"RawSeq\" not supported on this build/architecture/system.\n");
+#endif
+    }
+
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
 #ifdef AR_INPUT_ANDROID
@@ -658,6 +679,12 @@ int ar2VideoClose(AR2VideoParamT *vid)
         ret = ar2VideoCloseImage(vid->device.image);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        ret = ar2VideoCloseRawSeq(vid->device.rawSeq);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -769,6 +796,12 @@ int ar2VideoDispOption(AR2VideoParamT *vid)
         return ar2VideoDispOptionImage();
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoDispOptionRawSeq();
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -887,6 +920,12 @@ int ar2VideoGetId(AR2VideoParamT *vid, ARUint32 *id0, ARUint32 *id1)
         return ar2VideoGetIdImage(vid->device.image, id0, id1);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetIdRawSeq(vid->device.rawSeq, id0, id1);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -997,6 +1036,12 @@ int ar2VideoGetSize(AR2VideoParamT *vid, int *x, int *y)
         return ar2VideoGetSizeImage(vid->device.image, x, y);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetSizeRawSeq(vid->device.rawSeq, x, y);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1112,6 +1157,12 @@ AR_PIXEL_FORMAT ar2VideoGetPixelFormat(AR2VideoParamT *vid)
         return ar2VideoGetPixelFormatImage(vid->device.image);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetPixelFormatRawSeq(vid->device.rawSeq);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1222,6 +1273,12 @@ AR2VideoBufferT* ar2VideoGetImage(AR2VideoParamT *vid)
         return ar2VideoGetImageImage(vid->device.image);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetImageRawSeq(vid->device.rawSeq);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1336,6 +1393,12 @@ int ar2VideoCapStart(AR2VideoParamT *vid)
         return ar2VideoCapStartImage(vid->device.image);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoCapStartRawSeq(vid->device.rawSeq);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1468,6 +1531,12 @@ int ar2VideoCapStop(AR2VideoParamT *vid)
         return ar2VideoCapStopImage(vid->device.image);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoCapStopRawSeq(vid->device.rawSeq);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1598,6 +1667,12 @@ int ar2VideoGetParami(AR2VideoParamT *vid, int paramName, int *value)
         return ar2VideoGetParamiImage(vid->device.image, paramName, value);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetParamiRawSeq(vid->device.rawSeq, paramName, value);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1708,6 +1783,12 @@ int ar2VideoSetParami(AR2VideoParamT *vid, int paramName, int value)
         return ar2VideoSetParamiImage(vid->device.image, paramName, value);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoSetParamiRawSeq(vid->device.rawSeq, paramName, value);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1818,6 +1899,12 @@ int ar2VideoGetParamd(AR2VideoParamT *vid, int paramName, double *value)
         return ar2VideoGetParamdImage(vid->device.image, paramName, value);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetParamdRawSeq(vid->device.rawSeq, paramName, value);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1928,6 +2015,12 @@ int ar2VideoSetParamd(AR2VideoParamT *vid, int paramName, double value)
         return ar2VideoSetParamdImage(vid->device.image, paramName, value);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoSetParamdRawSeq(vid->device.rawSeq, paramName, value);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -1979,6 +2072,12 @@ int ar2VideoGetParams(AR2VideoParamT *vid, const int paramName, char **value)
         return ar2VideoGetParamsImage(vid->device.image, paramName, value);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetParamsRawSeq(vid->device.rawSeq, paramName, value);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -2029,6 +2128,12 @@ int ar2VideoSetParams(AR2VideoParamT *vid, const int paramName, const char  *val
         return ar2VideoSetParamsImage(vid->device.image, paramName, value);
     }
 #endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoSetParamsRawSeq(vid->device.rawSeq, paramName, value);
+    }
+#endif
 #ifdef AR_INPUT_ANDROID
     if (vid->deviceType == AR_VIDEO_DEVICE_ANDROID)
     {
@@ -2106,6 +2211,12 @@ int ar2VideoSetBufferSize(AR2VideoParamT *vid, const int width, const int height
     {
         return ar2VideoSetBufferSizeImage(vid->device.image, width, height);
     }
+#endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoSetBufferSizeRawSeq(vid->device.rawSeq, width, height);
+    }
 #endif
     return (-1);
 }
@@ -2138,6 +2249,12 @@ int ar2VideoGetBufferSize(AR2VideoParamT *vid, int *width, int *height)
     {
         return ar2VideoGetBufferSizeImage(vid->device.image, width, height);
     }
+#endif
+#ifdef AR_INPUT_RAWSEQ
+    if (vid->deviceType == AR_VIDEO_DEVICE_RAWSEQ)
+    {
+        return ar2VideoGetBufferSizeRawSeq(vid->device.rawSeq, width, height);
+    }
 #endif
     return (-1);
 }
@@ -0,0 +1,189 @@
+/*
+ *  videoFrameRef.c
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *
+ */
+
+#include <AR/video.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // memcpy()
+#ifdef _WIN32
+#  pragma comment(lib,"pthreadVC2.lib")
+#endif
+#include <pthread.h>
+
+struct _ARVideoFrameRef
+{
+    ARUint8         *buff;
+    size_t          lumaSize;       // Bytes in the first (or only) plane.
+    size_t          size;           // Bytes in buff.
+    int             xsize;
+    int             ysize;
+    AR_PIXEL_FORMAT pixFormat;
+    int             refCount;       // Guarded by lock.
+    pthread_mutex_t lock;
+};
+
+static int isBiPlanar(AR_PIXEL_FORMAT pixFormat)
+{
+    return (pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_NV21);
+}
+
+ARVideoFrameRef* arVideoFrameRefCreate(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat)
+{
+    ARVideoFrameRef *frame;
+    int             pixelSize;
+
+    if (xsize <= 0 || ysize <= 0)
+    {
+        ARLOGe("arVideoFrameRefCreate(): Error: bad frame size %dx%d.\n", xsize, ysize);
+        return (NULL);
+    }
+
+    if ((pixelSize = arVideoUtilGetPixelSize(pixFormat)) <= 0)
+    {
+        ARLOGe("arVideoFrameRefCreate(): Error: unsupported pixel format %d.\n", pixFormat);
+        return (NULL);
+    }
+
+    frame = (ARVideoFrameRef*)malloc(sizeof(ARVideoFrameRef));
+    if (!frame)
+    {
+        ARLOGe("Out of memory!!\n");
+        return (NULL);
+    }
+
+    frame->xsize     = xsize;
+    frame->ysize     = ysize;
+    frame->pixFormat = pixFormat;
+    frame->lumaSize  = (size_t)xsize * ysize * pixelSize;
+    if (isBiPlanar(pixFormat))
+        frame->size = frame->lumaSize + frame->lumaSize / 2;
+    else
+        frame->size = frame->lumaSize;
+    frame->refCount = 1;
+
+    frame->buff = (ARUint8*)malloc(frame->size);
+    if (!frame->buff)
+    {
+        ARLOGe("Out of memory!!\n");
+        free(frame);
+        return (NULL);
+    }
+
+    pthread_mutex_init(&frame->lock, NULL);
+
+    return (frame);
+}
+
+ARVideoFrameRef* arVideoFrameRefRetain(ARVideoFrameRef *frame)
+{
+    if (!frame)
+        return (NULL);
+
+    pthread_mutex_lock(&frame->lock);
+    frame->refCount++;
+    pthread_mutex_unlock(&frame->lock);
+
+    return (frame);
+}
+
+void arVideoFrameRefRelease(ARVideoFrameRef **frame_p)
+{
+    ARVideoFrameRef *frame;
+    int             refCount;
+
+    if (!frame_p || !*frame_p)
+        return;
+
+    frame    = *frame_p;
+    *frame_p = NULL;
+
+    pthread_mutex_lock(&frame->lock);
+    refCount = --frame->refCount;
+    pthread_mutex_unlock(&frame->lock);
+
+    if (refCount > 0)
+        return;
+
+    pthread_mutex_destroy(&frame->lock);
+    free(frame->buff);
+    free(frame);
+}
+
+int arVideoFrameRefIsShared(ARVideoFrameRef *frame)
+{
+    int refCount;
+
+    if (!frame)
+        return (0);
+
+    pthread_mutex_lock(&frame->lock);
+    refCount = frame->refCount;
+    pthread_mutex_unlock(&frame->lock);
+
+    return (refCount > 1);
+}
+
+ARUint8* arVideoFrameRefGetBuffer(ARVideoFrameRef *frame)
+{
+    if (!frame)
+        return (NULL);
+
+    return (frame->buff);
+}
+
+size_t arVideoFrameRefGetBufferSize(ARVideoFrameRef *frame)
+{
+    if (!frame)
+        return (0);
+
+    return (frame->size);
+}
+
+int arVideoFrameRefFill(ARVideoFrameRef *frame, const ARUint8 *buff, const ARUint8 *buffCbCr)
+{
+    if (!frame || !buff)
+        return (-1);
+
+    if (frame->size == frame->lumaSize || !buffCbCr)
+    {
+        // Single plane, or chroma directly follows luma.
+        memcpy(frame->buff, buff, frame->size);
+    }
+    else
+    {
+        memcpy(frame->buff, buff, frame->lumaSize);
+        memcpy(frame->buff + frame->lumaSize, buffCbCr, frame->size - frame->lumaSize);
+    }
+
+    return (0);
+}
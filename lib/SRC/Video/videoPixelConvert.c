@@ -0,0 +1,955 @@
+/*
+ *  videoPixelConvert.c
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *
+ */
+
+#include <AR/video.h>
+#include <stdlib.h> // malloc(), free()
+#include <string.h> // memcpy()
+
+#if defined(HAVE_ARM_NEON) || defined(HAVE_ARM64_NEON) || defined(__aarch64__)
+#  define AR_VIDEO_CONVERT_NEON 1
+#  include <arm_neon.h>
+#  if defined(ANDROID) && !defined(__aarch64__)
+#    include "cpu-features.h"
+#  endif
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define AR_VIDEO_CONVERT_SSE2 1
+#  include <emmintrin.h>
+// The AVX2 kernels are built whatever the target's baseline and chosen at runtime.
+#  if defined(_MSC_VER) || defined(__GNUC__)
+#    define AR_VIDEO_CONVERT_AVX2 1
+#    include <immintrin.h>
+#    ifdef _MSC_VER
+#      include <intrin.h>
+#      define AVX2_FUNC
+#    else
+#      define AVX2_FUNC __attribute__((target("avx2")))
+#    endif
+#  endif
+#endif
+
+// Byte offsets of the components within a pixel of one of the RGB formats.
+typedef struct
+{
+    int size;                   // 3 or 4.
+    int r, g, b, a;             // a is -1 when size is 3.
+} RGBLayoutT;
+
+// Y'CbCr to RGB in integer arithmetic which never leaves 16 bits, so that the SIMD kernels give
+// exactly the scalar result. With Cb and Cr offset by -128, t = ((Y * yMul) >> 1) - yOff, then
+// R = (t + crR*Cr) >> shift, G = (t + cbG*Cb + crG*Cr) >> shift, B = (t + cbB*Cb) >> shift, each clamped to [0, 255].
+typedef struct
+{
+    int yMul, yOff;
+    int crR, cbG, crG, cbB;
+    int shift;
+} YCbCrToRGBT;
+
+// RGB to Y'CbCr, 16 fractional bits, rounded.
+typedef struct
+{
+    int yR, yG, yB, yOff;
+    int cbR, cbG, cbB;
+    int crR, crG, crB;
+} RGBToYCbCrT;
+
+// BT.601 full range (420f, NV21). These are the coefficients VideoSource has always used for these formats.
+static const YCbCrToRGBT fromFullRange  = {256, 0, 179, -44, -91, 227, 7};
+// BT.601 video range, Y' in [16, 235] (420v, 2vuy, yuvs).
+static const YCbCrToRGBT fromVideoRange = {149, 1192, 102, -25, -52, 129, 6};
+
+static const RGBToYCbCrT toFullRange  = {19595, 38470, 7471, 0, -11059, -21709, 32768, 32768, -27439, -5329};
+static const RGBToYCbCrT toVideoRange = {16829, 33039, 6416, 16, -9714, -19070, 28784, 28784, -24103, -4681};
+
+static const RGBLayoutT layoutRGBA = {4, 0, 1, 2, 3};
+
+static int getRGBLayout(const AR_PIXEL_FORMAT format, RGBLayoutT *layout)
+{
+    static const RGBLayoutT layouts[] =
+    {
+        {3, 0, 1, 2, -1},       // AR_PIXEL_FORMAT_RGB
+        {3, 2, 1, 0, -1},       // AR_PIXEL_FORMAT_BGR
+        {4, 0, 1, 2, 3},        // AR_PIXEL_FORMAT_RGBA
+        {4, 2, 1, 0, 3},        // AR_PIXEL_FORMAT_BGRA
+        {4, 3, 2, 1, 0},        // AR_PIXEL_FORMAT_ABGR
+        {0, 0, 0, 0, 0},        // AR_PIXEL_FORMAT_MONO
+        {4, 1, 2, 3, 0}         // AR_PIXEL_FORMAT_ARGB
+    };
+
+    if ((int)format < 0 || format > AR_PIXEL_FORMAT_ARGB || format == AR_PIXEL_FORMAT_MONO)
+        return (0);
+
+    *layout = layouts[format];
+    return (1);
+}
+
+static int isBiPlanar(const AR_PIXEL_FORMAT format)
+{
+    return (format == AR_PIXEL_FORMAT_420v || format == AR_PIXEL_FORMAT_420f || format == AR_PIXEL_FORMAT_NV21);
+}
+
+static int isYCbCr(const AR_PIXEL_FORMAT format)
+{
+    return (isBiPlanar(format) || format == AR_PIXEL_FORMAT_2vuy || format == AR_PIXEL_FORMAT_yuvs);
+}
+
+// Branch-free, as out-of-range values are common in dark and saturated areas.
+static ARUint8 clampShift(int v, const int shift)
+{
+    v >>= shift;
+    v  &= ~(v >> 31);                           // Negative to 0.
+    return ((ARUint8)(v | ((255 - v) >> 31)));  // Over 255 to all ones.
+}
+
+static ARUint8 clamp8(const int v)
+{
+    return ((ARUint8)(v < 0 ? 0 : (v > 255 ? 255 : v)));
+}
+
+// Converts a pair of pixels which share Cb and Cr. The coefficients and layout are passed by
+// value so that the compiler need not reload them after every byte stored.
+static void ycbcrPairToRGB(const YCbCrToRGBT k, const int Y0, const int Y1, int Cb, int Cr, ARUint8 *p, const RGBLayoutT dl)
+{
+    int t, r, g, b;
+
+    Cb -= 128;
+    Cr -= 128;
+    r   = k.crR * Cr;
+    g   = k.cbG * Cb + k.crG * Cr;
+    b   = k.cbB * Cb;
+
+    t       = ((Y0 * k.yMul) >> 1) - k.yOff;
+    p[dl.r] = clampShift(t + r, k.shift);
+    p[dl.g] = clampShift(t + g, k.shift);
+    p[dl.b] = clampShift(t + b, k.shift);
+    if (dl.a >= 0)
+        p[dl.a] = 255;
+    p += dl.size;
+
+    t       = ((Y1 * k.yMul) >> 1) - k.yOff;
+    p[dl.r] = clampShift(t + r, k.shift);
+    p[dl.g] = clampShift(t + g, k.shift);
+    p[dl.b] = clampShift(t + b, k.shift);
+    if (dl.a >= 0)
+        p[dl.a] = 255;
+}
+
+//
+// CPU feature checks.
+//
+
+#ifdef AR_VIDEO_CONVERT_NEON
+static int convertNEON = -1;
+
+static int haveNEON(void)
+{
+    if (convertNEON == -1)
+    {
+#  if defined(ANDROID) && !defined(__aarch64__)
+        // Not all Android devices with ARMv7 are guaranteed to have NEON, so check.
+        uint64_t features = android_getCpuFeatures();
+        convertNEON = ((features & ANDROID_CPU_ARM_FEATURE_ARMv7) && (features & ANDROID_CPU_ARM_FEATURE_NEON)) ? 1 : 0;
+#  else
+        convertNEON = 1;
+#  endif
+    }
+
+    return (convertNEON);
+}
+#endif // AR_VIDEO_CONVERT_NEON
+
+#ifdef AR_VIDEO_CONVERT_AVX2
+static int convertAVX2 = -1;
+
+static int haveAVX2(void)
+{
+    if (convertAVX2 == -1)
+    {
+#  ifdef _MSC_VER
+        int info[4];
+
+        convertAVX2 = 0;
+        __cpuid(info, 0);
+        if (info[0] >= 7)
+        {
+            __cpuid(info, 1);
+            // AVX and OSXSAVE, and the OS saves the YMM registers.
+            if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6)
+            {
+                __cpuidex(info, 7, 0);
+                convertAVX2 = (info[1] & (1 << 5)) ? 1 : 0;
+            }
+        }
+
+#  else
+        __builtin_cpu_init();
+        convertAVX2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#  endif
+    }
+
+    return (convertAVX2);
+}
+#endif // AR_VIDEO_CONVERT_AVX2
+
+//
+// SSE2 and AVX2 kernels. Each converts as many whole blocks of pixels as fit in the
+// row starting at pixel i, and returns the index of the first pixel left unconverted.
+//
+
+#ifdef AR_VIDEO_CONVERT_SSE2
+// Any 32-bit RGB layout to any other. Components are moved by shifting within 32-bit lanes.
+static int swizzle32SSE2(const ARUint8 *src, const RGBLayoutT *sl, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    const __m128i mask  = _mm_set1_epi32(0xff);
+    const __m128i alpha = _mm_set1_epi32((int)(0xffu << (dl->a * 8)));
+    const __m128i sr    = _mm_cvtsi32_si128(sl->r * 8), sg = _mm_cvtsi32_si128(sl->g * 8), sb = _mm_cvtsi32_si128(sl->b * 8);
+    const __m128i dr    = _mm_cvtsi32_si128(dl->r * 8), dg = _mm_cvtsi32_si128(dl->g * 8), db = _mm_cvtsi32_si128(dl->b * 8);
+    __m128i       v, o;
+
+    for (; i + 4 <= width; i += 4)
+    {
+        v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        o = _mm_or_si128(alpha, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v, sr), mask), dr));
+        o = _mm_or_si128(o, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v, sg), mask), dg));
+        o = _mm_or_si128(o, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(v, sb), mask), db));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), o);
+    }
+
+    return (i);
+}
+
+static int monoTo32SSE2(const ARUint8 *src, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    const __m128i alpha = _mm_set1_epi32((int)(0xffu << (dl->a * 8)));
+    __m128i       y, yy;
+
+    for (; i + 16 <= width; i += 16)
+    {
+        y  = _mm_loadu_si128((const __m128i*)(src + i));
+        yy = _mm_unpacklo_epi8(y, y);
+        _mm_storeu_si128((__m128i*)(dst + i * 4 +  0), _mm_or_si128(_mm_unpacklo_epi16(yy, yy), alpha));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_or_si128(_mm_unpackhi_epi16(yy, yy), alpha));
+        yy = _mm_unpackhi_epi8(y, y);
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_or_si128(_mm_unpacklo_epi16(yy, yy), alpha));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_or_si128(_mm_unpackhi_epi16(yy, yy), alpha));
+    }
+
+    return (i);
+}
+
+// Converts 8 pixels. y holds eight 16-bit luma values, and c the four chroma pairs shared by them, also as 16-bit values.
+static void ycbcr8ToRGB32SSE2(__m128i y, __m128i c, const int cbFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl)
+{
+    const __m128i shift = _mm_cvtsi32_si128(k->shift);
+    __m128i       t, cb, cr, r, g, b, ch[4], lo, hi;
+
+    // Give each pixel its own copy of the chroma of its pair.
+    c  = _mm_sub_epi16(c, _mm_set1_epi16(128));
+    cb = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    cr = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+    if (!cbFirst)
+    {
+        t  = cb;
+        cb = cr;
+        cr = t;
+    }
+
+    t = _mm_sub_epi16(_mm_srli_epi16(_mm_mullo_epi16(y, _mm_set1_epi16((short)k->yMul)), 1), _mm_set1_epi16((short)k->yOff));
+    r = _mm_sra_epi16(_mm_adds_epi16(t, _mm_mullo_epi16(cr, _mm_set1_epi16((short)k->crR))), shift);
+    g = _mm_sra_epi16(_mm_adds_epi16(t, _mm_add_epi16(_mm_mullo_epi16(cb, _mm_set1_epi16((short)k->cbG)), _mm_mullo_epi16(cr, _mm_set1_epi16((short)k->crG)))), shift);
+    b = _mm_sra_epi16(_mm_adds_epi16(t, _mm_mullo_epi16(cb, _mm_set1_epi16((short)k->cbB))), shift);
+
+    ch[dl->r] = _mm_packus_epi16(r, r);
+    ch[dl->g] = _mm_packus_epi16(g, g);
+    ch[dl->b] = _mm_packus_epi16(b, b);
+    ch[dl->a] = _mm_set1_epi8((char)0xff);
+    lo        = _mm_unpacklo_epi8(ch[0], ch[1]);
+    hi        = _mm_unpacklo_epi8(ch[2], ch[3]);
+    _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(lo, hi));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(lo, hi));
+}
+
+static int biPlanarTo32SSE2(const ARUint8 *srcY, const ARUint8 *srcC, const int cbFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 8 <= width; i += 8)
+    {
+        ycbcr8ToRGB32SSE2(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(srcY + i)), zero),
+                          _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(srcC + i)), zero),
+                          cbFirst, k, dst + i * 4, dl);
+    }
+
+    return (i);
+}
+
+static int packed422To32SSE2(const ARUint8 *src, const int yFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    const __m128i mask = _mm_set1_epi16(0xff);
+    __m128i       v;
+
+    for (; i + 8 <= width; i += 8)
+    {
+        v = _mm_loadu_si128((const __m128i*)(src + i * 2));
+        if (yFirst)
+            ycbcr8ToRGB32SSE2(_mm_and_si128(v, mask), _mm_srli_epi16(v, 8), 1, k, dst + i * 4, dl);
+        else
+            ycbcr8ToRGB32SSE2(_mm_srli_epi16(v, 8), _mm_and_si128(v, mask), 1, k, dst + i * 4, dl);
+    }
+
+    return (i);
+}
+#endif // AR_VIDEO_CONVERT_SSE2
+
+#ifdef AR_VIDEO_CONVERT_AVX2
+AVX2_FUNC static int swizzle32AVX2(const ARUint8 *src, const RGBLayoutT *sl, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    const __m256i mask  = _mm256_set1_epi32(0xff);
+    const __m256i alpha = _mm256_set1_epi32((int)(0xffu << (dl->a * 8)));
+    const __m128i sr    = _mm_cvtsi32_si128(sl->r * 8), sg = _mm_cvtsi32_si128(sl->g * 8), sb = _mm_cvtsi32_si128(sl->b * 8);
+    const __m128i dr    = _mm_cvtsi32_si128(dl->r * 8), dg = _mm_cvtsi32_si128(dl->g * 8), db = _mm_cvtsi32_si128(dl->b * 8);
+    __m256i       v, o;
+
+    for (; i + 8 <= width; i += 8)
+    {
+        v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        o = _mm256_or_si256(alpha, _mm256_sll_epi32(_mm256_and_si256(_mm256_srl_epi32(v, sr), mask), dr));
+        o = _mm256_or_si256(o, _mm256_sll_epi32(_mm256_and_si256(_mm256_srl_epi32(v, sg), mask), dg));
+        o = _mm256_or_si256(o, _mm256_sll_epi32(_mm256_and_si256(_mm256_srl_epi32(v, sb), mask), db));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), o);
+    }
+
+    return (i);
+}
+
+// As ycbcr8ToRGB32SSE2(), for 16 pixels. The AVX2 shuffles and packs work within each 128-bit lane,
+// so the lanes hold pixels 0-7 and 8-15 throughout, and are put back in order only at the store.
+AVX2_FUNC static void ycbcr16ToRGB32AVX2(__m256i y, __m256i c, const int cbFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl)
+{
+    const __m128i shift = _mm_cvtsi32_si128(k->shift);
+    __m256i       t, cb, cr, r, g, b, ch[4], lo, hi, lo16, hi16;
+
+    c  = _mm256_sub_epi16(c, _mm256_set1_epi16(128));
+    cb = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    cr = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+    if (!cbFirst)
+    {
+        t  = cb;
+        cb = cr;
+        cr = t;
+    }
+
+    t = _mm256_sub_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(y, _mm256_set1_epi16((short)k->yMul)), 1), _mm256_set1_epi16((short)k->yOff));
+    r = _mm256_sra_epi16(_mm256_adds_epi16(t, _mm256_mullo_epi16(cr, _mm256_set1_epi16((short)k->crR))), shift);
+    g = _mm256_sra_epi16(_mm256_adds_epi16(t, _mm256_add_epi16(_mm256_mullo_epi16(cb, _mm256_set1_epi16((short)k->cbG)), _mm256_mullo_epi16(cr, _mm256_set1_epi16((short)k->crG)))), shift);
+    b = _mm256_sra_epi16(_mm256_adds_epi16(t, _mm256_mullo_epi16(cb, _mm256_set1_epi16((short)k->cbB))), shift);
+
+    ch[dl->r] = _mm256_packus_epi16(r, r);
+    ch[dl->g] = _mm256_packus_epi16(g, g);
+    ch[dl->b] = _mm256_packus_epi16(b, b);
+    ch[dl->a] = _mm256_set1_epi8((char)0xff);
+    lo        = _mm256_unpacklo_epi8(ch[0], ch[1]);
+    hi        = _mm256_unpacklo_epi8(ch[2], ch[3]);
+    lo16      = _mm256_unpacklo_epi16(lo, hi);
+    hi16      = _mm256_unpackhi_epi16(lo, hi);
+    _mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(lo16, hi16, 0x20));
+    _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(lo16, hi16, 0x31));
+}
+
+AVX2_FUNC static int biPlanarTo32AVX2(const ARUint8 *srcY, const ARUint8 *srcC, const int cbFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    for (; i + 16 <= width; i += 16)
+    {
+        ycbcr16ToRGB32AVX2(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcY + i))),
+                           _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(srcC + i))),
+                           cbFirst, k, dst + i * 4, dl);
+    }
+
+    return (i);
+}
+
+AVX2_FUNC static int packed422To32AVX2(const ARUint8 *src, const int yFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    const __m256i mask = _mm256_set1_epi16(0xff);
+    __m256i       v;
+
+    for (; i + 16 <= width; i += 16)
+    {
+        v = _mm256_loadu_si256((const __m256i*)(src + i * 2));
+        if (yFirst)
+            ycbcr16ToRGB32AVX2(_mm256_and_si256(v, mask), _mm256_srli_epi16(v, 8), 1, k, dst + i * 4, dl);
+        else
+            ycbcr16ToRGB32AVX2(_mm256_srli_epi16(v, 8), _mm256_and_si256(v, mask), 1, k, dst + i * 4, dl);
+    }
+
+    return (i);
+}
+#endif // AR_VIDEO_CONVERT_AVX2
+
+//
+// NEON kernels. The structure loads and stores (de)interleave the components, so these serve
+// both the 24- and 32-bit layouts.
+//
+
+#ifdef AR_VIDEO_CONVERT_NEON
+static int swizzleNEON(const ARUint8 *src, const RGBLayoutT *sl, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    uint8x16x4_t in4, out4;
+    uint8x16x3_t in3, out3;
+    uint8x16_t   r, g, b;
+
+    for (; i + 16 <= width; i += 16)
+    {
+        if (sl->size == 4)
+        {
+            in4 = vld4q_u8(src + i * 4);
+            r   = in4.val[sl->r];
+            g   = in4.val[sl->g];
+            b   = in4.val[sl->b];
+        }
+        else
+        {
+            in3 = vld3q_u8(src + i * 3);
+            r   = in3.val[sl->r];
+            g   = in3.val[sl->g];
+            b   = in3.val[sl->b];
+        }
+
+        if (dl->size == 4)
+        {
+            out4.val[dl->r] = r;
+            out4.val[dl->g] = g;
+            out4.val[dl->b] = b;
+            out4.val[dl->a] = vdupq_n_u8(0xff);
+            vst4q_u8(dst + i * 4, out4);
+        }
+        else
+        {
+            out3.val[dl->r] = r;
+            out3.val[dl->g] = g;
+            out3.val[dl->b] = b;
+            vst3q_u8(dst + i * 3, out3);
+        }
+    }
+
+    return (i);
+}
+
+static int monoToRGBNEON(const ARUint8 *src, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    uint8x16x4_t out4;
+    uint8x16x3_t out3;
+    uint8x16_t   y;
+
+    for (; i + 16 <= width; i += 16)
+    {
+        y = vld1q_u8(src + i);
+        if (dl->size == 4)
+        {
+            out4.val[dl->r] = out4.val[dl->g] = out4.val[dl->b] = y;
+            out4.val[dl->a] = vdupq_n_u8(0xff);
+            vst4q_u8(dst + i * 4, out4);
+        }
+        else
+        {
+            out3.val[0] = out3.val[1] = out3.val[2] = y;
+            vst3q_u8(dst + i * 3, out3);
+        }
+    }
+
+    return (i);
+}
+
+// Converts 8 pixels, given their luma and the chroma of each pixel, widened to 16 bits.
+static uint8x8x3_t ycbcr8ToRGBNEON(uint16x8_t y, int16x8_t cb, int16x8_t cr, const YCbCrToRGBT *k)
+{
+    const int16x8_t shift = vdupq_n_s16((int16_t)(-k->shift)); // A negative left shift is an arithmetic right shift.
+    int16x8_t       t;
+    uint8x8x3_t     rgb;
+
+    t          = vsubq_s16(vreinterpretq_s16_u16(vshrq_n_u16(vmulq_u16(y, vdupq_n_u16((uint16_t)k->yMul)), 1)), vdupq_n_s16((int16_t)k->yOff));
+    rgb.val[0] = vqmovun_s16(vshlq_s16(vqaddq_s16(t, vmulq_s16(cr, vdupq_n_s16((int16_t)k->crR))), shift));
+    rgb.val[1] = vqmovun_s16(vshlq_s16(vqaddq_s16(t, vaddq_s16(vmulq_s16(cb, vdupq_n_s16((int16_t)k->cbG)), vmulq_s16(cr, vdupq_n_s16((int16_t)k->crG)))), shift));
+    rgb.val[2] = vqmovun_s16(vshlq_s16(vqaddq_s16(t, vmulq_s16(cb, vdupq_n_s16((int16_t)k->cbB))), shift));
+
+    return (rgb);
+}
+
+// Converts 16 pixels, given their luma and the 8 chroma pairs shared by them.
+static void ycbcr16ToRGBNEON(uint8x16_t y, uint8x8_t cb, uint8x8_t cr, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl)
+{
+    const int16x8_t c128 = vdupq_n_s16(128);
+    uint8x8x2_t     cbd  = vzip_u8(cb, cb);
+    uint8x8x2_t     crd  = vzip_u8(cr, cr);
+    uint8x8x3_t     lo, hi;
+    uint8x16x4_t    out4;
+    uint8x16x3_t    out3;
+
+    lo = ycbcr8ToRGBNEON(vmovl_u8(vget_low_u8(y)), vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(cbd.val[0])), c128),
+                         vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(crd.val[0])), c128), k);
+    hi = ycbcr8ToRGBNEON(vmovl_u8(vget_high_u8(y)), vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(cbd.val[1])), c128),
+                         vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(crd.val[1])), c128), k);
+    if (dl->size == 4)
+    {
+        out4.val[dl->r] = vcombine_u8(lo.val[0], hi.val[0]);
+        out4.val[dl->g] = vcombine_u8(lo.val[1], hi.val[1]);
+        out4.val[dl->b] = vcombine_u8(lo.val[2], hi.val[2]);
+        out4.val[dl->a] = vdupq_n_u8(0xff);
+        vst4q_u8(dst, out4);
+    }
+    else
+    {
+        out3.val[dl->r] = vcombine_u8(lo.val[0], hi.val[0]);
+        out3.val[dl->g] = vcombine_u8(lo.val[1], hi.val[1]);
+        out3.val[dl->b] = vcombine_u8(lo.val[2], hi.val[2]);
+        vst3q_u8(dst, out3);
+    }
+}
+
+static int biPlanarToRGBNEON(const ARUint8 *srcY, const ARUint8 *srcC, const int cbFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    uint8x8x2_t c;
+
+    for (; i + 16 <= width; i += 16)
+    {
+        c = vld2_u8(srcC + i);
+        ycbcr16ToRGBNEON(vld1q_u8(srcY + i), c.val[cbFirst ? 0 : 1], c.val[cbFirst ? 1 : 0], k, dst + i * dl->size, dl);
+    }
+
+    return (i);
+}
+
+static int packed422ToRGBNEON(const ARUint8 *src, const int yFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, int i, const int width)
+{
+    uint8x8x4_t v;
+    uint8x8x2_t y;
+
+    for (; i + 16 <= width; i += 16)
+    {
+        v = vld4_u8(src + i * 2); // 2vuy: Cb, Y0, Cr, Y1. yuvs: Y0, Cb, Y1, Cr.
+        if (yFirst)
+        {
+            y = vzip_u8(v.val[0], v.val[2]);
+            ycbcr16ToRGBNEON(vcombine_u8(y.val[0], y.val[1]), v.val[1], v.val[3], k, dst + i * dl->size, dl);
+        }
+        else
+        {
+            y = vzip_u8(v.val[1], v.val[3]);
+            ycbcr16ToRGBNEON(vcombine_u8(y.val[0], y.val[1]), v.val[0], v.val[2], k, dst + i * dl->size, dl);
+        }
+    }
+
+    return (i);
+}
+#endif // AR_VIDEO_CONVERT_NEON
+
+//
+// Row converters. Each picks the widest kernel available, and finishes the row in scalar code.
+//
+
+static void swizzleRow(const ARUint8 *src, const RGBLayoutT *sl, ARUint8 *dst, const RGBLayoutT *dl, const int width)
+{
+    const RGBLayoutT s0 = *sl, d0 = *dl;
+    const ARUint8    *s;
+    ARUint8          *d;
+    int              i = 0;
+
+#if defined(AR_VIDEO_CONVERT_NEON)
+    if (haveNEON())
+        i = swizzleNEON(src, sl, dst, dl, i, width);
+#elif defined(AR_VIDEO_CONVERT_SSE2)
+    if (sl->size == 4 && dl->size == 4)
+    {
+#  ifdef AR_VIDEO_CONVERT_AVX2
+        if (haveAVX2())
+            i = swizzle32AVX2(src, sl, dst, dl, i, width);
+#  endif
+        i = swizzle32SSE2(src, sl, dst, dl, i, width);
+    }
+#endif
+
+    for (; i < width; i++)
+    {
+        s       = src + i * s0.size;
+        d       = dst + i * d0.size;
+        d[d0.r] = s[s0.r];
+        d[d0.g] = s[s0.g];
+        d[d0.b] = s[s0.b];
+        if (d0.a >= 0)
+            d[d0.a] = 255;
+    }
+}
+
+static void monoToRGBRow(const ARUint8 *src, ARUint8 *dst, const RGBLayoutT *dl, const int width)
+{
+    const RGBLayoutT d0 = *dl;
+    ARUint8          *d;
+    int              i = 0;
+
+#if defined(AR_VIDEO_CONVERT_NEON)
+    if (haveNEON())
+        i = monoToRGBNEON(src, dst, dl, i, width);
+#elif defined(AR_VIDEO_CONVERT_SSE2)
+    if (dl->size == 4)
+        i = monoTo32SSE2(src, dst, dl, i, width);
+#endif
+
+    for (; i < width; i++)
+    {
+        d       = dst + i * d0.size;
+        d[d0.r] = d[d0.g] = d[d0.b] = src[i];
+        if (d0.a >= 0)
+            d[d0.a] = 255;
+    }
+}
+
+static void biPlanarToRGBRow(const ARUint8 *srcY, const ARUint8 *srcC, const int cbFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, const int width)
+{
+    int i = 0;
+
+#if defined(AR_VIDEO_CONVERT_NEON)
+    if (haveNEON())
+        i = biPlanarToRGBNEON(srcY, srcC, cbFirst, k, dst, dl, i, width);
+#elif defined(AR_VIDEO_CONVERT_SSE2)
+    if (dl->size == 4)
+    {
+#  ifdef AR_VIDEO_CONVERT_AVX2
+        if (haveAVX2())
+            i = biPlanarTo32AVX2(srcY, srcC, cbFirst, k, dst, dl, i, width);
+#  endif
+        i = biPlanarTo32SSE2(srcY, srcC, cbFirst, k, dst, dl, i, width);
+    }
+#endif
+
+    for (; i < width; i += 2)
+    {
+        if (cbFirst)
+            ycbcrPairToRGB(*k, srcY[i], srcY[i + 1], srcC[i], srcC[i + 1], dst + i * dl->size, *dl);
+        else
+            ycbcrPairToRGB(*k, srcY[i], srcY[i + 1], srcC[i + 1], srcC[i], dst + i * dl->size, *dl);
+    }
+}
+
+static void packed422ToRGBRow(const ARUint8 *src, const int yFirst, const YCbCrToRGBT *k, ARUint8 *dst, const RGBLayoutT *dl, const int width)
+{
+    const ARUint8 *pair;
+    int           i = 0;
+
+#if defined(AR_VIDEO_CONVERT_NEON)
+    if (haveNEON())
+        i = packed422ToRGBNEON(src, yFirst, k, dst, dl, i, width);
+#elif defined(AR_VIDEO_CONVERT_SSE2)
+    if (dl->size == 4)
+    {
+#  ifdef AR_VIDEO_CONVERT_AVX2
+        if (haveAVX2())
+            i = packed422To32AVX2(src, yFirst, k, dst, dl, i, width);
+#  endif
+        i = packed422To32SSE2(src, yFirst, k, dst, dl, i, width);
+    }
+#endif
+
+    for (; i < width; i += 2)
+    {
+        pair = src + i * 2;
+        if (yFirst)
+            ycbcrPairToRGB(*k, pair[0], pair[2], pair[1], pair[3], dst + i * dl->size, *dl);
+        else
+            ycbcrPairToRGB(*k, pair[1], pair[3], pair[0], pair[2], dst + i * dl->size, *dl);
+    }
+}
+
+// The 16-bit formats are big-endian. Components are widened by replicating their high bits, so that full scale maps to 255.
+static void packed16ToRGBRow(const ARUint8 *src, const AR_PIXEL_FORMAT format, ARUint8 *dst, const RGBLayoutT *dl, const int width)
+{
+    unsigned int v, r, g, b;
+    ARUint8      *d;
+    int          i;
+
+    for (i = 0; i < width; i++)
+    {
+        v = (src[i * 2] << 8) | src[i * 2 + 1];
+        if (format == AR_PIXEL_FORMAT_RGB_565)
+        {
+            r = v >> 11; g = (v >> 5) & 0x3f; b = v & 0x1f;
+            r = (r << 3) | (r >> 2); g = (g << 2) | (g >> 4); b = (b << 3) | (b >> 2);
+        }
+        else if (format == AR_PIXEL_FORMAT_RGBA_5551)
+        {
+            r = v >> 11; g = (v >> 6) & 0x1f; b = (v >> 1) & 0x1f;
+            r = (r << 3) | (r >> 2); g = (g << 3) | (g >> 2); b = (b << 3) | (b >> 2);
+        }
+        else   // AR_PIXEL_FORMAT_RGBA_4444
+        {
+            r = (v >> 12) * 17; g = ((v >> 8) & 0x0f) * 17; b = ((v >> 4) & 0x0f) * 17;
+        }
+
+        d        = dst + i * dl->size;
+        d[dl->r] = (ARUint8)r;
+        d[dl->g] = (ARUint8)g;
+        d[dl->b] = (ARUint8)b;
+        if (dl->a >= 0)
+            d[dl->a] = 255;
+    }
+}
+
+// Converts one row of any format to one of the RGB formats. srcC is the chroma row for the bi-planar formats.
+static void convertRowToRGB(const ARUint8 *src, const ARUint8 *srcC, const AR_PIXEL_FORMAT srcFormat, ARUint8 *dst, const RGBLayoutT *dl, const int width)
+{
+    RGBLayoutT sl;
+
+    switch (srcFormat)
+    {
+    case AR_PIXEL_FORMAT_MONO:
+        monoToRGBRow(src, dst, dl, width);
+        break;
+
+    case AR_PIXEL_FORMAT_420v:
+        biPlanarToRGBRow(src, srcC, 1, &fromVideoRange, dst, dl, width);
+        break;
+
+    case AR_PIXEL_FORMAT_420f:
+        biPlanarToRGBRow(src, srcC, 1, &fromFullRange, dst, dl, width);
+        break;
+
+    case AR_PIXEL_FORMAT_NV21:
+        biPlanarToRGBRow(src, srcC, 0, &fromFullRange, dst, dl, width);
+        break;
+
+    case AR_PIXEL_FORMAT_2vuy:
+        packed422ToRGBRow(src, 0, &fromVideoRange, dst, dl, width);
+        break;
+
+    case AR_PIXEL_FORMAT_yuvs:
+        packed422ToRGBRow(src, 1, &fromVideoRange, dst, dl, width);
+        break;
+
+    case AR_PIXEL_FORMAT_RGB_565:
+    case AR_PIXEL_FORMAT_RGBA_5551:
+    case AR_PIXEL_FORMAT_RGBA_4444:
+        packed16ToRGBRow(src, srcFormat, dst, dl, width);
+        break;
+
+    default:
+        if (getRGBLayout(srcFormat, &sl))
+            swizzleRow(src, &sl, dst, dl, width);
+        break;
+    }
+}
+
+// Copies the luma of one row of a Y'CbCr format.
+static void lumaRow(const ARUint8 *src, const AR_PIXEL_FORMAT srcFormat, ARUint8 *dst, const int width)
+{
+    int i;
+
+    if (isBiPlanar(srcFormat))
+    {
+        memcpy(dst, src, width);
+    }
+    else
+    {
+        if (srcFormat == AR_PIXEL_FORMAT_2vuy)
+            src++;
+
+        for (i = 0; i < width; i++)
+            dst[i] = src[i * 2];
+    }
+}
+
+static void rgbToYCbCr(const RGBToYCbCrT *k, const int r, const int g, const int b, ARUint8 *Y, ARUint8 *Cb, ARUint8 *Cr)
+{
+    if (Y)
+        *Y = clamp8(((k->yR * r + k->yG * g + k->yB * b + 32768) >> 16) + k->yOff);
+
+    if (Cb)
+    {
+        *Cb = clamp8(((k->cbR * r + k->cbG * g + k->cbB * b + 32768) >> 16) + 128);
+        *Cr = clamp8(((k->crR * r + k->crG * g + k->crB * b + 32768) >> 16) + 128);
+    }
+}
+
+// Converts one row of RGBA to a format which is neither RGB nor taken from Y'CbCr luma alone.
+// For the bi-planar formats, dstC is the chroma row to fill, or NULL on odd rows, whose chroma is
+// shared with the row above. Chroma is taken from the mean of each horizontal pair of pixels.
+static void packRowFromRGBA(const ARUint8 *rgba, const AR_PIXEL_FORMAT dstFormat, ARUint8 *dst, ARUint8 *dstC, const int width)
+{
+    const RGBToYCbCrT *k = (dstFormat == AR_PIXEL_FORMAT_420f || dstFormat == AR_PIXEL_FORMAT_NV21 ? &toFullRange : &toVideoRange);
+    const ARUint8     *p, *q;
+    unsigned int      v;
+    ARUint8           Y0, Y1, Cb, Cr;
+    int               i;
+
+    switch (dstFormat)
+    {
+    case AR_PIXEL_FORMAT_MONO:
+        // As arImageProcLuma() does for the RGB formats.
+        for (i = 0; i < width; i++)
+            dst[i] = (ARUint8)((rgba[i * 4] + rgba[i * 4 + 1] + rgba[i * 4 + 2]) / 3);
+
+        break;
+
+    case AR_PIXEL_FORMAT_RGB_565:
+    case AR_PIXEL_FORMAT_RGBA_5551:
+    case AR_PIXEL_FORMAT_RGBA_4444:
+        for (i = 0; i < width; i++)
+        {
+            p = rgba + i * 4;
+            if (dstFormat == AR_PIXEL_FORMAT_RGB_565)
+                v = ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+            else if (dstFormat == AR_PIXEL_FORMAT_RGBA_5551)
+                v = ((p[0] >> 3) << 11) | ((p[1] >> 3) << 6) | ((p[2] >> 3) << 1) | 0x1;
+            else
+                v = ((p[0] >> 4) << 12) | ((p[1] >> 4) << 8) | ((p[2] >> 4) << 4) | 0xf;
+            dst[i * 2]     = (ARUint8)(v >> 8);
+            dst[i * 2 + 1] = (ARUint8)v;
+        }
+
+        break;
+
+    default:     // Y'CbCr formats.
+        for (i = 0; i < width; i += 2)
+        {
+            p = rgba + i * 4;
+            q = p + 4;
+            rgbToYCbCr(k, p[0], p[1], p[2], &Y0, NULL, NULL);
+            rgbToYCbCr(k, q[0], q[1], q[2], &Y1, NULL, NULL);
+            rgbToYCbCr(k, (p[0] + q[0] + 1) >> 1, (p[1] + q[1] + 1) >> 1, (p[2] + q[2] + 1) >> 1, NULL, &Cb, &Cr);
+            if (dstFormat == AR_PIXEL_FORMAT_2vuy || dstFormat == AR_PIXEL_FORMAT_yuvs)
+            {
+                ARUint8 *d = dst + i * 2;
+                if (dstFormat == AR_PIXEL_FORMAT_2vuy)
+                {
+                    d[0] = Cb; d[1] = Y0; d[2] = Cr; d[3] = Y1;
+                }
+                else
+                {
+                    d[0] = Y0; d[1] = Cb; d[2] = Y1; d[3] = Cr;
+                }
+            }
+            else
+            {
+                dst[i]     = Y0;
+                dst[i + 1] = Y1;
+                if (dstC)
+                {
+                    dstC[i]     = (dstFormat == AR_PIXEL_FORMAT_NV21 ? Cr : Cb);
+                    dstC[i + 1] = (dstFormat == AR_PIXEL_FORMAT_NV21 ? Cb : Cr);
+                }
+            }
+        }
+
+        break;
+    }
+}
+
+int arVideoUtilConvertPixels(const ARUint8 *src, const ARUint8 *srcCbCr, const AR_PIXEL_FORMAT srcFormat,
+                             ARUint8 *dst, ARUint8 *dstCbCr, const AR_PIXEL_FORMAT dstFormat,
+                             const int width, const int height)
+{
+    RGBLayoutT dl;
+    ARUint8    *rgba = NULL;
+    int        srcPixelSize, dstPixelSize;
+    int        toRGB, toLuma;
+    int        y;
+
+    if (!src || !dst || width <= 0 || height <= 0)
+        return (-1);
+
+    srcPixelSize = arVideoUtilGetPixelSize(srcFormat);
+    dstPixelSize = arVideoUtilGetPixelSize(dstFormat);
+    if (!srcPixelSize || !dstPixelSize)
+    {
+        ARLOGe("arVideoUtilConvertPixels: Error, unsupported pixel format.\n");
+        return (-1);
+    }
+
+    if (((isBiPlanar(srcFormat) || isBiPlanar(dstFormat)) && (width & 1 || height & 1))
+        || ((isYCbCr(srcFormat) || isYCbCr(dstFormat)) && width & 1))
+    {
+        ARLOGe("arVideoUtilConvertPixels: Error, image size %dx%d is not whole chroma blocks.\n", width, height);
+        return (-1);
+    }
+
+    if (isBiPlanar(srcFormat) && !srcCbCr)
+        srcCbCr = src + width * height;
+    if (isBiPlanar(dstFormat) && !dstCbCr)
+        dstCbCr = dst + width * height;
+
+    toRGB = getRGBLayout(dstFormat, &dl);
+
+    // Formats with alpha still go through the converters, which make it opaque.
+    if (srcFormat == dstFormat && (toRGB ? dl.a < 0 : (dstFormat != AR_PIXEL_FORMAT_RGBA_5551 && dstFormat != AR_PIXEL_FORMAT_RGBA_4444)))
+    {
+        memcpy(dst, src, width * height * srcPixelSize);
+        if (isBiPlanar(srcFormat))
+            memcpy(dstCbCr, srcCbCr, width * height / 2);
+        return (0);
+    }
+
+    toLuma = (dstFormat == AR_PIXEL_FORMAT_MONO && isYCbCr(srcFormat));
+    if (!toRGB && !toLuma)
+    {
+        rgba = (ARUint8*)malloc(width * 4);
+        if (!rgba)
+        {
+            ARLOGe("Out of memory!!\n");
+            return (-1);
+        }
+    }
+
+    for (y = 0; y < height; y++)
+    {
+        const ARUint8 *s  = src + y * width * srcPixelSize;
+        const ARUint8 *sc = (isBiPlanar(srcFormat) ? srcCbCr + (y >> 1) * width : NULL);
+        ARUint8       *d  = dst + y * width * dstPixelSize;
+        ARUint8       *dc = (isBiPlanar(dstFormat) && !(y & 1) ? dstCbCr + (y >> 1) * width : NULL);
+
+        if (toRGB)
+        {
+            convertRowToRGB(s, sc, srcFormat, d, &dl, width);
+        }
+        else if (toLuma)
+        {
+            lumaRow(s, srcFormat, d, width);
+        }
+        else
+        {
+            convertRowToRGB(s, sc, srcFormat, rgba, &layoutRGBA, width);
+            packRowFromRGBA(rgba, dstFormat, d, dc, width);
+        }
+    }
+
+    free(rgba);
+
+    return (0);
+}
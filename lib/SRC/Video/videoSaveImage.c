@@ -39,6 +39,10 @@
 #include <stdio.h>
 #include <string.h>
 #include "jpeglib.h"
+#ifdef _WIN32
+#  pragma comment(lib,"pthreadVC2.lib")
+#endif
+#include <pthread.h>
 
 #ifndef MAX
 #  define MAX(x, y) (x > y ? x : y)
@@ -50,64 +54,66 @@
 #  define CLAMP(x, r1, r2) (MIN(MAX(x, r1), r2))
 #endif
 
-int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixels, const char *filename, const int quality /* 0 to 100 */, const int flipV)
+// Encodes one image using an already-created compressor, which is left ready for reuse.
+// If conversion to RGB is needed, *row_p is used as the row buffer, being allocated if NULL. The caller frees it.
+static int saveImageJPEG(j_compress_ptr cinfo, JSAMPROW *row_p, int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixels, const char *filename, const int quality, const int flipV)
 {
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr       jerr;
-    FILE                        *outfile;
-
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
+    JSAMPROW row;
+    FILE     *outfile;
 
     if ((outfile = fopen(filename, "wb")) == NULL)
     {
         ARLOGe("Can't open %s\n", filename);
         ARLOGperror(NULL);
-        jpeg_destroy_compress(&cinfo);
         return (-1);
     }
 
-    jpeg_stdio_dest(&cinfo, outfile);
+    jpeg_stdio_dest(cinfo, outfile);
 
-    cinfo.image_width  = w;     /* image width and height, in pixels */
-    cinfo.image_height = h;
+    cinfo->image_width  = w;     /* image width and height, in pixels */
+    cinfo->image_height = h;
     if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_NV21)
     {
-        cinfo.input_components = 1;     /* # of color components per pixel */
-        cinfo.in_color_space   = JCS_GRAYSCALE; /* colorspace of input image */
+        cinfo->input_components = 1;     /* # of color components per pixel */
+        cinfo->in_color_space   = JCS_GRAYSCALE; /* colorspace of input image */
     }
     else
     {
-        cinfo.input_components = 3;     /* # of color components per pixel */
-        cinfo.in_color_space   = JCS_RGB; /* colorspace of input image */
+        cinfo->input_components = 3;     /* # of color components per pixel */
+        cinfo->in_color_space   = JCS_RGB; /* colorspace of input image */
     }
 
-    jpeg_set_defaults(&cinfo);
+    jpeg_set_defaults(cinfo);
     /* Make optional parameter settings here */
-    jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+    jpeg_set_quality(cinfo, quality, TRUE /* limit to baseline-JPEG values */);
 
-    jpeg_start_compress(&cinfo, TRUE);
+    jpeg_start_compress(cinfo, TRUE);
 
     if (pixFormat == AR_PIXEL_FORMAT_MONO || pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_NV21 || pixFormat == AR_PIXEL_FORMAT_RGB)
     {
-        while (cinfo.next_scanline < cinfo.image_height)
+        while (cinfo->next_scanline < cinfo->image_height)
         {
-            JSAMPROW row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * cinfo.input_components];
-            jpeg_write_scanlines(&cinfo, &row, 1);
+            row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * cinfo->input_components];
+            jpeg_write_scanlines(cinfo, &row, 1);
         }
     }
     else
     {
-        JSAMPROW row = (JSAMPROW)malloc(cinfo.image_width * cinfo.input_components);
-        if (!row)
+        if (!*row_p)
         {
-            ARLOGe("Out of memory.\n");
-            fclose(outfile);
-            jpeg_destroy_compress(&cinfo);
-            return (-1);
+            *row_p = (JSAMPROW)malloc(cinfo->image_width * cinfo->input_components);
+            if (!*row_p)
+            {
+                ARLOGe("Out of memory.\n");
+                jpeg_abort_compress(cinfo);
+                fclose(outfile);
+                return (-1);
+            }
         }
 
-        while (cinfo.next_scanline < cinfo.image_height)
+        row = *row_p;
+
+        while (cinfo->next_scanline < cinfo->image_height)
         {
             unsigned char *pixels_row;
             int           i;
@@ -115,9 +121,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
             switch (pixFormat)
             {
             case AR_PIXEL_FORMAT_BGR:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 3];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 3];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = pixels_row[i * 3 + 2];
                     row[i * 3 + 1] = pixels_row[i * 3 + 1];
@@ -127,9 +133,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_RGBA:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 4];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 4];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = pixels_row[i * 4 + 0];
                     row[i * 3 + 1] = pixels_row[i * 4 + 1];
@@ -139,9 +145,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_BGRA:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 4];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 4];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = pixels_row[i * 4 + 2];
                     row[i * 3 + 1] = pixels_row[i * 4 + 1];
@@ -151,9 +157,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_ARGB:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 4];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 4];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = pixels_row[i * 4 + 1];
                     row[i * 3 + 1] = pixels_row[i * 4 + 2];
@@ -163,9 +169,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_ABGR:
-                pixels_row = &pixels[cinfo.next_scanline * cinfo.image_width * 4];
+                pixels_row = &pixels[cinfo->next_scanline * cinfo->image_width * 4];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = pixels_row[i * 4 + 3];
                     row[i * 3 + 1] = pixels_row[i * 4 + 2];
@@ -175,9 +181,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_2vuy:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 2];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 2];
 
-                for (i = 0; i < cinfo.image_width; i += 2)
+                for (i = 0; i < cinfo->image_width; i += 2)
                 {
                     unsigned char Cb      = pixels_row[i * 2 + 0];
                     unsigned char Yprime0 = pixels_row[i * 2 + 1];
@@ -195,9 +201,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_yuvs:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 2];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 2];
 
-                for (i = 0; i < cinfo.image_width; i += 2)
+                for (i = 0; i < cinfo->image_width; i += 2)
                 {
                     unsigned char Yprime0 = pixels_row[i * 2 + 0];
                     unsigned char Cb      = pixels_row[i * 2 + 1];
@@ -215,9 +221,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_RGB_565:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 2];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 2];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = ((pixels_row[i * 2 + 0] & 0xf8) + 0x04);
                     row[i * 3 + 1] = (((pixels_row[i * 2 + 0] & 0x07) << 5) + ((pixels_row[i * 2 + 1] & 0xe0) >> 3) + 0x02);
@@ -227,9 +233,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_RGBA_5551:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 2];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 2];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = ((pixels_row[i * 2 + 0] & 0xf8) + 0x04);
                     row[i * 3 + 1] = (((pixels_row[i * 2 + 0] & 0x07) << 5) + ((pixels_row[i * 2 + 1] & 0xc0) >> 3) + 0x04);
@@ -239,9 +245,9 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
 
             case AR_PIXEL_FORMAT_RGBA_4444:
-                pixels_row = &pixels[(flipV ? (h - 1 - cinfo.next_scanline) : cinfo.next_scanline) * cinfo.image_width * 2];
+                pixels_row = &pixels[(flipV ? (h - 1 - cinfo->next_scanline) : cinfo->next_scanline) * cinfo->image_width * 2];
 
-                for (i = 0; i < cinfo.image_width; i++)
+                for (i = 0; i < cinfo->image_width; i++)
                 {
                     row[i * 3 + 0] = ((pixels_row[i * 2 + 0] & 0xf0) + 0x08);
                     row[i * 3 + 1] = (((pixels_row[i * 2 + 0] & 0x0f) << 4) + 0x08);
@@ -254,18 +260,449 @@ int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixel
                 break;
             }
 
-            jpeg_write_scanlines(&cinfo, &row, 1);
+            jpeg_write_scanlines(cinfo, &row, 1);
         }
-
-        free(row);
     }
 
-    jpeg_finish_compress(&cinfo);
+    jpeg_finish_compress(cinfo);
 
     fclose(outfile);
 
+    return (0);
+}
+
+int arVideoSaveImageJPEG(int w, int h, AR_PIXEL_FORMAT pixFormat, ARUint8 *pixels, const char *filename, const int quality /* 0 to 100 */, const int flipV)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr       jerr;
+    JSAMPROW                    row = NULL;
+    int                         ret;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+
+    ret = saveImageJPEG(&cinfo, &row, w, h, pixFormat, pixels, filename, quality, flipV);
+
+    free(row);
     jpeg_destroy_compress(&cinfo);
 
+    return (ret);
+}
+
+//
+// Asynchronous recorder.
+//
+
+typedef struct
+{
+    ARUint8       *buff;
+    unsigned long frameNumber;
+} ARVideoRecorderSlotT;
+
+struct _ARVideoRecorder
+{
+    AR_VIDEO_RECORDER_FORMAT format;
+    AR_VIDEO_RECORDER_POLICY policy;
+    int                      w;
+    int                      h;
+    AR_PIXEL_FORMAT          pixFormat;
+    int                      quality;
+    int                      flipV;
+    char                     *path;
+    size_t                   frameSize;
+    FILE                     *rawFile;          // AR_VIDEO_RECORDER_FORMAT_RAWSEQ only.
+    FILE                     *timestampsFile;   // AR_VIDEO_RECORDER_FORMAT_JPEG only.
+    double                   firstTime;
+    double                   lastTime;
+
+    // Slots cycle between the free list and the queue. All fields below are guarded by lock.
+    ARVideoRecorderSlotT     *slots;
+    int                      slotCount;
+    int                      *freeList;
+    int                      freeCount;
+    int                      *queue;            // Ring of slot indices, in enqueue order.
+    int                      queueHead;
+    int                      queueCount;
+    int                      closing;
+    unsigned long            enqueued;
+    unsigned long            written;
+    unsigned long            dropped;
+    unsigned long            failed;
+    pthread_mutex_t          lock;
+    pthread_cond_t           cond;
+    pthread_t                *threads;
+    int                      threadCount;
+};
+
+static void writeLE32(ARUint8 *p, ARUint32 v)
+{
+    p[0] = (ARUint8)(v & 0xff);
+    p[1] = (ARUint8)((v >> 8) & 0xff);
+    p[2] = (ARUint8)((v >> 16) & 0xff);
+    p[3] = (ARUint8)((v >> 24) & 0xff);
+}
+
+static int writeRawSeqHeader(ARVideoRecorder *rec, ARUint32 frameCount, double fps)
+{
+    ARUint8 header[AR_VIDEO_RAWSEQ_HEADER_SIZE];
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, AR_VIDEO_RAWSEQ_MAGIC, 8);
+    writeLE32(header + 8, AR_VIDEO_RAWSEQ_VERSION);
+    writeLE32(header + 12, AR_VIDEO_RAWSEQ_HEADER_SIZE);
+    writeLE32(header + 16, (ARUint32)rec->w);
+    writeLE32(header + 20, (ARUint32)rec->h);
+    writeLE32(header + 24, (ARUint32)rec->pixFormat);
+    writeLE32(header + 28, frameCount);
+    writeLE32(header + 32, 0);                                            // Tightly packed.
+    writeLE32(header + 36, (fps > 0.0 ? (ARUint32)(fps * 1000.0 + 0.5) : 0));
+    writeLE32(header + 40, 1000);
+
+    if (fseek(rec->rawFile, 0, SEEK_SET) != 0 || fwrite(header, sizeof(header), 1, rec->rawFile) != 1)
+        return (-1);
+
+    return (fseek(rec->rawFile, 0, SEEK_END));
+}
+
+static void *recorderWorker(void *arg)
+{
+    ARVideoRecorder             *rec = (ARVideoRecorder*)arg;
+    ARVideoRecorderSlotT        *slot;
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr       jerr;
+    JSAMPROW                    row = NULL;
+    char                        *filename = NULL;
+    size_t                      filenameLen = 0;
+    int                         i, ok;
+
+    // Each worker keeps one compressor for the life of the recorder.
+    if (rec->format == AR_VIDEO_RECORDER_FORMAT_JPEG)
+    {
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_compress(&cinfo);
+        filenameLen = strlen(rec->path) + 16;
+        arMalloc(filename, char, filenameLen);
+    }
+
+    pthread_mutex_lock(&rec->lock);
+    for (;;)
+    {
+        while (!rec->queueCount && !rec->closing)
+            pthread_cond_wait(&rec->cond, &rec->lock);
+
+        if (!rec->queueCount)
+            break;       // Closing, and the queue is drained.
+
+        i              = rec->queue[rec->queueHead];
+        rec->queueHead = (rec->queueHead + 1) % rec->slotCount;
+        rec->queueCount--;
+        slot           = &rec->slots[i];
+
+        if (rec->format == AR_VIDEO_RECORDER_FORMAT_RAWSEQ)
+        {
+            // There is only one raw writer, so frames reach the file in queue order.
+            pthread_mutex_unlock(&rec->lock);
+            ok = (fwrite(slot->buff, rec->frameSize, 1, rec->rawFile) == 1);
+        }
+        else
+        {
+            pthread_mutex_unlock(&rec->lock);
+            snprintf(filename, filenameLen, "%s%06lu.jpg", rec->path, slot->frameNumber);
+            ok = (saveImageJPEG(&cinfo, &row, rec->w, rec->h, rec->pixFormat, slot->buff, filename, rec->quality, rec->flipV) == 0);
+        }
+
+        pthread_mutex_lock(&rec->lock);
+        if (ok)
+            rec->written++;
+        else
+            rec->failed++;
+
+        rec->freeList[rec->freeCount++] = i;
+        pthread_cond_broadcast(&rec->cond); // Wakes producers blocked on a full queue.
+    }
+
+    pthread_mutex_unlock(&rec->lock);
+
+    if (rec->format == AR_VIDEO_RECORDER_FORMAT_JPEG)
+    {
+        free(row);
+        free(filename);
+        jpeg_destroy_compress(&cinfo);
+    }
+
+    return (NULL);
+}
+
+ARVideoRecorder *arVideoRecorderOpen(const char *path, AR_VIDEO_RECORDER_FORMAT format, int w, int h, AR_PIXEL_FORMAT pixFormat, int quality, int flipV,
+                                     int queueLength, int threads, AR_VIDEO_RECORDER_POLICY policy)
+{
+    ARVideoRecorder *rec;
+    char            *timestampsPath;
+    int             i;
+
+    if (!path || w <= 0 || h <= 0 || arVideoUtilGetPixelSize(pixFormat) == 0)
+    {
+        ARLOGe("arVideoRecorderOpen: Error, invalid arguments.\n");
+        return (NULL);
+    }
+
+    if (format == AR_VIDEO_RECORDER_FORMAT_RAWSEQ && (pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_NV21) && ((w & 1) || (h & 1)))
+    {
+        ARLOGe("arVideoRecorderOpen: Error, bi-planar frames must have even dimensions.\n");
+        return (NULL);
+    }
+
+    if (queueLength < 1)
+        queueLength = 1;
+
+    // Raw frames are appended to one file in order, so they need a single writer.
+    if (threads < 1 || format == AR_VIDEO_RECORDER_FORMAT_RAWSEQ)
+        threads = 1;
+
+    arMallocClear(rec, ARVideoRecorder, 1);
+    rec->format    = format;
+    rec->policy    = policy;
+    rec->w         = w;
+    rec->h         = h;
+    rec->pixFormat = pixFormat;
+    rec->quality   = quality;
+    rec->flipV     = flipV;
+    arMalloc(rec->path, char, strlen(path) + 1);
+    strcpy(rec->path, path);
+
+    if (pixFormat == AR_PIXEL_FORMAT_420v || pixFormat == AR_PIXEL_FORMAT_420f || pixFormat == AR_PIXEL_FORMAT_NV21)
+        rec->frameSize = (format == AR_VIDEO_RECORDER_FORMAT_RAWSEQ ? (size_t)w * h * 3 / 2 : (size_t)w * h); // JPEG uses luma only.
+    else
+        rec->frameSize = (size_t)w * h * arVideoUtilGetPixelSize(pixFormat);
+
+    if (format == AR_VIDEO_RECORDER_FORMAT_RAWSEQ)
+    {
+        if ((rec->rawFile = fopen(path, "w+b")) == NULL)
+        {
+            ARLOGe("arVideoRecorderOpen: Error, can't open %s\n", path);
+            ARLOGperror(NULL);
+            goto bail;
+        }
+
+        // Frame count and rate are filled in when the recorder is closed.
+        if (writeRawSeqHeader(rec, 0, 0.0) != 0)
+        {
+            ARLOGe("arVideoRecorderOpen: Error writing %s\n", path);
+            goto bail;
+        }
+    }
+    else
+    {
+        // One line per frame, as read by the Image video module's -timestamps option.
+        arMalloc(timestampsPath, char, strlen(path) + sizeof("timestamps.txt"));
+        sprintf(timestampsPath, "%stimestamps.txt", path);
+        rec->timestampsFile = fopen(timestampsPath, "w");
+        if (!rec->timestampsFile)
+        {
+            ARLOGe("arVideoRecorderOpen: Error, can't open %s\n", timestampsPath);
+            ARLOGperror(NULL);
+            free(timestampsPath);
+            goto bail;
+        }
+
+        free(timestampsPath);
+    }
+
+    rec->slotCount = queueLength;
+    arMallocClear(rec->slots, ARVideoRecorderSlotT, queueLength);
+    arMalloc(rec->freeList, int, queueLength);
+    arMalloc(rec->queue, int, queueLength);
+    for (i = 0; i < queueLength; i++)
+    {
+        arMalloc(rec->slots[i].buff, ARUint8, rec->frameSize);
+        rec->freeList[i] = i;
+    }
+
+    rec->freeCount = queueLength;
+
+    pthread_mutex_init(&rec->lock, NULL);
+    pthread_cond_init(&rec->cond, NULL);
+    arMalloc(rec->threads, pthread_t, threads);
+    for (i = 0; i < threads; i++)
+    {
+        if (pthread_create(&rec->threads[i], NULL, recorderWorker, rec) != 0)
+        {
+            ARLOGe("arVideoRecorderOpen: Error, unable to start worker thread.\n");
+            break;
+        }
+
+        rec->threadCount++;
+    }
+
+    if (!rec->threadCount)
+    {
+        pthread_cond_destroy(&rec->cond);
+        pthread_mutex_destroy(&rec->lock);
+        goto bail;
+    }
+
+    return (rec);
+
+bail:
+    if (rec->slots)
+    {
+        for (i = 0; i < rec->slotCount; i++)
+            free(rec->slots[i].buff);
+    }
+
+    free(rec->slots);
+    free(rec->freeList);
+    free(rec->queue);
+    free(rec->threads);
+    if (rec->rawFile)
+        fclose(rec->rawFile);
+
+    if (rec->timestampsFile)
+        fclose(rec->timestampsFile);
+
+    free(rec->path);
+    free(rec);
+    return (NULL);
+}
+
+int arVideoRecorderEnqueue(ARVideoRecorder *rec, AR2VideoBufferT *buffer)
+{
+    ARVideoRecorderSlotT *slot;
+    size_t               lumaSize;
+    unsigned long        frameNumber;
+    double               t;
+    int                  i;
+
+    if (!rec || !buffer || !buffer->buff)
+        return (-1);
+
+    pthread_mutex_lock(&rec->lock);
+    while (!rec->freeCount && rec->policy == AR_VIDEO_RECORDER_POLICY_BLOCK)
+        pthread_cond_wait(&rec->cond, &rec->lock);
+
+    if (!rec->freeCount)
+    {
+        rec->dropped++;
+        pthread_mutex_unlock(&rec->lock);
+        return (1);
+    }
+
+    i           = rec->freeList[--rec->freeCount];
+    frameNumber = rec->enqueued++;
+    t           = (double)buffer->time_sec + (double)buffer->time_usec * 0.000001;
+    if (!frameNumber)
+        rec->firstTime = t;
+
+    rec->lastTime = t;
+    if (rec->timestampsFile)
+        fprintf(rec->timestampsFile, "%.6f\n", t); // Buffered, so cheap enough to do in order here.
+
+    pthread_mutex_unlock(&rec->lock);
+
+    // Copy outside the lock; the slot belongs to this call until it is queued.
+    slot              = &rec->slots[i];
+    slot->frameNumber = frameNumber;
+    if (buffer->bufPlaneCount >= 2 && rec->format == AR_VIDEO_RECORDER_FORMAT_RAWSEQ)
+    {
+        lumaSize = (size_t)rec->w * rec->h;
+        memcpy(slot->buff, buffer->bufPlanes[0], lumaSize);
+        memcpy(slot->buff + lumaSize, buffer->bufPlanes[1], rec->frameSize - lumaSize);
+    }
+    else
+    {
+        memcpy(slot->buff, buffer->buff, rec->frameSize);
+    }
+
+    pthread_mutex_lock(&rec->lock);
+    rec->queue[(rec->queueHead + rec->queueCount) % rec->slotCount] = i;
+    rec->queueCount++;
+    pthread_cond_broadcast(&rec->cond);
+    pthread_mutex_unlock(&rec->lock);
+
+    return (0);
+}
+
+int arVideoRecorderGetStats(ARVideoRecorder *rec, unsigned long *enqueued, unsigned long *written, unsigned long *dropped, unsigned long *failed)
+{
+    if (!rec)
+        return (-1);
+
+    pthread_mutex_lock(&rec->lock);
+    if (enqueued)
+        *enqueued = rec->enqueued;
+
+    if (written)
+        *written = rec->written;
+
+    if (dropped)
+        *dropped = rec->dropped;
+
+    if (failed)
+        *failed = rec->failed;
+
+    pthread_mutex_unlock(&rec->lock);
+
     return (0);
 }
+
+int arVideoRecorderClose(ARVideoRecorder **rec_p)
+{
+    ARVideoRecorder *rec;
+    double          fps = 0.0;
+    int             ret = 0;
+    int             i;
+
+    if (!rec_p || !*rec_p)
+        return (-1);
+
+    rec = *rec_p;
+
+    // Workers drain the queue before exiting.
+    pthread_mutex_lock(&rec->lock);
+    rec->closing = 1;
+    pthread_cond_broadcast(&rec->cond);
+    pthread_mutex_unlock(&rec->lock);
+    for (i = 0; i < rec->threadCount; i++)
+        pthread_join(rec->threads[i], NULL);
+
+    if (rec->rawFile)
+    {
+        if (rec->written > 1 && rec->lastTime > rec->firstTime)
+            fps = (double)(rec->enqueued - 1) / (rec->lastTime - rec->firstTime);
+
+        if (writeRawSeqHeader(rec, (ARUint32)rec->written, fps) != 0)
+            ret = -1;
+
+        if (fclose(rec->rawFile) != 0)
+            ret = -1;
+    }
+
+    if (rec->timestampsFile)
+        fclose(rec->timestampsFile);
+
+    if (rec->failed)
+    {
+        ARLOGe("arVideoRecorderClose: %lu of %lu frames could not be written.\n", rec->failed, rec->enqueued);
+        ret = -1;
+    }
+
+    if (rec->dropped)
+        ARLOGw("arVideoRecorderClose: %lu frames were dropped because the queue was full.\n", rec->dropped);
+
+    pthread_cond_destroy(&rec->cond);
+    pthread_mutex_destroy(&rec->lock);
+    for (i = 0; i < rec->slotCount; i++)
+        free(rec->slots[i].buff);
+
+    free(rec->slots);
+    free(rec->freeList);
+    free(rec->queue);
+    free(rec->threads);
+    free(rec->path);
+    free(rec);
+    *rec_p = NULL;
+
+    return (ret);
+}
+
 #endif // !AR_ENABLE_MINIMIZE_MEMORY_FOOTPRINT
\ No newline at end of file
@@ -11,53 +11,13 @@
 // U (Cb) Sample Period 2 2
 // V (Cr) Sample Period 2 2
 //
+// The conversion itself is done by arVideoUtilConvertPixels(), which uses SIMD where available.
+//
 
-#define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
-#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+#include "color_convert_common.h"
+#include <AR/video.h>
 
 void color_convert_common(unsigned char *pY, unsigned char *pUV, int width, int height, unsigned char *buffer)
 {
-    const int bytes_per_pixel = 2;
-
-    int           nR, nG, nB, nY, nU, nV, i, j, id2, jd2, offset;
-    unsigned char *out = buffer;
-
-    offset = 0;
-
-    // YUV 4:2:0
-    for (i = 0; i < height; i++)
-    {
-        id2 = i >> 1;         // Divide by two
-
-        for (j = 0; j < width; j++)
-        {
-            jd2 = j >> 1;             // Divide by two
-
-            nY = *(pY + i * width + j);
-            nV = *(pUV + id2 * width + bytes_per_pixel * jd2);
-            nU = *(pUV + id2 * width + bytes_per_pixel * jd2 + 1);
-
-            // Yuv Convert
-            nY  = MAX(nY - 16, 0);
-            nU -= 128;
-            nV -= 128;
-
-            nB = 1192 * nY + 2066 * nU;
-            nG = 1192 * nY - 833 * nV - 400 * nU;
-            nR = 1192 * nY + 1634 * nV;
-
-            nR = MIN(262143, MAX(0, nR));
-            nG = MIN(262143, MAX(0, nG));
-            nB = MIN(262143, MAX(0, nB));
-
-            nR >>= 10; nR &= 0xff;
-            nG >>= 10; nG &= 0xff;
-            nB >>= 10; nB &= 0xff;
-
-            out[offset++] = (unsigned char)nR;
-            out[offset++] = (unsigned char)nG;
-            out[offset++] = (unsigned char)nB;
-            out[offset++] = (unsigned char)255;
-        }
-    }
-}
\ No newline at end of file
+    arVideoUtilConvertPixels(pY, pUV, AR_PIXEL_FORMAT_NV21, buffer, NULL, AR_PIXEL_FORMAT_RGBA, width, height);
+}
@@ -251,11 +251,57 @@ int ar2VideoCapStopDummy(AR2VideoParamDummyT *vid)
     return 0;
 }
 
+// Fill the rectangle [x0, x1) x [y0, y1) with a solid colour, given as an RGBA quadruplet.
+// The colour is encoded into the video format via arVideoUtilConvertPixels() so that every
+// pixel format the converter supports is drawn consistently.
+static void fillRectDummy(AR2VideoParamDummyT *vid, ARUint8 *p, ARUint8 *p1, int x0, int y0, int x1, int y1, const ARUint8 rgba[4])
+{
+    ARUint8 src[2 * 2 * 4];
+    ARUint8 dst[2 * 2 * 4];
+    ARUint8 dstCbCr[2 * 4];
+    int     pixelSize;
+    int     i, j, n;
+
+    for (n = 0; n < 4; n++)
+        memcpy(&src[n * 4], rgba, 4);
+    if (arVideoUtilConvertPixels(src, NULL, AR_PIXEL_FORMAT_RGBA, dst, dstCbCr, vid->format, 2, 2) < 0)
+        return;
+
+    pixelSize = arVideoUtilGetPixelSize(vid->format);
+
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 > vid->width)
+        x1 = vid->width;
+    if (y1 > vid->height)
+        y1 = vid->height;
+
+    for (j = y0; j < y1; j++)
+    {
+        for (i = x0; i < x1; i++)
+        {
+            // Pixel parity selects the right bytes for formats which pack pixel pairs (e.g. 2vuy, yuvs).
+            memcpy(&p[(j * vid->bufWidth + i) * pixelSize], &dst[(i & 1) * pixelSize], pixelSize);
+            if (p1 && (j & 1) == 0 && (i & 1) == 0)
+            {
+                p1[(j / 2) * vid->bufWidth + i]     = dstCbCr[0];
+                p1[(j / 2) * vid->bufWidth + i + 1] = dstCbCr[1];
+            }
+        }
+    }
+}
+
 AR2VideoBufferT* ar2VideoGetImageDummy(AR2VideoParamDummyT *vid)
 {
-    static int k = 0;
-    ARUint8    *p, *p1;
-    int        i, j;
+    static const ARUint8 black[4] = {0, 0, 0, 255};
+    static const ARUint8 red[4]   = {255, 0, 0, 255};
+    static const ARUint8 green[4] = {0, 255, 0, 255};
+    static const ARUint8 blue[4]  = {0, 0, 255, 255};
+    static int           k        = 0;
+    ARUint8              *p, *p1;
+    int                  x, y;
 
     if (!vid)
         return (NULL);       // Sanity check.
@@ -282,446 +328,15 @@ AR2VideoBufferT* ar2VideoGetImageDummy(AR2VideoParamDummyT *vid)
     if (p1)
         memset(p1, 128, vid->bufWidth * vid->bufHeight / 2);
 
-    for (j = vid->height / 2 - 50; j < vid->height / 2 - 25; j++)
-    {
-        for (i = vid->width / 2 - 50 + k; i < vid->width / 2 + 50 + k; i++)
-        {
-            switch (vid->format)
-            {
-            case AR_PIXEL_FORMAT_RGB:
-            case AR_PIXEL_FORMAT_BGR:
-                p[(j * vid->bufWidth + i) * 3 + 0] = p[(j * vid->bufWidth + i) * 3 + 1] = p[(j * vid->bufWidth + i) * 3 + 2] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA:
-            case AR_PIXEL_FORMAT_BGRA:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = 0; p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_ARGB:
-            case AR_PIXEL_FORMAT_ABGR:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 255; p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 0;
-                break;
-
-            // Packed pixel formats are endianness-dependent.
-            case AR_PIXEL_FORMAT_RGB_565:
-                p[(j * vid->bufWidth + i) * 2 + 0] = p[(j * vid->bufWidth + i) * 2 + 1] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_5551:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x01;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x01;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_4444:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x0f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x0f;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_NV21:
-            case AR_PIXEL_FORMAT_420f:
-            case AR_PIXEL_FORMAT_MONO:
-                p[j * vid->bufWidth + i] = 0;
-                break;
-
-            default:
-                break;
-            }
-        }
-    }
-
-    for (j = vid->height / 2 - 25; j < vid->height / 2 + 25; j++)
-    {
-        // Black bar (25 pixels wide).
-        for (i = vid->width / 2 - 50 + k; i < vid->width / 2 - 25 + k; i++)
-        {
-            switch (vid->format)
-            {
-            case AR_PIXEL_FORMAT_RGB:
-            case AR_PIXEL_FORMAT_BGR:
-                p[(j * vid->bufWidth + i) * 3 + 0] = p[(j * vid->bufWidth + i) * 3 + 1] = p[(j * vid->bufWidth + i) * 3 + 2] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA:
-            case AR_PIXEL_FORMAT_BGRA:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = 0; p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_ARGB:
-            case AR_PIXEL_FORMAT_ABGR:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 255; p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 0;
-                break;
-
-            // Packed pixel formats are endianness-dependent.
-            case AR_PIXEL_FORMAT_RGB_565:
-                p[(j * vid->bufWidth + i) * 2 + 0] = p[(j * vid->bufWidth + i) * 2 + 1] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_5551:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x01;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x01;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_4444:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x0f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x0f;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_NV21:
-            case AR_PIXEL_FORMAT_420f:
-            case AR_PIXEL_FORMAT_MONO:
-                p[j * vid->bufWidth + i] = 0;
-                break;
-
-            default:
-                break;
-            }
-        }
-
-        // Red bar (17 pixels wide).
-        for (i = vid->width / 2 - 25 + k; i < vid->width / 2 - 8 + k; i++)
-        {
-            switch (vid->format)
-            {
-            case AR_PIXEL_FORMAT_RGB:
-                p[(j * vid->bufWidth + i) * 3 + 0] = 255; p[(j * vid->bufWidth + i) * 3 + 1] = p[(j * vid->bufWidth + i) * 3 + 2] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_BGR:
-                p[(j * vid->bufWidth + i) * 3 + 0] = p[(j * vid->bufWidth + i) * 3 + 1] = 0; p[(j * vid->bufWidth + i) * 3 + 2] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA:
-            case AR_PIXEL_FORMAT_ABGR:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 255; p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = 0; p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_BGRA:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = 0; p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_ARGB:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = 255; p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 0;
-                break;
-
-            // Packed pixel formats are endianness-dependent.
-            case AR_PIXEL_FORMAT_RGB_565:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0xf8; p[(j * vid->bufWidth + i) * 2 + 0] = 0;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0xf8; p[(j * vid->bufWidth + i) * 2 + 1] = 0;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_5551:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0xf8; p[(j * vid->bufWidth + i) * 2 + 0] = 0x01;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0xf8; p[(j * vid->bufWidth + i) * 2 + 1] = 0x01;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_4444:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0xf0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x0f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0xf0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x0f;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_NV21:
-                p[j * vid->bufWidth + i] = 76;
-                if ((j & 1) == 0 && (i & 1) == 0)
-                {
-                    p1[(j / 2) * vid->bufWidth + i] = 255; p1[(j / 2) * vid->bufWidth + i + 1] = 86;
-                }
-
-                break;
-
-            case AR_PIXEL_FORMAT_420f:
-                p[j * vid->bufWidth + i] = 76;
-                if ((j & 1) == 0 && (i & 1) == 0)
-                {
-                    p1[(j / 2) * vid->bufWidth + i] = 86; p1[(j / 2) * vid->bufWidth + i + 1] = 255;
-                }
-
-                break;
-
-            case AR_PIXEL_FORMAT_MONO:
-                p[j * vid->bufWidth + i] = 76;
-                break;
-
-            default:
-                break;
-            }
-        }
-
-        // Green bar (16 pixels wide).
-        for (i = vid->width / 2 - 8 + k; i < vid->width / 2 + 8 + k; i++)
-        {
-            switch (vid->format)
-            {
-            case AR_PIXEL_FORMAT_RGB:
-            case AR_PIXEL_FORMAT_BGR:
-                p[(j * vid->bufWidth + i) * 3 + 0] = 0; p[(j * vid->bufWidth + i) * 3 + 1] = 255; p[(j * vid->bufWidth + i) * 3 + 2] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA:
-            case AR_PIXEL_FORMAT_BGRA:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 0; p[(j * vid->bufWidth + i) * 4 + 1] = 255; p[(j * vid->bufWidth + i) * 4 + 2] = 0; p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_ARGB:
-            case AR_PIXEL_FORMAT_ABGR:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 255; p[(j * vid->bufWidth + i) * 4 + 1] = 0; p[(j * vid->bufWidth + i) * 4 + 2] = 255; p[(j * vid->bufWidth + i) * 4 + 3] = 0;
-                break;
-
-            // Packed pixel formats are endianness-dependent.
-            case AR_PIXEL_FORMAT_RGB_565:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0x07; p[(j * vid->bufWidth + i) * 2 + 0] = 0xe0;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0x07; p[(j * vid->bufWidth + i) * 2 + 1] = 0xe0;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_5551:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0x07; p[(j * vid->bufWidth + i) * 2 + 0] = 0xc1;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0x07; p[(j * vid->bufWidth + i) * 2 + 1] = 0xc1;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_4444:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0x0f; p[(j * vid->bufWidth + i) * 2 + 0] = 0x0f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0x0f; p[(j * vid->bufWidth + i) * 2 + 1] = 0x0f;
-#endif
-            case AR_PIXEL_FORMAT_NV21:
-                p[j * vid->bufWidth + i] = 150;
-                if ((j & 1) == 0 && (i & 1) == 0)
-                {
-                    p1[(j / 2) * vid->bufWidth + i] = 21; p1[(j / 2) * vid->bufWidth + i + 1] = 44;
-                }
-
-                break;
-
-            case AR_PIXEL_FORMAT_420f:
-                p[j * vid->bufWidth + i] = 150;
-                if ((j & 1) == 0 && (i & 1) == 0)
-                {
-                    p1[(j / 2) * vid->bufWidth + i] = 44; p1[(j / 2) * vid->bufWidth + i + 1] = 21;
-                }
-
-                break;
-
-            case AR_PIXEL_FORMAT_MONO:
-                p[j * vid->bufWidth + i] = 150;
-                break;
-
-            default:
-                break;
-            }
-        }
-
-        // Blue bar (17 pixels wide).
-        for (i = vid->width / 2 + 8 + k; i < vid->width / 2 + 25 + k; i++)
-        {
-            switch (vid->format)
-            {
-            case AR_PIXEL_FORMAT_RGB:
-                p[(j * vid->bufWidth + i) * 3 + 0] = p[(j * vid->bufWidth + i) * 3 + 1] = 0; p[(j * vid->bufWidth + i) * 3 + 2] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_BGR:
-                p[(j * vid->bufWidth + i) * 3 + 0] = 255; p[(j * vid->bufWidth + i) * 3 + 1] = p[(j * vid->bufWidth + i) * 3 + 2] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = 0; p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_BGRA:
-            case AR_PIXEL_FORMAT_ARGB:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 255; p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = 0; p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_ABGR:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = 255; p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 0;
-                break;
-
-            // Packed pixel formats are endianness-dependent.
-            case AR_PIXEL_FORMAT_RGB_565:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x1f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x1f;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_5551:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x3f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x3f;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_4444:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0xff;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0xff;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_NV21:
-                p[j * vid->bufWidth + i] = 29;
-                if ((j & 1) == 0 && (i & 1) == 0)
-                {
-                    p1[(j / 2) * vid->bufWidth + i] = 118; p1[(j / 2) * vid->bufWidth + i + 1] = 255;
-                }
-
-                break;
-
-            case AR_PIXEL_FORMAT_420f:
-                p[j * vid->bufWidth + i] = 29;
-                if ((j & 1) == 0 && (i & 1) == 0)
-                {
-                    p1[(j / 2) * vid->bufWidth + i] = 255; p1[(j / 2) * vid->bufWidth + i + 1] = 118;
-                }
-
-                break;
-
-            case AR_PIXEL_FORMAT_MONO:
-                p[j * vid->bufWidth + i] = 29;
-                break;
-
-            default:
-                break;
-            }
-        }
-
-        // Black bar (25 pixels wide).
-        for (i = vid->width / 2 + 25 + k; i < vid->width / 2 + 50 + k; i++)
-        {
-            switch (vid->format)
-            {
-            case AR_PIXEL_FORMAT_RGB:
-            case AR_PIXEL_FORMAT_BGR:
-                p[(j * vid->bufWidth + i) * 3 + 0] = p[(j * vid->bufWidth + i) * 3 + 1] = p[(j * vid->bufWidth + i) * 3 + 2] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA:
-            case AR_PIXEL_FORMAT_BGRA:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = 0; p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_ARGB:
-            case AR_PIXEL_FORMAT_ABGR:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 255; p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 0;
-                break;
-
-            // Packed pixel formats are endianness-dependent.
-            case AR_PIXEL_FORMAT_RGB_565:
-                p[(j * vid->bufWidth + i) * 2 + 0] = p[(j * vid->bufWidth + i) * 2 + 1] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_5551:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x01;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x01;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_4444:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x0f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x0f;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_NV21:
-            case AR_PIXEL_FORMAT_420f:
-            case AR_PIXEL_FORMAT_MONO:
-                p[j * vid->bufWidth + i] = 0;
-                break;
-
-            default:
-                break;
-            }
-        }
-    }
-
-    for (j = vid->height / 2 + 25; j < vid->height / 2 + 50; j++)
-    {
-        for (i = vid->width / 2 - 50 + k; i < vid->width / 2 + 50 + k; i++)
-        {
-            switch (vid->format)
-            {
-            case AR_PIXEL_FORMAT_RGB:
-            case AR_PIXEL_FORMAT_BGR:
-                p[(j * vid->bufWidth + i) * 3 + 0] = p[(j * vid->bufWidth + i) * 3 + 1] = p[(j * vid->bufWidth + i) * 3 + 2] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA:
-            case AR_PIXEL_FORMAT_BGRA:
-                p[(j * vid->bufWidth + i) * 4 + 0] = p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = 0; p[(j * vid->bufWidth + i) * 4 + 3] = 255;
-                break;
-
-            case AR_PIXEL_FORMAT_ARGB:
-            case AR_PIXEL_FORMAT_ABGR:
-                p[(j * vid->bufWidth + i) * 4 + 0] = 255; p[(j * vid->bufWidth + i) * 4 + 1] = p[(j * vid->bufWidth + i) * 4 + 2] = p[(j * vid->bufWidth + i) * 4 + 3] = 0;
-                break;
-
-            // Packed pixel formats are endianness-dependent.
-            case AR_PIXEL_FORMAT_RGB_565:
-                p[(j * vid->bufWidth + i) * 2 + 0] = p[(j * vid->bufWidth + i) * 2 + 1] = 0;
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_5551:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x01;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x01;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_RGBA_4444:
-#ifdef AR_LITTLE_ENDIAN
-                p[(j * vid->bufWidth + i) * 2 + 1] = 0; p[(j * vid->bufWidth + i) * 2 + 0] = 0x0f;
-#else
-                p[(j * vid->bufWidth + i) * 2 + 0] = 0; p[(j * vid->bufWidth + i) * 2 + 1] = 0x0f;
-#endif
-                break;
-
-            case AR_PIXEL_FORMAT_NV21:
-            case AR_PIXEL_FORMAT_420f:
-            case AR_PIXEL_FORMAT_MONO:
-                p[j * vid->bufWidth + i] = 0;
-                break;
-
-            default:
-                break;
-            }
-        }
-    }
+    x = vid->width / 2 + k;
+    y = vid->height / 2;
+    fillRectDummy(vid, p, p1, x - 50, y - 50, x + 50, y - 25, black);
+    fillRectDummy(vid, p, p1, x - 50, y - 25, x - 25, y + 25, black); // Black bar (25 pixels wide).
+    fillRectDummy(vid, p, p1, x - 25, y - 25, x - 8, y + 25, red);    // Red bar (17 pixels wide).
+    fillRectDummy(vid, p, p1, x - 8, y - 25, x + 8, y + 25, green);   // Green bar (16 pixels wide).
+    fillRectDummy(vid, p, p1, x + 8, y - 25, x + 25, y + 25, blue);   // Blue bar (17 pixels wide).
+    fillRectDummy(vid, p, p1, x + 25, y - 25, x + 50, y + 25, black); // Black bar (25 pixels wide).
+    fillRectDummy(vid, p, p1, x - 50, y + 25, x + 50, y + 50, black);
 
     vid->buffer.fillFlag  = 1;
     vid->buffer.time_sec  = 0;
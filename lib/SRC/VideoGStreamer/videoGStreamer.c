@@ -52,15 +52,42 @@
 
 #define GSTREAMER_TEST_LAUNCH_CFG "videotestsrc ! video/x-raw-rgb,bpp=24 ! identity name=artoolkit sync=true ! fakesink"
 
+/*
+ * Frames are handed from the GStreamer streaming thread to the caller through a triple buffer.
+ * The streaming thread owns the 'back' slot and fills it, then swaps it with the 'ready' slot.
+ * ar2VideoGetImageGStreamer() swaps the 'ready' slot with the 'front' slot, which the caller then
+ * owns until its next call. The three slot indices and a 'fresh' flag are packed into one int
+ * which is only ever changed by atomic compare-and-exchange, so neither side ever blocks.
+ */
+#define GSTREAMER_SLOT_COUNT   3
+#define GSTREAMER_BACK_SHIFT   0
+#define GSTREAMER_READY_SHIFT  2
+#define GSTREAMER_FRONT_SHIFT  4
+#define GSTREAMER_SLOT_MASK    0x3
+#define GSTREAMER_FRESH        0x40
+#define GSTREAMER_SLOT(state, shift) (((state) >> (shift)) & GSTREAMER_SLOT_MASK)
+
+typedef struct
+{
+    ARUint8   *buff;        /* Copied frame data, or NULL if not allocated. */
+    GstBuffer *gstBuffer;   /* Retained GstBuffer in zero-copy mode, or NULL. */
+    ARUint8   *data;        /* The frame: either buff or the data of gstBuffer. */
+    ARUint32  time_sec;
+    ARUint32  time_usec;
+} AR2VideoSlotGStreamerT;
+
 struct _AR2VideoParamGStreamerT
 {
     /* size and pixel format of the image */
     int             width, height;
     AR_PIXEL_FORMAT pixelFormat;
 
-    /* the actual video buffer */
-    ARUint8         *videoBuffer;
-    AR2VideoBufferT arVideoBuffer;
+    /* the video buffers */
+    AR2VideoSlotGStreamerT slots[GSTREAMER_SLOT_COUNT];
+    size_t                 slotSize;
+    volatile gint          slotState;
+    gint                   zeroCopy;  /* If set, frames are not copied, but their GstBuffers are held until released by the caller. */
+    AR2VideoBufferT        arVideoBuffer;
 
     /* GStreamer pipeline */
     GstElement *pipeline;
@@ -82,21 +109,62 @@ cb_have_data(GstPad    *pad,
     gdouble rate;
 
     AR2VideoParamGStreamerT *vid = (AR2VideoParamGStreamerT*)u_data;
+    AR2VideoSlotGStreamerT  *slot;
+    GTimeVal                now;
+    gint                    state, newState;
 
     if (vid == NULL)
         return FALSE;
 
+    if (!buffer)
+        return TRUE;
 
-    /* only do initialy for the buffer */
-    if (vid->videoBuffer == NULL && buffer)
+    if (vid->slotSize == 0)
     {
         g_print("libARvideo error! Buffer not allocated\n");
+        return TRUE;
+    }
+
+    if (GST_BUFFER_SIZE(buffer) < vid->slotSize)
+    {
+        g_print("libARvideo error! Buffer of %u bytes is smaller than the negotiated frame size\n", GST_BUFFER_SIZE(buffer));
+        return TRUE;
+    }
+
+    g_get_current_time(&now);
+
+    /* fill the back slot, which only this thread touches */
+    slot = &(vid->slots[GSTREAMER_SLOT(g_atomic_int_get(&vid->slotState), GSTREAMER_BACK_SHIFT)]);
+    if (slot->gstBuffer)
+    {
+        gst_buffer_unref(slot->gstBuffer);
+        slot->gstBuffer = NULL;
+    }
+
+    if (g_atomic_int_get(&vid->zeroCopy))
+    {
+        slot->gstBuffer = gst_buffer_ref(buffer);
+        slot->data      = GST_BUFFER_DATA(buffer);
+    }
+    else
+    {
+        memcpy(slot->buff, GST_BUFFER_DATA(buffer), vid->slotSize);
+        slot->data = slot->buff;
     }
 
-    if (vid->videoBuffer)
+    slot->time_sec  = (ARUint32)now.tv_sec;
+    slot->time_usec = (ARUint32)now.tv_usec;
+
+    /* publish it by swapping the back and ready slots */
+    do
     {
-        memcpy(vid->videoBuffer, buffer->data, buffer->size);
+        state    = g_atomic_int_get(&vid->slotState);
+        newState = (GSTREAMER_SLOT(state, GSTREAMER_READY_SHIFT) << GSTREAMER_BACK_SHIFT)
+                   | (GSTREAMER_SLOT(state, GSTREAMER_BACK_SHIFT) << GSTREAMER_READY_SHIFT)
+                   | (GSTREAMER_SLOT(state, GSTREAMER_FRONT_SHIFT) << GSTREAMER_FRONT_SHIFT)
+                   | GSTREAMER_FRESH;
     }
+    while (!g_atomic_int_compare_and_exchange(&vid->slotState, state, newState));
 
     return TRUE;
 }
@@ -138,10 +206,24 @@ static void video_caps_notify(GObject *obj, GParamSpec *pspec, gpointer data)
         vid->height      = height;
         vid->pixelFormat = AR_INPUT_GSTREAMER_PIXEL_FORMAT;
 
-        g_print("libARvideo: allocating %d bytes\n", (vid->width * vid->height * arVideoUtilGetPixelSize(vid->pixelFormat)));
+        /* allocate the buffers. They are never reallocated, as the caller may be using one */
+        if (vid->slotSize == 0)
+        {
+            size_t size = (size_t)(vid->width * vid->height * arVideoUtilGetPixelSize(vid->pixelFormat));
+            int    i;
+
+            g_print("libARvideo: allocating %d buffers of %d bytes\n", GSTREAMER_SLOT_COUNT, (int)size);
+            for (i = 0; i < GSTREAMER_SLOT_COUNT; i++)
+            {
+                arMalloc(vid->slots[i].buff, ARUint8, size);
+            }
 
-        /* allocate the buffer */
-        arMalloc(vid->videoBuffer, ARUint8, (vid->width * vid->height * arVideoUtilGetPixelSize(vid->pixelFormat)));
+            vid->slotSize = size;
+        }
+        else if ((size_t)(vid->width * vid->height * arVideoUtilGetPixelSize(vid->pixelFormat)) != vid->slotSize)
+        {
+            g_print("libARvideo error! Frame size renegotiation is not supported\n");
+        }
     }
 }
 
@@ -168,10 +250,10 @@ AR2VideoParamGStreamerT* ar2VideoOpenGStreamer(const char *config_in)
     gst_init(0, 0);
 
     /* init ART structure */
-    arMalloc(vid, AR2VideoParamGStreamerT, 1);
+    arMallocClear(vid, AR2VideoParamGStreamerT, 1);
 
-    /* initialise buffer */
-    vid->videoBuffer = NULL;
+    /* initialise buffers. Slot 0 starts as back, 1 as ready and 2 as front */
+    vid->slotState = (0 << GSTREAMER_BACK_SHIFT) | (1 << GSTREAMER_READY_SHIFT) | (2 << GSTREAMER_FRONT_SHIFT);
 
     /* report the current version and features */
     g_print ("libARvideo: %s\n", gst_version_string());
@@ -304,6 +386,8 @@ AR2VideoParamGStreamerT* ar2VideoOpenGStreamer(const char *config_in)
 int
 ar2VideoCloseGStreamer(AR2VideoParamGStreamerT *vid)
 {
+    int i;
+
     if (!vid)
         return (-1);
 
@@ -313,6 +397,17 @@ ar2VideoCloseGStreamer(AR2VideoParamGStreamerT *vid)
     /* free the pipeline handle */
     gst_object_unref (GST_OBJECT (vid->pipeline));
 
+    /* with the pipeline stopped, no more frames can arrive */
+    for (i = 0; i < GSTREAMER_SLOT_COUNT; i++)
+    {
+        if (vid->slots[i].gstBuffer)
+            gst_buffer_unref(vid->slots[i].gstBuffer);
+
+        free(vid->slots[i].buff);
+    }
+
+    free(vid);
+
     return 0;
 }
 
@@ -352,12 +447,33 @@ ar2VideoGetPixelFormatGStreamer(AR2VideoParamGStreamerT *vid)
 AR2VideoBufferT*
 ar2VideoGetImageGStreamer(AR2VideoParamGStreamerT *vid)
 {
+    AR2VideoSlotGStreamerT *slot;
+    gint                   state, newState;
+
     if (!vid)
         return (NULL);
 
-    /* just return the bare video buffer */
-    (vid->arVideoBuffer).buff     = vid->videoBuffer;
-    (vid->arVideoBuffer).fillFlag = 1;
+    /* take the most recently published frame by swapping the ready and front slots.
+       The previous front slot goes back into circulation, so the caller must be done with it */
+    do
+    {
+        state = g_atomic_int_get(&vid->slotState);
+        if (!(state & GSTREAMER_FRESH))
+            return (NULL);
+
+        newState = (GSTREAMER_SLOT(state, GSTREAMER_BACK_SHIFT) << GSTREAMER_BACK_SHIFT)
+                   | (GSTREAMER_SLOT(state, GSTREAMER_FRONT_SHIFT) << GSTREAMER_READY_SHIFT)
+                   | (GSTREAMER_SLOT(state, GSTREAMER_READY_SHIFT) << GSTREAMER_FRONT_SHIFT);
+    }
+    while (!g_atomic_int_compare_and_exchange(&vid->slotState, state, newState));
+
+    slot                               = &(vid->slots[GSTREAMER_SLOT(newState, GSTREAMER_FRONT_SHIFT)]);
+    (vid->arVideoBuffer).buff          = slot->data;
+    (vid->arVideoBuffer).bufPlanes     = NULL;
+    (vid->arVideoBuffer).bufPlaneCount = 0;
+    (vid->arVideoBuffer).fillFlag      = 1;
+    (vid->arVideoBuffer).time_sec      = slot->time_sec;
+    (vid->arVideoBuffer).time_usec     = slot->time_usec;
     return (&(vid->arVideoBuffer));
 }
 
@@ -412,11 +528,37 @@ ar2VideoCapStopGStreamer(AR2VideoParamGStreamerT *vid)
 
 int ar2VideoGetParamiGStreamer(AR2VideoParamGStreamerT *vid, int paramName, int *value)
 {
-    return -1;
+    if (!vid || !value)
+        return (-1);
+
+    switch (paramName)
+    {
+    case AR_VIDEO_GSTREAMER_ZERO_COPY:
+        *value = g_atomic_int_get(&vid->zeroCopy);
+        break;
+
+    default:
+        return (-1);
+    }
+
+    return (0);
 }
 int ar2VideoSetParamiGStreamer(AR2VideoParamGStreamerT *vid, int paramName, int value)
 {
-    return -1;
+    if (!vid)
+        return (-1);
+
+    switch (paramName)
+    {
+    case AR_VIDEO_GSTREAMER_ZERO_COPY:
+        g_atomic_int_set(&vid->zeroCopy, (value ? 1 : 0));
+        break;
+
+    default:
+        return (-1);
+    }
+
+    return (0);
 }
 int ar2VideoGetParamdGStreamer(AR2VideoParamGStreamerT *vid, int paramName, double *value)
 {
@@ -43,9 +43,14 @@
 
 #include <string.h> // memset()
 #include "jpeglib.h"
+#ifdef _WIN32
+#  pragma comment(lib,"pthreadVC2.lib")
+#endif
+#include <pthread.h>
 
 #define AR_VIDEO_IMAGE_XSIZE_DEFAULT 640
 #define AR_VIDEO_IMAGE_YSIZE_DEFAULT 480
+#define AR_VIDEO_IMAGE_PREFETCH_DEFAULT 4
 #ifndef MIN
 #define MIN(x, y) (x < y ? x : y)
 #endif
@@ -58,18 +63,53 @@ struct _AR2VideoImageRef
     char             *pathname;
 };
 
+typedef struct
+{
+    ARUint8  *buff;
+    int      valid;                 // Set once the frame holds a decoded image.
+    ARUint32 time_sec;
+    ARUint32 time_usec;
+} AR2VideoImageFrameT;
+
 struct _AR2VideoParamImageT
 {
-    AR2VideoBufferT  buffer;
-    int              width;
-    int              height;
-    AR_PIXEL_FORMAT  format;
-    int              bufWidth;
-    int              bufHeight;
-    AR2VideoImageRef *imageList;
-    AR2VideoImageRef *nextImage;
-    unsigned long    imageCount;
-    int              loop;
+    AR2VideoBufferT     buffer;
+    int                 width;
+    int                 height;
+    AR_PIXEL_FORMAT     format;
+    int                 bufWidth;
+    int                 bufHeight;
+    AR2VideoImageRef    *imageList;
+    AR2VideoImageRef    *nextImage;
+    unsigned long       imageCount;
+    int                 loop;
+    unsigned long       nextIndex;  // Index of nextImage in imageList.
+    unsigned long       loopCount;  // Number of times the list has been wrapped.
+
+    // Decoded frames. With -cache, one per image, decoded once. Otherwise, a ring of
+    // prefetch + 1 frames: up to 'prefetch' decoded ahead, plus the one held by the caller.
+    AR2VideoImageFrameT *frames;
+    int                 frameCount;
+    int                 prefetch;
+    int                 cache;
+    int                 cacheFilled;
+    unsigned long       cacheNext;
+
+    // Prefetch thread and its queue, all guarded by 'lock'.
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    int                 threadRunning;
+    int                 threadStop;
+    int                 queueHead;      // Oldest decoded frame not yet returned.
+    int                 queueCount;     // Decoded frames not yet returned.
+    int                 held;           // Set while the frame before queueHead is in use by the caller.
+    int                 eos;            // Set when the list is exhausted and not looping.
+
+    // Timestamps, from a sidecar file (in seconds, one per image) or a fixed frame rate.
+    double              *timestamps;
+    double              timestampsPeriod;
+    double              fps;
 };
 
 #ifdef HAVE_LIBJPEG
@@ -292,6 +332,188 @@ static int jpegRead(FILE *fp, unsigned char *buf, int bufWidth, int bufHeight, A
 }
 #endif // HAVE_LIBJPEG
 
+static int readFrame(AR2VideoParamImageT *vid, const char *pathname, ARUint8 *buff)
+{
+    FILE *infile;
+    int  ok;
+
+    if ((infile = fopen(pathname, "rb")) == NULL)
+    {
+        ARLOGe("Can't open JPEG file '%s'\n", pathname);
+        ARLOGperror(NULL);
+        return (FALSE);
+    }
+
+    ok = jpegRead(infile, buff, vid->bufWidth, vid->bufHeight, vid->format);
+    fclose(infile);
+
+    return (ok);
+}
+
+// Sets the timestamp of the image at 'index' in the list on pass 'loopCount' through it.
+static void setFrameTime(AR2VideoParamImageT *vid, AR2VideoImageFrameT *frame, unsigned long index, unsigned long loopCount)
+{
+    double t;
+
+    if (vid->timestamps)
+        t = vid->timestamps[index] + vid->timestampsPeriod * loopCount;
+    else if (vid->fps > 0.0)
+        t = (double)(loopCount * vid->imageCount + index) / vid->fps;
+    else
+        t = 0.0;
+
+    frame->time_sec  = (ARUint32)t;
+    frame->time_usec = (ARUint32)((t - (double)frame->time_sec) * 1000000.0);
+}
+
+// Moves nextImage along the list, wrapping if looping.
+static void advanceImage(AR2VideoParamImageT *vid)
+{
+    vid->nextImage = vid->nextImage->next; // Next item in linked list.
+    vid->nextIndex++;
+    if (!vid->nextImage && vid->loop)
+    {
+        vid->nextImage = vid->imageList;   // If we've hit the end of the list and looping requested, go back to head of linked list.
+        vid->nextIndex = 0;
+        vid->loopCount++;
+    }
+}
+
+// Reads one timestamp per image, in seconds, from a text file. Blank lines and lines beginning with '#' are skipped.
+static int readTimestamps(AR2VideoParamImageT *vid, const char *pathname)
+{
+    FILE          *fp;
+    char          line[256];
+    unsigned long i = 0;
+
+    if ((fp = fopen(pathname, "r")) == NULL)
+    {
+        ARLOGe("Can't open timestamps file '%s'\n", pathname);
+        ARLOGperror(NULL);
+        return (-1);
+    }
+
+    arMalloc(vid->timestamps, double, vid->imageCount);
+
+    while (i < vid->imageCount && fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+            continue;
+
+        if (sscanf(line, "%lf", &(vid->timestamps[i])) != 1)
+        {
+            ARLOGe("Bad timestamp '%s' in file '%s'\n", line, pathname);
+            goto bail;
+        }
+
+        i++;
+    }
+
+    fclose(fp);
+
+    if (i < vid->imageCount)
+    {
+        ARLOGe("Timestamps file '%s' has %lu timestamps, but %lu images were specified.\n", pathname, i, vid->imageCount);
+        goto bail1;
+    }
+
+    // A looped sequence continues at the mean frame interval after its last frame.
+    if (vid->imageCount > 1)
+        vid->timestampsPeriod = (vid->timestamps[vid->imageCount - 1] - vid->timestamps[0]) * vid->imageCount / (vid->imageCount - 1);
+    else
+        vid->timestampsPeriod = (vid->fps > 0.0 ? 1.0 / vid->fps : 0.0);
+
+    return (0);
+
+bail:
+    fclose(fp);
+bail1:
+    free(vid->timestamps);
+    vid->timestamps = NULL;
+    return (-1);
+}
+
+static void* prefetchThread(void *arg)
+{
+    AR2VideoParamImageT *vid = (AR2VideoParamImageT*)arg;
+    AR2VideoImageFrameT *frame;
+    AR2VideoImageRef    *imageRef;
+    unsigned long       index, loopCount;
+    unsigned long       failures = 0;   // Consecutive images which failed to decode.
+    int                 ok;
+
+    pthread_mutex_lock(&(vid->lock));
+    for (;;)
+    {
+        // Wait for a free frame.
+        while (!vid->threadStop && vid->queueCount + vid->held >= vid->frameCount)
+        {
+            pthread_cond_wait(&(vid->cond), &(vid->lock));
+        }
+
+        if (vid->threadStop)
+            break;
+
+        if (!vid->nextImage)
+        {
+            vid->eos = TRUE;
+            pthread_cond_broadcast(&(vid->cond));
+            break;
+        }
+
+        frame     = &(vid->frames[(vid->queueHead + vid->queueCount) % vid->frameCount]);
+        imageRef  = vid->nextImage;
+        index     = vid->nextIndex;
+        loopCount = vid->loopCount;
+        advanceImage(vid);
+
+        // The frame is not visible to the caller until queued, so decode without holding the lock.
+        pthread_mutex_unlock(&(vid->lock));
+        ok = readFrame(vid, imageRef->pathname, frame->buff);
+        if (ok)
+            setFrameTime(vid, frame, index, loopCount);
+
+        pthread_mutex_lock(&(vid->lock));
+
+        if (ok)
+        {
+            failures = 0;
+            vid->queueCount++;
+            pthread_cond_broadcast(&(vid->cond));
+        }
+        else if (++failures >= vid->imageCount)
+        {
+            // A whole pass through the list without a single image decoded. Don't spin on it forever.
+            ARLOGe("Error: unable to decode any image in the list.\n");
+            vid->eos = TRUE;
+            pthread_cond_broadcast(&(vid->cond));
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&(vid->lock));
+
+    return (NULL);
+}
+
+static int fillCache(AR2VideoParamImageT *vid)
+{
+    AR2VideoImageRef *imageRef;
+    unsigned long    i;
+
+    ARLOGi("Decoding %lu images into memory.\n", vid->imageCount);
+    for (imageRef = vid->imageList, i = 0; imageRef; imageRef = imageRef->next, i++)
+    {
+        vid->frames[i].valid = readFrame(vid, imageRef->pathname, vid->frames[i].buff);
+    }
+
+    vid->cacheFilled = TRUE;
+    vid->cacheNext   = 0;
+    vid->loopCount   = 0;
+
+    return (0);
+}
+
 int ar2VideoDispOptionImage(void)
 {
     ARLOG(" -device=Image\n");
@@ -308,6 +530,15 @@ int ar2VideoDispOptionImage(void)
     ARLOG("    After reading last image, next read will return first image.\n");
     ARLOG(" -noloop\n");
     ARLOG("    After reading last image, no further images will be returned.\n");
+    ARLOG(" -prefetch=N\n");
+    ARLOG("    Decode up to N images ahead on a background thread (default %d). 0 decodes\n", AR_VIDEO_IMAGE_PREFETCH_DEFAULT);
+    ARLOG("    each image when it is requested.\n");
+    ARLOG(" -cache\n");
+    ARLOG("    Decode all images into memory once, when capture starts, and return them from there.\n");
+    ARLOG(" -fps=F\n");
+    ARLOG("    Timestamp images at F frames per second, starting at 0.\n");
+    ARLOG(" -timestamps=pathname\n");
+    ARLOG("    Timestamp images from a text file holding one time per image, in seconds.\n");
     ARLOG("\n");
 
     return 0;
@@ -322,11 +553,12 @@ AR2VideoParamImageT* ar2VideoOpenImage(const char *config)
     int                 bufSizeY;
     char                bufferpow2     = 0;
     AR2VideoImageRef    *imageListTail = NULL, *imageRef;
+    char                timestampsPath[1024] = "";
     FILE                *infile;
     int                 i, w, h, components;
     int                 ok, err_i = 0;
 
-    arMalloc(vid, AR2VideoParamImageT, 1);
+    arMallocClear(vid, AR2VideoParamImageT, 1);
     vid->buffer.buff          = NULL;
     vid->buffer.bufPlanes     = NULL;
     vid->buffer.bufPlaneCount = 0;
@@ -337,6 +569,9 @@ AR2VideoParamImageT* ar2VideoOpenImage(const char *config)
     vid->imageList            = NULL;
     vid->imageCount           = 0ul;
     vid->loop                 = FALSE;
+    vid->prefetch             = AR_VIDEO_IMAGE_PREFETCH_DEFAULT;
+    pthread_mutex_init(&(vid->lock), NULL);
+    pthread_cond_init(&(vid->cond), NULL);
 
     a = config;
     if (a != NULL)
@@ -433,6 +668,29 @@ AR2VideoParamImageT* ar2VideoOpenImage(const char *config)
             {
                 bufferpow2 = 1;
             }
+            else if (strncmp(line, "-prefetch=", 10) == 0)
+            {
+                if (sscanf(&line[10], "%d", &vid->prefetch) == 0 || vid->prefetch < 0)
+                {
+                    err_i = 1;
+                }
+            }
+            else if (strcmp(line, "-cache") == 0)
+            {
+                vid->cache = TRUE;
+            }
+            else if (strncmp(line, "-fps=", 5) == 0)
+            {
+                if (sscanf(&line[5], "%lf", &vid->fps) == 0 || vid->fps <= 0.0)
+                {
+                    err_i = 1;
+                }
+            }
+            else if (strncmp(line, "-timestamps=", 12) == 0)
+            {
+                strncpy(timestampsPath, &line[12], sizeof(timestampsPath) - 1);
+                timestampsPath[sizeof(timestampsPath) - 1] = '\0';
+            }
             else if (strncmp(a, "-loop", 5) == 0)
             {
                 vid->loop = TRUE;
@@ -527,6 +785,11 @@ AR2VideoParamImageT* ar2VideoOpenImage(const char *config)
         goto bail;
     }
 
+    if (timestampsPath[0] && readTimestamps(vid, timestampsPath) != 0)
+    {
+        goto bail;
+    }
+
     // Point to head of image list.
     vid->nextImage = vid->imageList;
 
@@ -534,6 +797,17 @@ AR2VideoParamImageT* ar2VideoOpenImage(const char *config)
 
     return vid;
 bail:
+    ar2VideoSetBufferSizeImage(vid, 0, 0);
+    while (vid->imageList)
+    {
+        imageRef       = vid->imageList;
+        vid->imageList = vid->imageList->next;
+        free(imageRef->pathname);
+        free(imageRef);
+    }
+
+    pthread_mutex_destroy(&(vid->lock));
+    pthread_cond_destroy(&(vid->cond));
     free(vid);
     return (NULL);
 }
@@ -545,6 +819,8 @@ int ar2VideoCloseImage(AR2VideoParamImageT *vid)
     if (!vid)
         return (-1);       // Sanity check.
 
+    ar2VideoCapStopImage(vid);
+
     while (vid->imageList)
     {
         imageRefToFree = vid->imageList;
@@ -557,6 +833,9 @@ int ar2VideoCloseImage(AR2VideoParamImageT *vid)
     }
 
     ar2VideoSetBufferSizeImage(vid, 0, 0);
+    free(vid->timestamps);
+    pthread_mutex_destroy(&(vid->lock));
+    pthread_cond_destroy(&(vid->cond));
     free(vid);
 
     return 0;
@@ -564,48 +843,137 @@ int ar2VideoCloseImage(AR2VideoParamImageT *vid)
 
 int ar2VideoCapStartImage(AR2VideoParamImageT *vid)
 {
+    if (!vid)
+        return (-1);       // Sanity check.
+
+    if (vid->cache)
+    {
+        if (!vid->cacheFilled)
+            return (fillCache(vid));
+
+        return (0);
+    }
+
+    if (vid->threadRunning)
+        return (0);
+
+    // Frames queued before capture stopped are kept, but the caller holds none of them across a
+    // stop and start. If none are queued, the queue restarts at frames[0], which the synchronous
+    // path may have used meanwhile.
+    vid->held = FALSE;
+    vid->eos  = FALSE;
+    if (!vid->queueCount)
+        vid->queueHead = 0;
+
+    if (vid->prefetch > 0)
+    {
+        vid->threadStop = FALSE;
+        if (pthread_create(&(vid->thread), NULL, prefetchThread, vid) != 0)
+        {
+            ARLOGe("Error: unable to start image prefetch thread.\n");
+            return (-1);
+        }
+
+        vid->threadRunning = TRUE;
+    }
+
     return 0;
 }
 
+// Frames already decoded stay queued, and are returned once capture restarts.
 int ar2VideoCapStopImage(AR2VideoParamImageT *vid)
 {
+    if (!vid)
+        return (-1);       // Sanity check.
+
+    if (vid->threadRunning)
+    {
+        pthread_mutex_lock(&(vid->lock));
+        vid->threadStop = TRUE;
+        pthread_cond_broadcast(&(vid->cond));
+        pthread_mutex_unlock(&(vid->lock));
+        pthread_join(vid->thread, NULL);
+        vid->threadRunning = FALSE;
+    }
+
     return 0;
 }
 
 AR2VideoBufferT* ar2VideoGetImageImage(AR2VideoParamImageT *vid)
 {
-    FILE *infile;
-    int  ok;
+    AR2VideoImageFrameT *frame;
+    unsigned long       i;
 
-    if (!vid)
+    if (!vid || !vid->frames)
         return (NULL);       // Sanity check.
 
-    if (vid->nextImage)
+    if (vid->cache)
     {
-        if ((infile = fopen(vid->nextImage->pathname, "rb")) == NULL)
+        if (!vid->cacheFilled)
+            fillCache(vid);
+
+        // Return the next image which decoded successfully.
+        for (i = 0; i < vid->imageCount; i++)
         {
-            ARLOGe("Can't open JPEG file '%s'\n", vid->nextImage->pathname);
-            ARLOGperror(NULL);
+            if (vid->cacheNext >= vid->imageCount)
+            {
+                if (!vid->loop)
+                    return (NULL);
+
+                vid->cacheNext = 0;
+                vid->loopCount++;
+            }
+
+            frame = &(vid->frames[vid->cacheNext]);
+            setFrameTime(vid, frame, vid->cacheNext, vid->loopCount);
+            vid->cacheNext++;
+            if (frame->valid)
+                break;
         }
-        else
+
+        if (i == vid->imageCount)
+            return (NULL);
+    }
+    else if (vid->threadRunning || vid->queueCount)
+    {
+        pthread_mutex_lock(&(vid->lock));
+        vid->held = FALSE; // The caller is done with the frame returned last time.
+        pthread_cond_broadcast(&(vid->cond));
+        while (!vid->queueCount && !vid->eos && vid->threadRunning)
         {
-            ok = jpegRead(infile, vid->buffer.buff, vid->bufWidth, vid->bufHeight, vid->format);
-            fclose(infile);
-            vid->buffer.fillFlag  = 1;
-            vid->buffer.time_sec  = 0;
-            vid->buffer.time_usec = 0;
+            pthread_cond_wait(&(vid->cond), &(vid->lock));
         }
 
-        vid->nextImage = vid->nextImage->next; // Next item in linked list.
-        if (!vid->nextImage && vid->loop)
-            vid->nextImage = vid->imageList;                               // If we've hit the end of the list and looping requested, go back to head of linked list.
+        if (!vid->queueCount)
+        {
+            pthread_mutex_unlock(&(vid->lock));
+            return (NULL);
+        }
 
-        return &(vid->buffer);
+        frame          = &(vid->frames[vid->queueHead]);
+        vid->queueHead = (vid->queueHead + 1) % vid->frameCount;
+        vid->queueCount--;
+        vid->held = TRUE;
+        pthread_mutex_unlock(&(vid->lock));
     }
     else
     {
-        return (NULL);
+        if (!vid->nextImage)
+            return (NULL);
+
+        frame = &(vid->frames[0]);
+        if (readFrame(vid, vid->nextImage->pathname, frame->buff))
+            setFrameTime(vid, frame, vid->nextIndex, vid->loopCount);
+
+        advanceImage(vid);
     }
+
+    vid->buffer.buff      = frame->buff;
+    vid->buffer.fillFlag  = 1;
+    vid->buffer.time_sec  = frame->time_sec;
+    vid->buffer.time_usec = frame->time_usec;
+
+    return &(vid->buffer);
 }
 
 int ar2VideoGetSizeImage(AR2VideoParamImageT *vid, int *x, int *y)
@@ -630,16 +998,32 @@ AR_PIXEL_FORMAT ar2VideoGetPixelFormatImage(AR2VideoParamImageT *vid)
 int ar2VideoSetBufferSizeImage(AR2VideoParamImageT *vid, const int width, const int height)
 {
     int rowBytes;
+    int i;
 
     if (!vid)
         return (-1);
 
-    if (vid->buffer.buff)
+    if (vid->threadRunning)
     {
-        free (vid->buffer.buff);
-        vid->buffer.buff = NULL;
+        ARLOGe("Error: Buffer size can't be changed during capture.\n");
+        return (-1);
     }
 
+    if (vid->frames)
+    {
+        for (i = 0; i < vid->frameCount; i++)
+            free(vid->frames[i].buff);
+
+        free(vid->frames);
+        vid->frames      = NULL;
+        vid->frameCount  = 0;
+        vid->queueHead   = vid->queueCount = 0;
+        vid->held        = FALSE;
+        vid->cacheFilled = FALSE;
+    }
+
+    vid->buffer.buff = NULL;
+
     if (width && height)
     {
         if (width < vid->width || height < vid->height)
@@ -648,12 +1032,23 @@ int ar2VideoSetBufferSizeImage(AR2VideoParamImageT *vid, const int width, const
             return (-1);
         }
 
-        rowBytes         = width * arVideoUtilGetPixelSize(vid->format);
-        vid->buffer.buff = (unsigned char*)malloc(height * rowBytes);
-        if (!vid->buffer.buff)
+        if (vid->cache)
+            vid->frameCount = (vid->imageCount ? (int)vid->imageCount : 1);
+        else
+            vid->frameCount = vid->prefetch + 1;
+
+        rowBytes = width * arVideoUtilGetPixelSize(vid->format);
+        arMallocClear(vid->frames, AR2VideoImageFrameT, vid->frameCount);
+        for (i = 0; i < vid->frameCount; i++)
         {
-            ARLOGe("Error: Out of memory!\n");
-            return (-1);
+            vid->frames[i].buff = (unsigned char*)malloc(height * rowBytes);
+            if (!vid->frames[i].buff)
+            {
+                ARLOGe("Error: Out of memory!\n");
+                vid->frameCount = i;
+                ar2VideoSetBufferSizeImage(vid, 0, 0);
+                return (-1);
+            }
         }
     }
 
@@ -0,0 +1,729 @@
+/*
+ *  videoRawSeq.c
+ *  ARToolKit5
+ *
+ *  This file is part of ARToolKit.
+ *
+ *  ARToolKit is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ARToolKit is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with ARToolKit.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  As a special exception, the copyright holders of this library give you
+ *  permission to link this library with independent modules to produce an
+ *  executable, regardless of the license terms of these independent modules, and to
+ *  copy and distribute the resulting executable under terms of your choice,
+ *  provided that you also meet, for each linked independent module, the terms and
+ *  conditions of the license of that module. An independent module is a module
+ *  which is neither derived from nor based on this library. If you modify this
+ *  library, you may extend this exception to your version of the library, but you
+ *  are not obligated to do so. If you do not wish to do so, delete this exception
+ *  statement from your version.
+ *
+ *  Copyright 2015 Daqri, LLC.
+ *
+ */
+
+#include <AR/video.h>
+
+#ifdef AR_INPUT_RAWSEQ
+
+#include <string.h> // memcmp(), strncmp()
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#endif
+
+#define AR_VIDEO_RAWSEQ_FPS_DEFAULT 30.0
+
+struct _AR2VideoParamRawSeqT
+{
+    AR2VideoBufferT buffer;
+    ARUint8         *planes[2];
+    int             width;
+    int             height;
+    AR_PIXEL_FORMAT format;
+#ifdef _WIN32
+    HANDLE          file;
+    HANDLE          mapping;
+#endif
+    ARUint8         *base;          // Start of the mapping.
+    size_t          mapSize;
+    ARUint8         *frames;        // First frame, i.e. base + headerSize.
+    size_t          frameSize;
+    size_t          frameStride;
+    int             frameCount;
+    double          fps;
+    int             loop;
+    int             paced;
+    int             capturing;
+    int             next;           // Index of the frame to return next in free-run mode.
+    int             last;           // Index of the frame returned last, or -1.
+    int             loopCount;      // Times the sequence has wrapped, so that timestamps keep increasing.
+    int             startIndex;     // In paced mode, the frame (counting across loops) due at startTime.
+    double          startTime;
+};
+
+static ARUint32 readLE32(const ARUint8 *p)
+{
+    return ((ARUint32)p[0] | ((ARUint32)p[1] << 8) | ((ARUint32)p[2] << 16) | ((ARUint32)p[3] << 24));
+}
+
+// Seconds on a clock which is not adjusted by arUtilTimerReset(), for pacing playback.
+static double getTime(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return ((double)count.QuadPart / (double)freq.QuadPart);
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return ((double)tv.tv_sec + (double)tv.tv_usec * 0.000001);
+#endif
+}
+
+static int isBiPlanar(AR_PIXEL_FORMAT format)
+{
+    return (format == AR_PIXEL_FORMAT_420v || format == AR_PIXEL_FORMAT_420f || format == AR_PIXEL_FORMAT_NV21);
+}
+
+static int mapFile(AR2VideoParamRawSeqT *vid, const char *path)
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    vid->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (vid->file == INVALID_HANDLE_VALUE)
+    {
+        vid->file = NULL;
+        return (-1);
+    }
+
+    if (!GetFileSizeEx(vid->file, &size) || (ULONGLONG)size.QuadPart > (ULONGLONG)((size_t)-1))
+        return (-1);
+
+    vid->mapSize = (size_t)size.QuadPart;
+    if (vid->mapSize < AR_VIDEO_RAWSEQ_HEADER_SIZE)
+        return (-1);
+
+    // Copy-on-write, so that callers may modify frames without altering the file.
+    vid->mapping = CreateFileMapping(vid->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!vid->mapping)
+        return (-1);
+
+    vid->base = (ARUint8*)MapViewOfFile(vid->mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!vid->base)
+        return (-1);
+
+#else
+    struct stat st;
+    void        *base;
+    int         fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return (-1);
+
+    if (fstat(fd, &st) != 0 || st.st_size < AR_VIDEO_RAWSEQ_HEADER_SIZE || (unsigned long long)st.st_size > (unsigned long long)((size_t)-1))
+    {
+        close(fd);
+        return (-1);
+    }
+
+    vid->mapSize = (size_t)st.st_size;
+    // Copy-on-write, so that callers may modify frames without altering the file.
+    base = mmap(NULL, vid->mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping holds its own reference to the file.
+    if (base == MAP_FAILED)
+        return (-1);
+
+    vid->base = (ARUint8*)base;
+#  ifdef MADV_SEQUENTIAL
+    madvise(base, vid->mapSize, MADV_SEQUENTIAL);
+#  endif
+#endif
+
+    return (0);
+}
+
+static void unmapFile(AR2VideoParamRawSeqT *vid)
+{
+#ifdef _WIN32
+    if (vid->base)
+        UnmapViewOfFile(vid->base);
+
+    if (vid->mapping)
+        CloseHandle(vid->mapping);
+
+    if (vid->file)
+        CloseHandle(vid->file);
+
+    vid->mapping = NULL;
+    vid->file    = NULL;
+#else
+    if (vid->base)
+        munmap(vid->base, vid->mapSize);
+#endif
+    vid->base = NULL;
+}
+
+// Validates the header and sets up frame geometry. Returns 0 if the file is usable.
+static int readHeader(AR2VideoParamRawSeqT *vid)
+{
+    const ARUint8 *h = vid->base;
+    ARUint32      version, headerSize, width, height, format, frameCount, frameStride, fpsNum, fpsDen;
+    size_t        available;
+
+    if (memcmp(h, AR_VIDEO_RAWSEQ_MAGIC, 8) != 0)
+    {
+        ARLOGe("Error: file is not a raw frame sequence.\n");
+        return (-1);
+    }
+
+    version     = readLE32(h + 8);
+    headerSize  = readLE32(h + 12);
+    width       = readLE32(h + 16);
+    height      = readLE32(h + 20);
+    format      = readLE32(h + 24);
+    frameCount  = readLE32(h + 28);
+    frameStride = readLE32(h + 32);
+    fpsNum      = readLE32(h + 36);
+    fpsDen      = readLE32(h + 40);
+
+    if (version != AR_VIDEO_RAWSEQ_VERSION)
+    {
+        ARLOGe("Error: unsupported raw frame sequence version %u.\n", version);
+        return (-1);
+    }
+
+    if (headerSize < AR_VIDEO_RAWSEQ_HEADER_SIZE || headerSize > vid->mapSize)
+    {
+        ARLOGe("Error: bad raw frame sequence header size %u.\n", headerSize);
+        return (-1);
+    }
+
+    if (width == 0 || height == 0 || width > 32768 || height > 32768 || format > AR_PIXEL_FORMAT_MAX || arVideoUtilGetPixelSize((AR_PIXEL_FORMAT)format) == 0)
+    {
+        ARLOGe("Error: bad raw frame sequence geometry %ux%u, format %u.\n", width, height, format);
+        return (-1);
+    }
+
+    vid->width  = (int)width;
+    vid->height = (int)height;
+    vid->format = (AR_PIXEL_FORMAT)format;
+    if (isBiPlanar(vid->format))
+    {
+        if ((width & 1) || (height & 1))
+        {
+            ARLOGe("Error: bi-planar raw frame sequence must have even dimensions.\n");
+            return (-1);
+        }
+
+        vid->frameSize = (size_t)width * height + (size_t)width * height / 2;
+    }
+    else
+    {
+        vid->frameSize = (size_t)width * height * arVideoUtilGetPixelSize(vid->format);
+    }
+
+    if (frameStride == 0)
+    {
+        vid->frameStride = vid->frameSize;
+    }
+    else if (frameStride < vid->frameSize)
+    {
+        ARLOGe("Error: raw frame sequence frame stride %u is less than frame size %lu.\n", frameStride, (unsigned long)vid->frameSize);
+        return (-1);
+    }
+    else
+    {
+        vid->frameStride = frameStride;
+    }
+
+    // The last frame needs only frameSize bytes, not a whole stride.
+    available = vid->mapSize - headerSize;
+    if (available < vid->frameSize)
+    {
+        ARLOGe("Error: raw frame sequence holds no frames.\n");
+        return (-1);
+    }
+
+    available = (available - vid->frameSize) / vid->frameStride + 1;
+    if (available > INT_MAX)
+        available = INT_MAX;
+
+    if (frameCount == 0)
+    {
+        vid->frameCount = (int)available;
+    }
+    else if (frameCount > available)
+    {
+        ARLOGw("Warning: raw frame sequence header declares %u frames but file holds only %lu.\n", frameCount, (unsigned long)available);
+        vid->frameCount = (int)available;
+    }
+    else
+    {
+        vid->frameCount = (int)frameCount;
+    }
+
+    vid->frames = vid->base + headerSize;
+    if (fpsNum)
+        vid->fps = (double)fpsNum / (double)(fpsDen ? fpsDen : 1);
+
+    return (0);
+}
+
+int ar2VideoDispOptionRawSeq(void)
+{
+    ARLOG(" -device=RawSeq\n");
+    ARLOG("\n");
+    ARLOG(" -file=\"path\"\n");
+    ARLOG("    specifies the raw frame sequence file to play back.\n");
+    ARLOG("    (Quotes are required only if the path contains spaces.)\n");
+    ARLOG(" -loop\n");
+    ARLOG("    return to the first frame after the last.\n");
+    ARLOG(" -noloop\n");
+    ARLOG("    stop returning frames after the last (default).\n");
+    ARLOG(" -paced\n");
+    ARLOG("    return frames at the sequence frame rate, skipping frames if the\n");
+    ARLOG("    caller falls behind. By default, each call returns the next frame.\n");
+    ARLOG(" -fps=F\n");
+    ARLOG("    overrides the frame rate stored in the file (default %.0f if none).\n", AR_VIDEO_RAWSEQ_FPS_DEFAULT);
+    ARLOG(" -preload\n");
+    ARLOG("    read the whole file into memory on open, so that playback never\n");
+    ARLOG("    waits on the disk.\n");
+    ARLOG("\n");
+
+    return 0;
+}
+
+AR2VideoParamRawSeqT* ar2VideoOpenRawSeq(const char *config)
+{
+    AR2VideoParamRawSeqT *vid;
+    const char           *a;
+    char                 b[256];
+    char                 *path    = NULL;
+    double               fps      = 0.0;
+    int                  preload  = 0;
+    int                  err_i    = 0;
+    size_t               i;
+    volatile ARUint8     sum      = 0;
+
+    arMallocClear(vid, AR2VideoParamRawSeqT, 1);
+    vid->last = -1;
+
+    a = config;
+    if (a != NULL)
+    {
+        for (;;)
+        {
+            while (*a == ' ' || *a == '\t')
+                a++;
+
+            if (*a == '\0')
+                break;
+
+            if (sscanf(a, "%255s", b) == 0)
+                break;
+
+            if (strncmp(b, "-file=", 6) == 0)
+            {
+                const char *p = a + 6, *q;
+                size_t     len;
+
+                if (*p == '"')
+                {
+                    p++;
+                    q = strchr(p, '"');
+                    if (!q)
+                    {
+                        ARLOGe("Error: unterminated quotes in -file option.\n");
+                        err_i = 1;
+                        break;
+                    }
+                }
+                else
+                {
+                    q = p;
+                    while (*q != ' ' && *q != '\t' && *q != '\0')
+                        q++;
+                }
+
+                len = q - p;
+                free(path);
+                arMalloc(path, char, len + 1);
+                strncpy(path, p, len);
+                path[len] = '\0';
+
+                // Skip the quoted path, which may contain spaces.
+                a = (*q == '"' ? q + 1 : q);
+                continue;
+            }
+            else if (strcmp(b, "-loop") == 0)
+            {
+                vid->loop = 1;
+            }
+            else if (strcmp(b, "-noloop") == 0)
+            {
+                vid->loop = 0;
+            }
+            else if (strcmp(b, "-paced") == 0)
+            {
+                vid->paced = 1;
+            }
+            else if (strncmp(b, "-fps=", 5) == 0)
+            {
+                if (sscanf(&b[5], "%lf", &fps) != 1 || fps <= 0.0)
+                    err_i = 1;
+            }
+            else if (strcmp(b, "-preload") == 0)
+            {
+                preload = 1;
+            }
+            else if (strcmp(b, "-device=RawSeq") == 0)
+            {}
+            else
+            {
+                err_i = 1;
+            }
+
+            if (err_i)
+                break;
+
+            while (*a != ' ' && *a != '\t' && *a != '\0')
+                a++;
+        }
+    }
+
+    if (err_i || !path)
+    {
+        if (!path)
+            ARLOGe("Error: no raw frame sequence file specified.\n");
+        ar2VideoDispOptionRawSeq();
+        goto bail;
+    }
+
+    if (mapFile(vid, path) != 0)
+    {
+        ARLOGe("Error: unable to map raw frame sequence file '%s'.\n", path);
+        ARLOGperror(NULL);
+        goto bail;
+    }
+
+    if (readHeader(vid) != 0)
+        goto bail;
+
+    if (fps > 0.0)
+        vid->fps = fps;
+    else if (vid->fps <= 0.0)
+        vid->fps = AR_VIDEO_RAWSEQ_FPS_DEFAULT;
+
+    if (preload)
+    {
+        // Touch one byte per page so every frame is resident before playback starts.
+        for (i = 0; i < vid->mapSize; i += 4096)
+            sum += vid->base[i];
+    }
+
+    if (isBiPlanar(vid->format))
+    {
+        vid->buffer.bufPlanes     = vid->planes;
+        vid->buffer.bufPlaneCount = 2;
+    }
+
+    ARLOGi("RawSeq video '%s': %d frames of %dx%d %s at %.3f fps%s.\n", path, vid->frameCount, vid->width, vid->height,
+           arVideoUtilGetPixelFormatName(vid->format), vid->fps, (vid->paced ? ", paced" : ""));
+    free(path);
+
+    return vid;
+
+bail:
+    unmapFile(vid);
+    free(path);
+    free(vid);
+    return (NULL);
+}
+
+int ar2VideoCloseRawSeq(AR2VideoParamRawSeqT *vid)
+{
+    if (!vid)
+        return (-1);       // Sanity check.
+
+    unmapFile(vid);
+    free(vid);
+
+    return 0;
+}
+
+int ar2VideoCapStartRawSeq(AR2VideoParamRawSeqT *vid)
+{
+    if (!vid)
+        return (-1);       // Sanity check.
+
+    vid->startIndex = vid->loopCount * vid->frameCount + vid->next;
+    vid->startTime  = getTime();
+    vid->capturing  = 1;
+
+    return 0;
+}
+
+int ar2VideoCapStopRawSeq(AR2VideoParamRawSeqT *vid)
+{
+    if (!vid)
+        return (-1);       // Sanity check.
+
+    vid->capturing = 0;
+
+    return 0;
+}
+
+AR2VideoBufferT* ar2VideoGetImageRawSeq(AR2VideoParamRawSeqT *vid)
+{
+    ARUint8 *frame;
+    double  due, t;
+    int     index;
+    int     loopCount;
+
+    if (!vid)
+        return (NULL);       // Sanity check.
+
+    if (vid->paced)
+    {
+        if (!vid->capturing)
+            return (NULL);
+
+        // The frame due now, which skips any frames the caller was too slow to collect.
+        due = (double)vid->startIndex + (getTime() - vid->startTime) * vid->fps;
+        if (due >= (double)INT_MAX)
+            due = (double)(INT_MAX - 1);
+        index     = (int)due;
+        loopCount = index / vid->frameCount;
+        if (loopCount)
+        {
+            if (!vid->loop)
+                return (NULL);
+
+            index %= vid->frameCount;
+        }
+
+        if (index == vid->last && loopCount == vid->loopCount)
+            return (NULL);       // No new frame yet.
+
+        vid->next      = index + 1;
+        vid->loopCount = loopCount;
+    }
+    else
+    {
+        if (vid->next >= vid->frameCount)
+        {
+            if (!vid->loop)
+                return (NULL);
+
+            vid->next = 0;
+            vid->loopCount++;
+        }
+
+        index = vid->next++;
+    }
+
+    vid->last = index;
+    frame     = vid->frames + (size_t)index * vid->frameStride;
+    if (vid->buffer.bufPlaneCount)
+    {
+        vid->planes[0] = frame;
+        vid->planes[1] = frame + (size_t)vid->width * vid->height;
+    }
+
+    // Timestamps are the frame's position in the sequence.
+    t                     = ((double)vid->loopCount * vid->frameCount + index) / vid->fps;
+    vid->buffer.buff      = frame;
+    vid->buffer.fillFlag  = 1;
+    vid->buffer.time_sec  = (ARUint32)t;
+    vid->buffer.time_usec = (ARUint32)((t - (double)vid->buffer.time_sec) * 1000000.0);
+
+    return &(vid->buffer);
+}
+
+int ar2VideoGetSizeRawSeq(AR2VideoParamRawSeqT *vid, int *x, int *y)
+{
+    if (!vid)
+        return (-1);       // Sanity check.
+
+    if (x)
+        *x = vid->width;
+
+    if (y)
+        *y = vid->height;
+
+    return 0;
+}
+
+AR_PIXEL_FORMAT ar2VideoGetPixelFormatRawSeq(AR2VideoParamRawSeqT *vid)
+{
+    if (!vid)
+        return (AR_PIXEL_FORMAT_INVALID);       // Sanity check.
+
+    return (vid->format);
+}
+
+int ar2VideoGetIdRawSeq(AR2VideoParamRawSeqT *vid, ARUint32 *id0, ARUint32 *id1)
+{
+    return -1;
+}
+
+int ar2VideoGetParamiRawSeq(AR2VideoParamRawSeqT *vid, int paramName, int *value)
+{
+    if (!vid || !value)
+        return -1;
+
+    if (paramName == AR_VIDEO_RAWSEQ_FRAME_COUNT)
+    {
+        *value = vid->frameCount;
+        return 0;
+    }
+    else if (paramName == AR_VIDEO_RAWSEQ_FRAME_INDEX)
+    {
+        *value = (vid->next < vid->frameCount ? vid->next : (vid->loop ? 0 : vid->frameCount));
+        return 0;
+    }
+
+#ifdef AR_INPUT_IPHONE
+    if (paramName == AR_VIDEO_PARAM_IOS_ASYNC)
+    {
+        *value = 0;
+        return 0;
+    }
+#endif
+    return -1;
+}
+
+int ar2VideoSetParamiRawSeq(AR2VideoParamRawSeqT *vid, int paramName, int value)
+{
+    if (!vid)
+        return -1;
+
+    if (paramName == AR_VIDEO_RAWSEQ_FRAME_INDEX)
+    {
+        if (value < 0 || value >= vid->frameCount)
+            return -1;
+
+        // Seeking also restarts the pacing clock from the new frame.
+        vid->next       = value;
+        vid->last       = -1;
+        vid->startIndex = vid->loopCount * vid->frameCount + value;
+        vid->startTime  = getTime();
+        return 0;
+    }
+
+    return -1;
+}
+
+int ar2VideoGetParamdRawSeq(AR2VideoParamRawSeqT *vid, int paramName, double *value)
+{
+    if (!vid || !value)
+        return -1;
+
+    if (paramName == AR_VIDEO_RAWSEQ_FPS)
+    {
+        *value = vid->fps;
+        return 0;
+    }
+
+    return -1;
+}
+
+int ar2VideoSetParamdRawSeq(AR2VideoParamRawSeqT *vid, int paramName, double value)
+{
+    if (!vid)
+        return -1;
+
+    if (paramName == AR_VIDEO_RAWSEQ_FPS)
+    {
+        if (value <= 0.0)
+            return -1;
+
+        // Keep the current position when the rate changes.
+        vid->startIndex = vid->loopCount * vid->frameCount + vid->next;
+        vid->startTime  = getTime();
+        vid->fps        = value;
+        return 0;
+    }
+
+    return -1;
+}
+
+int ar2VideoGetParamsRawSeq(AR2VideoParamRawSeqT *vid, const int paramName, char **value)
+{
+    if (!vid || !value)
+        return (-1);
+
+    switch (paramName)
+    {
+    default:
+        return (-1);
+    }
+
+    return (0);
+}
+
+int ar2VideoSetParamsRawSeq(AR2VideoParamRawSeqT *vid, const int paramName, const char *value)
+{
+    if (!vid)
+        return (-1);
+
+    switch (paramName)
+    {
+    default:
+        return (-1);
+    }
+
+    return (0);
+}
+
+// Frames are returned in place in the mapping, so the buffer is always exactly the frame size.
+int ar2VideoSetBufferSizeRawSeq(AR2VideoParamRawSeqT *vid, const int width, const int height)
+{
+    if (!vid)
+        return (-1);
+
+    if (width != vid->width || height != vid->height)
+    {
+        ARLOGe("Error: RawSeq video buffer size must equal the video size.\n");
+        return (-1);
+    }
+
+    return (0);
+}
+
+int ar2VideoGetBufferSizeRawSeq(AR2VideoParamRawSeqT *vid, int *width, int *height)
+{
+    if (!vid)
+        return (-1);
+
+    if (width)
+        *width = vid->width;
+
+    if (height)
+        *height = vid->height;
+
+    return (0);
+}
+
+#endif //  AR_INPUT_RAWSEQ
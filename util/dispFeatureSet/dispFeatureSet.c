@@ -244,11 +244,11 @@ static void dispFunc(void)
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
     argViewportSetPixFormat(vp[page / AR2_BLUR_IMAGE_MAX], AR_PIXEL_FORMAT_MONO);
     argDrawMode2D(vp[page / AR2_BLUR_IMAGE_MAX]);
-    argDrawImage(imageSet->scale[page / AR2_BLUR_IMAGE_MAX]->imgBWBlur[page % AR2_BLUR_IMAGE_MAX]);
+    argDrawImage(ar2GetImageSetScale(imageSet, page / AR2_BLUR_IMAGE_MAX)->imgBWBlur[page % AR2_BLUR_IMAGE_MAX]);
 #else
     argViewportSetPixFormat(vp[page], AR_PIXEL_FORMAT_MONO);
     argDrawMode2D(vp[page]);
-    argDrawImage(imageSet->scale[page]->imgBW);
+    argDrawImage(ar2GetImageSetScale(imageSet, page)->imgBW);
 #endif
 
     if (display_fset)
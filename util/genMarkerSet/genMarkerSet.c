@@ -259,9 +259,9 @@ static int init(int argc, char *argv[])
         pixFormat = AR_PIXEL_FORMAT_MONO;
 
 #if AR2_CAPABLE_ADAPTIVE_TEMPLATE
-        image = imageSet->scale[targetScale]->imgBWBlur[1];
+        image = ar2GetImageSetScale(imageSet, targetScale)->imgBWBlur[1];
 #else
-        image = imageSet->scale[targetScale]->imgBW;
+        image = ar2GetImageSetScale(imageSet, targetScale)->imgBW;
 #endif
         xsize = imageSet->scale[targetScale]->xsize;
         ysize = imageSet->scale[targetScale]->ysize;
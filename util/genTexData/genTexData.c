@@ -52,6 +52,9 @@
 #include <AR2/featureSet.h>
 #include <AR2/util.h>
 #include <KPM/kpm.h>
+#include <thread_sub.h>
+#include <pthread.h>
+#include <stdint.h> // uint64_t
 #ifdef _WIN32
 #  define MAXPATHLEN MAX_PATH
 #else
@@ -73,6 +76,10 @@
 #define KPM_MINIMUM_IMAGE_SIZE                           28 // Filter size for 1 octaves plus 1.
 // #define KPM_MINIMUM_IMAGE_SIZE 196 // Filter size for 4 octaves plus 1.
 
+#define GEN_BATCH_MAX_MEMORY_DEFAULT 2048       // Megabytes.
+#define GEN_BATCH_BYTES_PER_PIXEL    80         // Approximate peak memory use per source image pixel while generating one dataset.
+#define GEN_BATCH_HASH_EXT           "gentexdata"
+
 #ifndef MIN
 #  define MIN(x, y) (x < y ? x : y)
 #endif
@@ -89,8 +96,43 @@ enum
     E_GENERIC_ERROR                              = 255
 };
 
+enum
+{
+    GEN_STAGE_IMAGESET = 0,
+    GEN_STAGE_FEATUREMAP,
+    GEN_STAGE_FEATURESET,
+    GEN_STAGE_KPM,
+    GEN_STAGE_NUM
+};
+
+static const char *genStageNames[GEN_STAGE_NUM] = {"ImageSet", "FeatureMap", "FeatureSet", "KPM"};
+
+typedef struct
+{
+    char   imagePath[MAXPATHLEN];
+    char   basename[MAXPATHLEN];                // Output path, without extension.
+    float  dpi;                                 // From the manifest, or -1.0f if not given.
+    int    result;
+    int    skipped;                             // Set if the dataset was already up to date.
+    double times[GEN_STAGE_NUM];
+} GenBatchJobT;
+
+typedef struct
+{
+    GenBatchJobT    *jobs;
+    int             jobCount;
+    int             next;                       // Index of the next job to be taken by a thread.
+    size_t          memoryLimit;                // Bytes, or 0 for no limit.
+    size_t          memoryInUse;                // Estimated bytes used by jobs in progress.
+    int             force;
+    int             featureMapThreads;          // Threads each job uses to generate feature maps.
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+} GenBatchT;
+
 static int genfset  = 1;
 static int genfset3 = 1;
+static int genfset3Indexed = 0;                 // Write the memory-mappable .fset3, which older versions of ARToolKit cannot read.
 
 static char          filename[MAXPATHLEN] = "";
 static AR2JpegImageT *jpegImage;
@@ -118,28 +160,31 @@ static char exitcodefile[MAXPATHLEN] = "";
 static char exitcode                 = 255;
 #define EXIT(c) {exitcode = c; exit(c); }
 
+static char batchfile[MAXPATHLEN] = "";
+static char outdir[MAXPATHLEN]    = "";
+static int  jobNum                = 0;      // 0 = one per CPU.
+static int  maxMemory             = GEN_BATCH_MAX_MEMORY_DEFAULT;
+static int  force                 = 0;
+
 
 static void  usage(char *com);
 static int   readImageFromFile(const char *filename, ARUint8 **image_p, int *xsize_p, int *ysize_p, int *nc_p, float *dpi_p);
 static int   setDPI(void);
+static float getDPIMinAllowable(int imageXsize, int imageYsize, float imageDpi);
+static int   genDPIList(float dpiMinimum, float dpiMaximum, float **dpiList_p, int *dpiNum_p);
+static int   genDataSet(ARUint8 *image, int imageXsize, int imageYsize, int imageNc, float imageDpi, float *dpiList, int dpiNum,
+                        const char *basename, int featureMapThreads, double times[GEN_STAGE_NUM]);
+static int   genBatch(const char *manifest, const char *outputDir, int threads, int maxMemoryMB, int forceAll);
 static void  write_exitcode(void);
 
 int main(int argc, char *argv[])
 {
-    AR2JpegImageT  *jpegImage  = NULL;
     ARUint8        *image      = NULL;
-    AR2ImageSetT   *imageSet   = NULL;
-    AR2FeatureMapT *featureMap = NULL;
-    AR2FeatureSetT *featureSet = NULL;
-    KpmRefDataSet  *refDataSet = NULL;
-    float          scale1, scale2;
-    int            procMode;
     char           buf[1024];
-    int            num;
-    int            i, j;
+    int            i;
     char           *sep = NULL;
     time_t         clock;
-    int            maxFeatureNum;
+    double         times[GEN_STAGE_NUM];
     int            err;
 
     for (i = 1; i < argc; i++)
@@ -193,6 +238,30 @@ int main(int argc, char *argv[])
         {
             background = 1;
         }
+        else if (strncmp(argv[i], "-batch=", 7) == 0)
+        {
+            strncpy(batchfile, &(argv[i][7]), sizeof(batchfile) - 1);
+            batchfile[sizeof(batchfile) - 1] = '\0'; // Ensure NULL termination.
+        }
+        else if (strncmp(argv[i], "-outdir=", 8) == 0)
+        {
+            strncpy(outdir, &(argv[i][8]), sizeof(outdir) - 1);
+            outdir[sizeof(outdir) - 1] = '\0'; // Ensure NULL termination.
+        }
+        else if (strncmp(argv[i], "-jobs=", 6) == 0)
+        {
+            if (sscanf(&argv[i][6], "%d", &jobNum) != 1 || jobNum < 0)
+                usage(argv[0]);
+        }
+        else if (strncmp(argv[i], "-max_memory=", 12) == 0)
+        {
+            if (sscanf(&argv[i][12], "%d", &maxMemory) != 1 || maxMemory < 0)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-force") == 0)
+        {
+            force = 1;
+        }
         else if (strcmp(argv[i], "-nofset") == 0)
         {
             genfset = 0;
@@ -219,6 +288,10 @@ int main(int argc, char *argv[])
         {
             genfset3 = 1;
         }
+        else if (strcmp(argv[i], "-fset3_indexed") == 0)
+        {
+            genfset3Indexed = 1;
+        }
         else if (strncmp(argv[i], "-log=", 5) == 0)
         {
             strncpy(logfile, &(argv[i][5]), sizeof(logfile) - 1);
@@ -264,25 +337,36 @@ int main(int argc, char *argv[])
     }
 
     // Do some checks on the input.
-    if (filename[0] == '\0')
+    if (batchfile[0])
     {
-        ARLOGe("Error: no input file specified. Exiting.\n");
-        usage(argv[0]);
+        if (filename[0] != '\0')
+        {
+            ARLOGe("Error: an input file may not be specified with -batch. Exiting.\n");
+            usage(argv[0]);
+        }
     }
-
-    sep = strrchr(filename, '.');
-    if (!sep || (strcmp(sep, ".jpeg") && strcmp(sep, ".jpg") && strcmp(sep, ".jpe") && strcmp(sep, ".JPEG") && strcmp(sep, ".JPE") && strcmp(sep, ".JPG")))
+    else
     {
-        ARLOGe("Error: input file must be a JPEG image (with suffix .jpeg/.jpg/.jpe). Exiting.\n");
-        usage(argv[0]);
+        if (filename[0] == '\0')
+        {
+            ARLOGe("Error: no input file specified. Exiting.\n");
+            usage(argv[0]);
+        }
+
+        sep = strrchr(filename, '.');
+        if (!sep || (strcmp(sep, ".jpeg") && strcmp(sep, ".jpg") && strcmp(sep, ".jpe") && strcmp(sep, ".JPEG") && strcmp(sep, ".JPE") && strcmp(sep, ".JPG")))
+        {
+            ARLOGe("Error: input file must be a JPEG image (with suffix .jpeg/.jpg/.jpe). Exiting.\n");
+            usage(argv[0]);
+        }
     }
 
     if (background)
     {
 #if HAVE_DAEMON_FUNC
-        if (filename[0] != '/' || logfile[0] != '/' || exitcodefile[0] != '/')
+        if ((batchfile[0] ? (batchfile[0] != '/' || outdir[0] != '/') : filename[0] != '/') || logfile[0] != '/' || exitcodefile[0] != '/')
         {
-            ARLOGe("Error: -background flag requires full pathname of files (input, -log or -exitcode) to be specified. Exiting.\n");
+            ARLOGe("Error: -background flag requires full pathname of files (input or -batch and -outdir, -log or -exitcode) to be specified. Exiting.\n");
             EXIT(E_BAD_PARAMETER);
         }
 
@@ -298,22 +382,25 @@ int main(int argc, char *argv[])
             EXIT(E_BAD_PARAMETER);
         }
 
-        if (dpi == -1.0)
+        if (!batchfile[0])
         {
-            ARLOGe("Error: -background flag requires -dpi to be set. Exiting.\n");
-            EXIT(E_BAD_PARAMETER);
-        }
+            if (dpi == -1.0)
+            {
+                ARLOGe("Error: -background flag requires -dpi to be set. Exiting.\n");
+                EXIT(E_BAD_PARAMETER);
+            }
 
-        if (dpiMin != -1.0f && (dpiMin <= 0.0f || dpiMin > dpi))
-        {
-            ARLOGe("Error: -min_dpi must be greater than 0 and less than or equal to -dpi. Exiting.n\n");
-            EXIT(E_BAD_PARAMETER);
-        }
+            if (dpiMin != -1.0f && (dpiMin <= 0.0f || dpiMin > dpi))
+            {
+                ARLOGe("Error: -min_dpi must be greater than 0 and less than or equal to -dpi. Exiting.n\n");
+                EXIT(E_BAD_PARAMETER);
+            }
 
-        if (dpiMax != -1.0f && (dpiMax < dpiMin || dpiMax > dpi))
-        {
-            ARLOGe("Error: -max_dpi must be greater than or equal to -min_dpi and less than or equal to -dpi. Exiting.n\n");
-            EXIT(E_BAD_PARAMETER);
+            if (dpiMax != -1.0f && (dpiMax < dpiMin || dpiMax > dpi))
+            {
+                ARLOGe("Error: -max_dpi must be greater than or equal to -min_dpi and less than or equal to -dpi. Exiting.n\n");
+                EXIT(E_BAD_PARAMETER);
+            }
         }
 
 #else
@@ -360,6 +447,16 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Batch mode never prompts, so extraction levels not set on the command-line take their defaults.
+    if (batchfile[0])
+    {
+        if (tracking_extraction_level == -1 && (sd_thresh == -1.0 || min_thresh == -1.0 || max_thresh == -1.0 || occ_size == -1))
+            tracking_extraction_level = TRACKING_EXTRACTION_LEVEL_DEFAULT;
+
+        if (initialization_extraction_level == -1 && featureDensity == -1)
+            initialization_extraction_level = INITIALIZATION_EXTRACTION_LEVEL_DEFAULT;
+    }
+
     if (genfset)
     {
         if (tracking_extraction_level == -1 && (sd_thresh == -1.0 || min_thresh == -1.0 || max_thresh == -1.0 || occ_size == -1))
@@ -513,40 +610,683 @@ int main(int argc, char *argv[])
         ARLOGi("SURF_FEATURE = %d\n", featureDensity);
     }
 
-    if ((err = readImageFromFile(filename, &image, &xsize, &ysize, &nc, &dpi)) != 0)
+    if (batchfile[0])
     {
-        ARLOGe("Error reading image from file '%s'.\n", filename);
-        EXIT(err);
+        err = genBatch(batchfile, outdir, jobNum, maxMemory, force);
+        if (err != E_NO_ERROR)
+            EXIT(err);
     }
+    else
+    {
+        if ((err = readImageFromFile(filename, &image, &xsize, &ysize, &nc, &dpi)) != 0)
+        {
+            ARLOGe("Error reading image from file '%s'.\n", filename);
+            EXIT(err);
+        }
 
-    setDPI();
+        setDPI();
 
-    ARLOGi("Generating ImageSet...\n");
-    ARLOGi("   (Source image xsize=%d, ysize=%d, channels=%d, dpi=%.1f).\n", xsize, ysize, nc, dpi);
-    imageSet = ar2GenImageSet(image, xsize, ysize, nc, dpi, dpi_list, dpi_num);
+        ar2UtilRemoveExt(filename);
+        err = genDataSet(image, xsize, ysize, nc, dpi, dpi_list, dpi_num, filename, 0, times);
+        ar2FreeJpegImage(&jpegImage);
+        free(dpi_list);
+        if (err != E_NO_ERROR)
+            EXIT(err);
+
+        for (i = 0; i < GEN_STAGE_NUM; i++)
+        {
+            ARLOGi("%s time: %.3f s.\n", genStageNames[i], times[i]);
+        }
+    }
+
+    // Print the start date and time.
+    clock = time(NULL);
+    if (clock != (time_t)-1)
+    {
+        struct tm *timeptr = localtime(&clock);
+        if (timeptr)
+        {
+            char stime[26 + 8] = "";
+            if (strftime(stime, sizeof(stime), "%Y-%m-%d %H:%M:%S %z", timeptr)) // e.g. "1999-12-31 23:59:59 NZDT".
+                ARLOGi("Generator finished at %s\n--\n", stime);
+        }
+    }
+
+    exitcode = E_NO_ERROR;
+    return (exitcode);
+}
+
+// Reads dpiMinAllowable, xsize, ysize, dpi, background, dpiMin, dpiMax.
+// Sets dpiMin, dpiMax, dpi_num, dpi_list.
+static int setDPI(void)
+{
+    float dpiMinAllowable;
+    char  buf1[256];
+
+    // Determine minimum allowable DPI, truncated to 3 decimal places.
+    dpiMinAllowable = getDPIMinAllowable(xsize, ysize, dpi);
+
+    if (background)
+    {
+        if (dpiMin == -1.0f)
+            dpiMin = dpiMinAllowable;
+
+        if (dpiMax == -1.0f)
+            dpiMax = dpi;
+    }
+
+    if (dpiMin == -1.0f)
+    {
+        for (;;)
+        {
+            printf("Enter the minimum image resolution (DPI, in range [%.3f, %.3f]): ", dpiMinAllowable, (dpiMax == -1.0f ? dpi : dpiMax));
+            if (fgets(buf1, 256, stdin) == NULL)
+                EXIT(E_USER_INPUT_CANCELLED);
+
+            if (sscanf(buf1, "%f", &dpiMin) == 0)
+                continue;
+
+            if (dpiMin >= dpiMinAllowable && dpiMin <= (dpiMax == -1.0f ? dpi : dpiMax))
+                break;
+            else
+                printf("Error: you entered %.3f, but value must be greater than or equal to %.3f and less than or equal to %.3f.\n", dpiMin, dpiMinAllowable, (dpiMax == -1.0f ? dpi : dpiMax));
+        }
+    }
+    else if (dpiMin < dpiMinAllowable)
+    {
+        ARLOGe("Warning: -min_dpi=%.3f smaller than minimum allowable. Value will be adjusted to %.3f.\n", dpiMin, dpiMinAllowable);
+        dpiMin = dpiMinAllowable;
+    }
+
+    if (dpiMax == -1.0f)
+    {
+        for (;;)
+        {
+            printf("Enter the maximum image resolution (DPI, in range [%.3f, %.3f]): ", dpiMin, dpi);
+            if (fgets(buf1, 256, stdin) == NULL)
+                EXIT(E_USER_INPUT_CANCELLED);
+
+            if (sscanf(buf1, "%f", &dpiMax) == 0)
+                continue;
+
+            if (dpiMax >= dpiMin && dpiMax <= dpi)
+                break;
+            else
+                printf("Error: you entered %.3f, but value must be greater than or equal to minimum resolution (%.3f) and less than or equal to image resolution (%.3f).\n", dpiMax, dpiMin, dpi);
+        }
+    }
+    else if (dpiMax > dpi)
+    {
+        ARLOGe("Warning: -max_dpi=%.3f larger than maximum allowable. Value will be adjusted to %.3f.\n", dpiMax, dpi);
+        dpiMax = dpi;
+    }
+
+    return (genDPIList(dpiMin, dpiMax, &dpi_list, &dpi_num));
+}
+
+// Minimum resolution at which the image is still at least KPM_MINIMUM_IMAGE_SIZE pixels across, truncated to 3 decimal places.
+static float getDPIMinAllowable(int imageXsize, int imageYsize, float imageDpi)
+{
+    return (truncf(((float)KPM_MINIMUM_IMAGE_SIZE / (float)(MIN(imageXsize, imageYsize))) * imageDpi * 1000.0) / 1000.0f);
+}
+
+// Allocate and fill a list of resolutions from dpiMaximum down to dpiMinimum, a third of an octave apart.
+static int genDPIList(float dpiMinimum, float dpiMaximum, float **dpiList_p, int *dpiNum_p)
+{
+    float *dpiList;
+    float dpiWork;
+    int   dpiNum;
+    int   i;
+
+    // Decide how many levels we need.
+    if (dpiMinimum == dpiMaximum)
+    {
+        dpiNum = 1;
+    }
+    else
+    {
+        dpiWork = dpiMinimum;
+
+        for (i = 1;; i++)
+        {
+            dpiWork *= powf(2.0f, 1.0f / 3.0f); // *= 1.25992104989487
+            if (dpiWork >= dpiMaximum * 0.95f)
+            {
+                break;
+            }
+        }
+
+        dpiNum = i + 1;
+    }
+
+    arMalloc(dpiList, float, dpiNum);
+
+    // Determine the DPI values of each level.
+    dpiWork = dpiMinimum;
+
+    for (i = 0; i < dpiNum; i++)
+    {
+        ARLOGi("Image DPI (%d): %f\n", i + 1, dpiWork);
+        dpiList[dpiNum - i - 1] = dpiWork; // Lowest value goes at tail of array, highest at head.
+        dpiWork                *= powf(2.0f, 1.0f / 3.0f);
+        if (dpiWork >= dpiMaximum * 0.95f)
+            dpiWork = dpiMaximum;
+    }
+
+    *dpiList_p = dpiList;
+    *dpiNum_p  = dpiNum;
+
+    return 0;
+}
+
+//
+// Batch generation.
+//
+
+// 64-bit FNV-1a hash.
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char*)data;
+    size_t              i;
+
+    for (i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return (hash);
+}
+
+// Returns 1 if the hash recorded for the dataset matches, and all the files it should have exist.
+static int batchDataSetIsCurrent(const char *basename, uint64_t hash)
+{
+    char               path[MAXPATHLEN + 16];   // Room for the basename and any extension.
+    char               buf[64];
+    FILE               *fp;
+    unsigned long long oldHash;
+    int                ok;
+
+    snprintf(path, sizeof(path), "%s.%s", basename, GEN_BATCH_HASH_EXT);
+    if ((fp = fopen(path, "r")) == NULL)
+        return (0);
+
+    ok = (fgets(buf, sizeof(buf), fp) != NULL && sscanf(buf, "%llx", &oldHash) == 1 && (uint64_t)oldHash == hash);
+    fclose(fp);
+    if (!ok)
+        return (0);
+
+    snprintf(path, sizeof(path), "%s.iset", basename);
+    if ((fp = fopen(path, "rb")) == NULL)
+        return (0);
+
+    fclose(fp);
+    if (genfset)
+    {
+        snprintf(path, sizeof(path), "%s.fset", basename);
+        if ((fp = fopen(path, "rb")) == NULL)
+            return (0);
+
+        fclose(fp);
+    }
+
+    if (genfset3)
+    {
+        snprintf(path, sizeof(path), "%s.fset3", basename);
+        if ((fp = fopen(path, "rb")) == NULL)
+            return (0);
+
+        fclose(fp);
+    }
+
+    return (1);
+}
+
+// Wait until the estimated memory use of running jobs leaves room for another 'bytes'.
+// A job is always admitted when no others are running, however large it is.
+static void batchMemoryAcquire(GenBatchT *batch, size_t bytes)
+{
+    pthread_mutex_lock(&(batch->lock));
+    while (batch->memoryLimit && batch->memoryInUse > 0 && batch->memoryInUse + bytes > batch->memoryLimit)
+    {
+        pthread_cond_wait(&(batch->cond), &(batch->lock));
+    }
+
+    batch->memoryInUse += bytes;
+    pthread_mutex_unlock(&(batch->lock));
+}
+
+static void batchMemoryRelease(GenBatchT *batch, size_t bytes)
+{
+    pthread_mutex_lock(&(batch->lock));
+    batch->memoryInUse -= bytes;
+    pthread_cond_broadcast(&(batch->cond));
+    pthread_mutex_unlock(&(batch->lock));
+}
+
+// Generate the dataset for one manifest entry, unless its image and settings are unchanged since it was last generated.
+static void genBatchJob(GenBatchT *batch, GenBatchJobT *job)
+{
+    AR2JpegImageT *jpegImage = NULL;
+    FILE          *fp;
+    unsigned char buf[4096];
+    size_t        len;
+    uint64_t      hash;
+    float         imageDpi, dpiMinimum, dpiMaximum, dpiMinAllowable;
+    float         *dpiList = NULL;
+    int           dpiNum;
+    int           imageXsize, imageYsize, imageNc;
+    float         jpegDpi;
+    size_t        memory = 0;
+    char          path[MAXPATHLEN + 16];        // Room for the basename and any extension.
+
+    job->result = E_INPUT_DATA_ERROR;
+
+    if ((fp = fopen(job->imagePath, "rb")) == NULL)
+    {
+        ARLOGe("Error: unable to open image '%s'.\n", job->imagePath);
+        return;
+    }
+
+    // Hash the image file, and the settings which affect the output.
+    hash = 14695981039346656037ULL;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        hash = hashBytes(hash, buf, len);
+    }
+
+    len  = snprintf((char*)buf, sizeof(buf), "%s %d %d %d %f %f %f %d %d %f %f %f %f", AR_HEADER_VERSION_STRING, genfset, genfset3, genfset3Indexed,
+                    sd_thresh, min_thresh, max_thresh, occ_size, featureDensity, job->dpi, dpi, dpiMin, dpiMax);
+    hash = hashBytes(hash, buf, len);
+
+    if (!batch->force && batchDataSetIsCurrent(job->basename, hash))
+    {
+        fclose(fp);
+        job->result = E_NO_ERROR;
+        job->skipped = 1;
+        return;
+    }
+
+    // Check the image from its header, so that its memory can be reserved before it is decoded.
+    rewind(fp);
+    if (ar2ReadJpegImageInfo2(fp, &imageXsize, &imageYsize, &imageNc, &jpegDpi) < 0)
+    {
+        ARLOGe("Error: unable to read JPEG image from file '%s'.\n", job->imagePath);
+        fclose(fp);
+        return;
+    }
+
+    if (imageNc != 1 && imageNc != 3)
+    {
+        ARLOGe("Error: JPEG image '%s' is in neither RGB nor grayscale format.\n", job->imagePath);
+        fclose(fp);
+        return;
+    }
+
+    if (imageXsize < KPM_MINIMUM_IMAGE_SIZE || imageYsize < KPM_MINIMUM_IMAGE_SIZE)
+    {
+        ARLOGe("Error: JPEG image '%s' width and height must be at least %d pixels.\n", job->imagePath, KPM_MINIMUM_IMAGE_SIZE);
+        fclose(fp);
+        return;
+    }
+
+    if (job->dpi > 0.0f)
+        imageDpi = job->dpi;
+    else if (dpi != -1.0f)
+        imageDpi = dpi;
+    else
+        imageDpi = jpegDpi;
+
+    if (imageDpi <= 0.0f)
+    {
+        ARLOGe("Error: JPEG image '%s' does not contain embedded resolution data, and none was given in the manifest or with -dpi.\n", job->imagePath);
+        fclose(fp);
+        return;
+    }
+
+    memory = (size_t)imageXsize * (size_t)imageYsize * GEN_BATCH_BYTES_PER_PIXEL;
+    batchMemoryAcquire(batch, memory);
+
+    rewind(fp);
+    jpegImage = ar2ReadJpegImage2(fp);
+    fclose(fp);
+    if (jpegImage == NULL)
+    {
+        ARLOGe("Error: unable to read JPEG image from file '%s'.\n", job->imagePath);
+        goto done;
+    }
+
+    dpiMinAllowable = getDPIMinAllowable(jpegImage->xsize, jpegImage->ysize, imageDpi);
+    dpiMaximum      = (dpiMax == -1.0f || dpiMax > imageDpi) ? imageDpi : dpiMax;
+    dpiMinimum      = (dpiMin == -1.0f || dpiMin < dpiMinAllowable) ? dpiMinAllowable : dpiMin;
+    if (dpiMinimum > dpiMaximum)
+        dpiMinimum = dpiMaximum;
+
+    genDPIList(dpiMinimum, dpiMaximum, &dpiList, &dpiNum);
+
+    // Remove the old hash first, so that an interrupted run is never taken for a complete one.
+    snprintf(path, sizeof(path), "%s.%s", job->basename, GEN_BATCH_HASH_EXT);
+    remove(path);
+
+    ARLOGi("Generating '%s'.\n", job->basename);
+    job->result = genDataSet(jpegImage->image, jpegImage->xsize, jpegImage->ysize, jpegImage->nc, imageDpi, dpiList, dpiNum,
+                             job->basename, batch->featureMapThreads, job->times);
+
+    if (job->result == E_NO_ERROR)
+    {
+        if ((fp = fopen(path, "w")) == NULL)
+        {
+            ARLOGe("Error: unable to write '%s'.\n", path);
+        }
+        else
+        {
+            fprintf(fp, "%016llx\n", (unsigned long long)hash);
+            fclose(fp);
+        }
+    }
+
+done:
+    free(dpiList);
     ar2FreeJpegImage(&jpegImage);
+    batchMemoryRelease(batch, memory);
+}
+
+static void* genBatchWorker(THREAD_HANDLE_T *threadHandle)
+{
+    GenBatchT *batch;
+    int       i;
+
+    batch = (GenBatchT*)threadGetArg(threadHandle);
+
+    while (threadStartWait(threadHandle) == 0)
+    {
+        for (;;)
+        {
+            pthread_mutex_lock(&(batch->lock));
+            i = (batch->next < batch->jobCount ? batch->next++ : -1);
+            pthread_mutex_unlock(&(batch->lock));
+            if (i < 0)
+                break;
+
+            genBatchJob(batch, &(batch->jobs[i]));
+        }
+
+        threadEndSignal(threadHandle);
+    }
+
+    return (NULL);
+}
+
+// Read a manifest of images, one per line, each optionally followed by its resolution in DPI.
+// Blank lines and lines beginning with '#' are ignored. Relative paths are relative to the manifest.
+static int readBatchManifest(const char *manifest, const char *outputDir, GenBatchJobT **jobs_p, int *jobCount_p)
+{
+    FILE         *fp;
+    GenBatchJobT *jobs = NULL, *jobs2;
+    int          jobCount = 0, jobMax = 0;
+    char         line[MAXPATHLEN + 64];
+    char         manifestDir[MAXPATHLEN];
+    char         *p, *sep, *end;
+    char         *name;
+    float        f;
+    int          i;
+
+    if ((fp = fopen(manifest, "r")) == NULL)
+    {
+        ARLOGe("Error: unable to open manifest '%s'.\n", manifest);
+        return (E_INPUT_DATA_ERROR);
+    }
+
+    if (!arUtilGetDirectoryNameFromPath(manifestDir, manifest, sizeof(manifestDir), 1))
+        manifestDir[0] = '\0';
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        // Trim leading and trailing whitespace.
+        for (p = line; *p == ' ' || *p == '\t'; p++) ;
+        for (end = p + strlen(p); end > p && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'); end--) ;
+        *end = '\0';
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        if (jobCount == jobMax)
+        {
+            jobMax += 64;
+            jobs2   = (GenBatchJobT*)realloc(jobs, sizeof(GenBatchJobT) * jobMax);
+            if (!jobs2)
+            {
+                ARLOGe("Out of memory!!\n");
+                goto bail;
+            }
+
+            jobs = jobs2;
+        }
+
+        memset(&(jobs[jobCount]), 0, sizeof(GenBatchJobT));
+        jobs[jobCount].dpi = -1.0f;
+
+        // A trailing number is the resolution.
+        sep = strrchr(p, ' ');
+        if (!sep || strrchr(p, '\t') > sep)
+            sep = strrchr(p, '\t');
+
+        if (sep)
+        {
+            f = strtof(sep + 1, &end);
+            if (end != sep + 1 && *end == '\0')
+            {
+                jobs[jobCount].dpi = f;
+                for (end = sep; end > p && (end[-1] == ' ' || end[-1] == '\t'); end--) ;
+                *end = '\0';
+            }
+        }
+
+        if (p[0] == '/' || manifestDir[0] == '\0'
+#ifdef _WIN32
+            || p[0] == '\\' || (p[0] != '\0' && p[1] == ':')
+#endif
+            )
+            snprintf(jobs[jobCount].imagePath, MAXPATHLEN, "%s", p);
+        else
+            snprintf(jobs[jobCount].imagePath, MAXPATHLEN, "%s%s", manifestDir, p);
+
+        if ((name = arUtilGetFileBasenameFromPath(p, 0)) == NULL)
+        {
+            ARLOGe("Error: bad image path '%s' in manifest.\n", p);
+            goto bail;
+        }
+
+        snprintf(jobs[jobCount].basename, MAXPATHLEN, "%s/%s", outputDir, name);
+        free(name);
+
+        for (i = 0; i < jobCount; i++)
+        {
+            if (strcmp(jobs[i].basename, jobs[jobCount].basename) == 0)
+            {
+                ARLOGe("Error: images '%s' and '%s' would both generate dataset '%s'.\n", jobs[i].imagePath, jobs[jobCount].imagePath, jobs[i].basename);
+                goto bail;
+            }
+        }
+
+        jobCount++;
+    }
+
+    fclose(fp);
+    *jobs_p     = jobs;
+    *jobCount_p = jobCount;
+    return (E_NO_ERROR);
+
+bail:
+    fclose(fp);
+    free(jobs);
+    return (E_INPUT_DATA_ERROR);
+}
+
+// Generate datasets for all the images listed in a manifest into outputDir, up to 'threads' at a time,
+// admitting jobs only while their estimated memory use fits within maxMemoryMB (0 for no limit).
+static int genBatch(const char *manifest, const char *outputDir, int threads, int maxMemoryMB, int forceAll)
+{
+    GenBatchT       batch;
+    THREAD_HANDLE_T **threadHandle;
+    GenBatchJobT    *job;
+    double          totals[GEN_STAGE_NUM];
+    double          t0;
+    int             generated, skipped, failed;
+    int             err;
+    int             i, j;
+
+    if ((err = readBatchManifest(manifest, (outputDir[0] ? outputDir : "."), &(batch.jobs), &(batch.jobCount))) != E_NO_ERROR)
+        return (err);
+
+    if (batch.jobCount == 0)
+    {
+        ARLOGe("Error: no images listed in manifest '%s'.\n", manifest);
+        free(batch.jobs);
+        return (E_INPUT_DATA_ERROR);
+    }
+
+    if (threads < 1)
+        threads = threadGetCPU();
+
+    if (threads > batch.jobCount)
+        threads = batch.jobCount;
+
+    batch.next        = 0;
+    batch.memoryLimit = (size_t)maxMemoryMB * 1024 * 1024;
+    batch.memoryInUse = 0;
+    batch.force       = forceAll;
+    // Share the CPUs between the jobs running at once, rather than have each start a thread per CPU.
+    batch.featureMapThreads = threadGetCPU() / threads;
+    if (batch.featureMapThreads < 1)
+        batch.featureMapThreads = 1;
+    pthread_mutex_init(&(batch.lock), NULL);
+    pthread_cond_init(&(batch.cond), NULL);
+
+    ARLOGi("Generating %d dataset(s) with %d thread(s).\n", batch.jobCount, threads);
+    t0 = arUtilTimer();
+
+    arMalloc(threadHandle, THREAD_HANDLE_T*, threads);
+    for (i = 0; i < threads; i++)
+    {
+        threadHandle[i] = threadInit(i, &batch, genBatchWorker);
+        if (!threadHandle[i])
+        {
+            ARLOGe("Error: unable to start batch thread.\n");
+            exit(E_GENERIC_ERROR);
+        }
+
+        threadStartSignal(threadHandle[i]);
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        threadEndWait(threadHandle[i]);
+        threadWaitQuit(threadHandle[i]);
+        threadFree(&threadHandle[i]);
+    }
+
+    free(threadHandle);
+    pthread_mutex_destroy(&(batch.lock));
+    pthread_cond_destroy(&(batch.cond));
+
+    // Report.
+    for (j = 0; j < GEN_STAGE_NUM; j++)
+        totals[j] = 0.0;
+
+    generated = skipped = failed = 0;
+    ARLOG("%-32s %-9s", "Dataset", "Result");
+    for (j = 0; j < GEN_STAGE_NUM; j++)
+        ARLOG(" %10s", genStageNames[j]);
+
+    ARLOG("\n");
+
+    for (i = 0; i < batch.jobCount; i++)
+    {
+        job = &(batch.jobs[i]);
+        ARLOG("%-32s %-9s", arUtilGetFileNameFromPath(job->basename), (job->result != E_NO_ERROR ? "failed" : (job->skipped ? "unchanged" : "generated")));
+        if (job->result == E_NO_ERROR && !job->skipped)
+        {
+            for (j = 0; j < GEN_STAGE_NUM; j++)
+            {
+                ARLOG(" %9.2fs", job->times[j]);
+                totals[j] += job->times[j];
+            }
+
+            generated++;
+        }
+        else if (job->result == E_NO_ERROR)
+            skipped++;
+        else
+            failed++;
+
+        ARLOG("\n");
+    }
+
+    ARLOG("%-32s %-9s", "Total", "");
+    for (j = 0; j < GEN_STAGE_NUM; j++)
+        ARLOG(" %9.2fs", totals[j]);
+
+    ARLOG("\n");
+    ARLOG("%d generated, %d unchanged, %d failed, in %.2f s.\n", generated, skipped, failed, arUtilTimer() - t0);
+
+    free(batch.jobs);
+
+    return (failed ? E_DATA_PROCESSING_ERROR : E_NO_ERROR);
+}
+
+
+// Generate the image set and, as selected by genfset and genfset3, the feature sets for one image,
+// and save them with the given basename. The time spent in each stage, in seconds, is returned in times[].
+// Reads only settings which are fixed before generation starts, so may be called on several threads at once.
+// Feature maps are generated with featureMapThreads threads, or one per CPU if 0.
+static int genDataSet(ARUint8 *image, int imageXsize, int imageYsize, int imageNc, float imageDpi, float *dpiList, int dpiNum,
+                      const char *basename, int featureMapThreads, double times[GEN_STAGE_NUM])
+{
+    AR2ImageSetT   *imageSet   = NULL;
+    AR2FeatureMapT *featureMap = NULL;
+    AR2FeatureSetT *featureSet = NULL;
+    KpmRefDataSet  *refDataSet = NULL;
+    float          scale1, scale2;
+    int            procMode;
+    int            num;
+    int            maxFeatureNum;
+    int            i, j;
+    double         t0;
+
+    for (i = 0; i < GEN_STAGE_NUM; i++)
+        times[i] = 0.0;
+
+    t0 = arUtilTimer();
+    ARLOGi("Generating ImageSet...\n");
+    ARLOGi("   (Source image xsize=%d, ysize=%d, channels=%d, dpi=%.1f).\n", imageXsize, imageYsize, imageNc, imageDpi);
+    imageSet = ar2GenImageSet(image, imageXsize, imageYsize, imageNc, imageDpi, dpiList, dpiNum);
     if (imageSet == NULL)
     {
         ARLOGe("ImageSet generation error!!\n");
-        EXIT(E_DATA_PROCESSING_ERROR);
+        return (E_DATA_PROCESSING_ERROR);
     }
 
     ARLOGi("  Done.\n");
-    ar2UtilRemoveExt(filename);
-    ARLOGi("Saving to %s.iset...\n", filename);
-    if (ar2WriteImageSet(filename, imageSet) < 0)
+    ARLOGi("Saving to %s.iset...\n", basename);
+    if (ar2WriteImageSet((char*)basename, imageSet) < 0)
     {
-        ARLOGe("Save error: %s.iset\n", filename);
-        EXIT(E_DATA_PROCESSING_ERROR);
+        ARLOGe("Save error: %s.iset\n", basename);
+        goto bail;
     }
 
     ARLOGi("  Done.\n");
+    times[GEN_STAGE_IMAGESET] = arUtilTimer() - t0;
 
     if (genfset)
     {
         arMalloc(featureSet, AR2FeatureSetT, 1);                        // A featureSet with a single image,
         arMalloc(featureSet->list, AR2FeaturePointsT, imageSet->num);   // and with 'num' scale levels of this image.
         featureSet->num = imageSet->num;
+        for (i = 0; i < featureSet->num; i++)
+        {
+            featureSet->list[i].coord = NULL;
+            featureSet->list[i].num   = 0;
+        }
 
         ARLOGi("Generating FeatureList...\n");
 
@@ -554,26 +1294,27 @@ int main(int argc, char *argv[])
         {
             ARLOGi("Start for %f dpi image.\n", imageSet->scale[i]->dpi);
 
-            featureMap = ar2GenFeatureMap(imageSet->scale[i],
-                                          AR2_DEFAULT_TS1 * AR2_TEMP_SCALE, AR2_DEFAULT_TS2 * AR2_TEMP_SCALE,
-                                          AR2_DEFAULT_GEN_FEATURE_MAP_SEARCH_SIZE1, AR2_DEFAULT_GEN_FEATURE_MAP_SEARCH_SIZE2,
-                                          AR2_DEFAULT_MAX_SIM_THRESH2, AR2_DEFAULT_SD_THRESH2);
+            t0         = arUtilTimer();
+            featureMap = ar2GenFeatureMap2(imageSet->scale[i],
+                                           AR2_DEFAULT_TS1 * AR2_TEMP_SCALE, AR2_DEFAULT_TS2 * AR2_TEMP_SCALE,
+                                           AR2_DEFAULT_GEN_FEATURE_MAP_SEARCH_SIZE1, AR2_DEFAULT_GEN_FEATURE_MAP_SEARCH_SIZE2,
+                                           AR2_DEFAULT_MAX_SIM_THRESH2, AR2_DEFAULT_SD_THRESH2, featureMapThreads);
+            times[GEN_STAGE_FEATUREMAP] += arUtilTimer() - t0;
             if (featureMap == NULL)
             {
                 ARLOGe("Error!!\n");
-                EXIT(E_DATA_PROCESSING_ERROR);
+                goto bail;
             }
 
             ARLOGi("  Done.\n");
 
-
+            t0                        = arUtilTimer();
             featureSet->list[i].coord = ar2SelectFeature2(imageSet->scale[i], featureMap,
                                                           AR2_DEFAULT_TS1 * AR2_TEMP_SCALE, AR2_DEFAULT_TS2 * AR2_TEMP_SCALE, AR2_DEFAULT_GEN_FEATURE_MAP_SEARCH_SIZE2,
                                                           occ_size,
                                                           max_thresh, min_thresh, sd_thresh, &num);
             if (featureSet->list[i].coord == NULL)
                 num = 0;
-
             featureSet->list[i].num   = num;
             featureSet->list[i].scale = i;
 
@@ -628,24 +1369,30 @@ int main(int argc, char *argv[])
                 featureSet->list[i].maxdpi = scale2 * 0.8f + scale1 * 0.2f;
             }
 
+
+            times[GEN_STAGE_FEATURESET] += arUtilTimer() - t0;
+
             ar2FreeFeatureMap(featureMap);
         }
 
         ARLOGi("  Done.\n");
 
+        t0 = arUtilTimer();
         ARLOGi("Saving FeatureSet...\n");
-        if (ar2SaveFeatureSet(filename, "fset", featureSet) < 0)
+        if (ar2SaveFeatureSet((char*)basename, "fset", featureSet) < 0)
         {
-            ARLOGe("Save error: %s.fset\n", filename);
-            EXIT(E_DATA_PROCESSING_ERROR);
+            ARLOGe("Save error: %s.fset\n", basename);
+            goto bail;
         }
 
         ARLOGi("  Done.\n");
         ar2FreeFeatureSet(&featureSet);
+        times[GEN_STAGE_FEATURESET] += arUtilTimer() - t0;
     }
 
     if (genfset3)
     {
+        t0 = arUtilTimer();
         ARLOGi("Generating FeatureSet3...\n");
         refDataSet = NULL;
         procMode   = KpmProcFullSize;
@@ -669,143 +1416,37 @@ int main(int argc, char *argv[])
                     procMode, KpmCompNull, maxFeatureNum, 1, i, &refDataSet) < 0)                  // Page number set to 1 by default.
             {
                 ARLOGe("Error at kpmAddRefDataSet.\n");
-                EXIT(E_DATA_PROCESSING_ERROR);
+                goto bail;
             }
         }
 
         ARLOGi("  Done.\n");
         ARLOGi("Saving FeatureSet3...\n");
-        if (kpmSaveRefDataSet(filename, "fset3", refDataSet) != 0)
+        if ((genfset3Indexed ? kpmSaveRefDataSetIndexed(basename, "fset3", refDataSet) : kpmSaveRefDataSet(basename, "fset3", refDataSet)) != 0)
         {
-            ARLOGe("Save error: %s.fset2\n", filename);
-            EXIT(E_DATA_PROCESSING_ERROR);
+            ARLOGe("Save error: %s.fset3\n", basename);
+            goto bail;
         }
 
         ARLOGi("  Done.\n");
         kpmDeleteRefDataSet(&refDataSet);
+        times[GEN_STAGE_KPM] = arUtilTimer() - t0;
     }
 
     ar2FreeImageSet(&imageSet);
 
-    // Print the start date and time.
-    clock = time(NULL);
-    if (clock != (time_t)-1)
-    {
-        struct tm *timeptr = localtime(&clock);
-        if (timeptr)
-        {
-            char stime[26 + 8] = "";
-            if (strftime(stime, sizeof(stime), "%Y-%m-%d %H:%M:%S %z", timeptr)) // e.g. "1999-12-31 23:59:59 NZDT".
-                ARLOGi("Generator finished at %s\n--\n", stime);
-        }
-    }
-
-    exitcode = E_NO_ERROR;
-    return (exitcode);
-}
-
-// Reads dpiMinAllowable, xsize, ysize, dpi, background, dpiMin, dpiMax.
-// Sets dpiMin, dpiMax, dpi_num, dpi_list.
-static int setDPI(void)
-{
-    float dpiWork, dpiMinAllowable;
-    char  buf1[256];
-    int   i;
-
-    // Determine minimum allowable DPI, truncated to 3 decimal places.
-    dpiMinAllowable = truncf(((float)KPM_MINIMUM_IMAGE_SIZE / (float)(MIN(xsize, ysize))) * dpi * 1000.0) / 1000.0f;
-
-    if (background)
-    {
-        if (dpiMin == -1.0f)
-            dpiMin = dpiMinAllowable;
-
-        if (dpiMax == -1.0f)
-            dpiMax = dpi;
-    }
-
-    if (dpiMin == -1.0f)
-    {
-        for (;;)
-        {
-            printf("Enter the minimum image resolution (DPI, in range [%.3f, %.3f]): ", dpiMinAllowable, (dpiMax == -1.0f ? dpi : dpiMax));
-            if (fgets(buf1, 256, stdin) == NULL)
-                EXIT(E_USER_INPUT_CANCELLED);
-
-            if (sscanf(buf1, "%f", &dpiMin) == 0)
-                continue;
-
-            if (dpiMin >= dpiMinAllowable && dpiMin <= (dpiMax == -1.0f ? dpi : dpiMax))
-                break;
-            else
-                printf("Error: you entered %.3f, but value must be greater than or equal to %.3f and less than or equal to %.3f.\n", dpiMin, dpiMinAllowable, (dpiMax == -1.0f ? dpi : dpiMax));
-        }
-    }
-    else if (dpiMin < dpiMinAllowable)
-    {
-        ARLOGe("Warning: -min_dpi=%.3f smaller than minimum allowable. Value will be adjusted to %.3f.\n", dpiMin, dpiMinAllowable);
-        dpiMin = dpiMinAllowable;
-    }
-
-    if (dpiMax == -1.0f)
-    {
-        for (;;)
-        {
-            printf("Enter the maximum image resolution (DPI, in range [%.3f, %.3f]): ", dpiMin, dpi);
-            if (fgets(buf1, 256, stdin) == NULL)
-                EXIT(E_USER_INPUT_CANCELLED);
-
-            if (sscanf(buf1, "%f", &dpiMax) == 0)
-                continue;
-
-            if (dpiMax >= dpiMin && dpiMax <= dpi)
-                break;
-            else
-                printf("Error: you entered %.3f, but value must be greater than or equal to minimum resolution (%.3f) and less than or equal to image resolution (%.3f).\n", dpiMax, dpiMin, dpi);
-        }
-    }
-    else if (dpiMax > dpi)
-    {
-        ARLOGe("Warning: -max_dpi=%.3f larger than maximum allowable. Value will be adjusted to %.3f.\n", dpiMax, dpi);
-        dpiMax = dpi;
-    }
-
-    // Decide how many levels we need.
-    if (dpiMin == dpiMax)
-    {
-        dpi_num = 1;
-    }
-    else
-    {
-        dpiWork = dpiMin;
-
-        for (i = 1;; i++)
-        {
-            dpiWork *= powf(2.0f, 1.0f / 3.0f); // *= 1.25992104989487
-            if (dpiWork >= dpiMax * 0.95f)
-            {
-                break;
-            }
-        }
-
-        dpi_num = i + 1;
-    }
+    return (E_NO_ERROR);
 
-    arMalloc(dpi_list, float, dpi_num);
+bail:
+    if (featureSet)
+        ar2FreeFeatureSet(&featureSet);
 
-    // Determine the DPI values of each level.
-    dpiWork = dpiMin;
+    if (refDataSet)
+        kpmDeleteRefDataSet(&refDataSet);
 
-    for (i = 0; i < dpi_num; i++)
-    {
-        ARLOGi("Image DPI (%d): %f\n", i + 1, dpiWork);
-        dpi_list[dpi_num - i - 1] = dpiWork; // Lowest value goes at tail of array, highest at head.
-        dpiWork                  *= powf(2.0f, 1.0f / 3.0f);
-        if (dpiWork >= dpiMax * 0.95f)
-            dpiWork = dpiMax;
-    }
+    ar2FreeImageSet(&imageSet);
 
-    return 0;
+    return (E_DATA_PROCESSING_ERROR);
 }
 
 static void usage(char *com)
@@ -813,6 +1454,7 @@ static void usage(char *com)
     if (!background)
     {
         ARLOG("%s <filename>\n", com);
+        ARLOG("%s -batch=<manifest> [-outdir=<path>]\n", com);
         ARLOG("    -level=n\n"
               "         (n is an integer in range 0 (few) to 4 (many). Default %d.'\n", TRACKING_EXTRACTION_LEVEL_DEFAULT);
         ARLOG("    -sd_thresh=<sd_thresh>\n");
@@ -824,6 +1466,18 @@ static void usage(char *com)
         ARLOG("    -dpi=f: Override embedded JPEG DPI value.\n");
         ARLOG("    -max_dpi=<max_dpi>\n");
         ARLOG("    -min_dpi=<min_dpi>\n");
+        ARLOG("    -batch=<manifest>\n");
+        ARLOG("         Generate datasets for all the JPEG images listed in file 'manifest', one per line, each optionally followed by its DPI.\n");
+        ARLOG("    -outdir=<path>\n");
+        ARLOG("         Directory into which batch datasets are written. Default is the current directory.\n");
+        ARLOG("    -jobs=n\n");
+        ARLOG("         Number of images to process concurrently in batch mode. Default is one per CPU.\n");
+        ARLOG("    -max_memory=n\n");
+        ARLOG("         Approximate memory limit in megabytes for concurrent batch jobs, or 0 for no limit. Default %d.\n", GEN_BATCH_MAX_MEMORY_DEFAULT);
+        ARLOG("    -fset3_indexed\n");
+        ARLOG("         Save the .fset3 in the indexed format, which loads faster but cannot be read by ARToolKit versions up to 5.3.2. Default is the legacy format.\n");
+        ARLOG("    -force\n");
+        ARLOG("         Regenerate batch datasets even if their image and settings are unchanged.\n");
         ARLOG("    -background\n");
         ARLOG("         Run in background, i.e. as daemon detached from controlling terminal. (Mac OS X and Linux only.)\n");
         ARLOG("    -log=<path>\n");